@@ -0,0 +1,366 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+#else
+#include <driver/gpio.h>
+#include <driver/i2c.h>
+#include <esp_cpu.h>
+#include <esp_matter.h>
+#include <esp_rom_sys.h>
+#endif
+
+#include "app_bench.h"
+
+static const char *TAG = "app_bench";
+
+#define TIMER_BENCH_DELAY_US    1000
+#define SHTC3_ADDR              0x70
+#define SHTC3_I2C_PORT          I2C_NUM_0
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    double sum;
+    double sum_sq;
+} bench_acc_t;
+
+// Raw tick source: CPU cycles on the device, nanoseconds on the host. Only differences are used,
+// so the 32-bit wrap is harmless for anything shorter than a few seconds.
+static inline uint32_t bench_ticks(void)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#else
+    return esp_cpu_get_cycle_count();
+#endif
+}
+
+static inline uint32_t bench_ticks_to_ns(uint32_t ticks)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    return ticks;
+#else
+    return (uint32_t)((uint64_t)ticks * 1000 / esp_rom_get_cpu_ticks_per_us());
+#endif
+}
+
+static void acc_add(bench_acc_t *acc, uint32_t ns)
+{
+    if (acc->count == 0 || ns < acc->min_ns) {
+        acc->min_ns = ns;
+    }
+    if (ns > acc->max_ns) {
+        acc->max_ns = ns;
+    }
+    acc->sum += ns;
+    acc->sum_sq += (double)ns * ns;
+    acc->count++;
+}
+
+static void acc_result(const bench_acc_t *acc, app_bench_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    if (acc->count == 0) {
+        return;
+    }
+    double mean = acc->sum / acc->count;
+    double variance = acc->sum_sq / acc->count - mean * mean;
+    result->iterations = acc->count;
+    result->mean_ns = (uint32_t)mean;
+    result->min_ns = acc->min_ns;
+    result->max_ns = acc->max_ns;
+    result->stddev_ns = variance > 0 ? (uint32_t)sqrt(variance) : 0;
+}
+
+/* ---------------------------------- timer --------------------------------- */
+
+typedef struct {
+    TaskHandle_t waiter;
+    int64_t fired_us;
+} timer_bench_t;
+
+static void timer_bench_cb(void *arg)
+{
+    timer_bench_t *bench = (timer_bench_t *)arg;
+    bench->fired_us = esp_timer_get_time();
+    xTaskNotifyGive(bench->waiter);
+}
+
+static esp_err_t bench_timer(uint32_t iterations, bench_acc_t *acc)
+{
+    timer_bench_t bench = {
+        .waiter = xTaskGetCurrentTaskHandle(),
+        .fired_us = 0,
+    };
+    esp_timer_create_args_t timer_args = {
+        .callback = timer_bench_cb,
+        .arg = &bench,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "bench",
+        .skip_unhandled_events = false,
+    };
+    esp_timer_handle_t timer;
+    esp_err_t err = esp_timer_create(&timer_args, &timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (uint32_t i = 0; i < iterations && err == ESP_OK; i++) {
+        int64_t due_us = esp_timer_get_time() + TIMER_BENCH_DELAY_US;
+        err = esp_timer_start_once(timer, TIMER_BENCH_DELAY_US);
+        if (err == ESP_OK && ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0) {
+            err = ESP_ERR_TIMEOUT;
+        }
+        if (err == ESP_OK) {
+            acc_add(acc, (uint32_t)((bench.fired_us - due_us) * 1000));
+        }
+    }
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    return err;
+}
+
+/* ---------------------------------- queue --------------------------------- */
+
+typedef struct {
+    QueueHandle_t request;
+    QueueHandle_t reply;
+} queue_bench_t;
+
+static void queue_echo_task(void *arg)
+{
+    queue_bench_t *bench = (queue_bench_t *)arg;
+    uint32_t value;
+    // A zero value ends the benchmark
+    while (xQueueReceive(bench->request, &value, portMAX_DELAY) == pdTRUE && value != 0) {
+        xQueueSend(bench->reply, &value, portMAX_DELAY);
+    }
+    xQueueSend(bench->reply, &value, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t bench_queue(uint32_t iterations, bench_acc_t *acc)
+{
+    queue_bench_t bench = {
+        .request = xQueueCreate(1, sizeof(uint32_t)),
+        .reply = xQueueCreate(1, sizeof(uint32_t)),
+    };
+    esp_err_t err = ESP_OK;
+    if (!bench.request || !bench.reply ||
+        xTaskCreate(queue_echo_task, "bench_echo", 2048, &bench, uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+        err = ESP_ERR_NO_MEM;
+    }
+
+    for (uint32_t i = 1; i <= iterations && err == ESP_OK; i++) {
+        uint32_t value;
+        uint32_t start = bench_ticks();
+        xQueueSend(bench.request, &i, portMAX_DELAY);
+        if (xQueueReceive(bench.reply, &value, pdMS_TO_TICKS(100)) != pdTRUE) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        acc_add(acc, bench_ticks_to_ns(bench_ticks() - start));
+    }
+
+    if (bench.request && bench.reply && err != ESP_ERR_NO_MEM) {
+        uint32_t stop = 0;
+        uint32_t value;
+        xQueueSend(bench.request, &stop, portMAX_DELAY);
+        xQueueReceive(bench.reply, &value, portMAX_DELAY);
+    }
+    if (bench.request) {
+        vQueueDelete(bench.request);
+    }
+    if (bench.reply) {
+        vQueueDelete(bench.reply);
+    }
+    return err;
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+
+/* ---------------------------------- gpio ---------------------------------- */
+
+static esp_err_t bench_gpio(const app_bench_config_t *config, uint32_t iterations, bench_acc_t *acc)
+{
+    gpio_num_t gpio_num = (gpio_num_t)config->gpio_num;
+    esp_err_t err = gpio_reset_pin(gpio_num);
+    if (err == ESP_OK) {
+        err = gpio_set_direction(gpio_num, GPIO_MODE_OUTPUT);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t start = bench_ticks();
+        gpio_set_level(gpio_num, i & 1);
+        acc_add(acc, bench_ticks_to_ns(bench_ticks() - start));
+    }
+    gpio_set_level(gpio_num, 0);
+    return ESP_OK;
+}
+
+/* -------------------------------- attribute ------------------------------- */
+
+static esp_err_t bench_attribute(const app_bench_config_t *config, bool hold_lock, uint32_t iterations,
+                                 bench_acc_t *acc)
+{
+    esp_matter::attribute_t *attribute = esp_matter::attribute::get(config->endpoint_id, config->cluster_id,
+                                                                    config->attribute_id);
+    if (!attribute) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_matter_attr_val_t val;
+    esp_err_t err = esp_matter::attribute::get_val(attribute, &val);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // With the lock already held, the lock taken inside attribute::update() is a no-op
+    if (hold_lock) {
+        esp_matter::lock::chip_stack_lock(portMAX_DELAY);
+    }
+    for (uint32_t i = 0; i < iterations && err == ESP_OK; i++) {
+        uint32_t start = bench_ticks();
+        // The guard needs the lock too, so the per-call variant takes it here instead of
+        // inside attribute::update(); the sample still covers one lock and unlock
+        if (!hold_lock) {
+            esp_matter::lock::chip_stack_lock(portMAX_DELAY);
+        }
+        if (config->update_guard) {
+            config->update_guard(true);
+        }
+        err = esp_matter::attribute::update(config->endpoint_id, config->cluster_id, config->attribute_id, &val);
+        if (config->update_guard) {
+            config->update_guard(false);
+        }
+        if (!hold_lock) {
+            esp_matter::lock::chip_stack_unlock();
+        }
+        acc_add(acc, bench_ticks_to_ns(bench_ticks() - start));
+    }
+    if (hold_lock) {
+        esp_matter::lock::chip_stack_unlock();
+    }
+    return err;
+}
+
+/* ----------------------------------- i2c ---------------------------------- */
+
+#if CONFIG_SKULL_BENCH_SHTC3
+static esp_err_t bench_i2c(uint32_t iterations, bench_acc_t *acc)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = CONFIG_SHTC3_I2C_SDA_PIN,
+        .scl_io_num = CONFIG_SHTC3_I2C_SCL_PIN,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master = {.clk_speed = 400000},
+        .clk_flags = 0,
+    };
+    esp_err_t err = i2c_param_config(SHTC3_I2C_PORT, &conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // Reuse the bus if the sensor driver already installed it
+    bool installed = (i2c_driver_install(SHTC3_I2C_PORT, conf.mode, 0, 0, 0) == ESP_OK);
+
+    const uint8_t read_id[] = {0xEF, 0xC8};
+    for (uint32_t i = 0; i < iterations && err == ESP_OK; i++) {
+        uint8_t id[3];
+        uint32_t start = bench_ticks();
+        err = i2c_master_write_read_device(SHTC3_I2C_PORT, SHTC3_ADDR, read_id, sizeof(read_id), id, sizeof(id),
+                                           pdMS_TO_TICKS(50));
+        acc_add(acc, bench_ticks_to_ns(bench_ticks() - start));
+    }
+
+    if (installed) {
+        i2c_driver_delete(SHTC3_I2C_PORT);
+    }
+    return err;
+}
+#endif // CONFIG_SKULL_BENCH_SHTC3
+
+#endif // !CONFIG_IDF_TARGET_LINUX
+
+const char *app_bench_name(app_bench_id_t id)
+{
+    switch (id) {
+    case APP_BENCH_GPIO:        return "gpio";
+    case APP_BENCH_TIMER:       return "timer";
+    case APP_BENCH_ATTR:        return "attr";
+    case APP_BENCH_ATTR_LOCKED: return "attr_locked";
+    case APP_BENCH_QUEUE:       return "queue";
+    case APP_BENCH_I2C:         return "i2c";
+    default:                    return "?";
+    }
+}
+
+esp_err_t app_bench_run(app_bench_id_t id, const app_bench_config_t *config, uint32_t iterations,
+                        app_bench_result_t *result)
+{
+    if (!config || !result || iterations == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bench_acc_t acc = {};
+    esp_err_t err = ESP_ERR_NOT_SUPPORTED;
+    switch (id) {
+    case APP_BENCH_TIMER:
+        err = bench_timer(iterations, &acc);
+        break;
+    case APP_BENCH_QUEUE:
+        err = bench_queue(iterations, &acc);
+        break;
+#if !CONFIG_IDF_TARGET_LINUX
+    case APP_BENCH_GPIO:
+        err = bench_gpio(config, iterations, &acc);
+        break;
+    case APP_BENCH_ATTR:
+    case APP_BENCH_ATTR_LOCKED:
+        err = bench_attribute(config, id == APP_BENCH_ATTR_LOCKED, iterations, &acc);
+        break;
+#if CONFIG_SKULL_BENCH_SHTC3
+    case APP_BENCH_I2C:
+        err = bench_i2c(iterations, &acc);
+        break;
+#endif
+#endif
+    default:
+        if (id >= APP_BENCH_COUNT) {
+            err = ESP_ERR_INVALID_ARG;
+        }
+        break;
+    }
+
+    if (err != ESP_OK && err != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "%s benchmark stopped after %" PRIu32 " iterations: %s", app_bench_name(id), acc.count,
+                 esp_err_to_name(err));
+    }
+    acc_result(&acc, result);
+    return err;
+}
@@ -0,0 +1,67 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Microbenchmarks for the platform primitives on the trigger path.
+//
+// Each benchmark times every iteration individually and reports mean, min, max and standard
+// deviation in nanoseconds; for the timer benchmark the sample is the lateness of the callback
+// rather than the cost of the call. The timer and queue benchmarks also build for the Linux
+// target (the host tests run them that way), the GPIO, I2C and Matter ones return
+// ESP_ERR_NOT_SUPPORTED there.
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef enum {
+    APP_BENCH_GPIO = 0,         // gpio_set_level() toggle
+    APP_BENCH_TIMER,            // esp_timer one-shot lateness
+    APP_BENCH_ATTR,             // attribute::update(), taking the stack lock on every call
+    APP_BENCH_ATTR_LOCKED,      // attribute::update() with the stack lock already held
+    APP_BENCH_QUEUE,            // queue send to a task and back
+    APP_BENCH_I2C,              // SHTC3 read-ID transaction
+    APP_BENCH_COUNT,
+} app_bench_id_t;
+
+typedef struct {
+    // line toggled by APP_BENCH_GPIO; must not be wired to anything that reacts to it
+    int gpio_num = CONFIG_SKULL_BENCH_GPIO;
+    // attribute rewritten with its current value by the APP_BENCH_ATTR* benchmarks
+    uint16_t endpoint_id = 0;
+    uint32_t cluster_id = 0;
+    uint32_t attribute_id = 0;
+    // called with the stack lock held right before (true) and after (false) each of those
+    // updates, e.g. to mark the write as the firmware's own; its cost is part of the sample
+    void (*update_guard)(bool active) = nullptr;
+} app_bench_config_t;
+
+typedef struct {
+    uint32_t iterations;
+    uint32_t mean_ns;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    uint32_t stddev_ns;
+} app_bench_result_t;
+
+/**
+ * @brief Short name of a benchmark, as used by the console command.
+ */
+const char *app_bench_name(app_bench_id_t id);
+
+/**
+ * @brief Run one benchmark in the calling task.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if an argument is invalid.
+ * @return ESP_ERR_NOT_SUPPORTED if the benchmark is not available on this target/configuration.
+ * @return error in case of failure.
+ */
+esp_err_t app_bench_run(app_bench_id_t id, const app_bench_config_t *config, uint32_t iterations,
+                        app_bench_result_t *result);
@@ -0,0 +1,264 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <atomic>
+
+#include <driver/gpio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+
+#include "sdkconfig.h"
+
+#include "app_busy.h"
+
+static const char *TAG = "app_busy";
+
+#define EDGE_RING_SIZE  8   // power of two
+#define PEND_RETRY_US   (portTICK_PERIOD_MS * 1000)
+
+typedef struct {
+    int64_t time_us;
+    bool busy;
+} busy_edge_t;
+
+static app_busy_config_t s_config;
+static esp_timer_handle_t s_start_timer;
+static esp_timer_handle_t s_drain_retry_timer;  // hands the ring over again after a full timer queue
+
+// Edges captured by the ISR, drained by the timer task
+static busy_edge_t s_edges[EDGE_RING_SIZE];
+static volatile uint32_t s_edge_head;
+static uint32_t s_edge_tail;
+static volatile bool s_drain_pending;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// State machine; the fields below are shared with app_busy_note_trigger() under s_lock
+static std::atomic<bool> s_busy{false};
+static int64_t s_busy_since_us;
+static int64_t s_trigger_us;        // 0 when no trigger is waiting for the busy line
+static app_busy_stats_t s_stats;
+
+size_t app_busy_hist_bucket(uint32_t ms)
+{
+    size_t bucket = 0;
+    while (ms && bucket < APP_BUSY_HIST_BUCKETS - 1) {
+        ms >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void busy_notify(bool busy)
+{
+    if (s_config.state_cb) {
+        s_config.state_cb(busy, s_config.user_data);
+    }
+}
+
+void app_busy_handle_edge(bool busy, int64_t time_us)
+{
+    if (busy == s_busy.load(std::memory_order_relaxed)) {
+        return; // bounce, or an edge lost while the ring was full
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (busy) {
+        s_busy_since_us = time_us;
+        if (s_trigger_us != 0) {
+            s_stats.playbacks++;
+            s_stats.latency_hist[app_busy_hist_bucket((uint32_t)((time_us - s_trigger_us) / 1000))]++;
+            s_trigger_us = 0;
+        } else {
+            s_stats.unsolicited++;
+        }
+    } else {
+        s_stats.duration_hist[app_busy_hist_bucket((uint32_t)((time_us - s_busy_since_us) / 1000))]++;
+    }
+    s_busy.store(busy, std::memory_order_relaxed);
+    portEXIT_CRITICAL(&s_lock);
+
+    busy_notify(busy);
+}
+
+void app_busy_handle_timeout(void)
+{
+    bool expired = false;
+    portENTER_CRITICAL(&s_lock);
+    if (s_trigger_us != 0 && !s_busy.load(std::memory_order_relaxed)) {
+        s_trigger_us = 0;
+        s_stats.timeouts++;
+        expired = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (expired) {
+        busy_notify(false);
+    }
+}
+
+static void busy_drain(void *arg1, uint32_t arg2)
+{
+    s_drain_pending = false;
+    while (s_edge_tail != s_edge_head) {
+        busy_edge_t edge = s_edges[s_edge_tail % EDGE_RING_SIZE];
+        s_edge_tail++;
+        app_busy_handle_edge(edge.busy, edge.time_us);
+    }
+}
+
+static void busy_pended_timeout(void *arg1, uint32_t arg2)
+{
+    busy_drain(NULL, 0); // an edge that raced the timeout wins
+    app_busy_handle_timeout();
+}
+
+static void IRAM_ATTR busy_count_pend_retry(void)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    s_stats.pend_retries++;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+static void IRAM_ATTR busy_isr(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool busy = gpio_get_level((gpio_num_t)s_config.gpio_num) == s_config.active_level;
+
+    portENTER_CRITICAL_ISR(&s_lock);
+    if (s_edge_head - s_edge_tail < EDGE_RING_SIZE) {
+        s_edges[s_edge_head % EDGE_RING_SIZE] = {.time_us = now_us, .busy = busy};
+        s_edge_head++;
+    }
+    bool kick = !s_drain_pending;
+    s_drain_pending = true;
+    portEXIT_CRITICAL_ISR(&s_lock);
+
+    if (kick) {
+        BaseType_t woken = pdFALSE;
+        if (xTimerPendFunctionCallFromISR(busy_drain, NULL, 0, &woken) != pdPASS) {
+            // The edges stay in the ring and s_drain_pending stays set until the retry gets through
+            busy_count_pend_retry();
+            esp_timer_start_once(s_drain_retry_timer, PEND_RETRY_US);
+        }
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+// The esp_timer callbacks below hand over to the timer task, which owns the state. They never
+// wait for room in its queue, which would hold up every other esp_timer; a full queue is
+// counted and tried again a tick later.
+static void busy_drain_retry_cb(void *arg)
+{
+    if (xTimerPendFunctionCall(busy_drain, NULL, 0, 0) != pdPASS) {
+        busy_count_pend_retry();
+        esp_timer_start_once(s_drain_retry_timer, PEND_RETRY_US);
+    }
+}
+
+static void busy_start_timer_cb(void *arg)
+{
+    if (xTimerPendFunctionCall(busy_pended_timeout, NULL, 0, 0) != pdPASS) {
+        busy_count_pend_retry();
+        esp_timer_start_once(s_start_timer, PEND_RETRY_US);
+    }
+}
+
+esp_err_t app_busy_init(const app_busy_config_t *config)
+{
+    if (!config || !GPIO_IS_VALID_GPIO(config->gpio_num) || config->start_timeout_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_start_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_config = *config;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = busy_start_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "busy_start",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_start_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    timer_args.callback = busy_drain_retry_cb;
+    timer_args.name = "busy_retry";
+    err = esp_timer_create(&timer_args, &s_drain_retry_timer);
+    if (err != ESP_OK) {
+        esp_timer_delete(s_start_timer);
+        s_start_timer = NULL;
+        return err;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << config->gpio_num,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = config->active_level ? GPIO_PULLUP_DISABLE : GPIO_PULLUP_ENABLE,
+        .pull_down_en = config->active_level ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    err = gpio_config(&io_conf);
+    if (err == ESP_OK) {
+        // The service may already be installed by another driver
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add((gpio_num_t)config->gpio_num, busy_isr, NULL);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up busy input on GPIO %d: %s", config->gpio_num, esp_err_to_name(err));
+        esp_timer_delete(s_drain_retry_timer);
+        esp_timer_delete(s_start_timer);
+        s_drain_retry_timer = NULL;
+        s_start_timer = NULL;
+        return err;
+    }
+
+    // Pick up a controller that is already playing at boot
+    s_busy.store(gpio_get_level((gpio_num_t)config->gpio_num) == config->active_level, std::memory_order_relaxed);
+    s_busy_since_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Busy input on GPIO %d (active %s), currently %s", config->gpio_num,
+             config->active_level ? "high" : "low", s_busy.load() ? "busy" : "idle");
+    return ESP_OK;
+}
+
+bool app_busy_is_busy(void)
+{
+    return s_busy.load(std::memory_order_relaxed);
+}
+
+void app_busy_note_trigger(int64_t now_us)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_trigger_us = now_us;
+    s_stats.triggers++;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (s_start_timer) {
+        esp_timer_stop(s_start_timer);
+        esp_timer_start_once(s_start_timer, (uint64_t)s_config.start_timeout_ms * 1000);
+    }
+}
+
+void app_busy_get_stats(app_busy_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,86 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Busy input from the animatronic controller.
+//
+// Edges on the busy line are timestamped in the GPIO ISR and handled in the FreeRTOS timer
+// task, which also handles the start timeout, so state callbacks come from a single task. The
+// state callback reports when playback starts and ends; if the controller does not go busy
+// within the start timeout of a trigger, the trigger is considered finished. Trigger-to-busy latency and playback duration are kept as log2 histograms.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_BUSY_HIST_BUCKETS   16  // bucket 0: < 1 ms, bucket n: [2^(n-1), 2^n) ms, last one open-ended
+
+// Called from the FreeRTOS timer task. busy == false also follows a start timeout.
+using app_busy_state_cb_t = void (*)(bool busy, void *user_data);
+
+typedef struct {
+    // GPIO connected to the busy line
+    int gpio_num;
+    // level of the line while the animatronic is playing
+    int active_level;
+    // a trigger not answered by busy within this time counts as finished
+    uint32_t start_timeout_ms;
+    // state change callback
+    app_busy_state_cb_t state_cb = NULL;
+    // user data
+    void *user_data = NULL;
+} app_busy_config_t;
+
+typedef struct {
+    uint32_t triggers;          // triggers announced with app_busy_note_trigger()
+    uint32_t playbacks;         // busy periods that followed a trigger
+    uint32_t unsolicited;       // busy periods without a trigger (e.g. the prop's own sensor)
+    uint32_t timeouts;          // triggers the controller never answered
+    uint32_t pend_retries;      // hand-offs to the timer task retried because its queue was full
+    uint32_t latency_hist[APP_BUSY_HIST_BUCKETS];   // trigger to busy, ms
+    uint32_t duration_hist[APP_BUSY_HIST_BUCKETS];  // busy to idle, ms
+} app_busy_stats_t;
+
+/**
+ * @brief Configure the busy input and start capturing edges. This function should be called only once.
+ *
+ * @param config input configuration. It is copied, so it does not need to outlive the call.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the config is invalid.
+ * @return error in case of failure.
+ */
+esp_err_t app_busy_init(const app_busy_config_t *config);
+
+/**
+ * @brief Whether the animatronic currently reports busy. Safe to call from any context.
+ */
+bool app_busy_is_busy(void);
+
+/**
+ * @brief Tell the input a trigger pulse has just been sent, to start latency measurement and
+ *        the start timeout.
+ */
+void app_busy_note_trigger(int64_t now_us);
+
+/**
+ * @brief Copy the counters and histograms.
+ */
+void app_busy_get_stats(app_busy_stats_t *stats);
+
+/**
+ * @brief Histogram bucket of a duration in milliseconds.
+ */
+size_t app_busy_hist_bucket(uint32_t ms);
+
+/**
+ * @brief State machine inputs, normally driven by the ISR and the start timer. Exposed for host
+ *        tests; callers must not run them concurrently.
+ */
+void app_busy_handle_edge(bool busy, int64_t time_us);
+void app_busy_handle_timeout(void);
@@ -0,0 +1,152 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <driver/uart.h>
+#include <driver/uart_vfs.h>
+#include <esp_console.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <linenoise/linenoise.h>
+
+#include "app_console.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "app_console";
+
+// The esp_console_new_repl_uart() defaults
+#define CONSOLE_TASK_STACK      4096
+#define CONSOLE_TASK_PRIORITY   2
+#define CONSOLE_LINE_MAX        256
+#define CONSOLE_RX_BUFFER       256
+#define CONSOLE_PROMPT          LOG_COLOR_I "esp> " LOG_RESET_COLOR
+
+static bool s_initialized;
+static std::atomic<size_t> s_history_len{0};    // requested; applied by the REPL task
+
+static void console_task(void *arg)
+{
+    // A terminal without escape sequence support (e.g. a plain serial logger) gets the dumb mode
+    if (linenoiseProbe() != 0) {
+        linenoiseSetDumbMode(1);
+    }
+    size_t applied_len = s_history_len.load(std::memory_order_relaxed);
+    for (;;) {
+        // Between lines, so linenoise() is not holding on to a history entry
+        size_t history_len = s_history_len.load(std::memory_order_relaxed);
+        if (history_len != applied_len && linenoiseHistorySetMaxLen((int)history_len)) {
+            applied_len = history_len;
+        }
+
+        char *line = linenoise(CONSOLE_PROMPT);
+        if (!line) {
+            continue;
+        }
+        if (line[0] != '\0') {
+            linenoiseHistoryAdd(line);
+        }
+        int ret;
+        esp_err_t err = esp_console_run(line, &ret);
+        if (err == ESP_ERR_NOT_FOUND) {
+            printf("Unrecognized command\n");
+        } else if (err == ESP_ERR_INVALID_ARG) {
+            // Command was empty
+        } else if (err == ESP_OK && ret != ESP_OK) {
+            printf("Command returned non-zero error code: 0x%x (%s)\n", ret, esp_err_to_name(ret));
+        } else if (err != ESP_OK) {
+            printf("Internal error: %s\n", esp_err_to_name(err));
+        }
+        linenoiseFree(line);
+    }
+}
+
+esp_err_t app_console_init(size_t history_len)
+{
+    if (s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (history_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Drain stdout before the driver takes the UART over
+    fflush(stdout);
+    fsync(fileno(stdout));
+    // Terminals send CR for Enter; move the caret to the start of the next line on '\n'
+    uart_vfs_dev_port_set_rx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_CR);
+    uart_vfs_dev_port_set_tx_line_endings(CONFIG_ESP_CONSOLE_UART_NUM, ESP_LINE_ENDINGS_CRLF);
+
+    uart_config_t uart_config = {};
+    uart_config.baud_rate = CONFIG_ESP_CONSOLE_UART_BAUDRATE;
+    uart_config.data_bits = UART_DATA_8_BITS;
+    uart_config.parity = UART_PARITY_DISABLE;
+    uart_config.stop_bits = UART_STOP_BITS_1;
+    // A clock that keeps the baud rate while the APB frequency changes in light sleep
+#if SOC_UART_SUPPORT_REF_TICK
+    uart_config.source_clk = UART_SCLK_REF_TICK;
+#elif SOC_UART_SUPPORT_XTAL_CLK
+    uart_config.source_clk = UART_SCLK_XTAL;
+#endif
+    esp_err_t err = uart_param_config(CONFIG_ESP_CONSOLE_UART_NUM, &uart_config);
+    if (err == ESP_OK) {
+        err = uart_driver_install(CONFIG_ESP_CONSOLE_UART_NUM, CONSOLE_RX_BUFFER, 0, 0, NULL, 0);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up UART%d, err:%d", CONFIG_ESP_CONSOLE_UART_NUM, err);
+        return err;
+    }
+    uart_vfs_dev_use_driver(CONFIG_ESP_CONSOLE_UART_NUM);
+
+    esp_console_config_t console_config = ESP_CONSOLE_CONFIG_DEFAULT();
+    console_config.max_cmdline_length = CONSOLE_LINE_MAX;
+#if CONFIG_LOG_COLORS
+    console_config.hint_color = atoi(LOG_COLOR_CYAN);
+#endif
+    err = esp_console_init(&console_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    linenoiseSetMultiLine(1);
+    linenoiseSetCompletionCallback(&esp_console_get_completion);
+    linenoiseSetHintsCallback((linenoiseHintsCallback *)&esp_console_get_hint);
+    linenoiseSetMaxLineLen(CONSOLE_LINE_MAX);
+    linenoiseAllowEmpty(false);
+    // The REPL task is not running yet, so the history can be sized here
+    linenoiseHistorySetMaxLen((int)history_len);
+    s_history_len.store(history_len, std::memory_order_relaxed);
+    s_initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t app_console_start(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = esp_console_register_help_command();
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (xTaskCreate(console_task, "console_repl", CONSOLE_TASK_STACK, NULL, CONSOLE_TASK_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void app_console_set_history_len(size_t history_len)
+{
+    if (history_len > 0) {
+        s_history_len.store(history_len, std::memory_order_relaxed);
+    }
+}
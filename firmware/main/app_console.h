@@ -0,0 +1,36 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Serial console on the console UART: esp_console commands behind a linenoise prompt.
+//
+// Same setup as esp_console_new_repl_uart(), but with a REPL loop of its own. linenoise keeps
+// its history in plain heap arrays that linenoise() uses while it waits for a line, so the
+// history is only ever resized by the REPL task, between two lines.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+
+/**
+ * @brief Install the UART driver for stdin/stdout and initialize esp_console and linenoise.
+ *        Commands can be registered once this returns. This function should be called only once.
+ *
+ * @param history_len lines of history kept.
+ */
+esp_err_t app_console_init(size_t history_len);
+
+/**
+ * @brief Register the help command and start the REPL task.
+ */
+esp_err_t app_console_start(void);
+
+/**
+ * @brief Change the number of history lines kept. Safe to call from any task; the REPL task
+ *        applies it before its next prompt, i.e. after the line being typed is entered.
+ */
+void app_console_set_history_len(size_t history_len);
@@ -0,0 +1,47 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_log.h>
+#include <esp_matter.h>
+
+#include "app_control_cluster.h"
+#include "app_settings.h"
+
+static const char *TAG = "app_control";
+
+using namespace esp_matter;
+
+cluster_t *app_control_cluster_create(endpoint_t *endpoint)
+{
+    cluster_t *cluster = cluster::create(endpoint, SkullControl::Id, CLUSTER_FLAG_SERVER);
+    if (!cluster) {
+        ESP_LOGE(TAG, "Failed to create control cluster");
+        return NULL;
+    }
+
+    cluster::global::attribute::create_cluster_revision(cluster, 1);
+    cluster::global::attribute::create_feature_map(cluster, 0);
+
+    // Writes are handled in app_attribute_update_cb(); the stored value is just the last request.
+    attribute::create(cluster, SkullControl::Attributes::TriggerDelay::Id, ATTRIBUTE_FLAG_WRITABLE,
+                      esp_matter_uint32(0));
+    attribute::create(cluster, SkullControl::Attributes::TriggerAtUtc::Id, ATTRIBUTE_FLAG_WRITABLE,
+                      esp_matter_uint64(0));
+    attribute::create(cluster, SkullControl::Attributes::TriggerPattern::Id, ATTRIBUTE_FLAG_WRITABLE,
+                      esp_matter_uint8(0));
+
+    // Seeded from the persisted setting; out-of-range writes are rejected by the bounds.
+    attribute_t *pulse_duration = attribute::create(cluster, SkullControl::Attributes::PulseDuration::Id,
+                                                    ATTRIBUTE_FLAG_WRITABLE,
+                                                    esp_matter_uint16(app_settings_get_pulse_ms()));
+    if (pulse_duration) {
+        attribute::add_bounds(pulse_duration, esp_matter_uint16(APP_SETTINGS_PULSE_MS_MIN),
+                              esp_matter_uint16(APP_SETTINGS_PULSE_MS_MAX));
+    }
+    return cluster;
+}
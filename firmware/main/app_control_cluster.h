@@ -0,0 +1,47 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Manufacturer-specific "Skull Switch Control" cluster, hosted on the switch endpoint.
+// Ids use the test vendor prefix (0xFFF1) in the manufacturer-specific cluster range.
+#pragma once
+
+#include <esp_matter.h>
+
+namespace SkullControl {
+
+static constexpr uint32_t Id = 0xFFF1FC00;
+
+namespace Attributes {
+// uint32, milliseconds. Writing it fires a pulse after the given delay.
+namespace TriggerDelay {
+static constexpr uint32_t Id = 0x0000;
+} // namespace TriggerDelay
+// uint64, Unix time in milliseconds. Writing it fires a pulse at that wall-clock time.
+namespace TriggerAtUtc {
+static constexpr uint32_t Id = 0x0001;
+} // namespace TriggerAtUtc
+// uint16, milliseconds (50-5000). Width of the trigger pulse, persisted across reboots.
+namespace PulseDuration {
+static constexpr uint32_t Id = 0x0002;
+} // namespace PulseDuration
+// uint8, pattern id (1-255). Writing it plays that pattern from the on-flash pattern library.
+namespace TriggerPattern {
+static constexpr uint32_t Id = 0x0003;
+} // namespace TriggerPattern
+} // namespace Attributes
+
+} // namespace SkullControl
+
+/** Create the Skull Switch Control cluster
+ *
+ * @param[in] endpoint Endpoint to add the cluster to.
+ *
+ * @return cluster handle on success.
+ * @return NULL in case of failure.
+ */
+esp_matter::cluster_t *app_control_cluster_create(esp_matter::endpoint_t *endpoint);
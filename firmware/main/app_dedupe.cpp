@@ -0,0 +1,102 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "app_dedupe.h"
+
+#define DEDUPE_WINDOW_US    ((int64_t)CONFIG_SKULL_DEDUPE_WINDOW_MS * 1000)
+
+typedef struct {
+    int64_t time_us;
+    uint16_t endpoint_id;
+    uint8_t fabric_index;
+    bool value;
+    bool in_use;
+} dedupe_entry_t;
+
+static dedupe_entry_t s_table[APP_DEDUPE_TABLE_SIZE];
+static uint8_t s_next;          // slot to overwrite next, oldest first
+
+static struct {
+    bool valid;
+    bool suppressed;
+    uint8_t entry;              // accepted: the new entry, suppressed: the entry it matched
+} s_pending;
+
+static app_dedupe_fabric_stats_t s_stats[APP_DEDUPE_MAX_FABRICS];
+
+bool app_dedupe_check(uint16_t endpoint_id, bool value, int64_t now_us)
+{
+    for (uint8_t i = 0; i < APP_DEDUPE_TABLE_SIZE; i++) {
+        const dedupe_entry_t &entry = s_table[i];
+        if (entry.in_use && entry.endpoint_id == endpoint_id && entry.value == value &&
+            now_us - entry.time_us < DEDUPE_WINDOW_US) {
+            s_pending = { .valid = true, .suppressed = true, .entry = i };
+            return true;
+        }
+    }
+
+    // An accepted change ends the window of the opposite value on the same endpoint, so
+    // ON, OFF, ON from different fabrics is three changes rather than ON, OFF, duplicate ON
+    for (dedupe_entry_t &entry : s_table) {
+        if (entry.in_use && entry.endpoint_id == endpoint_id && entry.value != value) {
+            entry.in_use = false;
+        }
+    }
+
+    uint8_t slot = s_next;
+    s_next = (s_next + 1) % APP_DEDUPE_TABLE_SIZE;
+    s_table[slot] = {
+        .time_us = now_us,
+        .endpoint_id = endpoint_id,
+        .fabric_index = 0,
+        .value = value,
+        .in_use = true,
+    };
+    s_pending = { .valid = true, .suppressed = false, .entry = slot };
+    return false;
+}
+
+void app_dedupe_commit(uint8_t fabric_index)
+{
+    if (fabric_index >= APP_DEDUPE_MAX_FABRICS) {
+        fabric_index = 0;
+    }
+    app_dedupe_fabric_stats_t &stats = s_stats[fabric_index];
+
+    if (!s_pending.valid) {
+        stats.unchanged++;
+        return;
+    }
+    dedupe_entry_t &entry = s_table[s_pending.entry];
+    if (s_pending.suppressed) {
+        stats.suppressed++;
+        if (entry.fabric_index != fabric_index) {
+            stats.cross_fabric++;
+        }
+    } else {
+        entry.fabric_index = fabric_index;
+        stats.accepted++;
+    }
+    s_pending.valid = false;
+}
+
+void app_dedupe_get_stats(uint8_t fabric_index, app_dedupe_fabric_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (fabric_index >= APP_DEDUPE_MAX_FABRICS) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = s_stats[fabric_index];
+}
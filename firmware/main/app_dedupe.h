@@ -0,0 +1,52 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Duplicate On/Off command suppression.
+//
+// A device commissioned into several ecosystems often receives the same automation once per
+// fabric, a few milliseconds apart. Recent accepted (endpoint, value, fabric, time) entries are
+// kept in a small fixed table and a repeat of the same endpoint/value inside the window is
+// collapsed into the first one. Accepting the opposite value drops the endpoint's entries, so
+// only an uninterrupted repeat counts as a duplicate.
+//
+// The attribute callback does not know which fabric the change came from, so the decision is
+// made first with app_dedupe_check() and the fabric is attached afterwards, from the command
+// callback that runs right after it on the Matter thread, with app_dedupe_commit(). All calls
+// must come from the Matter thread.
+#pragma once
+
+#include <stdint.h>
+
+#define APP_DEDUPE_TABLE_SIZE   8
+#define APP_DEDUPE_MAX_FABRICS  16  // fabric index 0 counts changes that did not come from a fabric
+
+typedef struct {
+    uint32_t accepted;      // commands that changed the state
+    uint32_t suppressed;    // duplicates collapsed into an earlier command
+    uint32_t cross_fabric;  // suppressed duplicates whose original came from another fabric
+    uint32_t unchanged;     // commands that did not change the attribute (e.g. ON while already ON)
+} app_dedupe_fabric_stats_t;
+
+/**
+ * @brief Decide whether an On/Off change is a duplicate of a recent one.
+ *
+ * @return true if the change should be suppressed.
+ */
+bool app_dedupe_check(uint16_t endpoint_id, bool value, int64_t now_us);
+
+/**
+ * @brief Attribute the last decision to the fabric that sent the command.
+ *
+ * If no app_dedupe_check() happened for this command it is counted as unchanged.
+ */
+void app_dedupe_commit(uint8_t fabric_index);
+
+/**
+ * @brief Copy the counters for a fabric index.
+ */
+void app_dedupe_get_stats(uint8_t fabric_index, app_dedupe_fabric_stats_t *stats);
@@ -0,0 +1,112 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <app/InteractionModelEngine.h>
+#include <app/reporting/reporting.h>
+#include <esp_log.h>
+#include <esp_matter.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+#include <platform/PlatformManager.h>
+
+#include "sdkconfig.h"
+
+#include "app_diag_cluster.h"
+#include "app_stats.h"
+
+static const char *TAG = "app_diag";
+
+using namespace esp_matter;
+using namespace SkullDiagnostics::Attributes;
+
+static uint16_t s_endpoint_id;
+static app_stats_snapshot_t s_reported;     // values as of the last report check
+
+static uint32_t snapshot_value(const app_stats_snapshot_t &snapshot, uint32_t attribute_id)
+{
+    switch (attribute_id) {
+    case TotalTriggers::Id:         return snapshot.triggers;
+    case IgnoredTriggers::Id:       return snapshot.ignored;
+    case RateLimitedTriggers::Id:   return snapshot.rate_limited;
+    case LastTriggerLatency::Id:    return snapshot.last_latency_us;
+    case P99TriggerLatency::Id:     return snapshot.p99_latency_us;
+    case PirEdges::Id:              return snapshot.pir_edges;
+    case SensorReadErrors::Id:      return snapshot.sensor_errors;
+    case Uptime::Id:                return snapshot.uptime_s;
+    case ReportsSaved::Id:          return snapshot.reports_saved;
+    case ThermalThrottle::Id:       return snapshot.thermal_throttle;
+    default:                        return 0;
+    }
+}
+
+// Answers reads straight from the counters; nothing is stored in the attribute itself
+static esp_err_t diag_override_cb(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
+                                  uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+{
+    if (type != attribute::READ || !val) {
+        return ESP_OK;
+    }
+    app_stats_snapshot_t snapshot;
+    app_stats_snapshot(&snapshot);
+    *val = esp_matter_uint32(snapshot_value(snapshot, attribute_id));
+    return ESP_OK;
+}
+
+// Runs on the Matter thread
+static void diag_report_check(intptr_t arg)
+{
+    using chip::app::InteractionModelEngine;
+    using chip::app::ReadHandler;
+    if (InteractionModelEngine::GetInstance()->GetNumActiveReadHandlers(ReadHandler::InteractionType::Subscribe) == 0) {
+        return; // nobody is listening; a later subscription starts with a fresh read anyway
+    }
+
+    app_stats_snapshot_t snapshot;
+    app_stats_snapshot(&snapshot);
+    for (uint32_t attribute_id = TotalTriggers::Id; attribute_id <= ThermalThrottle::Id; attribute_id++) {
+        if (attribute_id != Uptime::Id &&
+            snapshot_value(snapshot, attribute_id) != snapshot_value(s_reported, attribute_id)) {
+            MatterReportingAttributeChangeCallback(s_endpoint_id, SkullDiagnostics::Id, attribute_id);
+        }
+    }
+    s_reported = snapshot;
+}
+
+static void diag_report_timer_cb(TimerHandle_t timer)
+{
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(diag_report_check, 0);
+}
+
+cluster_t *app_diag_cluster_create(endpoint_t *endpoint)
+{
+    cluster_t *cluster = cluster::create(endpoint, SkullDiagnostics::Id, CLUSTER_FLAG_SERVER);
+    if (!cluster) {
+        ESP_LOGE(TAG, "Failed to create diagnostics cluster");
+        return NULL;
+    }
+
+    cluster::global::attribute::create_cluster_revision(cluster, 1);
+    cluster::global::attribute::create_feature_map(cluster, 0);
+
+    for (uint32_t attribute_id = TotalTriggers::Id; attribute_id <= ThermalThrottle::Id; attribute_id++) {
+        attribute_t *attribute = attribute::create(cluster, attribute_id, ATTRIBUTE_FLAG_OVERRIDE, esp_matter_uint32(0));
+        if (!attribute) {
+            ESP_LOGE(TAG, "Failed to create diagnostics attribute 0x%04" PRIx32, attribute_id);
+            return NULL;
+        }
+        attribute::set_override_callback(attribute, diag_override_cb);
+    }
+    s_endpoint_id = endpoint::get_id(endpoint);
+
+    TimerHandle_t timer = xTimerCreate("diag_report", pdMS_TO_TICKS(CONFIG_SKULL_DIAG_REPORT_INTERVAL_MS),
+                                       pdTRUE /* periodic */, NULL, diag_report_timer_cb);
+    if (!timer || xTimerStart(timer, 0) != pdPASS) {
+        ESP_LOGW(TAG, "Diagnostics change reports disabled, reads still work");
+    }
+    return cluster;
+}
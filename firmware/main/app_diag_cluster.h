@@ -0,0 +1,75 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Manufacturer-specific "Skull Switch Diagnostics" cluster, hosted on the switch endpoint.
+//
+// Attributes are read-only and not stored: reads are answered from app_stats through an
+// override callback. Changes are only reported while at least one subscription exists, by
+// a periodic check that compares against the last reported values.
+#pragma once
+
+#include <esp_matter.h>
+
+namespace SkullDiagnostics {
+
+static constexpr uint32_t Id = 0xFFF1FC01;
+
+namespace Attributes {
+// uint32, pulses started since boot
+namespace TotalTriggers {
+static constexpr uint32_t Id = 0x0000;
+} // namespace TotalTriggers
+// uint32, triggers dropped as busy, playing or duplicate
+namespace IgnoredTriggers {
+static constexpr uint32_t Id = 0x0001;
+} // namespace IgnoredTriggers
+// uint32, triggers rejected by the rate limiter or the thermal cutoff
+namespace RateLimitedTriggers {
+static constexpr uint32_t Id = 0x0002;
+} // namespace RateLimitedTriggers
+// uint32, microseconds from trigger request to pulse start, last trigger
+namespace LastTriggerLatency {
+static constexpr uint32_t Id = 0x0003;
+} // namespace LastTriggerLatency
+// uint32, microseconds, 99th percentile since boot (histogram bucket upper bound)
+namespace P99TriggerLatency {
+static constexpr uint32_t Id = 0x0004;
+} // namespace P99TriggerLatency
+// uint32, PIR edges since boot
+namespace PirEdges {
+static constexpr uint32_t Id = 0x0005;
+} // namespace PirEdges
+// uint32, failed SHTC3 reads since boot
+namespace SensorReadErrors {
+static constexpr uint32_t Id = 0x0006;
+} // namespace SensorReadErrors
+// uint32, seconds since boot; never reported, only read
+namespace Uptime {
+static constexpr uint32_t Id = 0x0007;
+} // namespace Uptime
+// uint32, OnOff subscription reports avoided by coalescing short pulses
+namespace ReportsSaved {
+static constexpr uint32_t Id = 0x0008;
+} // namespace ReportsSaved
+// uint32, percent the trigger rate, duty budget and pulse width are derated for enclosure
+// temperature; 0 when cool, 100 at the cutoff
+namespace ThermalThrottle {
+static constexpr uint32_t Id = 0x0009;
+} // namespace ThermalThrottle
+} // namespace Attributes
+
+} // namespace SkullDiagnostics
+
+/** Create the Skull Switch Diagnostics cluster and start the subscription-gated report check
+ *
+ * @param[in] endpoint Endpoint to add the cluster to.
+ *
+ * @return cluster handle on success.
+ * @return NULL in case of failure.
+ */
+esp_matter::cluster_t *app_diag_cluster_create(esp_matter::endpoint_t *endpoint);
@@ -0,0 +1,389 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "sdkconfig.h"
+
+#include "app_evtlog.h"
+
+static const char *TAG = "app_evtlog";
+
+#define EVTLOG_PARTITION_LABEL      "evtlog"
+#define EVTLOG_SECTOR_SIZE          4096
+#define EVTLOG_MAGIC                0x474C5645  // "EVLG"
+#define EVTLOG_READ_CHUNK           16          // records read per flash access when scanning
+#define EVTLOG_TASK_STACK           2560
+#define EVTLOG_TASK_PRIORITY        1           // just above idle; flash erases must not delay triggers
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;       // increases by one every time a sector is (re)opened
+    uint16_t boot;      // boot that opened the sector
+    uint8_t reserved[6];
+} evtlog_sector_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;   // since boot
+    uint16_t boot;
+    uint8_t type;
+    uint8_t arg;
+    uint16_t value;
+    uint8_t reserved;
+    uint8_t crc;        // CRC-8 over the preceding bytes
+} evtlog_record_t;
+
+static_assert(sizeof(evtlog_sector_header_t) == 16, "sector header must stay 16 bytes");
+static_assert(sizeof(evtlog_record_t) == 12, "record must stay 12 bytes");
+
+#define EVTLOG_RECORDS_PER_SECTOR   ((EVTLOG_SECTOR_SIZE - sizeof(evtlog_sector_header_t)) / sizeof(evtlog_record_t))
+
+static const esp_partition_t *s_partition = NULL;
+static uint32_t s_sector_count;
+static uint32_t s_head_sector;      // sector currently appended to
+static uint32_t s_head_seq;
+static uint32_t s_head_slot;        // next free record slot in the head sector
+static uint16_t s_boot;
+
+static evtlog_record_t s_buffer[CONFIG_SKULL_EVTLOG_BUFFER_RECORDS];
+static uint32_t s_buffered;
+static bool s_flush_pending;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Records being written; static rather than on the stack of whichever task flushes
+static evtlog_record_t s_batch[CONFIG_SKULL_EVTLOG_BUFFER_RECORDS];
+static SemaphoreHandle_t s_flash_mutex;
+static TaskHandle_t s_task;
+static app_evtlog_stats_t s_stats;
+
+static const char *evtlog_type_str(uint8_t type)
+{
+    switch (type) {
+    case APP_EVTLOG_BOOT:               return "BOOT";
+    case APP_EVTLOG_TRIGGER:            return "TRIGGER";
+    case APP_EVTLOG_TRIGGER_IGNORED:    return "IGNORED";
+    case APP_EVTLOG_PIR_EDGE:           return "PIR_EDGE";
+    case APP_EVTLOG_SENSOR_FAULT:       return "SENSOR_FAULT";
+    default:                            return "UNKNOWN";
+    }
+}
+
+static uint8_t evtlog_record_crc(const evtlog_record_t *record)
+{
+    return esp_rom_crc8_le(0, (const uint8_t *)record, offsetof(evtlog_record_t, crc));
+}
+
+static bool evtlog_record_erased(const evtlog_record_t *record)
+{
+    const uint8_t *bytes = (const uint8_t *)record;
+    for (size_t i = 0; i < sizeof(*record); i++) {
+        if (bytes[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t evtlog_slot_offset(uint32_t sector, uint32_t slot)
+{
+    return sector * EVTLOG_SECTOR_SIZE + sizeof(evtlog_sector_header_t) + slot * sizeof(evtlog_record_t);
+}
+
+static bool evtlog_read_header(uint32_t sector, evtlog_sector_header_t *header)
+{
+    return esp_partition_read(s_partition, sector * EVTLOG_SECTOR_SIZE, header, sizeof(*header)) == ESP_OK &&
+           header->magic == EVTLOG_MAGIC;
+}
+
+// Walks the records of a sector until the first erased slot. Returns the index of that slot.
+template <typename Visitor>
+static uint32_t evtlog_scan_sector(uint32_t sector, Visitor visit)
+{
+    evtlog_record_t chunk[EVTLOG_READ_CHUNK];
+    for (uint32_t slot = 0; slot < EVTLOG_RECORDS_PER_SECTOR; slot += EVTLOG_READ_CHUNK) {
+        uint32_t count = EVTLOG_RECORDS_PER_SECTOR - slot;
+        count = count > EVTLOG_READ_CHUNK ? EVTLOG_READ_CHUNK : count;
+        if (esp_partition_read(s_partition, evtlog_slot_offset(sector, slot), chunk,
+                               count * sizeof(evtlog_record_t)) != ESP_OK) {
+            return slot;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (evtlog_record_erased(&chunk[i])) {
+                return slot + i;
+            }
+            // A record torn by a reset fails the CRC; it is skipped, not treated as the end.
+            visit(&chunk[i], evtlog_record_crc(&chunk[i]) == chunk[i].crc);
+        }
+    }
+    return EVTLOG_RECORDS_PER_SECTOR;
+}
+
+static esp_err_t evtlog_open_sector(uint32_t sector, uint32_t seq)
+{
+    esp_err_t err = esp_partition_erase_range(s_partition, sector * EVTLOG_SECTOR_SIZE, EVTLOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_stats.erases++;
+
+    // The magic goes in last, after the sequence number, so a reset anywhere in here leaves a
+    // sector that is not valid yet rather than one with a torn sequence number, and the next
+    // boot keeps appending to the previous one.
+    evtlog_sector_header_t header;
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = EVTLOG_MAGIC;
+    header.seq = seq;
+    header.boot = s_boot;
+    const size_t body = offsetof(evtlog_sector_header_t, seq);
+    err = esp_partition_write(s_partition, sector * EVTLOG_SECTOR_SIZE + body, (const uint8_t *)&header + body,
+                              sizeof(header) - body);
+    if (err == ESP_OK) {
+        err = esp_partition_write(s_partition, sector * EVTLOG_SECTOR_SIZE, &header, body);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_stats.bytes_written += sizeof(header);
+
+    s_head_sector = sector;
+    s_head_seq = seq;
+    s_head_slot = 0;
+    return ESP_OK;
+}
+
+esp_err_t app_evtlog_flush(void)
+{
+    if (!s_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_flash_mutex, portMAX_DELAY);
+
+    evtlog_record_t *batch = s_batch;
+    portENTER_CRITICAL(&s_lock);
+    uint32_t count = s_buffered;
+    memcpy(batch, s_buffer, count * sizeof(evtlog_record_t));
+    s_buffered = 0;
+    s_flush_pending = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    for (uint32_t i = 0; i < count; i++) {
+        batch[i].crc = evtlog_record_crc(&batch[i]);
+    }
+
+    // Each flush is one write per sector touched, so flash traffic scales with the batch,
+    // not with the number of events.
+    esp_err_t err = ESP_OK;
+    uint32_t done = 0;
+    while (done < count) {
+        if (s_head_slot >= EVTLOG_RECORDS_PER_SECTOR) {
+            err = evtlog_open_sector((s_head_sector + 1) % s_sector_count, s_head_seq + 1);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+        uint32_t n = count - done;
+        uint32_t space = EVTLOG_RECORDS_PER_SECTOR - s_head_slot;
+        n = n > space ? space : n;
+        err = esp_partition_write(s_partition, evtlog_slot_offset(s_head_sector, s_head_slot), &batch[done],
+                                  n * sizeof(evtlog_record_t));
+        if (err != ESP_OK) {
+            break;
+        }
+        s_head_slot += n;
+        s_stats.bytes_written += n * sizeof(evtlog_record_t);
+        done += n;
+    }
+    if (count > 0) {
+        s_stats.flushes++;
+    }
+
+    xSemaphoreGive(s_flash_mutex);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write %" PRIu32 " events: %s", count - done, esp_err_to_name(err));
+    }
+    return err;
+}
+
+// Owns the flash traffic of the log: commits when the threshold is hit, and at least every
+// flush interval. Sector erases take tens of milliseconds, so this runs at the lowest priority
+// instead of in the timer task that dispatches input edges.
+static void evtlog_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_SKULL_EVTLOG_FLUSH_INTERVAL_MS));
+        if (s_buffered > 0) {
+            app_evtlog_flush();
+        }
+    }
+}
+
+static void evtlog_shutdown_handler(void)
+{
+    app_evtlog_flush();
+}
+
+void IRAM_ATTR app_evtlog_append(app_evtlog_type_t type, uint8_t arg, uint16_t value)
+{
+    if (!s_partition) {
+        return;
+    }
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    bool kick = false;
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    if (s_buffered < CONFIG_SKULL_EVTLOG_BUFFER_RECORDS) {
+        evtlog_record_t *record = &s_buffer[s_buffered++];
+        record->time_ms = now_ms;
+        record->boot = s_boot;
+        record->type = (uint8_t)type;
+        record->arg = arg;
+        record->value = value;
+        record->reserved = 0;
+        s_stats.appended++;
+        if (s_buffered >= CONFIG_SKULL_EVTLOG_FLUSH_THRESHOLD && !s_flush_pending) {
+            s_flush_pending = true;
+            kick = true;
+        }
+    } else {
+        s_stats.dropped++;
+    }
+    portEXIT_CRITICAL_SAFE(&s_lock);
+
+    if (!kick || !s_task) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(s_task, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+uint32_t app_evtlog_dump(void)
+{
+    if (!s_partition) {
+        printf("Event log not available\n");
+        return 0;
+    }
+    app_evtlog_flush();
+
+    uint32_t printed = 0;
+    uint32_t corrupt = 0;
+    xSemaphoreTake(s_flash_mutex, portMAX_DELAY);
+    // Sectors are filled in ring order, so the one after the head is the oldest.
+    for (uint32_t i = 1; i <= s_sector_count; i++) {
+        uint32_t sector = (s_head_sector + i) % s_sector_count;
+        evtlog_sector_header_t header;
+        if (!evtlog_read_header(sector, &header)) {
+            continue;
+        }
+        evtlog_scan_sector(sector, [&](const evtlog_record_t *record, bool valid) {
+            if (!valid) {
+                corrupt++;
+                return;
+            }
+            printf("boot %5u +%10" PRIu32 " ms  %-12s arg=%u value=%u\n", record->boot, record->time_ms,
+                   evtlog_type_str(record->type), record->arg, record->value);
+            printed++;
+        });
+    }
+    xSemaphoreGive(s_flash_mutex);
+
+    printf("%" PRIu32 " events, %" PRIu32 " corrupt records skipped\n", printed, corrupt);
+    return printed;
+}
+
+void app_evtlog_get_stats(app_evtlog_stats_t *stats)
+{
+    if (stats) {
+        *stats = s_stats;
+    }
+}
+
+esp_err_t app_evtlog_init(void)
+{
+    if (s_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                                EVTLOG_PARTITION_LABEL);
+    if (!partition) {
+        ESP_LOGW(TAG, "No '%s' partition, event log disabled", EVTLOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_sector_count = partition->size / EVTLOG_SECTOR_SIZE;
+    if (s_sector_count < 2) {
+        ESP_LOGE(TAG, "Event log partition needs at least two sectors");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    s_flash_mutex = xSemaphoreCreateMutex();
+    if (!s_flash_mutex) {
+        ESP_LOGE(TAG, "Failed to allocate event log resources");
+        return ESP_ERR_NO_MEM;
+    }
+    s_partition = partition;
+
+    // The newest valid sector is the head; the boot counter continues from what it holds.
+    bool found = false;
+    uint16_t last_boot = 0;
+    for (uint32_t sector = 0; sector < s_sector_count; sector++) {
+        evtlog_sector_header_t header;
+        if (evtlog_read_header(sector, &header) && (!found || header.seq > s_head_seq)) {
+            found = true;
+            s_head_sector = sector;
+            s_head_seq = header.seq;
+            last_boot = header.boot;
+        }
+    }
+
+    esp_err_t err = ESP_OK;
+    if (found) {
+        s_head_slot = evtlog_scan_sector(s_head_sector, [&](const evtlog_record_t *record, bool valid) {
+            if (valid && record->boot > last_boot) {
+                last_boot = record->boot;
+            }
+        });
+        s_boot = last_boot + 1;
+    } else {
+        s_boot = 1;
+        err = evtlog_open_sector(0, 1);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to format event log: %s", esp_err_to_name(err));
+        s_partition = NULL;
+        return err;
+    }
+
+    esp_register_shutdown_handler(evtlog_shutdown_handler);
+    if (xTaskCreate(evtlog_task, "evtlog", EVTLOG_TASK_STACK, NULL, EVTLOG_TASK_PRIORITY, &s_task) != pdPASS) {
+        // Appends still land in RAM; they reach flash on dump or shutdown
+        ESP_LOGE(TAG, "Failed to start the event log task");
+    }
+
+    ESP_LOGI(TAG, "Event log: boot %u, sector %" PRIu32 "/%" PRIu32 ", slot %" PRIu32, s_boot, s_head_sector,
+             s_sector_count, s_head_slot);
+
+    // Commit the reset reason right away so crash loops are visible even if we die again soon.
+    app_evtlog_append(APP_EVTLOG_BOOT, (uint8_t)esp_reset_reason(), 0);
+    return app_evtlog_flush();
+}
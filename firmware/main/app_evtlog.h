@@ -0,0 +1,89 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Append-only event log on the "evtlog" flash partition.
+//
+// Events are packed into 12-byte records, buffered in RAM and committed in batches by a
+// low-priority task of the log's own, either periodically or once the buffer reaches a
+// threshold. Sectors are used as a ring: each one starts with a header carrying a sequence
+// number, and the oldest sector is erased when the newest fills up. Every record carries a CRC
+// so a write torn by a reset is skipped on read-back instead of corrupting the log.
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+typedef enum {
+    APP_EVTLOG_BOOT = 1,            // arg: esp_reset_reason_t
+    APP_EVTLOG_TRIGGER,             // arg: app_evtlog_source_t, value: pulse width in ms (high time for patterns)
+    APP_EVTLOG_TRIGGER_IGNORED,     // arg: app_evtlog_source_t, value: app_evtlog_ignore_reason_t
+    APP_EVTLOG_PIR_EDGE,            // arg: sensor index, value: new level
+    APP_EVTLOG_SENSOR_FAULT,        // arg: sensor id, value: low 16 bits of the esp_err_t
+} app_evtlog_type_t;
+
+typedef enum {
+    APP_EVTLOG_SRC_MATTER = 0,
+    APP_EVTLOG_SRC_SCHEDULED,
+    APP_EVTLOG_SRC_CONSOLE,
+    APP_EVTLOG_SRC_MOTION,
+    APP_EVTLOG_SRC_BUTTON,
+    APP_EVTLOG_SRC_HOST,            // binary host protocol (app_hostlink.h)
+} app_evtlog_source_t;
+
+typedef enum {
+    APP_EVTLOG_IGNORED_BUSY = 0,    // a pulse was already playing
+    APP_EVTLOG_IGNORED_DUPLICATE,   // same command already accepted inside the dedupe window
+    APP_EVTLOG_IGNORED_RATE,        // rate limiter bucket empty
+    APP_EVTLOG_IGNORED_DUTY,        // duty-cycle budget exhausted
+    APP_EVTLOG_IGNORED_PLAYING,     // the animatronic reports busy
+    APP_EVTLOG_IGNORED_THERMAL,     // the enclosure is over the thermal cutoff
+} app_evtlog_ignore_reason_t;
+
+typedef enum {
+    APP_EVTLOG_SENSOR_SHTC3 = 0,
+} app_evtlog_sensor_t;
+
+typedef struct {
+    uint32_t appended;      // records accepted into the RAM buffer
+    uint32_t dropped;       // records lost because the RAM buffer was full
+    uint32_t flushes;       // batches written to flash
+    uint32_t bytes_written; // payload bytes written to flash, headers included
+    uint32_t erases;        // sectors erased
+} app_evtlog_stats_t;
+
+/**
+ * @brief Mount the log partition, find the write position and log the reset reason.
+ *        This function should be called only once, after NVS/flash are up.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_NOT_FOUND if there is no "evtlog" partition.
+ * @return error in case of failure.
+ */
+esp_err_t app_evtlog_init(void);
+
+/**
+ * @brief Queue an event. Safe to call from tasks and ISRs; never touches flash.
+ */
+void app_evtlog_append(app_evtlog_type_t type, uint8_t arg, uint16_t value);
+
+/**
+ * @brief Write all buffered events to flash now. Must not be called from an ISR.
+ */
+esp_err_t app_evtlog_flush(void);
+
+/**
+ * @brief Print every valid record, oldest first, to stdout.
+ *
+ * @return number of records printed.
+ */
+uint32_t app_evtlog_dump(void);
+
+/**
+ * @brief Copy the log counters.
+ */
+void app_evtlog_get_stats(app_evtlog_stats_t *stats);
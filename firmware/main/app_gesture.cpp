@@ -0,0 +1,337 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <driver/gpio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+
+#include "sdkconfig.h"
+
+#include "app_gesture.h"
+
+static const char *TAG = "app_gesture";
+
+#define EDGE_RING_SIZE  16  // power of two
+#define PEND_RETRY_US   (portTICK_PERIOD_MS * 1000)
+
+typedef struct {
+    int64_t time_us;
+    bool pressed;
+} gesture_edge_t;
+
+static app_gesture_config_t s_config;
+static esp_timer_handle_t s_gap_timer;
+static esp_timer_handle_t s_long_timer;
+static esp_timer_handle_t s_settle_timer;
+static esp_timer_handle_t s_drain_retry_timer;  // hands the ring over again after a full timer queue
+
+// Edges captured by the ISR, drained by the timer task
+static gesture_edge_t s_edges[EDGE_RING_SIZE];
+static volatile uint32_t s_edge_head;
+static uint32_t s_edge_tail;
+static volatile bool s_drain_pending;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Classifier state, owned by the timer task
+static bool s_pressed;
+static bool s_settle;           // the line bounced and must be sampled again
+static bool s_long_held;        // APP_GESTURE_LONG_HOLD already reported for this press
+static uint8_t s_clicks;
+static int64_t s_last_edge_us;  // last accepted edge, 0 if none yet
+static int64_t s_first_press_us;
+static int64_t s_press_us;
+static int64_t s_release_us;
+
+// Read by app_gesture_get_stats() under s_lock
+static app_gesture_stats_t s_stats[APP_GESTURE_COUNT];
+static uint32_t s_pend_retries;
+
+const char *app_gesture_name(app_gesture_t gesture)
+{
+    switch (gesture) {
+    case APP_GESTURE_SINGLE:        return "single";
+    case APP_GESTURE_DOUBLE:        return "double";
+    case APP_GESTURE_TRIPLE:        return "triple";
+    case APP_GESTURE_LONG_HOLD:     return "long_hold";
+    case APP_GESTURE_LONG_PRESS:    return "long_press";
+    default:                        return "?";
+    }
+}
+
+static void gesture_emit(app_gesture_t gesture, int64_t press_us, int64_t time_us)
+{
+    uint32_t latency_us = (uint32_t)(time_us - press_us);
+    portENTER_CRITICAL(&s_lock);
+    app_gesture_stats_t *stats = &s_stats[gesture];
+    stats->count++;
+    stats->last_latency_us = latency_us;
+    if (latency_us > stats->max_latency_us) {
+        stats->max_latency_us = latency_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (s_config.cb) {
+        s_config.cb(gesture, press_us, s_config.user_data);
+    }
+}
+
+static void gesture_timer_start(esp_timer_handle_t timer, uint32_t ms)
+{
+    if (timer) {
+        esp_timer_stop(timer);
+        esp_timer_start_once(timer, (uint64_t)ms * 1000);
+    }
+}
+
+static void gesture_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer) {
+        esp_timer_stop(timer);
+    }
+}
+
+void app_gesture_handle_edge(bool pressed, int64_t time_us)
+{
+    if (pressed == s_pressed) {
+        return; // the matching edge was lost or dropped as bounce
+    }
+    if (s_last_edge_us != 0 && time_us - s_last_edge_us < (int64_t)s_config.debounce_ms * 1000) {
+        s_settle = true;
+        if (s_settle_timer && !esp_timer_is_active(s_settle_timer)) {
+            esp_timer_start_once(s_settle_timer, (uint64_t)s_config.debounce_ms * 1000 + 1000);
+        }
+        return;
+    }
+    s_pressed = pressed;
+    s_settle = false;
+    s_last_edge_us = time_us;
+
+    if (pressed) {
+        if (s_clicks == 0) {
+            s_first_press_us = time_us;
+        }
+        s_press_us = time_us;
+        s_long_held = false;
+        gesture_timer_stop(s_gap_timer);
+        gesture_timer_start(s_long_timer, s_config.long_press_ms);
+        return;
+    }
+
+    gesture_timer_stop(s_long_timer);
+    s_release_us = time_us;
+    if (s_long_held || time_us - s_press_us >= (int64_t)s_config.long_press_ms * 1000) {
+        // A long press ends the gesture, whatever clicks came before it
+        s_clicks = 0;
+        gesture_emit(APP_GESTURE_LONG_PRESS, s_press_us, time_us);
+        return;
+    }
+    if (++s_clicks == APP_GESTURE_MAX_CLICKS) {
+        // Nothing longer to wait for
+        s_clicks = 0;
+        gesture_emit(APP_GESTURE_TRIPLE, s_first_press_us, time_us);
+        return;
+    }
+    gesture_timer_start(s_gap_timer, s_config.click_gap_ms);
+}
+
+void app_gesture_handle_gap_expired(int64_t time_us)
+{
+    // Ignore an expiry that raced a newer click
+    if (s_pressed || s_clicks == 0 || time_us - s_release_us < (int64_t)s_config.click_gap_ms * 1000) {
+        return;
+    }
+    app_gesture_t gesture = (app_gesture_t)(APP_GESTURE_SINGLE + s_clicks - 1);
+    s_clicks = 0;
+    gesture_emit(gesture, s_first_press_us, time_us);
+}
+
+void app_gesture_handle_long_expired(int64_t time_us)
+{
+    if (!s_pressed || s_long_held || time_us - s_press_us < (int64_t)s_config.long_press_ms * 1000) {
+        return;
+    }
+    s_long_held = true;
+    gesture_emit(APP_GESTURE_LONG_HOLD, s_press_us, time_us);
+}
+
+static void gesture_drain(void *arg1, uint32_t arg2)
+{
+    s_drain_pending = false;
+    while (s_edge_tail != s_edge_head) {
+        gesture_edge_t edge = s_edges[s_edge_tail % EDGE_RING_SIZE];
+        s_edge_tail++;
+        app_gesture_handle_edge(edge.pressed, edge.time_us);
+    }
+}
+
+// The pended handlers drain first so an edge that raced the timer is seen before it
+static void gesture_pended_gap(void *arg1, uint32_t arg2)
+{
+    gesture_drain(NULL, 0);
+    app_gesture_handle_gap_expired(esp_timer_get_time());
+}
+
+static void gesture_pended_long(void *arg1, uint32_t arg2)
+{
+    gesture_drain(NULL, 0);
+    app_gesture_handle_long_expired(esp_timer_get_time());
+}
+
+static void gesture_pended_settle(void *arg1, uint32_t arg2)
+{
+    gesture_drain(NULL, 0);
+    if (s_settle) {
+        bool pressed = gpio_get_level((gpio_num_t)s_config.gpio_num) == s_config.active_level;
+        app_gesture_handle_edge(pressed, esp_timer_get_time());
+    }
+}
+
+static void IRAM_ATTR gesture_count_pend_retry(void)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    s_pend_retries++;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+static void IRAM_ATTR gesture_isr(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool pressed = gpio_get_level((gpio_num_t)s_config.gpio_num) == s_config.active_level;
+
+    portENTER_CRITICAL_ISR(&s_lock);
+    if (s_edge_head - s_edge_tail < EDGE_RING_SIZE) {
+        s_edges[s_edge_head % EDGE_RING_SIZE] = {.time_us = now_us, .pressed = pressed};
+        s_edge_head++;
+    }
+    bool kick = !s_drain_pending;
+    s_drain_pending = true;
+    portEXIT_CRITICAL_ISR(&s_lock);
+
+    if (kick) {
+        BaseType_t woken = pdFALSE;
+        if (xTimerPendFunctionCallFromISR(gesture_drain, NULL, 0, &woken) != pdPASS) {
+            // The edges stay in the ring and s_drain_pending stays set until the retry gets through
+            gesture_count_pend_retry();
+            esp_timer_start_once(s_drain_retry_timer, PEND_RETRY_US);
+        }
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+// Each esp_timer hands its handler over to the timer task, which owns the state
+typedef struct {
+    PendedFunction_t handler;
+    esp_timer_handle_t *timer;
+    const char *name;
+} gesture_timer_t;
+
+static const gesture_timer_t s_timers[] = {
+    {gesture_pended_gap, &s_gap_timer, "gesture_gap"},
+    {gesture_pended_long, &s_long_timer, "gesture_long"},
+    {gesture_pended_settle, &s_settle_timer, "gesture_settle"},
+    {gesture_drain, &s_drain_retry_timer, "gesture_retry"},
+};
+
+// Runs in the esp_timer task. It never waits for room in the timer task's queue, which would
+// hold up every other esp_timer; a full queue is counted and the same timer tried again a tick
+// later. The handlers check the elapsed time themselves, so a late one still decides right.
+static void gesture_timer_cb(void *arg)
+{
+    const gesture_timer_t *timer = (const gesture_timer_t *)arg;
+    if (xTimerPendFunctionCall(timer->handler, NULL, 0, 0) != pdPASS) {
+        gesture_count_pend_retry();
+        esp_timer_start_once(*timer->timer, PEND_RETRY_US);
+    }
+}
+
+static void gesture_timers_delete(void)
+{
+    for (const gesture_timer_t &timer : s_timers) {
+        if (*timer.timer) {
+            esp_timer_delete(*timer.timer);
+            *timer.timer = NULL;
+        }
+    }
+}
+
+esp_err_t app_gesture_init(const app_gesture_config_t *config)
+{
+    if (!config || !GPIO_IS_VALID_GPIO(config->gpio_num) || config->click_gap_ms == 0 ||
+        config->long_press_ms <= config->click_gap_ms) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_gap_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_config = *config;
+
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; err == ESP_OK && i < sizeof(s_timers) / sizeof(s_timers[0]); i++) {
+        esp_timer_create_args_t timer_args = {
+            .callback = gesture_timer_cb,
+            .arg = (void *)&s_timers[i],
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = s_timers[i].name,
+            .skip_unhandled_events = true,
+        };
+        err = esp_timer_create(&timer_args, s_timers[i].timer);
+    }
+    if (err != ESP_OK) {
+        gesture_timers_delete();
+        return err;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << config->gpio_num,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = config->active_level ? GPIO_PULLUP_DISABLE : GPIO_PULLUP_ENABLE,
+        .pull_down_en = config->active_level ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    err = gpio_config(&io_conf);
+    if (err == ESP_OK) {
+        // The service may already be installed by another driver
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add((gpio_num_t)config->gpio_num, gesture_isr, NULL);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up button on GPIO %d: %s", config->gpio_num, esp_err_to_name(err));
+        gesture_timers_delete();
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Button on GPIO %d: click gap %" PRIu32 " ms, long press %" PRIu32 " ms", config->gpio_num,
+             config->click_gap_ms, config->long_press_ms);
+    return ESP_OK;
+}
+
+esp_err_t app_gesture_get_stats(app_gesture_t gesture, app_gesture_stats_t *stats)
+{
+    if (gesture >= APP_GESTURE_COUNT || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats[gesture];
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+uint32_t app_gesture_pend_retries(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint32_t retries = s_pend_retries;
+    portEXIT_CRITICAL(&s_lock);
+    return retries;
+}
@@ -0,0 +1,94 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Click gestures on a push button.
+//
+// Button edges are timestamped in the GPIO ISR and classified in the FreeRTOS timer task; there
+// is no polling. Up to APP_GESTURE_MAX_CLICKS clicks separated by less than the click gap make
+// one gesture. A triple click is reported on its last release, single and double clicks once
+// the click gap has passed without another press. A press held for the long-press time is
+// announced while held and reported as a long press on release. Latency from the first press
+// of a gesture to its callback is recorded per gesture.
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+#define APP_GESTURE_MAX_CLICKS  3
+
+typedef enum {
+    APP_GESTURE_SINGLE = 0,
+    APP_GESTURE_DOUBLE,
+    APP_GESTURE_TRIPLE,
+    APP_GESTURE_LONG_HOLD,      // still held, long-press time reached
+    APP_GESTURE_LONG_PRESS,     // released after a long hold
+    APP_GESTURE_COUNT,
+} app_gesture_t;
+
+// Called from the FreeRTOS timer task. press_us is the esp_timer time of the first press of the
+// gesture, or of the held press for the long-press gestures.
+using app_gesture_cb_t = void (*)(app_gesture_t gesture, int64_t press_us, void *user_data);
+
+typedef struct {
+    // GPIO connected to the button
+    int gpio_num;
+    // level of the line while pressed; the opposite pull is enabled
+    int active_level;
+    // edges closer together than this are treated as bounce
+    uint32_t debounce_ms;
+    // longest release between two clicks of one gesture
+    uint32_t click_gap_ms;
+    // hold time of a long press
+    uint32_t long_press_ms;
+    // gesture callback
+    app_gesture_cb_t cb = NULL;
+    // user data
+    void *user_data = NULL;
+} app_gesture_config_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t last_latency_us;   // first press to callback
+    uint32_t max_latency_us;
+} app_gesture_stats_t;
+
+/**
+ * @brief Configure the button input and start capturing edges. This function should be called only once.
+ *
+ * @param config input configuration. It is copied, so it does not need to outlive the call.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the config is invalid.
+ * @return error in case of failure.
+ */
+esp_err_t app_gesture_init(const app_gesture_config_t *config);
+
+/**
+ * @brief Copy the counters of one gesture.
+ *
+ * @return ESP_ERR_INVALID_ARG if the gesture is out of range.
+ */
+esp_err_t app_gesture_get_stats(app_gesture_t gesture, app_gesture_stats_t *stats);
+
+/**
+ * @brief Hand-offs to the timer task retried because its queue was full.
+ */
+uint32_t app_gesture_pend_retries(void);
+
+/**
+ * @brief Short name of a gesture, e.g. "double".
+ */
+const char *app_gesture_name(app_gesture_t gesture);
+
+/**
+ * @brief Classifier inputs, normally driven by the ISR and the timers. Exposed for host tests;
+ *        callers must not run them concurrently.
+ */
+void app_gesture_handle_edge(bool pressed, int64_t time_us);
+void app_gesture_handle_gap_expired(int64_t time_us);
+void app_gesture_handle_long_expired(int64_t time_us);
@@ -0,0 +1,101 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include "app_heap.h"
+
+static const char *TAG = "app_heap";
+
+#define HEAP_CAPS   MALLOC_CAP_INTERNAL
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static app_heap_mark_t s_marks[APP_HEAP_MAX_MARKS];
+static size_t s_count;
+
+void app_heap_mark(const char *name, app_heap_mark_t *out)
+{
+    app_heap_mark_t mark = {
+        .name = name,
+        .time_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .free = (uint32_t)heap_caps_get_free_size(HEAP_CAPS),
+        .min_free = (uint32_t)heap_caps_get_minimum_free_size(HEAP_CAPS),
+        .largest = (uint32_t)heap_caps_get_largest_free_block(HEAP_CAPS),
+    };
+    ESP_LOGI(TAG, "%s: free %" PRIu32 ", min %" PRIu32 ", largest block %" PRIu32, name, mark.free, mark.min_free,
+             mark.largest);
+
+    portENTER_CRITICAL(&s_lock);
+    bool known = false;
+    for (size_t i = 0; i < s_count && !known; i++) {
+        known = (strcmp(s_marks[i].name, name) == 0);
+    }
+    if (!known && s_count < APP_HEAP_MAX_MARKS) {
+        s_marks[s_count++] = mark;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (out) {
+        *out = mark;
+    }
+}
+
+esp_err_t app_heap_find(const char *name, app_heap_mark_t *mark)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_lock);
+    for (size_t i = 0; i < s_count; i++) {
+        if (strcmp(s_marks[i].name, name) == 0) {
+            *mark = s_marks[i];
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return err;
+}
+
+esp_err_t app_heap_check_gain(const char *from, const char *to, int32_t min_bytes, int32_t *gain)
+{
+    app_heap_mark_t before;
+    app_heap_mark_t after;
+    if (app_heap_find(from, &before) != ESP_OK || app_heap_find(to, &after) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    int32_t change = (int32_t)(after.free - before.free);
+    if (gain) {
+        *gain = change;
+    }
+    return change >= min_bytes ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+void app_heap_dump(void)
+{
+    app_heap_mark_t marks[APP_HEAP_MAX_MARKS];
+    portENTER_CRITICAL(&s_lock);
+    size_t count = s_count;
+    memcpy(marks, s_marks, count * sizeof(marks[0]));
+    portEXIT_CRITICAL(&s_lock);
+
+    printf("%8s  %-20s %8s %8s %8s %8s\n", "ms", "mark", "free", "change", "min", "largest");
+    for (size_t i = 0; i < count; i++) {
+        int32_t change = i > 0 ? (int32_t)(marks[i].free - marks[i - 1].free) : 0;
+        printf("%8" PRIu32 "  %-20s %8" PRIu32 " %+8" PRId32 " %8" PRIu32 " %8" PRIu32 "\n", marks[i].time_ms,
+               marks[i].name, marks[i].free, change, marks[i].min_free, marks[i].largest);
+    }
+    printf("%8" PRIu32 "  %-20s %8u %8s %8u %8u\n", (uint32_t)(esp_timer_get_time() / 1000), "now",
+           (unsigned)heap_caps_get_free_size(HEAP_CAPS), "", (unsigned)heap_caps_get_minimum_free_size(HEAP_CAPS),
+           (unsigned)heap_caps_get_largest_free_block(HEAP_CAPS));
+}
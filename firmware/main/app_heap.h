@@ -0,0 +1,58 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Heap timeline: free, low-water and largest-block figures of the internal heap, sampled at
+// named points of the boot and commissioning sequence. The first sample of each name is kept,
+// later ones are logged only, so the timeline reads as "what the device went through".
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_HEAP_MAX_MARKS  12
+
+typedef struct {
+    const char *name;       // string literal passed to app_heap_mark()
+    uint32_t time_ms;       // since boot
+    uint32_t free;          // bytes
+    uint32_t min_free;      // low-water mark since boot
+    uint32_t largest;       // largest free block
+} app_heap_mark_t;
+
+/**
+ * @brief Sample the heap, log the figures and record them under `name`. Safe to call from any task.
+ *
+ * @param name string literal; it is stored, not copied.
+ * @param out  optional copy of the sample.
+ */
+void app_heap_mark(const char *name, app_heap_mark_t *out = NULL);
+
+/**
+ * @brief First recorded sample with this name.
+ *
+ * @return ESP_ERR_NOT_FOUND if no such mark was recorded.
+ */
+esp_err_t app_heap_find(const char *name, app_heap_mark_t *mark);
+
+/**
+ * @brief Free heap gained from the first `from` mark to the first `to` mark, checked against a
+ *        minimum. This is the post-commissioning check: "commissioned" to "ble released".
+ *
+ * @param gain optional, set whenever both marks were recorded. Negative when the heap shrank.
+ *
+ * @return ESP_OK if the gain is at least min_bytes.
+ * @return ESP_ERR_NOT_FOUND if either mark was not recorded.
+ * @return ESP_ERR_INVALID_SIZE if the gain is below min_bytes.
+ */
+esp_err_t app_heap_check_gain(const char *from, const char *to, int32_t min_bytes, int32_t *gain = NULL);
+
+/**
+ * @brief Print the timeline with the change from each mark to the next to stdout.
+ */
+void app_heap_dump(void);
@@ -0,0 +1,454 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <driver/uart.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "app_evtlog.h"
+#include "app_hostlink.h"
+#include "app_limiter.h"
+#include "app_pattern.h"
+#include "app_sched.h"
+#include "app_stats.h"
+
+static const char *TAG = "app_hostlink";
+
+#define RX_POLL_MS          100
+#define RX_CHUNK            128
+#define LOG_LINE_MAX        160     // on the stack of the logging task
+#define LOG_LOCK_WAIT_MS    20      // a log line is dropped rather than stall its task longer
+
+typedef enum {
+    PARSE_SOF = 0,
+    PARSE_LEN_LO,
+    PARSE_LEN_HI,
+    PARSE_BODY,
+} parse_state_t;
+
+// Allocated for the duration of a session only
+typedef struct {
+    app_hostlink_parser_t parser;
+    app_hostlink_frame_t request;
+    uint8_t response[APP_HOSTLINK_MAX_PAYLOAD];
+    app_stats_bucket_t buckets[APP_STATS_LATENCY_BUCKETS];
+} session_t;
+
+static app_hostlink_config_t s_config;
+static int s_uart_num = -1;             // set while a session owns the UART; written under s_tx_lock
+static SemaphoreHandle_t s_tx_lock;     // keeps response and log frames whole
+static std::atomic<bool> s_streaming{false};
+static std::atomic<uint8_t> s_log_seq{0};
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static app_hostlink_stats_t s_stats;
+
+uint16_t app_hostlink_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+bool app_hostlink_parse(app_hostlink_parser_t *parser, uint8_t byte, app_hostlink_frame_t *frame, uint32_t *errors)
+{
+    switch (parser->state) {
+    case PARSE_SOF:
+        if (byte == APP_HOSTLINK_SOF) {
+            parser->state = PARSE_LEN_LO;
+        } else if (errors) {
+            (*errors)++;
+        }
+        return false;
+
+    case PARSE_LEN_LO:
+        parser->buf[0] = byte;
+        parser->state = PARSE_LEN_HI;
+        return false;
+
+    case PARSE_LEN_HI:
+        parser->len = (uint16_t)(parser->buf[0] | (byte << 8));
+        if (parser->len < 2 || parser->len > APP_HOSTLINK_MAX_PAYLOAD + 2) {
+            parser->state = (byte == APP_HOSTLINK_SOF) ? PARSE_LEN_LO : PARSE_SOF;
+            if (errors) {
+                *errors += 3;
+            }
+            return false;
+        }
+        parser->buf[1] = byte;
+        parser->pos = 2;
+        parser->state = PARSE_BODY;
+        return false;
+
+    default:
+        parser->buf[parser->pos++] = byte;
+        // 2 length bytes + body + 2 CRC bytes
+        if (parser->pos < parser->len + 4) {
+            return false;
+        }
+        parser->state = PARSE_SOF;
+        size_t covered = parser->len + 2;
+        uint16_t crc = (uint16_t)((parser->buf[covered] << 8) | parser->buf[covered + 1]);
+        if (crc != app_hostlink_crc16(0xFFFF, parser->buf, covered)) {
+            if (errors) {
+                *errors += parser->pos + 1;
+            }
+            return false;
+        }
+        frame->seq = parser->buf[2];
+        frame->op = parser->buf[3];
+        frame->len = parser->len - 2;
+        memcpy(frame->payload, parser->buf + 4, frame->len);
+        return true;
+    }
+}
+
+static void put_u16(uint8_t *out, uint16_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *out, uint32_t value)
+{
+    put_u16(out, (uint16_t)value);
+    put_u16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *in)
+{
+    return get_u16(in) | ((uint32_t)get_u16(in + 2) << 16);
+}
+
+// Header, payload and CRC go out as three writes under the lock, so nothing needs a frame buffer
+static bool send_frame(uint8_t seq, uint8_t op, const uint8_t *payload, size_t len, TickType_t wait)
+{
+    uint8_t header[5] = {APP_HOSTLINK_SOF, 0, 0, seq, op};
+    put_u16(header + 1, (uint16_t)(len + 2));
+    uint16_t crc = app_hostlink_crc16(app_hostlink_crc16(0xFFFF, header + 1, 4), payload, len);
+    uint8_t trailer[2] = {(uint8_t)(crc >> 8), (uint8_t)crc};
+
+    if (xSemaphoreTake(s_tx_lock, wait) != pdTRUE) {
+        return false;
+    }
+    // A line logged just as the session ends is dropped
+    int uart_num = s_uart_num;
+    if (uart_num < 0) {
+        xSemaphoreGive(s_tx_lock);
+        return false;
+    }
+    uart_write_bytes(uart_num, header, sizeof(header));
+    if (len) {
+        uart_write_bytes(uart_num, payload, len);
+    }
+    uart_write_bytes(uart_num, trailer, sizeof(trailer));
+    xSemaphoreGive(s_tx_lock);
+    return true;
+}
+
+// Installed with esp_log_set_vprintf() for the duration of a session. Runs in whichever task logs.
+static int log_vprintf(const char *format, va_list args)
+{
+    if (!s_streaming.load(std::memory_order_relaxed)) {
+        portENTER_CRITICAL(&s_lock);
+        s_stats.log_dropped++;
+        portEXIT_CRITICAL(&s_lock);
+        return 0;
+    }
+    char line[LOG_LINE_MAX];
+    int len = vsnprintf(line, sizeof(line), format, args);
+    if (len <= 0) {
+        return len;
+    }
+    size_t n = (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1;
+    // One frame is one line; the host adds its own line ends
+    while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) {
+        n--;
+    }
+    bool sent = send_frame(s_log_seq.fetch_add(1, std::memory_order_relaxed), APP_HOSTLINK_OP_LOG_LINE,
+                           (const uint8_t *)line, n, pdMS_TO_TICKS(LOG_LOCK_WAIT_MS));
+    portENTER_CRITICAL(&s_lock);
+    if (sent) {
+        s_stats.log_lines++;
+    } else {
+        s_stats.log_dropped++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return len;
+}
+
+static void put_settings(uint8_t *out, const app_settings_t *settings)
+{
+    put_u16(out, settings->pulse_ms);
+    out[2] = (uint8_t)settings->signal_gpio;
+    put_u16(out + 3, settings->pir_hold_s);
+    put_u32(out + 5, settings->shtc3_interval_ms);
+}
+
+static void get_settings(const uint8_t *in, app_settings_t *settings)
+{
+    settings->pulse_ms = get_u16(in);
+    settings->signal_gpio = (int8_t)in[2];
+    settings->pir_hold_s = get_u16(in + 3);
+    settings->shtc3_interval_ms = get_u32(in + 5);
+}
+
+// STATS layout: the app_stats snapshot (10 x u32, in struct order), the signal limiter
+// (allowed, rejected_rate, rejected_duty u32, duty_permille, tokens u16), the scheduler
+// (scheduled, fired, late, dropped u32, max_lag_us i32) and the event log (appended, dropped u32).
+static size_t put_stats(uint8_t *out)
+{
+    uint8_t *p = out;
+    app_stats_snapshot_t stats;
+    app_stats_snapshot(&stats);
+    const uint32_t counters[] = {stats.triggers, stats.ignored, stats.rate_limited, stats.last_latency_us,
+                                 stats.p99_latency_us, stats.pir_edges, stats.sensor_errors, stats.uptime_s,
+                                 stats.reports_saved, stats.thermal_throttle};
+    for (uint32_t value : counters) {
+        put_u32(p, value);
+        p += 4;
+    }
+
+    app_limiter_stats_t limiter;
+    app_limiter_get_stats(APP_OUTPUT_CHANNEL_SIGNAL, esp_timer_get_time(), &limiter);
+    put_u32(p, limiter.allowed);
+    put_u32(p + 4, limiter.rejected_rate);
+    put_u32(p + 8, limiter.rejected_duty);
+    put_u16(p + 12, limiter.duty_permille);
+    put_u16(p + 14, limiter.tokens);
+    p += 16;
+
+    app_sched_stats_t sched;
+    app_sched_get_stats(&sched);
+    put_u32(p, sched.scheduled);
+    put_u32(p + 4, sched.fired);
+    put_u32(p + 8, sched.late);
+    put_u32(p + 12, sched.dropped);
+    put_u32(p + 16, (uint32_t)sched.max_lag_us);
+    p += 20;
+
+    app_evtlog_stats_t evtlog;
+    app_evtlog_get_stats(&evtlog);
+    put_u32(p, evtlog.appended);
+    put_u32(p + 4, evtlog.dropped);
+    p += 8;
+    return p - out;
+}
+
+// Fills the response after its status; returns the status and sets *len to the data length.
+static esp_err_t handle_request(session_t *session, const app_hostlink_frame_t *req, size_t *len)
+{
+    uint8_t *out = session->response + 2;
+    *len = 0;
+    switch (req->op) {
+    case APP_HOSTLINK_OP_HELLO: {
+        size_t name_len = strlen(s_config.profile_name);
+        out[0] = APP_HOSTLINK_VERSION;
+        put_u16(out + 1, APP_HOSTLINK_MAX_PAYLOAD);
+        memcpy(out + 3, s_config.profile_name, name_len);
+        *len = 3 + name_len;
+        return ESP_OK;
+    }
+
+    case APP_HOSTLINK_OP_CONFIG_GET: {
+        app_settings_t staged;
+        app_settings_get_staged(&staged);
+        const app_settings_t *boot = app_settings_get();
+        put_settings(out, &staged);
+        // Everything but the pulse waits for a reboot
+        out[APP_HOSTLINK_SETTINGS_LEN] = staged.signal_gpio != boot->signal_gpio ||
+                                         staged.pir_hold_s != boot->pir_hold_s ||
+                                         staged.shtc3_interval_ms != boot->shtc3_interval_ms;
+        *len = APP_HOSTLINK_SETTINGS_LEN + 1;
+        return ESP_OK;
+    }
+
+    case APP_HOSTLINK_OP_CONFIG_SET: {
+        if (req->len != APP_HOSTLINK_SETTINGS_LEN) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        app_settings_t settings;
+        get_settings(req->payload, &settings);
+        // A signal line on a pin the prop cannot drive, or one another driver owns, would stop
+        // the next boot; refuse it here so one bad provisioning frame cannot stage it
+        const char *owner;
+        esp_err_t err = app_settings_check_signal_gpio(settings.signal_gpio, &owner);
+        if (err != ESP_OK) {
+            if (owner) {
+                ESP_LOGW(TAG, "CONFIG_SET refused: GPIO %d is the %s", settings.signal_gpio, owner);
+            } else {
+                ESP_LOGW(TAG, "CONFIG_SET refused: GPIO %d cannot drive the signal", settings.signal_gpio);
+            }
+            return err;
+        }
+        err = app_settings_stage(&settings);
+        if (err == ESP_OK && s_config.settings_cb) {
+            s_config.settings_cb(&settings, s_config.user_data);
+        }
+        return err;
+    }
+
+    case APP_HOSTLINK_OP_PATTERN_BEGIN:
+        if (req->len != 4) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        return app_pattern_upload_begin(get_u32(req->payload));
+
+    case APP_HOSTLINK_OP_PATTERN_DATA:
+        if (req->len < 4) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        return app_pattern_upload_write(get_u32(req->payload), req->payload + 4, req->len - 4);
+
+    case APP_HOSTLINK_OP_PATTERN_COMMIT: {
+        esp_err_t err = app_pattern_upload_commit();
+        put_u16(out, (uint16_t)app_pattern_count());
+        *len = 2;
+        return err;
+    }
+
+    case APP_HOSTLINK_OP_FIRE:
+        if (req->len != 2) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (!s_config.fire_cb) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        return s_config.fire_cb(req->payload[0], req->payload[1], s_config.user_data);
+
+    case APP_HOSTLINK_OP_STATS:
+        *len = put_stats(out);
+        return ESP_OK;
+
+    case APP_HOSTLINK_OP_HISTOGRAM: {
+        size_t count = app_stats_latency_histogram(session->buckets, APP_STATS_LATENCY_BUCKETS);
+        for (size_t i = 0; i < count; i++) {
+            put_u32(out + 8 * i, session->buckets[i].upper_us);
+            put_u32(out + 8 * i + 4, session->buckets[i].count);
+        }
+        *len = 8 * count;
+        return ESP_OK;
+    }
+
+    case APP_HOSTLINK_OP_LOG:
+        if (req->len != 1) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        s_streaming.store(req->payload[0] != 0, std::memory_order_relaxed);
+        return ESP_OK;
+
+    case APP_HOSTLINK_OP_EXIT:
+        return ESP_OK;
+
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static_assert(2 + 8 * APP_STATS_LATENCY_BUCKETS <= APP_HOSTLINK_MAX_PAYLOAD, "histogram does not fit a frame");
+
+esp_err_t app_hostlink_session(const app_hostlink_config_t *config)
+{
+    session_t *session = (session_t *)calloc(1, sizeof(session_t));
+    if (!session) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!s_tx_lock) {
+        s_tx_lock = xSemaphoreCreateMutex();
+        if (!s_tx_lock) {
+            free(session);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ESP_LOGI(TAG, "Session started, idle timeout %" PRIu32 " ms", config->idle_timeout_ms);
+    s_config = *config;
+    s_streaming.store(false, std::memory_order_relaxed);
+    s_uart_num = config->uart_num;
+    vprintf_like_t previous_vprintf = esp_log_set_vprintf(log_vprintf);
+    portENTER_CRITICAL(&s_lock);
+    s_stats.sessions++;
+    portEXIT_CRITICAL(&s_lock);
+
+    esp_err_t result = ESP_ERR_TIMEOUT;
+    int64_t last_frame_us = esp_timer_get_time();
+    bool done = false;
+    while (!done) {
+        // Wait for the first byte, then take whatever else has arrived without waiting again
+        uint8_t chunk[RX_CHUNK];
+        int n = uart_read_bytes(config->uart_num, chunk, 1, pdMS_TO_TICKS(RX_POLL_MS));
+        if (n > 0) {
+            size_t buffered = 0;
+            uart_get_buffered_data_len(config->uart_num, &buffered);
+            if (buffered > 0) {
+                int more = uart_read_bytes(config->uart_num, chunk + 1,
+                                           buffered < sizeof(chunk) - 1 ? buffered : sizeof(chunk) - 1, 0);
+                n += more > 0 ? more : 0;
+            }
+        }
+        uint32_t errors = 0;
+        for (int i = 0; i < n && !done; i++) {
+            if (!app_hostlink_parse(&session->parser, chunk[i], &session->request, &errors)) {
+                continue;
+            }
+            const app_hostlink_frame_t *req = &session->request;
+            size_t len;
+            esp_err_t err = handle_request(session, req, &len);
+            put_u16(session->response, (uint16_t)err);
+            send_frame(req->seq, req->op | APP_HOSTLINK_RESPONSE, session->response, len + 2,
+                       portMAX_DELAY);
+            portENTER_CRITICAL(&s_lock);
+            s_stats.requests++;
+            portEXIT_CRITICAL(&s_lock);
+            last_frame_us = esp_timer_get_time();
+            if (req->op == APP_HOSTLINK_OP_EXIT) {
+                result = ESP_OK;
+                done = true;
+            }
+        }
+        if (errors) {
+            portENTER_CRITICAL(&s_lock);
+            s_stats.rx_errors += errors;
+            portEXIT_CRITICAL(&s_lock);
+        }
+        if (!done && esp_timer_get_time() - last_frame_us > (int64_t)config->idle_timeout_ms * 1000) {
+            done = true;
+        }
+    }
+
+    esp_log_set_vprintf(previous_vprintf);
+    s_streaming.store(false, std::memory_order_relaxed);
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    s_uart_num = -1;
+    xSemaphoreGive(s_tx_lock);
+    free(session);
+    ESP_LOGI(TAG, "Session ended (%s)", result == ESP_OK ? "host" : "idle");
+    return result;
+}
+
+void app_hostlink_get_stats(app_hostlink_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,118 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Binary host protocol on the console UART, for provisioning and benchmarking many props.
+//
+// The `hostlink` console command hands the UART from the REPL to a session that runs in the
+// REPL task until the host sends EXIT or stays silent for the idle timeout; the REPL then
+// continues where it was. Frame: SOF (0xA7), length (u16 LE), sequence, op, payload,
+// CRC-16/CCITT-FALSE (big endian) over everything from the length to the end of the payload.
+// The length counts sequence, op and payload. Each request is answered by one frame with the
+// same sequence, the op with APP_HOSTLINK_RESPONSE set and a payload that starts with the
+// esp_err_t (i16 LE). All integers are little endian. While a session runs, ESP_LOG output is
+// either streamed as LOG_LINE frames or dropped, so it never corrupts a frame.
+// tools/hostlink.py is the host side.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_settings.h"
+
+#define APP_HOSTLINK_SOF            0xA7
+#define APP_HOSTLINK_VERSION        1
+#define APP_HOSTLINK_MAX_PAYLOAD    1024
+#define APP_HOSTLINK_SETTINGS_LEN   9       // pulse_ms u16, signal_gpio i8, pir_hold_s u16, shtc3_interval_ms u32
+
+typedef enum {
+    APP_HOSTLINK_OP_HELLO = 0x01,           // -> version, max payload (u16), profile name
+    APP_HOSTLINK_OP_CONFIG_GET = 0x02,      // -> settings for the next boot, reboot pending (u8)
+    APP_HOSTLINK_OP_CONFIG_SET = 0x03,      // settings; the pulse applies now, the rest on reboot
+    APP_HOSTLINK_OP_PATTERN_BEGIN = 0x04,   // image length (u32)
+    APP_HOSTLINK_OP_PATTERN_DATA = 0x05,    // offset (u32), bytes
+    APP_HOSTLINK_OP_PATTERN_COMMIT = 0x06,  // -> patterns loaded (u16)
+    APP_HOSTLINK_OP_FIRE = 0x07,            // pulses, pattern id (0 for plain pulses)
+    APP_HOSTLINK_OP_STATS = 0x08,           // -> counters, see app_hostlink.cpp
+    APP_HOSTLINK_OP_HISTOGRAM = 0x09,       // -> (upper bound us u32, count u32) per non-empty bucket
+    APP_HOSTLINK_OP_LOG = 0x0A,             // stream ESP_LOG lines (u8 0/1)
+    APP_HOSTLINK_OP_EXIT = 0x0F,            // back to the REPL after the answer
+    APP_HOSTLINK_OP_LOG_LINE = 0x40,        // device to host, unanswered; payload: one log line
+    APP_HOSTLINK_RESPONSE = 0x80,           // or-ed into the op of an answer
+} app_hostlink_op_t;
+
+typedef struct {
+    uint8_t seq;
+    uint8_t op;
+    uint16_t len;               // payload length
+    uint8_t payload[APP_HOSTLINK_MAX_PAYLOAD];
+} app_hostlink_frame_t;
+
+typedef struct {
+    uint8_t state;
+    uint16_t pos;
+    uint16_t len;
+    uint8_t buf[APP_HOSTLINK_MAX_PAYLOAD + 6];
+} app_hostlink_parser_t;
+
+/**
+ * @brief Fire a trigger on behalf of the host. Runs in the session (REPL) task.
+ */
+typedef esp_err_t (*app_hostlink_fire_cb_t)(uint8_t pulses, uint8_t pattern_id, void *user_data);
+
+/**
+ * @brief Called after the host has staged new settings. Runs in the session (REPL) task.
+ */
+typedef void (*app_hostlink_settings_cb_t)(const app_settings_t *settings, void *user_data);
+
+typedef struct {
+    // UART the REPL runs on; its driver must already be installed
+    int uart_num;
+    // the session ends after this long without a valid frame
+    uint32_t idle_timeout_ms = 10000;
+    const char *profile_name = "";
+    app_hostlink_fire_cb_t fire_cb = NULL;
+    app_hostlink_settings_cb_t settings_cb = NULL;
+    void *user_data = NULL;
+} app_hostlink_config_t;
+
+typedef struct {
+    uint32_t sessions;
+    uint32_t requests;      // valid frames received
+    uint32_t rx_errors;     // bytes discarded while looking for a valid frame
+    uint32_t log_lines;     // ESP_LOG lines streamed to the host
+    uint32_t log_dropped;   // ESP_LOG lines dropped while not streaming or while the UART was busy
+} app_hostlink_stats_t;
+
+/**
+ * @brief Run one session on the console UART. Blocks the calling task until the host sends
+ *        EXIT or the idle timeout passes. The heap for the frame buffers is only held while
+ *        the session runs.
+ *
+ * @return ESP_OK if the host ended the session.
+ * @return ESP_ERR_TIMEOUT if the session went idle.
+ * @return ESP_ERR_NO_MEM if the frame buffers could not be allocated.
+ */
+esp_err_t app_hostlink_session(const app_hostlink_config_t *config);
+
+/**
+ * @brief Copy the session counters.
+ */
+void app_hostlink_get_stats(app_hostlink_stats_t *stats);
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021), continued from crc; start with 0xFFFF.
+ */
+uint16_t app_hostlink_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Feed one received byte.
+ *
+ * @return true when a complete, valid frame has been stored in frame.
+ */
+bool app_hostlink_parse(app_hostlink_parser_t *parser, uint8_t byte, app_hostlink_frame_t *frame, uint32_t *errors);
@@ -0,0 +1,214 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "app_identify.h"
+
+static const char *TAG = "app_identify";
+
+#define MS(ms)              ((ms) * 1000)
+#define STEPS(array)        (uint16_t)(sizeof(array) / sizeof(array[0]))
+#define BREATHE_LEVELS      8           // brightness steps from off to full
+#define BREATHE_PERIOD_US   10000       // software PWM period
+#define BREATHE_PERIODS     6           // periods per brightness step, ~1 s per breath
+#define BREATHE_STEPS       (2 * BREATHE_LEVELS * BREATHE_PERIODS * 2)
+
+typedef struct {
+    const app_output_step_t *steps;
+    uint16_t step_count;
+    uint8_t iterations;
+} identify_effect_t;
+
+// Effects follow the Identify cluster description for a non-colour light
+static const app_output_step_t s_blink_steps[] = {{MS(500), 1}, {MS(500), 0}};
+static const app_output_step_t s_okay_steps[] = {{MS(250), 1}, {MS(250), 0}, {MS(250), 1}, {MS(250), 0}};
+static const app_output_step_t s_channel_change_steps[] = {{MS(500), 1}, {MS(7500), 0}};
+static app_output_step_t s_breathe_steps[BREATHE_STEPS];   // filled in by app_identify_init()
+
+static const identify_effect_t s_blink = {s_blink_steps, STEPS(s_blink_steps), 1};
+static const identify_effect_t s_breathe = {s_breathe_steps, BREATHE_STEPS, 15};
+static const identify_effect_t s_okay = {s_okay_steps, STEPS(s_okay_steps), 1};
+static const identify_effect_t s_channel_change = {s_channel_change_steps, STEPS(s_channel_change_steps), 1};
+
+static app_output_channel_t s_channel;
+static SemaphoreHandle_t s_mutex;
+
+// Guarded by s_mutex
+static bool s_active;
+static bool s_continuous;           // repeat until stopped
+static uint8_t s_iterations_left;   // after the one playing
+static bool s_suspended;            // cut short by a trigger, s_pattern restarts when it is done
+static app_output_pattern_t s_pattern;
+
+static void identify_fill_breathe(void)
+{
+    size_t n = 0;
+    for (int i = 0; i < 2 * BREATHE_LEVELS; i++) {
+        // 1/8 .. 8/8 on the way up, 7/8 .. 0 on the way down
+        int level = i < BREATHE_LEVELS ? i + 1 : 2 * BREATHE_LEVELS - 1 - i;
+        uint32_t high_us = BREATHE_PERIOD_US * level / BREATHE_LEVELS;
+        for (int p = 0; p < BREATHE_PERIODS; p++) {
+            s_breathe_steps[n++] = {.duration_us = high_us, .level = 1};
+            s_breathe_steps[n++] = {.duration_us = BREATHE_PERIOD_US - high_us, .level = 0};
+        }
+    }
+}
+
+// Called with s_mutex held
+static esp_err_t identify_play(const identify_effect_t *effect, bool continuous)
+{
+    app_output_stop(s_channel);
+    s_suspended = false;
+    s_pattern = {.steps = effect->steps, .step_count = effect->step_count};
+    s_continuous = continuous;
+    s_iterations_left = effect->iterations - 1;
+    esp_err_t err = app_output_play(s_channel, &s_pattern);
+    s_active = (err == ESP_OK);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to play effect: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+// Called with s_mutex held
+static bool identify_stop_locked(void)
+{
+    bool was_active = s_active;
+    s_active = false;
+    s_suspended = false;
+    if (was_active) {
+        app_output_stop(s_channel);
+    }
+    return was_active;
+}
+
+// Called with s_mutex held
+static void identify_resume_locked(void)
+{
+    if (s_suspended && !s_active) {
+        s_suspended = false;
+        s_active = (app_output_play(s_channel, &s_pattern) == ESP_OK);
+    }
+}
+
+esp_err_t app_identify_init(app_output_channel_t channel)
+{
+    if (s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_channel = channel;
+    identify_fill_breathe();
+    return ESP_OK;
+}
+
+esp_err_t app_identify_start(void)
+{
+    if (!s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_err_t err = identify_play(&s_blink, true);
+    xSemaphoreGive(s_mutex);
+    return err;
+}
+
+esp_err_t app_identify_effect(uint8_t effect_id)
+{
+    const identify_effect_t *effect;
+    switch (effect_id) {
+    case APP_IDENTIFY_EFFECT_BLINK:             effect = &s_blink; break;
+    case APP_IDENTIFY_EFFECT_BREATHE:           effect = &s_breathe; break;
+    case APP_IDENTIFY_EFFECT_OKAY:              effect = &s_okay; break;
+    case APP_IDENTIFY_EFFECT_CHANNEL_CHANGE:    effect = &s_channel_change; break;
+    case APP_IDENTIFY_EFFECT_FINISH:            effect = NULL; break;
+    case APP_IDENTIFY_EFFECT_STOP:              app_identify_stop(); return ESP_OK;
+    default:                                    return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (effect) {
+        err = identify_play(effect, false);
+    } else {
+        // Let the iteration in progress run to its end
+        s_continuous = false;
+        s_iterations_left = 0;
+    }
+    xSemaphoreGive(s_mutex);
+    return err;
+}
+
+void app_identify_stop(void)
+{
+    if (!s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    identify_stop_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+bool app_identify_preempt(void)
+{
+    if (!s_mutex) {
+        return false;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool suspended = s_suspended;
+    bool was_active = identify_stop_locked();
+    // A second trigger before the first one's pattern ended keeps the effect waiting
+    s_suspended = was_active || suspended;
+    xSemaphoreGive(s_mutex);
+    return was_active;
+}
+
+void app_identify_resume(void)
+{
+    if (!s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    identify_resume_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+bool app_identify_is_active(void)
+{
+    return s_active;
+}
+
+void app_identify_handle_done(void)
+{
+    if (!s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_active) {
+        if (s_continuous || s_iterations_left > 0) {
+            if (!s_continuous) {
+                s_iterations_left--;
+            }
+            s_active = (app_output_play(s_channel, &s_pattern) == ESP_OK);
+        } else {
+            s_active = false;
+        }
+    } else {
+        identify_resume_locked();
+    }
+    xSemaphoreGive(s_mutex);
+}
@@ -0,0 +1,83 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Identify effects rendered as output patterns on a status channel.
+//
+// Effects play through the output sequencer, so nothing here blocks: repeats are started from
+// the channel's done callback. The status channel is separate from the signal line, so an
+// effect can never hold back a trigger. A trigger calls app_identify_preempt() to cut the
+// effect short and take the LED over; when the trigger's pattern is done the effect starts its
+// cut iteration again, unless Identify was stopped in the meantime.
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+#include "app_output.h"
+
+// Effect identifiers of the Identify cluster TriggerEffect command
+#define APP_IDENTIFY_EFFECT_BLINK           0x00
+#define APP_IDENTIFY_EFFECT_BREATHE         0x01
+#define APP_IDENTIFY_EFFECT_OKAY            0x02
+#define APP_IDENTIFY_EFFECT_CHANNEL_CHANGE  0x0B
+#define APP_IDENTIFY_EFFECT_FINISH          0xFE
+#define APP_IDENTIFY_EFFECT_STOP            0xFF
+
+/**
+ * @brief Render Identify effects on an output channel. This function should be called only once,
+ *        after the channel is initialized. The channel's done callback must call
+ *        app_identify_handle_done().
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_STATE if already initialized.
+ * @return ESP_ERR_NO_MEM if the lock cannot be created.
+ */
+esp_err_t app_identify_init(app_output_channel_t channel);
+
+/**
+ * @brief Blink until app_identify_stop() (IdentifyTime running).
+ */
+esp_err_t app_identify_start(void);
+
+/**
+ * @brief Play a TriggerEffect effect. FINISH lets the current iteration end, STOP ends it now.
+ *
+ * @return ESP_ERR_NOT_SUPPORTED for unknown effect identifiers.
+ */
+esp_err_t app_identify_effect(uint8_t effect_id);
+
+/**
+ * @brief Stop any effect and return the channel to idle.
+ */
+void app_identify_stop(void);
+
+/**
+ * @brief Stop any effect so the caller can use the channel. The effect is kept for
+ *        app_identify_resume() until app_identify_stop() or another effect replaces it.
+ *
+ * @return true if an effect was cut short.
+ */
+bool app_identify_preempt(void);
+
+/**
+ * @brief Restart the iteration app_identify_preempt() cut short, if any. The channel's done
+ *        callback does this once the caller's pattern ends; call it when that pattern was
+ *        stopped early or never started, since no done callback follows then.
+ */
+void app_identify_resume(void);
+
+/**
+ * @brief Whether an effect is playing.
+ */
+bool app_identify_is_active(void);
+
+/**
+ * @brief Start the next iteration of a repeating effect, or resume a preempted one. Call from
+ *        the channel's done callback.
+ */
+void app_identify_handle_done(void);
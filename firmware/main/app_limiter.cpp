@@ -0,0 +1,173 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+
+#include "app_limiter.h"
+
+#define DUTY_BUCKETS    16                      // must be a power of two
+#define DUTY_MASK       (DUTY_BUCKETS - 1)
+
+typedef struct {
+    bool enabled;
+
+    // Token bucket, kept as accumulated refill time times the scale in percent, so neither
+    // refilling nor scaling needs a division: one token is worth token_cost.
+    int64_t token_cost;
+    int64_t capacity;
+    int64_t credit;
+    int64_t last_us;
+    uint8_t scale_pct;          // refill speed and duty budget, percent of the configured ones
+
+    // Rolling duty window: HIGH time per sub-window, plus their running sum.
+    int64_t bucket_us;
+    int64_t budget_us;
+    int64_t window_us;
+    int64_t bucket_end_us;      // end of the sub-window in high_us[slot]
+    uint8_t slot;
+    uint32_t high_us[DUTY_BUCKETS];
+    int64_t high_sum_us;
+
+    app_limiter_stats_t stats;
+} limiter_t;
+
+static limiter_t s_limiters[APP_OUTPUT_CHANNEL_COUNT];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void limiter_advance(limiter_t *limiter, int64_t now_us)
+{
+    if (now_us > limiter->last_us) {
+        limiter->credit += (now_us - limiter->last_us) * limiter->scale_pct;
+        if (limiter->credit > limiter->capacity) {
+            limiter->credit = limiter->capacity;
+        }
+        limiter->last_us = now_us;
+    }
+
+    // Drop sub-windows that slid out; after a full window of silence everything is gone and
+    // the sub-windows restart at now_us. Otherwise this steps at most DUTY_BUCKETS times.
+    if (now_us - limiter->bucket_end_us >= limiter->window_us) {
+        memset(limiter->high_us, 0, sizeof(limiter->high_us));
+        limiter->high_sum_us = 0;
+        limiter->bucket_end_us = now_us + limiter->bucket_us;
+    }
+    while (now_us >= limiter->bucket_end_us) {
+        limiter->slot = (limiter->slot + 1) & DUTY_MASK;
+        limiter->high_sum_us -= limiter->high_us[limiter->slot];
+        limiter->high_us[limiter->slot] = 0;
+        limiter->bucket_end_us += limiter->bucket_us;
+    }
+}
+
+esp_err_t app_limiter_init(app_output_channel_t channel, const app_limiter_config_t *config)
+{
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT || !config || config->burst == 0 || config->refill_ms == 0 ||
+        config->duty_window_ms < DUTY_BUCKETS || config->max_duty_pct == 0 || config->max_duty_pct > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    limiter_t limiter = {};
+    limiter.token_cost = (int64_t)config->refill_ms * 1000 * 100;
+    limiter.capacity = limiter.token_cost * config->burst;
+    limiter.credit = limiter.capacity;
+    limiter.bucket_us = (int64_t)config->duty_window_ms * 1000 / DUTY_BUCKETS;
+    limiter.window_us = limiter.bucket_us * DUTY_BUCKETS;
+    limiter.budget_us = limiter.window_us * config->max_duty_pct / 100;
+    limiter.scale_pct = 100;
+    limiter.enabled = true;
+
+    portENTER_CRITICAL(&s_lock);
+    s_limiters[channel] = limiter;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+app_limiter_verdict_t app_limiter_acquire(app_output_channel_t channel, uint32_t high_us, int64_t now_us,
+                                          uint8_t scale_pct)
+{
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT) {
+        return APP_LIMITER_ALLOWED;
+    }
+    limiter_t *limiter = &s_limiters[channel];
+    app_limiter_verdict_t verdict = APP_LIMITER_ALLOWED;
+
+    portENTER_CRITICAL(&s_lock);
+    if (limiter->enabled) {
+        // The time since the last call is credited at the scale that was in force then
+        limiter_advance(limiter, now_us);
+        limiter->scale_pct = scale_pct > 100 ? 100 : scale_pct;
+        if (limiter->credit < limiter->token_cost) {
+            verdict = APP_LIMITER_REJECTED_RATE;
+            limiter->stats.rejected_rate++;
+        } else if ((limiter->high_sum_us + high_us) * 100 > limiter->budget_us * limiter->scale_pct) {
+            verdict = APP_LIMITER_REJECTED_DUTY;
+            limiter->stats.rejected_duty++;
+        } else {
+            limiter->credit -= limiter->token_cost;
+            limiter->high_us[limiter->slot] += high_us;
+            limiter->high_sum_us += high_us;
+            limiter->stats.allowed++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return verdict;
+}
+
+void app_limiter_refund(app_output_channel_t channel, uint32_t high_us, int64_t charged_us)
+{
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT) {
+        return;
+    }
+    limiter_t *limiter = &s_limiters[channel];
+
+    portENTER_CRITICAL(&s_lock);
+    if (limiter->enabled) {
+        limiter->credit += limiter->token_cost;
+        if (limiter->credit > limiter->capacity) {
+            limiter->credit = limiter->capacity;
+        }
+        // Sub-windows back from the current one; a charge older than the window is already gone
+        int64_t back = 0;
+        if (charged_us < limiter->bucket_end_us - limiter->bucket_us) {
+            back = (limiter->bucket_end_us - 1 - charged_us) / limiter->bucket_us;
+        }
+        if (back < DUTY_BUCKETS) {
+            uint8_t slot = (limiter->slot - back) & DUTY_MASK;
+            uint32_t refund_us = high_us < limiter->high_us[slot] ? high_us : limiter->high_us[slot];
+            limiter->high_us[slot] -= refund_us;
+            limiter->high_sum_us -= refund_us;
+        }
+        if (limiter->stats.allowed > 0) {
+            limiter->stats.allowed--;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void app_limiter_get_stats(app_output_channel_t channel, int64_t now_us, app_limiter_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    limiter_t *limiter = &s_limiters[channel];
+
+    portENTER_CRITICAL(&s_lock);
+    if (limiter->enabled) {
+        limiter_advance(limiter, now_us);
+        limiter->stats.duty_permille = (uint16_t)(limiter->high_sum_us * 1000 / limiter->window_us);
+        limiter->stats.tokens = (uint16_t)(limiter->credit / limiter->token_cost);
+    }
+    *stats = limiter->stats;
+    portEXIT_CRITICAL(&s_lock);
+}
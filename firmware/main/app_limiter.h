@@ -0,0 +1,83 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Trigger rate limiter for the output channels.
+//
+// Each channel has a token bucket (burst size + refill period) and a rolling duty-cycle budget
+// (HIGH time over a sliding window, kept in a ring of sub-window buckets). A trigger must pass
+// both. Everything is O(1), statically allocated and safe to call from any task; acquiring
+// only adds, multiplies and compares.
+//
+// A caller can scale a channel down (thermal derating): at scale_pct the bucket refills that
+// much slower and the duty budget shrinks by the same factor; 0 stops the channel.
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "app_output.h"
+
+typedef enum {
+    APP_LIMITER_ALLOWED = 0,
+    APP_LIMITER_REJECTED_RATE,  // bucket empty
+    APP_LIMITER_REJECTED_DUTY,  // the pulse would push the window over the duty budget
+} app_limiter_verdict_t;
+
+typedef struct {
+    // triggers accepted back to back before the bucket is empty
+    uint16_t burst = CONFIG_SKULL_LIMIT_BURST;
+    // one token comes back every refill_ms
+    uint32_t refill_ms = CONFIG_SKULL_LIMIT_REFILL_MS;
+    // length of the rolling duty-cycle window
+    uint32_t duty_window_ms = CONFIG_SKULL_LIMIT_DUTY_WINDOW_MS;
+    // maximum HIGH time within the window, in percent
+    uint8_t max_duty_pct = CONFIG_SKULL_LIMIT_MAX_DUTY_PCT;
+} app_limiter_config_t;
+
+typedef struct {
+    uint32_t allowed;
+    uint32_t rejected_rate;
+    uint32_t rejected_duty;
+    uint16_t duty_permille;     // HIGH time in the current window, per mille
+    uint16_t tokens;            // whole tokens left
+} app_limiter_stats_t;
+
+/**
+ * @brief Configure the limiter of a channel. The bucket starts full.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the channel or config is invalid.
+ */
+esp_err_t app_limiter_init(app_output_channel_t channel, const app_limiter_config_t *config);
+
+/**
+ * @brief Ask for permission to drive a channel HIGH for high_us. On success a token and the
+ *        HIGH time are charged; a rejected request costs nothing.
+ *
+ * Channels that were never initialized are not limited.
+ *
+ * @param scale_pct share of the configured rate and duty budget currently allowed, 0-100. It
+ *                  applies from this call on, until the next call brings a new one.
+ */
+app_limiter_verdict_t app_limiter_acquire(app_output_channel_t channel, uint32_t high_us, int64_t now_us,
+                                          uint8_t scale_pct = 100);
+
+/**
+ * @brief Give back what app_limiter_acquire() charged for a trigger whose output then failed to
+ *        start: the token, and the HIGH time while its sub-window is still in the window.
+ *
+ * @param charged_us the now_us of the app_limiter_acquire() call that was allowed
+ */
+void app_limiter_refund(app_output_channel_t channel, uint32_t high_us, int64_t charged_us);
+
+/**
+ * @brief Copy the counters of a channel, with the bucket and window brought up to now_us.
+ */
+void app_limiter_get_stats(app_output_channel_t channel, int64_t now_us, app_limiter_stats_t *stats);
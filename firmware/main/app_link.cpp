@@ -0,0 +1,307 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <driver/uart.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "app_link.h"
+
+static const char *TAG = "app_link";
+
+#define LINK_TX_BUFFER      256
+#define LINK_RX_BUFFER      256     // the driver's minimum is larger than any burst of acks
+#define LINK_RX_TASK_STACK  2560
+
+typedef enum {
+    PARSE_SOF = 0,
+    PARSE_LEN,
+    PARSE_BODY,
+} parse_state_t;
+
+static app_link_config_t s_config;
+static bool s_ready;
+static uint8_t s_seq;
+static esp_timer_handle_t s_ack_timer;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static app_link_stats_t s_stats;
+static app_link_parser_t s_rx_parser;  // kept across reads, a frame may span two
+
+// Frame waiting for its ack, kept for resends
+static struct {
+    bool active;
+    uint8_t seq;
+    uint8_t tries_left;
+    uint8_t len;
+    int64_t queued_us;
+    uint8_t frame[APP_LINK_MAX_FRAME];
+} s_pending;
+
+uint16_t app_link_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t app_link_encode(uint8_t seq, uint8_t cmd, const uint8_t *payload, size_t len, uint8_t *out, size_t size)
+{
+    size_t total = len + 6;
+    if (len > APP_LINK_MAX_PAYLOAD || size < total) {
+        return 0;
+    }
+    out[0] = APP_LINK_SOF;
+    out[1] = (uint8_t)(len + 2);
+    out[2] = seq;
+    out[3] = cmd;
+    if (len) {
+        memcpy(out + 4, payload, len);
+    }
+    uint16_t crc = app_link_crc16(out + 1, len + 3);
+    out[total - 2] = (uint8_t)(crc >> 8);
+    out[total - 1] = (uint8_t)crc;
+    return total;
+}
+
+bool app_link_parse(app_link_parser_t *parser, uint8_t byte, app_link_frame_t *frame, uint32_t *errors)
+{
+    switch (parser->state) {
+    case PARSE_SOF:
+        if (byte == APP_LINK_SOF) {
+            parser->state = PARSE_LEN;
+        } else if (errors) {
+            (*errors)++;
+        }
+        return false;
+
+    case PARSE_LEN:
+        if (byte < 2 || byte > APP_LINK_MAX_PAYLOAD + 2) {
+            parser->state = (byte == APP_LINK_SOF) ? PARSE_LEN : PARSE_SOF;
+            if (errors) {
+                (*errors)++;
+            }
+            return false;
+        }
+        parser->buf[0] = byte;
+        parser->pos = 1;
+        parser->state = PARSE_BODY;
+        return false;
+
+    default:
+        parser->buf[parser->pos++] = byte;
+        // length byte + body + 2 CRC bytes
+        if (parser->pos < parser->buf[0] + 3) {
+            return false;
+        }
+        parser->state = PARSE_SOF;
+        size_t covered = parser->buf[0] + 1;
+        uint16_t crc = (uint16_t)(parser->buf[covered] << 8 | parser->buf[covered + 1]);
+        if (crc != app_link_crc16(parser->buf, covered)) {
+            if (errors) {
+                *errors += parser->pos + 1;
+            }
+            return false;
+        }
+        frame->seq = parser->buf[1];
+        frame->cmd = parser->buf[2];
+        frame->len = parser->buf[0] - 2;
+        memcpy(frame->payload, parser->buf + 3, frame->len);
+        return true;
+    }
+}
+
+static esp_err_t link_send(uint8_t cmd, const uint8_t *payload, size_t len)
+{
+    if (!s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t frame[APP_LINK_MAX_FRAME];
+    portENTER_CRITICAL(&s_lock);
+    uint8_t seq = s_seq++;
+    portEXIT_CRITICAL(&s_lock);
+    size_t frame_len = app_link_encode(seq, cmd, payload, len, frame, sizeof(frame));
+
+    // Never block the pulse path: drop the frame rather than wait for space
+    size_t free_space = 0;
+    uart_get_tx_buffer_free_size((uart_port_t)s_config.uart_num, &free_space);
+    if (free_space < frame_len) {
+        s_stats.tx_full++;
+        return ESP_ERR_NO_MEM;
+    }
+    int64_t now_us = esp_timer_get_time();
+    if (s_ack_timer) {
+        portENTER_CRITICAL(&s_lock);
+        if (s_pending.active) {
+            s_stats.superseded++;
+        }
+        s_pending.active = true;
+        s_pending.seq = seq;
+        s_pending.tries_left = s_config.retries;
+        s_pending.len = (uint8_t)frame_len;
+        s_pending.queued_us = now_us;
+        memcpy(s_pending.frame, frame, frame_len);
+        portEXIT_CRITICAL(&s_lock);
+        esp_timer_stop(s_ack_timer);
+        esp_timer_start_once(s_ack_timer, (uint64_t)s_config.ack_timeout_ms * 1000);
+    }
+    uart_write_bytes((uart_port_t)s_config.uart_num, frame, frame_len);
+    s_stats.sent++;
+    return ESP_OK;
+}
+
+// Runs in the esp_timer task
+static void link_ack_timer_cb(void *arg)
+{
+    uint8_t frame[APP_LINK_MAX_FRAME];
+    uint8_t len = 0;
+    bool gave_up = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_pending.active) {
+        if (s_pending.tries_left > 0) {
+            s_pending.tries_left--;
+            len = s_pending.len;
+            memcpy(frame, s_pending.frame, len);
+        } else {
+            s_pending.active = false;
+            gave_up = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (len) {
+        uart_write_bytes((uart_port_t)s_config.uart_num, frame, len);
+        s_stats.resent++;
+        esp_timer_start_once(s_ack_timer, (uint64_t)s_config.ack_timeout_ms * 1000);
+    } else if (gave_up) {
+        s_stats.timeouts++;
+        ESP_LOGW(TAG, "No ack from the animatronic controller");
+    }
+}
+
+void app_link_receive(uint32_t wait_ms)
+{
+    app_link_frame_t frame;
+    uint8_t buf[32];
+
+    int read = uart_read_bytes((uart_port_t)s_config.uart_num, buf, sizeof(buf), pdMS_TO_TICKS(wait_ms));
+    for (int i = 0; i < read; i++) {
+        if (!app_link_parse(&s_rx_parser, buf[i], &frame, &s_stats.rx_errors) || !(frame.cmd & APP_LINK_ACK)) {
+            continue;
+        }
+        int64_t now_us = esp_timer_get_time();
+        int64_t queued_us = 0;
+        bool matched = false;
+        portENTER_CRITICAL(&s_lock);
+        if (s_pending.active && frame.seq == s_pending.seq) {
+            s_pending.active = false;
+            queued_us = s_pending.queued_us;
+            matched = true;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (matched) {
+            esp_timer_stop(s_ack_timer);
+            uint32_t ack_us = (uint32_t)(now_us - queued_us);
+            s_stats.acked++;
+            s_stats.last_ack_us = ack_us;
+            if (ack_us > s_stats.max_ack_us) {
+                s_stats.max_ack_us = ack_us;
+            }
+        }
+    }
+}
+
+static void link_rx_task(void *arg)
+{
+    while (true) {
+        app_link_receive(100);
+    }
+}
+
+esp_err_t app_link_init(const app_link_config_t *config)
+{
+    if (!config || config->uart_num < 0 || config->uart_num >= UART_NUM_MAX || config->baud_rate == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_config = *config;
+    uart_port_t port = (uart_port_t)config->uart_num;
+
+    uart_config_t uart_config = {};
+    uart_config.baud_rate = (int)config->baud_rate;
+    uart_config.data_bits = UART_DATA_8_BITS;
+    uart_config.parity = UART_PARITY_DISABLE;
+    uart_config.stop_bits = UART_STOP_BITS_1;
+    uart_config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    uart_config.source_clk = UART_SCLK_DEFAULT;
+
+    esp_err_t err = uart_driver_install(port, LINK_RX_BUFFER, LINK_TX_BUFFER, 0, NULL, 0);
+    if (err == ESP_OK) {
+        err = uart_param_config(port, &uart_config);
+    }
+    if (err == ESP_OK) {
+        err = uart_set_pin(port, config->tx_gpio, config->ack_timeout_ms ? config->rx_gpio : UART_PIN_NO_CHANGE,
+                           UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up UART%d: %s", config->uart_num, esp_err_to_name(err));
+        return err;
+    }
+
+    if (config->ack_timeout_ms) {
+        esp_timer_create_args_t timer_args = {
+            .callback = link_ack_timer_cb,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "link_ack",
+            .skip_unhandled_events = true,
+        };
+        err = esp_timer_create(&timer_args, &s_ack_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (xTaskCreate(link_rx_task, "link_rx", LINK_RX_TASK_STACK, NULL, 5, NULL) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    s_ready = true;
+    ESP_LOGI(TAG, "Controller link on UART%d TX %d, %" PRIu32 " baud, acks %s", config->uart_num, config->tx_gpio,
+             config->baud_rate, config->ack_timeout_ms ? "on" : "off");
+    return ESP_OK;
+}
+
+esp_err_t app_link_play(uint16_t track, uint8_t volume, uint8_t effect)
+{
+    const uint8_t payload[] = {(uint8_t)track, (uint8_t)(track >> 8), volume, effect};
+    return link_send(APP_LINK_CMD_PLAY, payload, sizeof(payload));
+}
+
+esp_err_t app_link_stop(void)
+{
+    return link_send(APP_LINK_CMD_STOP, NULL, 0);
+}
+
+void app_link_get_stats(app_link_stats_t *stats)
+{
+    if (stats) {
+        *stats = s_stats;
+    }
+}
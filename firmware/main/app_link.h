@@ -0,0 +1,128 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Framed UART link to the animatronic controller.
+//
+// Frame: SOF (0xA5), length, sequence, command, payload, CRC-16/CCITT-FALSE (big endian) over
+// everything from the length byte to the end of the payload. The length counts sequence,
+// command and payload. A controller may answer with a frame carrying the same sequence number
+// and the command with APP_LINK_ACK set; if acks are enabled an unanswered frame is resent up
+// to the configured number of times. Only the newest frame waits for its ack: the controller
+// acts on the last command, so a PLAY or STOP sent before the previous frame's ack replaces it
+// and counts as superseded, and the late ack is ignored. Sends are queued into the UART driver's TX ring buffer
+// and never wait for the wire. tools/uart_link.py speaks the same protocol on the host.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_LINK_SOF            0xA5
+#define APP_LINK_MAX_PAYLOAD    16
+#define APP_LINK_MAX_FRAME      (APP_LINK_MAX_PAYLOAD + 6)
+
+typedef enum {
+    APP_LINK_CMD_PLAY = 0x01,   // payload: track (u16 LE), volume, effect
+    APP_LINK_CMD_STOP = 0x02,   // no payload
+    APP_LINK_ACK = 0x80,        // or-ed into the command of the answer; payload: status
+} app_link_cmd_t;
+
+typedef struct {
+    uint8_t seq;
+    uint8_t cmd;
+    uint8_t len;                // payload length
+    uint8_t payload[APP_LINK_MAX_PAYLOAD];
+} app_link_frame_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t pos;
+    uint8_t buf[APP_LINK_MAX_FRAME];
+} app_link_parser_t;
+
+typedef struct {
+    // UART port and pins
+    int uart_num;
+    int tx_gpio;
+    int rx_gpio;
+    uint32_t baud_rate;
+    // 0 disables acks
+    uint32_t ack_timeout_ms = 0;
+    // resends of an unanswered frame
+    uint8_t retries = 0;
+} app_link_config_t;
+
+typedef struct {
+    uint32_t sent;          // frames queued, resends excluded
+    uint32_t resent;
+    uint32_t acked;
+    uint32_t timeouts;      // frames given up on
+    uint32_t superseded;    // unacked frames replaced by a newer one
+    uint32_t tx_full;       // frames dropped because the TX buffer was full
+    uint32_t rx_errors;     // bytes discarded while looking for a valid frame
+    uint32_t last_ack_us;   // queue-to-ack time of the last acked frame
+    uint32_t max_ack_us;
+} app_link_stats_t;
+
+/**
+ * @brief Install the UART driver and, if acks are enabled, start the receive task.
+ *        This function should be called only once.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the config is invalid.
+ * @return error in case of failure.
+ */
+esp_err_t app_link_init(const app_link_config_t *config);
+
+/**
+ * @brief Queue a PLAY frame. Returns without waiting for the UART. A frame still waiting for
+ *        its ack is superseded by this one.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_STATE if the link is not initialized.
+ * @return ESP_ERR_NO_MEM if the TX buffer is full.
+ */
+esp_err_t app_link_play(uint16_t track, uint8_t volume, uint8_t effect);
+
+/**
+ * @brief Queue a STOP frame.
+ *
+ * @return same as app_link_play().
+ */
+esp_err_t app_link_stop(void);
+
+/**
+ * @brief Read what the controller sent for up to wait_ms and match its acks to the frame
+ *        waiting for one. Only after app_link_init() with acks enabled. The receive task app_link_init() starts loops on this; a build
+ *        without that task, such as the host tests, calls it instead.
+ */
+void app_link_receive(uint32_t wait_ms);
+
+/**
+ * @brief Copy the link counters.
+ */
+void app_link_get_stats(app_link_stats_t *stats);
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+ */
+uint16_t app_link_crc16(const uint8_t *data, size_t len);
+
+/**
+ * @brief Build a frame.
+ *
+ * @return frame length, or 0 if the payload or output buffer is too large/small.
+ */
+size_t app_link_encode(uint8_t seq, uint8_t cmd, const uint8_t *payload, size_t len, uint8_t *out, size_t size);
+
+/**
+ * @brief Feed one received byte.
+ *
+ * @return true when a complete, valid frame has been stored in frame.
+ */
+bool app_link_parse(app_link_parser_t *parser, uint8_t byte, app_link_frame_t *frame, uint32_t *errors);
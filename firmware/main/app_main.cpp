@@ -6,6 +6,7 @@
    CONDITIONS OF ANY KIND, either express or implied.
 */
 
+#include <app/InteractionModelEngine.h>
 #include <app/server/CommissioningWindowManager.h>
 #include <app/server/Server.h>
 #include <esp_err.h>
@@ -18,12 +19,34 @@
 #include "sdkconfig.h"
 
 #include <app_openthread_config.h>
-#include "app_reset.h"
+#if CONFIG_SKULL_BENCH
+#include "app_bench.h"
+#endif
+#include "app_busy.h"
+#include "app_console.h"
+#include "app_control_cluster.h"
+#include "app_dedupe.h"
+#include "app_diag_cluster.h"
+#include "app_evtlog.h"
+#include "app_gesture.h"
+#include "app_heap.h"
+#include "app_hostlink.h"
+#include "app_identify.h"
+#include "app_limiter.h"
+#include "app_link.h"
+#include "app_output.h"
+#include "app_pattern.h"
+#include "app_pir.h"
+#include "app_profile.h"
+#include "app_sched.h"
+#include "app_settings.h"
+#include "app_stats.h"
+#include "app_thermal.h"
+#include "app_trace.h"
 #include "utils/common_macros.h"
-
-// Button component direct include (for factory reset only)
-#include "iot_button.h"
-#include "button_gpio.h"
+#if CONFIG_SKULL_SHTC3
+#include "drivers/shtc3.h"
+#endif
 
 // For VID/PID and Onboarding Codes (official example method)
 #include <app/server/OnboardingCodesUtil.h>
@@ -39,14 +62,31 @@
 #include <esp_console.h>
 #include <esp_vfs_dev.h>
 #include <driver/gpio.h>
+#include <esp_system.h>
 #include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#if CONFIG_SKULL_SCHED_SNTP
+#include <esp_netif_sntp.h>
+#endif
 
 static const char *TAG = "app_main";
 
 // Global variables
 static uint16_t g_switch_endpoint_id = 0;
+#if CONFIG_SKULL_UI_ENDPOINT
 static uint16_t g_ui_endpoint_id = 0; // On/Off endpoint for Home UI
-static bool g_pulse_active = false;    // Track if pulse is currently active
+#endif
+static bool g_local_update = false;    // set while the firmware itself writes OnOff, only with the chip stack lock held
+#if CONFIG_SKULL_REPORT_COALESCE
+static bool g_coalesce_pending = false; // set by an accepted ON whose pulse fits the coalescing window
+// The following are only touched with the chip stack lock held
+static bool g_coalesced_pulse = false;  // a folded pulse is playing: the switch reads OFF but is really ON
+static bool g_onoff_deferred = false;   // an ON during a folded pulse, left for onoff_command_cb()
+#endif
 
 // Use the Kconfig value directly
 
@@ -58,225 +98,1518 @@ using namespace chip::app::Clusters;
 // Define GPIO pins
 #define BUTTON_GPIO CONFIG_BSP_BUTTON_GPIO  // GPIO 9 on ESP32-C3 SuperMini
 #define BSP_BUTTON_NUM 0
-#define SIGNAL_GPIO (gpio_num_t)4            // GPIO 4 for signal output
-#define PULSE_DURATION_MS 500               // 500ms pulse duration
+#define SIGNAL_GPIO ((gpio_num_t)app_settings_get()->signal_gpio)  // CONFIG_SKULL_SIGNAL_GPIO (4) unless overridden in the settings blob
+
+static bool s_ble_released = false; // NimBLE was torn down this boot (Matter thread only)
+
+static void restart_for_ble(chip::System::Layer *layer, void *context)
+{
+    esp_restart();
+}
 
 static void open_commissioning_window_if_necessary()
 {
-    VerifyOrReturn(chip::Server::GetInstance().GetFabricTable().FabricCount() == 0);
+    VerifyOrReturn(chip::Server::GetInstance().GetFabricTable().FabricCount() == 0);
+
+    chip::CommissioningWindowManager & commissionMgr = chip::Server::GetInstance().GetCommissioningWindowManager();
+    VerifyOrReturn(commissionMgr.IsCommissioningWindowOpen() == false);
+
+    if (s_ble_released) {
+        // The BLE stack and its memory are gone until the next boot, which finds no fabric and
+        // opens the window over BLE and DNS-SD. Give the RemoveFabric response time to go out.
+        ESP_LOGW(TAG, "Last fabric removed, restarting to commission over BLE");
+        CHIP_ERROR err = chip::DeviceLayer::SystemLayer().StartTimer(chip::System::Clock::Seconds32(2),
+                                                                     restart_for_ble, nullptr);
+        if (err == CHIP_NO_ERROR) {
+            return;
+        }
+        ESP_LOGE(TAG, "Failed to schedule the restart, err:%" CHIP_ERROR_FORMAT, err.Format());
+    }
+
+    // After removing last fabric, this example does not remove the Wi-Fi credentials and still
+    // has IP connectivity, so the window is also advertised on DNS-SD.
+    CHIP_ERROR err = commissionMgr.OpenBasicCommissioningWindow(chip::System::Clock::Seconds16(300),
+                                    s_ble_released ? chip::CommissioningWindowAdvertisement::kDnssdOnly
+                                                   : chip::CommissioningWindowAdvertisement::kAllSupported);
+    if (err != CHIP_NO_ERROR)
+    {
+        ESP_LOGE(TAG, "Failed to open commissioning window, err:%" CHIP_ERROR_FORMAT, err.Format());
+    }
+}
+
+// Logs how long the image transfer took, to compare full and delta OTA images
+static void log_ota_progress(chip::DeviceLayer::OtaState state)
+{
+    static int64_t download_start_us = 0;
+
+    switch (state) {
+    case chip::DeviceLayer::kOtaDownloadInProgress:
+        if (download_start_us == 0) {
+            download_start_us = esp_timer_get_time();
+            ESP_LOGI(TAG, "OTA download started");
+        }
+        break;
+
+    case chip::DeviceLayer::kOtaDownloadComplete:
+        ESP_LOGI(TAG, "OTA download complete in %" PRId64 " ms", (esp_timer_get_time() - download_start_us) / 1000);
+        download_start_us = 0;
+        break;
+
+    case chip::DeviceLayer::kOtaDownloadFailed:
+    case chip::DeviceLayer::kOtaDownloadAborted:
+        ESP_LOGW(TAG, "OTA download failed after %" PRId64 " ms", (esp_timer_get_time() - download_start_us) / 1000);
+        download_start_us = 0;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Heap gained from commissioning complete to the BLE teardown, against CONFIG_SKULL_HEAP_RECLAIM_MIN_KB
+static esp_err_t check_reclaimed(int32_t *reclaimed)
+{
+#if CONFIG_SKULL_HEAP_RECLAIM_MIN_KB > 0
+    return app_heap_check_gain("commissioned", "ble released", CONFIG_SKULL_HEAP_RECLAIM_MIN_KB * 1024, reclaimed);
+#else
+    return app_heap_check_gain("commissioned", "ble released", INT32_MIN, reclaimed);
+#endif
+}
+
+// Runs on the Matter thread once BLE is gone, after commissioning or at a boot that finds
+// fabrics. NimBLE is torn down and its memory released by the SDK
+// (CONFIG_USE_BLE_ONLY_FOR_COMMISSIONING); it comes back at the next boot without a fabric,
+// which removing the last fabric forces. Windows opened by an admin meanwhile use DNS-SD. Here
+// the console history is cut down and the gain is measured against the heap at commissioning
+// complete.
+static void apply_post_commissioning_profile()
+{
+    s_ble_released = true;
+    app_console_set_history_len(CONFIG_SKULL_CONSOLE_HISTORY_COMMISSIONED);
+
+    app_heap_mark("ble released");
+    int32_t reclaimed;
+    esp_err_t err = check_reclaimed(&reclaimed);
+    if (err == ESP_ERR_NOT_FOUND) {
+        return; // commissioned on an earlier boot; BLE never came up for real
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Post-commissioning profile reclaimed only %" PRId32 " bytes, expected %d KB or more",
+                 reclaimed, CONFIG_SKULL_HEAP_RECLAIM_MIN_KB);
+    } else {
+        ESP_LOGI(TAG, "Post-commissioning profile reclaimed %" PRId32 " bytes", reclaimed);
+    }
+}
+
+static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
+{
+    switch (event->Type) {
+    case chip::DeviceLayer::DeviceEventType::kCommissioningComplete:
+        ESP_LOGI(TAG, "Commissioning complete");
+        // The SDK schedules the BLE teardown after this event, so this is the "before" figure
+        app_heap_mark("commissioned");
+        break;
+
+    case chip::DeviceLayer::DeviceEventType::kFailSafeTimerExpired:
+        ESP_LOGI(TAG, "Commissioning failed, fail safe timer expired");
+        break;
+
+    case chip::DeviceLayer::DeviceEventType::kFabricRemoved:
+        ESP_LOGI(TAG, "Fabric removed successfully");
+        open_commissioning_window_if_necessary();
+        break;
+
+    case chip::DeviceLayer::DeviceEventType::kBLEDeinitialized:
+        ESP_LOGI(TAG, "BLE deinitialized and memory reclaimed");
+        apply_post_commissioning_profile();
+        break;
+
+    case chip::DeviceLayer::DeviceEventType::kOtaStateChanged:
+        log_ota_progress(event->OtaStateChanged.newState);
+        break;
+
+    default:
+        break;
+    }
+}
+
+// This callback is invoked when clients interact with the Identify Cluster.
+// In the callback implementation, an endpoint can identify itself. (e.g., by flashing a light).
+static esp_err_t app_identification_cb(identification::callback_type_t type, uint16_t endpoint_id, uint8_t effect_id,
+                                       uint8_t effect_variant, void *priv_data)
+{
+    ESP_LOGI(TAG, "Identification callback: type: %u, effect: %u, variant: %u", type, effect_id, effect_variant);
+#if CONFIG_SKULL_STATUS_LED
+    // Rendered on the status LED by the output sequencer; none of these block
+    switch (type) {
+    case identification::callback_type_t::START:
+        return app_identify_start();
+    case identification::callback_type_t::STOP:
+        app_identify_stop();
+        return ESP_OK;
+    case identification::callback_type_t::EFFECT:
+        return app_identify_effect(effect_id);
+    default:
+        break;
+    }
+#endif
+    return ESP_OK;
+}
+
+// The firmware's own OnOff writes. Commands are applied on the Matter thread with the chip stack
+// lock held, so holding it across the write keeps g_local_update from covering a real command
+// that arrives meanwhile. Callers already on the Matter thread hold the lock and keep it.
+static esp_err_t update_onoff_local(uint16_t endpoint_id, bool on)
+{
+    esp_matter_attr_val_t val = esp_matter_bool(on);
+    lock::status_t lock_status = lock::chip_stack_lock(portMAX_DELAY);
+    g_local_update = true;
+    esp_err_t err = attribute::update(endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id, &val);
+    g_local_update = false;
+    if (lock_status == lock::SUCCESS) {
+        lock::chip_stack_unlock();
+    }
+    return err;
+}
+
+// Reports the switch state to controllers without running the trigger path
+static void report_switch_state(bool on)
+{
+    esp_err_t err = update_onoff_local(g_switch_endpoint_id, on);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Matter attribute updated to %s successfully", on ? "ON" : "OFF");
+    } else {
+        ESP_LOGE(TAG, "Failed to update Matter attribute to %s: %s", on ? "ON" : "OFF", esp_err_to_name(err));
+    }
+}
+
+#if CONFIG_SKULL_REPORT_COALESCE
+// The pulse ended or was stopped
+static void end_coalesced_pulse(void)
+{
+    lock::status_t lock_status = lock::chip_stack_lock(portMAX_DELAY);
+    g_coalesced_pulse = false;
+    if (lock_status == lock::SUCCESS) {
+        lock::chip_stack_unlock();
+    }
+}
+#endif
+
+// Runs in the esp_timer task once the pulse has been fully rendered on the signal line
+static void pulse_done_cb(app_output_channel_t channel, void *user_data)
+{
+    ESP_LOGI(TAG, "Pulse ended - GPIO %d LOW", SIGNAL_GPIO);
+
+#if CONFIG_SKULL_REPORT_COALESCE
+    end_coalesced_pulse();
+#endif
+#if !CONFIG_SKULL_BUSY_INPUT
+    // Without the busy line the switch reports OFF as soon as the pulse is over. After a
+    // coalesced ON the attribute is already OFF and the update marks nothing dirty.
+    report_switch_state(false);
+#endif
+}
+
+#if CONFIG_SKULL_LINK_UART
+static esp_err_t init_controller_link()
+{
+    app_link_config_t link_config = {
+        .uart_num = CONFIG_SKULL_LINK_UART_NUM,
+        .tx_gpio = CONFIG_SKULL_LINK_TX_GPIO,
+        .rx_gpio = CONFIG_SKULL_LINK_RX_GPIO,
+        .baud_rate = CONFIG_SKULL_LINK_BAUD,
+        .ack_timeout_ms = CONFIG_SKULL_LINK_ACK_TIMEOUT_MS,
+#if CONFIG_SKULL_LINK_ACK_TIMEOUT_MS > 0
+        .retries = CONFIG_SKULL_LINK_RETRIES,
+#endif
+    };
+    return app_link_init(&link_config);
+}
+#endif
+
+#if CONFIG_SKULL_BUSY_INPUT
+// Runs in the FreeRTOS timer task; the switch reports ON for as long as the animatronic plays
+static void busy_state_cb(bool busy, void *user_data)
+{
+    ESP_LOGI(TAG, "Animatronic %s", busy ? "busy" : "idle");
+    app_trace_append(APP_TRACE_BUSY, 0, busy, 0);
+    report_switch_state(busy);
+}
+
+static esp_err_t init_busy_input()
+{
+    app_busy_config_t busy_config = {
+        .gpio_num = CONFIG_SKULL_BUSY_GPIO,
+        .active_level = CONFIG_SKULL_BUSY_ACTIVE_LEVEL,
+        .start_timeout_ms = CONFIG_SKULL_BUSY_START_TIMEOUT_MS,
+        .state_cb = busy_state_cb,
+        .user_data = NULL,
+    };
+    return app_busy_init(&busy_config);
+}
+#endif
+
+#if CONFIG_SKULL_STATUS_LED
+// Runs in the esp_timer task whenever a status LED pattern completes
+static void status_done_cb(app_output_channel_t channel, void *user_data)
+{
+    app_identify_handle_done();
+}
+
+static esp_err_t init_status_led()
+{
+    app_output_config_t output_config = {
+        .gpio_num = CONFIG_SKULL_STATUS_LED_GPIO,
+        .active_low = CONFIG_SKULL_STATUS_LED_ACTIVE_LOW,
+        .done_cb = status_done_cb,
+        .user_data = NULL,
+    };
+    esp_err_t err = app_output_init(APP_OUTPUT_CHANNEL_STATUS, &output_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize status LED on GPIO %d: %s", CONFIG_SKULL_STATUS_LED_GPIO,
+                 esp_err_to_name(err));
+        return err;
+    }
+    return app_identify_init(APP_OUTPUT_CHANNEL_STATUS);
+}
+#endif
+
+// GPIO control functions (defined before they're used)
+static esp_err_t init_signal_gpio()
+{
+    app_output_config_t output_config = {
+        .gpio_num = SIGNAL_GPIO,
+        .done_cb = pulse_done_cb,
+        .user_data = NULL,
+    };
+    esp_err_t err = app_output_init(APP_OUTPUT_CHANNEL_SIGNAL, &output_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize signal output on GPIO %d: %s", SIGNAL_GPIO, esp_err_to_name(err));
+        return err;
+    }
+    app_limiter_config_t limiter_config;
+    err = app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &limiter_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize signal rate limiter: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Signal GPIO %d initialized", SIGNAL_GPIO);
+    return ESP_OK;
+}
+
+#define MAX_BURST_PULSES    APP_GESTURE_MAX_CLICKS
+#define MAX_BURST_US        (MAX_BURST_PULSES * APP_SETTINGS_PULSE_MS_MAX * 1000ULL + \
+                             (MAX_BURST_PULSES - 1) * CONFIG_SKULL_BUTTON_BURST_GAP_MS * 1000ULL)
+
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+// The signal line and the status LED play a burst from their own RMT symbol buffer, which must
+// hold the longest one the settings allow
+static_assert(APP_OUTPUT_RMT_SYMBOLS_MAX(MAX_BURST_US, 2 * MAX_BURST_PULSES - 1,
+                                         CONFIG_SKULL_OUTPUT_RMT_TICKS_PER_US) <= CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS,
+              "The longest burst does not fit the RMT symbol buffer; raise SKULL_OUTPUT_RMT_MAX_SYMBOLS or lower "
+              "SKULL_OUTPUT_RMT_TICKS_PER_US or SKULL_BUTTON_BURST_GAP_MS");
+#endif
+
+// Bursts are built on the Matter thread. A burst's steps must outlive its playback, and the status
+// LED may still be finishing the last one when the next starts, so the two buffers take turns.
+static app_output_step_t s_burst_steps[2][2 * MAX_BURST_PULSES - 1];
+static uint8_t s_burst_buffer;
+
+// A refused trigger goes to the flash log and, while recording, to the input trace
+static void note_ignored(app_evtlog_source_t source, app_evtlog_ignore_reason_t reason)
+{
+    app_evtlog_append(APP_EVTLOG_TRIGGER_IGNORED, source, reason);
+    app_trace_append(APP_TRACE_IGNORED, source, reason, 0);
+}
+
+// Fires `pulses` pulses of the configured width, CONFIG_SKULL_BUTTON_BURST_GAP_MS apart, or the
+// library pattern `pattern_id` when it is not 0.
+// Returns ESP_ERR_NOT_ALLOWED when the rate limiter rejected the trigger, ESP_ERR_NOT_FOUND when
+// the library has no such pattern and the output's error when the signal failed to start. A
+// trigger ignored because the prop is busy returns ESP_OK too; `started` tells the two apart.
+static esp_err_t start_trigger(app_evtlog_source_t source, uint8_t pulses, uint8_t pattern_id, bool *started = NULL)
+{
+    if (started) {
+        *started = false;
+    }
+    // With the RMT backend both edges are timed by hardware; the software GPIO
+    // backend (fallback) drives the falling edge from an esp_timer callback.
+    // Lock-free read of the PulseDuration attribute mirror
+    int64_t request_us = esp_timer_get_time();
+    uint32_t pulse_ms = app_settings_get_pulse_ms();
+    if (source == APP_EVTLOG_SRC_CONSOLE || source == APP_EVTLOG_SRC_HOST) {
+        // Every other source is traced where its input arrives
+        app_trace_append(APP_TRACE_FIRE, source, pulses, pattern_id);
+    }
+    app_pattern_info_t info = {};
+    if (pattern_id != 0 && app_pattern_find(pattern_id, &info) != ESP_OK) {
+        ESP_LOGW(TAG, "No pattern %u in the library", pattern_id);
+        return ESP_ERR_NOT_FOUND;
+    }
+    // Checked before the limiter so a trigger landing on a running pulse does not cost a token
+    if (app_output_is_active(APP_OUTPUT_CHANNEL_SIGNAL)) {
+        ESP_LOGW(TAG, "Pulse already active, ignoring");
+        note_ignored(source, APP_EVTLOG_IGNORED_BUSY);
+        app_stats_ignored();
+        return ESP_OK;
+    }
+#if CONFIG_SKULL_BUSY_INPUT
+    // Retriggering would interrupt playback
+    if (app_busy_is_busy()) {
+        ESP_LOGW(TAG, "Animatronic still playing, ignoring");
+        note_ignored(source, APP_EVTLOG_IGNORED_PLAYING);
+        app_stats_ignored();
+        return ESP_OK;
+    }
+#endif
+#if CONFIG_SKULL_THERMAL
+    // Published by the sensor task; one byte load, no I2C here
+    uint8_t thermal_pct = app_thermal_scale_pct();
+    if (thermal_pct == 0) {
+        ESP_LOGW(TAG, "Enclosure too hot, trigger refused");
+        note_ignored(source, APP_EVTLOG_IGNORED_THERMAL);
+        app_stats_rate_limited();
+        return ESP_ERR_NOT_ALLOWED;
+    }
+    if (thermal_pct < 100) {
+        // Patterns keep their shape; they are only held to the derated duty budget below
+        uint32_t max_pulse_ms = app_thermal_max_pulse_ms(thermal_pct, APP_SETTINGS_PULSE_MS_MIN);
+        pulse_ms = pulse_ms > max_pulse_ms ? max_pulse_ms : pulse_ms;
+    }
+#else
+    uint8_t thermal_pct = 100;
+#endif
+    // A pattern is charged for the time its line is actually high
+    uint32_t high_us = pattern_id != 0 ? info.high_us : pulses * pulse_ms * 1000;
+    app_limiter_verdict_t verdict =
+        app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, high_us, request_us, thermal_pct);
+    if (verdict != APP_LIMITER_ALLOWED) {
+        bool rate = (verdict == APP_LIMITER_REJECTED_RATE);
+        ESP_LOGW(TAG, "Trigger rejected by the limiter (%s)", rate ? "rate" : "duty cycle");
+        note_ignored(source, rate ? APP_EVTLOG_IGNORED_RATE : APP_EVTLOG_IGNORED_DUTY);
+        app_stats_rate_limited();
+        return ESP_ERR_NOT_ALLOWED;
+    }
+    esp_err_t err;
+    app_output_step_t *steps = NULL;
+    if (pattern_id != 0) {
+        // Played straight from the mapped partition
+        err = app_pattern_play(APP_OUTPUT_CHANNEL_SIGNAL, pattern_id);
+    } else if (pulses <= 1) {
+        err = app_output_pulse(APP_OUTPUT_CHANNEL_SIGNAL, pulse_ms * 1000); // Convert to microseconds
+    } else {
+        pulses = pulses > MAX_BURST_PULSES ? MAX_BURST_PULSES : pulses;
+        s_burst_buffer ^= 1;
+        steps = s_burst_steps[s_burst_buffer];
+        uint16_t step_count = 0;
+        for (uint8_t i = 0; i < pulses; i++) {
+            if (i > 0) {
+                steps[step_count++] = {.duration_us = CONFIG_SKULL_BUTTON_BURST_GAP_MS * 1000, .level = 0};
+            }
+            steps[step_count++] = {.duration_us = pulse_ms * 1000, .level = 1};
+        }
+        app_output_pattern_t pattern = {.steps = steps, .step_count = step_count};
+        err = app_output_play(APP_OUTPUT_CHANNEL_SIGNAL, &pattern);
+    }
+    if (err != ESP_OK) {
+        // Nothing was driven, so nothing is charged
+        app_limiter_refund(APP_OUTPUT_CHANNEL_SIGNAL, high_us, request_us);
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "Pulse already active, ignoring");
+        note_ignored(source, APP_EVTLOG_IGNORED_BUSY);
+        app_stats_ignored();
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start pulse: %s", esp_err_to_name(err));
+        return err;
+    }
+    uint32_t latency_us = (uint32_t)(esp_timer_get_time() - request_us);
+    app_stats_trigger(latency_us);
+#if CONFIG_SKULL_STATUS_LED
+    // The signal line is already running; only then does the LED get taken over from Identify
+    app_identify_preempt();
+    app_output_stop(APP_OUTPUT_CHANNEL_STATUS);
+    if (pattern_id != 0) {
+        err = app_pattern_play(APP_OUTPUT_CHANNEL_STATUS, pattern_id);
+    } else if (pulses <= 1) {
+        err = app_output_pulse(APP_OUTPUT_CHANNEL_STATUS, pulse_ms * 1000);
+    } else {
+        app_output_pattern_t pattern = {.steps = steps, .step_count = (uint16_t)(2 * pulses - 1)};
+        err = app_output_play(APP_OUTPUT_CHANNEL_STATUS, &pattern);
+    }
+    if (err != ESP_OK) {
+        // The signal is already out; only the mirror is missing, so Identify gets the LED back
+        ESP_LOGW(TAG, "Status LED did not mirror the trigger: %s", esp_err_to_name(err));
+        app_identify_resume();
+    }
+#endif
+#if CONFIG_SKULL_LINK_UART
+    // Queued only; the UART driver drains it in the background
+    if (app_link_play(CONFIG_SKULL_LINK_TRACK, CONFIG_SKULL_LINK_VOLUME, CONFIG_SKULL_LINK_EFFECT) != ESP_OK) {
+        ESP_LOGW(TAG, "Controller link busy, PLAY frame dropped");
+    }
+#endif
+#if CONFIG_SKULL_BUSY_INPUT
+    app_busy_note_trigger(esp_timer_get_time());
+#endif
+    // Latency in the low 24 bits (saturated), the pulse count on top; 0 pulses marks a pattern
+    uint32_t traced = (latency_us > 0xFFFFFF ? 0xFFFFFF : latency_us) |
+                      (uint32_t)(pattern_id != 0 ? 0 : pulses) << 24;
+    if (pattern_id != 0) {
+        uint32_t high_ms = info.high_us / 1000;
+        app_evtlog_append(APP_EVTLOG_TRIGGER, source, high_ms > UINT16_MAX ? UINT16_MAX : (uint16_t)high_ms);
+        app_trace_append(APP_TRACE_TRIGGER, source, high_ms > UINT16_MAX ? UINT16_MAX : (uint16_t)high_ms, traced);
+        ESP_LOGI(TAG, "Pattern %u started - GPIO %d, %u steps, %" PRIu32 " ms", pattern_id, SIGNAL_GPIO,
+                 info.step_count, info.total_us / 1000);
+    } else {
+        app_evtlog_append(APP_EVTLOG_TRIGGER, source, (uint16_t)pulse_ms);
+        app_trace_append(APP_TRACE_TRIGGER, source, (uint16_t)pulse_ms, traced);
+        ESP_LOGI(TAG, "Pulse started - GPIO %d HIGH for %" PRIu32 " ms x %u", SIGNAL_GPIO, pulse_ms, pulses);
+    }
+    if (started) {
+        *started = true;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t start_pulse(app_evtlog_source_t source, uint8_t pulses = 1, bool *started = NULL)
+{
+    return start_trigger(source, pulses, 0, started);
+}
+
+static esp_err_t start_pattern(app_evtlog_source_t source, uint8_t pattern_id)
+{
+    // Id 0 would fall back to a plain pulse
+    if (pattern_id == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return start_trigger(source, 1, pattern_id);
+}
+
+static void stop_pulse()
+{
+#if CONFIG_SKULL_REPORT_COALESCE
+    end_coalesced_pulse();
+#endif
+    app_output_stop(APP_OUTPUT_CHANNEL_SIGNAL);
+#if CONFIG_SKULL_STATUS_LED
+    if (!app_identify_is_active()) {
+        // No done callback follows a stopped mirror; an effect it cut short comes back here
+        app_output_stop(APP_OUTPUT_CHANNEL_STATUS);
+        app_identify_resume();
+    }
+#endif
+#if CONFIG_SKULL_LINK_UART
+    app_link_stop();
+#endif
+    ESP_LOGI(TAG, "Pulse stopped - GPIO %d LOW", SIGNAL_GPIO);
+}
+
+// Runs on the Matter thread, with the chip stack lock held
+static void scheduled_trigger_work(intptr_t arg)
+{
+    start_pulse(APP_EVTLOG_SRC_SCHEDULED);
+}
+
+// Runs in the esp_timer task when a scheduled trigger comes due; the trigger path is handed to the
+// Matter thread like the button's and the PIR's
+static void scheduled_trigger_cb(void *arg)
+{
+    if (chip::DeviceLayer::PlatformMgr().ScheduleWork(scheduled_trigger_work, 0) != CHIP_NO_ERROR) {
+        ESP_LOGW(TAG, "Scheduled trigger dropped, Matter thread unavailable");
+    }
+}
+
+// A trigger from the REPL task (console and host protocol), run on the Matter thread
+typedef struct {
+    app_evtlog_source_t source;
+    uint8_t pulses;
+    uint8_t pattern_id;
+    esp_err_t err;
+} repl_trigger_t;
+
+static SemaphoreHandle_t s_repl_trigger_done;
+
+// Runs on the Matter thread, with the chip stack lock held
+static void repl_trigger_work(intptr_t arg)
+{
+    repl_trigger_t *trigger = (repl_trigger_t *)arg;
+    if (trigger->pattern_id != 0) {
+        trigger->err = start_pattern(trigger->source, trigger->pattern_id);
+    } else {
+        trigger->err = start_pulse(trigger->source, trigger->pulses);
+    }
+    xSemaphoreGive(s_repl_trigger_done);
+}
+
+// The REPL task can wait, so it gets the trigger's result back. Only the REPL task calls this.
+static esp_err_t run_repl_trigger(app_evtlog_source_t source, uint8_t pulses, uint8_t pattern_id)
+{
+    if (!esp_matter::is_started()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_repl_trigger_done) {
+        static StaticSemaphore_t done_buffer;
+        s_repl_trigger_done = xSemaphoreCreateBinaryStatic(&done_buffer);
+    }
+    repl_trigger_t trigger = {.source = source, .pulses = pulses, .pattern_id = pattern_id, .err = ESP_FAIL};
+    if (chip::DeviceLayer::PlatformMgr().ScheduleWork(repl_trigger_work, (intptr_t)&trigger) != CHIP_NO_ERROR) {
+        return ESP_ERR_NO_MEM;
+    }
+    // The Matter thread runs for good once started; the work always completes
+    xSemaphoreTake(s_repl_trigger_done, portMAX_DELAY);
+    return trigger.err;
+}
+
+// Runs on the Matter thread, with the chip stack lock held: the trigger path and factory_reset()
+// touch the stack and the flash and have no business in the timer task. arg holds the gesture in
+// the low byte and the low 24 bits of the press time in ms above it.
+static void button_gesture_work(intptr_t arg)
+{
+    app_gesture_t gesture = (app_gesture_t)(arg & 0xFF);
+    switch (gesture) {
+    case APP_GESTURE_SINGLE:
+    case APP_GESTURE_DOUBLE:
+    case APP_GESTURE_TRIPLE: {
+#if CONFIG_SKULL_BUTTON_TRIGGER
+        // Library patterns 1-3 replace the built-in bursts when present
+        uint8_t clicks = gesture - APP_GESTURE_SINGLE + 1;
+        if (app_pattern_find(clicks, NULL) == ESP_OK) {
+            start_pattern(APP_EVTLOG_SRC_BUTTON, clicks);
+        } else {
+            start_pulse(APP_EVTLOG_SRC_BUTTON, clicks);
+        }
+        uint32_t press_ms = (uint32_t)arg >> 8;
+        ESP_LOGI(TAG, "Button %s click, press to pulse %" PRIu32 " ms", app_gesture_name(gesture),
+                 ((uint32_t)(esp_timer_get_time() / 1000) - press_ms) & 0xFFFFFF);
+#endif
+        break;
+    }
+    case APP_GESTURE_LONG_PRESS:
+        ESP_LOGW(TAG, "Starting factory reset");
+        esp_matter::factory_reset();
+        break;
+    default:
+        break;
+    }
+}
+
+// Runs in the FreeRTOS timer task. Clicks test-fire, a long press still does factory reset; both
+// are handed to the Matter thread.
+static void button_gesture_cb(app_gesture_t gesture, int64_t press_us, void *user_data)
+{
+    app_trace_append(APP_TRACE_BUTTON, gesture, 0, (uint32_t)(esp_timer_get_time() - press_us));
+    if (gesture == APP_GESTURE_LONG_HOLD) {
+        ESP_LOGW(TAG, "Long press detected. Release the button to start factory reset.");
+        return;
+    }
+    intptr_t arg = (intptr_t)gesture | (intptr_t)(((uint32_t)(press_us / 1000) & 0xFFFFFF) << 8);
+    if (chip::DeviceLayer::PlatformMgr().ScheduleWork(button_gesture_work, arg) != CHIP_NO_ERROR) {
+        // The stack is not up yet or its event queue is full
+        ESP_LOGW(TAG, "Button %s dropped, Matter thread unavailable", app_gesture_name(gesture));
+    }
+}
+
+static esp_err_t init_button_gestures()
+{
+    app_gesture_config_t gesture_config = {
+        .gpio_num = CONFIG_SKULL_BUTTON_GPIO,
+        .active_level = 0,
+        .debounce_ms = CONFIG_SKULL_BUTTON_DEBOUNCE_MS,
+        .click_gap_ms = CONFIG_SKULL_BUTTON_CLICK_GAP_MS,
+        .long_press_ms = CONFIG_SKULL_BUTTON_LONG_PRESS_MS,
+        .cb = button_gesture_cb,
+        .user_data = NULL,
+    };
+    return app_gesture_init(&gesture_config);
+}
+
+#if CONFIG_SKULL_PIR_INPUT
+#if CONFIG_SKULL_PIR_TRIGGER
+// Runs on the Matter thread, with the chip stack lock held
+static void pir_trigger_work(intptr_t arg)
+{
+    start_pulse(APP_EVTLOG_SRC_MOTION);
+}
+#endif
+
+// Both run in the FreeRTOS timer task
+static void pir_edge_cb(uint8_t sensor, bool level, void *user_data)
+{
+    app_stats_pir_edge();
+    app_evtlog_append(APP_EVTLOG_PIR_EDGE, sensor, level);
+    app_trace_append(APP_TRACE_PIR_EDGE, sensor, level, 0);
+}
+
+static void pir_occupancy_cb(bool occupied, uint8_t first_sensor, void *user_data)
+{
+    if (!occupied) {
+        ESP_LOGI(TAG, "Area unoccupied");
+        return;
+    }
+    ESP_LOGI(TAG, "Area occupied, first motion on PIR %u", first_sensor);
+#if CONFIG_SKULL_PIR_TRIGGER
+    // The trigger path does not belong in the timer task; fire it on the Matter thread
+    if (chip::DeviceLayer::PlatformMgr().ScheduleWork(pir_trigger_work, 0) != CHIP_NO_ERROR) {
+        ESP_LOGW(TAG, "Motion trigger dropped, Matter thread unavailable");
+    }
+#endif
+}
+
+static esp_err_t init_pir_input()
+{
+    static const int gpios[] = {
+        CONFIG_SKULL_PIR1_GPIO,
+#if CONFIG_SKULL_PIR_COUNT >= 2
+        CONFIG_SKULL_PIR2_GPIO,
+#endif
+#if CONFIG_SKULL_PIR_COUNT >= 3
+        CONFIG_SKULL_PIR3_GPIO,
+#endif
+#if CONFIG_SKULL_PIR_COUNT >= 4
+        CONFIG_SKULL_PIR4_GPIO,
+#endif
+    };
+    app_pir_config_t pir_config;
+    for (size_t i = 0; i < sizeof(gpios) / sizeof(gpios[0]); i++) {
+        pir_config.sensors[i] = {.gpio_num = gpios[i], .debounce_ms = CONFIG_SKULL_PIR_DEBOUNCE_MS};
+    }
+    pir_config.sensor_count = sizeof(gpios) / sizeof(gpios[0]);
+    pir_config.hold_ms = (uint32_t)app_settings_get()->pir_hold_s * 1000;
+    pir_config.occupancy_cb = pir_occupancy_cb;
+    pir_config.edge_cb = pir_edge_cb;
+    return app_pir_init(&pir_config);
+}
+#endif
+
+#if CONFIG_SKULL_SHTC3
+// All run in the SHTC3 polling task
+static void temperature_cb(uint16_t endpoint_id, float value, void *user_data)
+{
+    ESP_LOGD(TAG, "Temperature %.1f C", value);
+    // The driver only hands out the converted value; its bits let a replay round it like app_thermal
+    int16_t centi_c = isnan(value) ? INT16_MIN : (int16_t)lroundf(value * 100);
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    app_trace_append(APP_TRACE_TEMPERATURE, 0, (uint16_t)centi_c, bits);
+#if CONFIG_SKULL_THERMAL
+    app_stats_thermal_throttle(100 - app_thermal_update(value));
+#endif
+}
+
+static void sensor_status_cb(shtc3_status_t status, esp_err_t err, void *user_data)
+{
+    switch (status) {
+    case SHTC3_STATUS_READ_FAILED:
+        app_stats_sensor_error();
+        break;
+    case SHTC3_STATUS_DEGRADED:
+        app_evtlog_append(APP_EVTLOG_SENSOR_FAULT, APP_EVTLOG_SENSOR_SHTC3, (uint16_t)err);
+        break;
+    case SHTC3_STATUS_RECOVERED:
+        break;
+    }
+}
+
+static esp_err_t init_temperature_sensor()
+{
+#if CONFIG_SKULL_THERMAL
+    app_thermal_config_t thermal_config;
+    thermal_config.derate_start_c = CONFIG_SKULL_THERMAL_DERATE_START_C;
+    thermal_config.derate_full_c = CONFIG_SKULL_THERMAL_DERATE_FULL_C;
+    thermal_config.min_scale_pct = CONFIG_SKULL_THERMAL_MIN_SCALE_PCT;
+    thermal_config.cutoff_c = CONFIG_SKULL_THERMAL_CUTOFF_C;
+    thermal_config.hysteresis_c = CONFIG_SKULL_THERMAL_HYSTERESIS_C;
+    thermal_config.unknown_scale_pct = CONFIG_SKULL_THERMAL_UNKNOWN_SCALE_PCT;
+    thermal_config.max_pulse_ms = CONFIG_SKULL_THERMAL_MAX_PULSE_MS;
+    esp_err_t err = app_thermal_init(&thermal_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid thermal derating curve: %s", esp_err_to_name(err));
+        return err;
+    }
+    app_stats_thermal_throttle(100 - app_thermal_scale_pct());
+#endif
+    static shtc3_sensor_config_t shtc3_config;
+    shtc3_config.temperature.cb = temperature_cb;
+    shtc3_config.status_cb = sensor_status_cb;
+    shtc3_config.interval_ms = app_settings_get()->shtc3_interval_ms;
+    return shtc3_sensor_init(&shtc3_config);
+}
+#endif
+
+// Writes to the control cluster carry a delay or an absolute fire time instead of "fire now"
+static esp_err_t handle_control_write(uint32_t attribute_id, esp_matter_attr_val_t *val)
+{
+    esp_err_t err = ESP_OK;
+    if (attribute_id == SkullControl::Attributes::TriggerDelay::Id) {
+        app_trace_append(APP_TRACE_CONTROL, APP_TRACE_TRIGGER_DELAY, 0, val->val.u32);
+        ESP_LOGI(TAG, "Trigger scheduled in %" PRIu32 " ms", val->val.u32);
+        err = app_sched_after(val->val.u32, scheduled_trigger_cb, NULL);
+    } else if (attribute_id == SkullControl::Attributes::TriggerAtUtc::Id) {
+        app_trace_append(APP_TRACE_CONTROL, APP_TRACE_TRIGGER_AT_UTC, (uint16_t)(val->val.u64 >> 32),
+                         (uint32_t)val->val.u64);
+        ESP_LOGI(TAG, "Trigger scheduled at %" PRIu64 " ms (UTC)", val->val.u64);
+        err = app_sched_at_utc(val->val.u64, scheduled_trigger_cb, NULL);
+    } else if (attribute_id == SkullControl::Attributes::PulseDuration::Id) {
+        app_trace_append(APP_TRACE_CONTROL, APP_TRACE_PULSE_DURATION, 0, val->val.u16);
+        ESP_LOGI(TAG, "Pulse duration set to %u ms", val->val.u16);
+        err = app_settings_set_pulse_ms(val->val.u16);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Rejected pulse duration %u ms", val->val.u16);
+        }
+        return err;
+    } else if (attribute_id == SkullControl::Attributes::TriggerPattern::Id) {
+        app_trace_append(APP_TRACE_CONTROL, APP_TRACE_TRIGGER_PATTERN, 0, val->val.u8);
+        ESP_LOGI(TAG, "Pattern %u requested", val->val.u8);
+        // Unknown patterns and limiter rejections fail the write, like an ON that was refused
+        return start_pattern(APP_EVTLOG_SRC_MATTER, val->val.u8);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to schedule trigger: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+// A suppressed duplicate ON still turned the attribute on; put it back once the command is done
+static void revert_duplicate_on(intptr_t endpoint_id)
+{
+    update_onoff_local((uint16_t)endpoint_id, false);
+}
+
+#if CONFIG_SKULL_REPORT_COALESCE
+// The command is still being handled, so the reporting engine has not seen the ON yet. Folding
+// the attribute back to OFF now leaves subscribers one report (OFF, DataVersion two ahead) where
+// they would get ON now and OFF at the end of the pulse. When that report goes out is still up
+// to the engine and each subscription's min/max intervals.
+// Subscriptions whose paths cover OnOff on the endpoint, wildcards included: the ones a folded
+// pulse saves a report on
+static uint32_t onoff_subscriptions(uint16_t endpoint_id)
+{
+    using chip::app::InteractionModelEngine;
+    using chip::app::ReadHandler;
+    InteractionModelEngine *engine = InteractionModelEngine::GetInstance();
+    const chip::app::ConcreteAttributePath onoff(endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < engine->GetNumActiveReadHandlers(); i++) {
+        ReadHandler *handler = engine->ActiveHandlerAt(i);
+        if (!handler || !handler->IsType(ReadHandler::InteractionType::Subscribe)) {
+            continue;
+        }
+        for (auto *path = handler->GetAttributePathList(); path; path = path->mpNext) {
+            if (path->mValue.IsAttributePathSupersetOf(onoff)) {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+static void coalesce_on_report(uint16_t endpoint_id)
+{
+    esp_err_t err = update_onoff_local(endpoint_id, false);
+    if (err == ESP_OK) {
+        app_stats_reports_saved(onoff_subscriptions(endpoint_id));
+    }
+}
+
+// While a folded pulse plays the attribute reads OFF, so the On/Off server sees an OFF switch:
+// Off changes nothing and never reaches app_attribute_update_cb(), and Toggle or On turn it ON
+// (deferred there). Give each command the meaning it has for the switch that is really ON.
+static void handle_command_during_coalesced_pulse(uint16_t endpoint_id, chip::CommandId command_id)
+{
+    bool deferred = g_onoff_deferred;
+    g_onoff_deferred = false;
+    if (command_id == OnOff::Commands::Off::Id || (command_id == OnOff::Commands::Toggle::Id && deferred)) {
+        stop_pulse();
+        if (deferred) {
+            update_onoff_local(endpoint_id, false);
+        }
+    } else if (deferred) {
+        // On while ON: nothing to start, as without coalescing; the pulse stays folded
+        coalesce_on_report(endpoint_id);
+    }
+}
+#endif
+
+// Runs on the Matter thread right after the On/Off server has applied On/Off/Toggle, which is
+// the first point where the sending fabric is known
+static esp_err_t onoff_command_cb(const chip::app::ConcreteCommandPath &command_path, chip::TLV::TLVReader &tlv_data,
+                                  void *opaque_ptr)
+{
+    chip::app::CommandHandler *command_handler = static_cast<chip::app::CommandHandler *>(opaque_ptr);
+    app_dedupe_commit(command_handler ? command_handler->GetAccessingFabricIndex() : chip::kUndefinedFabricIndex);
+#if CONFIG_SKULL_REPORT_COALESCE
+    if (g_coalesce_pending) {
+        g_coalesce_pending = false;
+        g_coalesced_pulse = true;
+        coalesce_on_report(command_path.mEndpointId);
+    } else if (g_coalesced_pulse || g_onoff_deferred) {
+        handle_command_during_coalesced_pulse(command_path.mEndpointId, command_path.mCommandId);
+    }
+#endif
+    return ESP_OK;
+}
+
+static void register_onoff_command_cbs(endpoint_t *endpoint)
+{
+    cluster_t *cluster = cluster::get(endpoint, OnOff::Id);
+    if (!cluster) {
+        return;
+    }
+    const uint32_t command_ids[] = {OnOff::Commands::On::Id, OnOff::Commands::Off::Id, OnOff::Commands::Toggle::Id};
+    for (uint32_t command_id : command_ids) {
+        command_t *command = command::get(cluster, command_id, COMMAND_FLAG_ACCEPTED);
+        if (command) {
+            command::set_user_callback(command, onoff_command_cb);
+        }
+    }
+}
+
+// This callback is called for every attribute update. The callback implementation shall
+// handle the desired attributes and return an appropriate error code. If the attribute
+// is not of your interest, please do not return an error code and strictly return ESP_OK.
+static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
+                                         uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+{
+    if (type == PRE_UPDATE) {
+        // Handle On/Off cluster commands
+        if (cluster_id == OnOff::Id && attribute_id == OnOff::Attributes::OnOff::Id) {
+            // The firmware's own writes (pulse end, duplicate revert, bench) never trigger anything
+            if (g_local_update) {
+                return ESP_OK;
+            }
+            bool new_state = val->val.b;
+            app_trace_append(APP_TRACE_ONOFF, (uint8_t)endpoint_id, new_state, 0);
+            ESP_LOGI(TAG, "On/Off command received: %s", new_state ? "ON" : "OFF");
+
+            // Accept the write so the controller sees success, but do not act on it twice
+            if (app_dedupe_check(endpoint_id, new_state, esp_timer_get_time())) {
+                ESP_LOGI(TAG, "Duplicate %s on endpoint %u suppressed", new_state ? "ON" : "OFF", endpoint_id);
+                if (new_state) {
+                    note_ignored(APP_EVTLOG_SRC_MATTER, APP_EVTLOG_IGNORED_DUPLICATE);
+                    app_stats_ignored();
+                    chip::DeviceLayer::PlatformMgr().ScheduleWork(revert_duplicate_on, endpoint_id);
+                }
+                return ESP_OK;
+            }
+
+#if CONFIG_SKULL_REPORT_COALESCE
+            if (new_state && g_coalesced_pulse) {
+                // On or Toggle while a folded pulse plays; the command callback tells them apart
+                g_onoff_deferred = true;
+                return ESP_OK;
+            }
+#endif
+            if (new_state) {
+                // Matter "ON" command - start pulse. A rate-limited trigger fails the write so the
+                // controller sees it was refused and the attribute does not stay ON.
+                bool started = false;
+                esp_err_t err = start_pulse(APP_EVTLOG_SRC_MATTER, 1, &started);
+                if (err != ESP_OK) {
+                    return err;
+                }
+#if CONFIG_SKULL_REPORT_COALESCE
+                // The pulse ends inside the window; onoff_command_cb() folds the ON back to OFF. An
+                // ON ignored while the prop is busy started nothing to fold.
+                g_coalesce_pending =
+                    started && app_settings_get_pulse_ms() <= CONFIG_SKULL_REPORT_COALESCE_WINDOW_MS;
+#endif
+            } else {
+                // Matter "OFF" command - stop pulse immediately
+                stop_pulse();
+            }
+        } else if (cluster_id == SkullControl::Id && endpoint_id == g_switch_endpoint_id) {
+            // Rejecting the write tells the controller the trigger was not scheduled
+            return handle_control_write(attribute_id, val);
+        }
+    } else if (type == POST_UPDATE) {
+        // Handle post-update to ensure HomeKit gets the final state
+        if (cluster_id == OnOff::Id && attribute_id == OnOff::Attributes::OnOff::Id) {
+            ESP_LOGI(TAG, "Post-update: On/Off attribute updated to %s", val->val.b ? "ON" : "OFF");
+        }
+    }
+    return ESP_OK;
+}
+
+// Simple factory reset trigger - will reset after 10 seconds
+static void trigger_factory_reset_timer(void)
+{
+    ESP_LOGW(TAG, "=== FACTORY RESET TRIGGERED ===");
+    ESP_LOGW(TAG, "Device will reset in 10 seconds...");
+    ESP_LOGW(TAG, "Unplug power now if you want to cancel!");
+    
+    vTaskDelay(pdMS_TO_TICKS(10000)); // Wait 10 seconds
+    
+    ESP_LOGI(TAG, "Starting factory reset NOW");
+    esp_matter::factory_reset();
+}
+
+// Console command for factory reset
+static int factory_reset_cmd(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "confirm") == 0) {
+        // Start the reset in a new task
+        xTaskCreate([](void*){ trigger_factory_reset_timer(); vTaskDelete(NULL); }, 
+                   "factory_reset", 4096, NULL, 5, NULL);
+        return 0;
+    } else {
+        printf("Usage: factory_reset confirm\n");
+        printf("WARNING: This will erase all pairing data!\n");
+        return 1;
+    }
+}
+
+// Parses a whole decimal argument; rejects signs, trailing text and values above max
+static bool parse_decimal(const char *text, uint64_t max, uint64_t *out)
+{
+    if (!text || *text < '0' || *text > '9') {
+        return false;
+    }
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || value > max) {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+// Console command to fire now, after a delay or at an absolute time
+static int trigger_cmd(int argc, char **argv)
+{
+    uint64_t value;
+    esp_err_t err = ESP_OK;
+    if (argc == 1) {
+        err = run_repl_trigger(APP_EVTLOG_SRC_CONSOLE, 1, 0);
+        if (err != ESP_OK) {
+            printf("Trigger not fired: %s\n", esp_err_to_name(err));
+            return 1;
+        }
+        return 0;
+    } else if (argc == 2 && strcmp(argv[1], "stats") == 0) {
+        app_sched_stats_t stats;
+        app_sched_get_stats(&stats);
+        printf("scheduled: %" PRIu32 ", fired: %" PRIu32 ", late: %" PRIu32 ", dropped: %" PRIu32 "\n",
+               stats.scheduled, stats.fired, stats.late, stats.dropped);
+        printf("pending: %u, worst lag: %" PRId32 " us\n", (unsigned)app_sched_pending(), stats.max_lag_us);
+        app_limiter_stats_t limiter;
+        app_limiter_get_stats(APP_OUTPUT_CHANNEL_SIGNAL, esp_timer_get_time(), &limiter);
+        printf("limiter: allowed: %" PRIu32 ", rejected (rate): %" PRIu32 ", rejected (duty): %" PRIu32 "\n",
+               limiter.allowed, limiter.rejected_rate, limiter.rejected_duty);
+        printf("tokens: %u, duty: %u.%u%%\n", limiter.tokens, limiter.duty_permille / 10, limiter.duty_permille % 10);
+#if CONFIG_SKULL_THERMAL
+        app_thermal_stats_t thermal;
+        app_thermal_get_stats(&thermal);
+        if (thermal.temperature_dc == INT16_MIN) {
+            printf("thermal: no sample, budget %u%%\n", thermal.scale_pct);
+        } else {
+            printf("thermal: %d.%d C, budget %u%%%s, %" PRIu32 " samples, %" PRIu32 " changes\n",
+                   thermal.temperature_dc / 10, abs(thermal.temperature_dc % 10), thermal.scale_pct,
+                   thermal.cut_off ? " (cut off)" : "", thermal.samples, thermal.changes);
+        }
+#endif
+#if CONFIG_SKULL_LINK_UART
+        app_link_stats_t link;
+        app_link_get_stats(&link);
+        printf("link: sent: %" PRIu32 ", resent: %" PRIu32 ", acked: %" PRIu32 ", timeouts: %" PRIu32
+               ", superseded: %" PRIu32 ", tx full: %" PRIu32 ", rx errors: %" PRIu32 "\n", link.sent, link.resent,
+               link.acked, link.timeouts, link.superseded, link.tx_full, link.rx_errors);
+        printf("ack time: last %" PRIu32 " us, worst %" PRIu32 " us\n", link.last_ack_us, link.max_ack_us);
+#endif
+        return 0;
+    } else if (argc == 2 && parse_decimal(argv[1], UINT32_MAX, &value)) {
+        err = app_sched_after((uint32_t)value, scheduled_trigger_cb, NULL);
+    } else if (argc == 3 && strcmp(argv[1], "at") == 0 && parse_decimal(argv[2], UINT64_MAX, &value)) {
+        err = app_sched_at_utc(value, scheduled_trigger_cb, NULL);
+    } else {
+        printf("Usage: trigger [<delay_ms> | at <unix_ms> | stats]\n");
+        return 1;
+    }
+    if (err != ESP_OK) {
+        printf("Failed to schedule trigger: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    return 0;
+}
+
+static void register_trigger_console_cmd()
+{
+    esp_console_cmd_t cmd = {
+        .command = "trigger",
+        .help = "Fire the signal now, after <delay_ms>, or 'at <unix_ms>'; 'stats' prints scheduler counters",
+        .hint = NULL,
+        .func = &trigger_cmd,
+    };
+    esp_console_cmd_register(&cmd);
+}
+
+// Console command to read back the on-flash event log
+static int evtlog_cmd(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "stats") == 0) {
+        app_evtlog_stats_t stats;
+        app_evtlog_get_stats(&stats);
+        printf("appended: %" PRIu32 ", dropped: %" PRIu32 ", flushes: %" PRIu32 "\n", stats.appended, stats.dropped,
+               stats.flushes);
+        printf("flash bytes written: %" PRIu32 ", sectors erased: %" PRIu32 "\n", stats.bytes_written, stats.erases);
+        return 0;
+    }
+    if (argc != 1) {
+        printf("Usage: evtlog [stats]\n");
+        return 1;
+    }
+    app_evtlog_dump();
+    return 0;
+}
 
-    chip::CommissioningWindowManager & commissionMgr = chip::Server::GetInstance().GetCommissioningWindowManager();
-    VerifyOrReturn(commissionMgr.IsCommissioningWindowOpen() == false);
+static void register_evtlog_console_cmd()
+{
+    esp_console_cmd_t cmd = {
+        .command = "evtlog",
+        .help = "Dump the trigger/event log, oldest first ('evtlog stats' for write counters)",
+        .hint = NULL,
+        .func = &evtlog_cmd,
+    };
+    esp_console_cmd_register(&cmd);
+}
 
-    // After removing last fabric, this example does not remove the Wi-Fi credentials
-    // and still has IP connectivity so, only advertising on DNS-SD.
-    CHIP_ERROR err = commissionMgr.OpenBasicCommissioningWindow(chip::System::Clock::Seconds16(300),
-                                    chip::CommissioningWindowAdvertisement::kDnssdOnly);
-    if (err != CHIP_NO_ERROR)
-    {
-        ESP_LOGE(TAG, "Failed to open commissioning window, err:%" CHIP_ERROR_FORMAT, err.Format());
+// Console command to print duplicate suppression counters per fabric
+static int dedupe_cmd(int argc, char **argv)
+{
+    if (argc != 1) {
+        printf("Usage: dedupe\n");
+        return 1;
     }
+    printf("window: %d ms\n", CONFIG_SKULL_DEDUPE_WINDOW_MS);
+    for (uint8_t fabric_index = 0; fabric_index < APP_DEDUPE_MAX_FABRICS; fabric_index++) {
+        app_dedupe_fabric_stats_t stats;
+        app_dedupe_get_stats(fabric_index, &stats);
+        if (stats.accepted == 0 && stats.suppressed == 0 && stats.unchanged == 0) {
+            continue;
+        }
+        printf("fabric %u: accepted: %" PRIu32 ", suppressed: %" PRIu32 " (cross-fabric: %" PRIu32 "), unchanged: %" PRIu32
+               "\n", fabric_index, stats.accepted, stats.suppressed, stats.cross_fabric, stats.unchanged);
+    }
+    return 0;
 }
 
-static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
+static void register_dedupe_console_cmd()
 {
-    switch (event->Type) {
-    case chip::DeviceLayer::DeviceEventType::kCommissioningComplete:
-        ESP_LOGI(TAG, "Commissioning complete");
-        break;
+    esp_console_cmd_t cmd = {
+        .command = "dedupe",
+        .help = "Print duplicate On/Off command counters per fabric (fabric 0: local changes)",
+        .hint = NULL,
+        .func = &dedupe_cmd,
+    };
+    esp_console_cmd_register(&cmd);
+}
 
-    case chip::DeviceLayer::DeviceEventType::kFailSafeTimerExpired:
-        ESP_LOGI(TAG, "Commissioning failed, fail safe timer expired");
-        break;
+#if CONFIG_SKULL_BENCH
+// Runs with the chip stack lock held around each benchmark write, like update_onoff_local()
+static void bench_update_guard(bool active)
+{
+    g_local_update = active;
+}
 
-    case chip::DeviceLayer::DeviceEventType::kFabricRemoved:
-        ESP_LOGI(TAG, "Fabric removed successfully");
-        open_commissioning_window_if_necessary();
-        break;
+// Console command to time the platform primitives on the trigger path
+static int bench_cmd(int argc, char **argv)
+{
+    uint32_t iterations = (argc >= 3) ? strtoul(argv[2], NULL, 10) : 200;
+    int first = 0;
+    int last = APP_BENCH_COUNT - 1;
+    if (argc >= 2 && strcmp(argv[1], "all") != 0) {
+        for (first = 0; first < APP_BENCH_COUNT; first++) {
+            if (strcmp(argv[1], app_bench_name((app_bench_id_t)first)) == 0) {
+                break;
+            }
+        }
+        last = first;
+    }
+    if (argc > 3 || first >= APP_BENCH_COUNT || iterations == 0) {
+        printf("Usage: bench [all|gpio|timer|attr|attr_locked|queue|i2c] [iterations]\n");
+        return 1;
+    }
 
-    case chip::DeviceLayer::DeviceEventType::kBLEDeinitialized:
-        ESP_LOGI(TAG, "BLE deinitialized and memory reclaimed");
-        break;
+    // Rewrites the switch OnOff attribute with its current value; each write is flagged as a
+    // local update so it does not stop a pulse or reach the dedupe table
+    app_bench_config_t config;
+    config.endpoint_id = g_switch_endpoint_id;
+    config.cluster_id = OnOff::Id;
+    config.attribute_id = OnOff::Attributes::OnOff::Id;
+    config.update_guard = bench_update_guard;
 
-    default:
-        break;
+    printf("%-12s %6s %10s %10s %10s %10s\n", "bench", "ops", "mean ns", "min ns", "max ns", "stddev ns");
+    for (int id = first; id <= last; id++) {
+        app_bench_result_t result;
+        esp_err_t err = app_bench_run((app_bench_id_t)id, &config, iterations, &result);
+        if (err == ESP_ERR_NOT_SUPPORTED) {
+            printf("%-12s not available\n", app_bench_name((app_bench_id_t)id));
+            continue;
+        }
+        printf("%-12s %6" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "%s\n",
+               app_bench_name((app_bench_id_t)id), result.iterations, result.mean_ns, result.min_ns, result.max_ns,
+               result.stddev_ns, err == ESP_OK ? "" : " (incomplete)");
     }
+    return 0;
 }
 
-// This callback is invoked when clients interact with the Identify Cluster.
-// In the callback implementation, an endpoint can identify itself. (e.g., by flashing a light).
-static esp_err_t app_identification_cb(identification::callback_type_t type, uint16_t endpoint_id, uint8_t effect_id,
-                                       uint8_t effect_variant, void *priv_data)
+static void register_bench_console_cmd()
 {
-    ESP_LOGI(TAG, "Identification callback: type: %u, effect: %u, variant: %u", type, effect_id, effect_variant);
-    return ESP_OK;
+    esp_console_cmd_t cmd = {
+        .command = "bench",
+        .help = "Time platform primitives: bench [all|gpio|timer|attr|attr_locked|queue|i2c] [iterations]",
+        .hint = NULL,
+        .func = &bench_cmd,
+    };
+    esp_console_cmd_register(&cmd);
 }
+#endif
 
-// GPIO control functions (defined before they're used)
-static esp_err_t init_signal_gpio()
+#if CONFIG_SKULL_BUSY_INPUT
+static void print_busy_hist(const char *name, const uint32_t *hist)
 {
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << SIGNAL_GPIO),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    
-    esp_err_t err = gpio_config(&io_conf);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to configure GPIO %d: %s", SIGNAL_GPIO, esp_err_to_name(err));
-        return err;
+    printf("%s:\n", name);
+    for (size_t i = 0; i < APP_BUSY_HIST_BUCKETS; i++) {
+        if (hist[i] == 0) {
+            continue;
+        }
+        if (i == 0) {
+            printf("  < 1 ms: %" PRIu32 "\n", hist[i]);
+        } else if (i == APP_BUSY_HIST_BUCKETS - 1) {
+            printf("  >= %lu ms: %" PRIu32 "\n", 1UL << (i - 1), hist[i]);
+        } else {
+            printf("  %lu-%lu ms: %" PRIu32 "\n", 1UL << (i - 1), (1UL << i) - 1, hist[i]);
+        }
     }
-    
-    // Initialize to LOW
-    gpio_set_level(SIGNAL_GPIO, 0);
-    ESP_LOGI(TAG, "Signal GPIO %d initialized", SIGNAL_GPIO);
-    return ESP_OK;
 }
 
-static void start_pulse()
+// Console command to print busy line statistics
+static int busy_cmd(int argc, char **argv)
 {
-    if (g_pulse_active) {
-        ESP_LOGW(TAG, "Pulse already active, ignoring");
-        return;
+    if (argc != 1) {
+        printf("Usage: busy\n");
+        return 1;
     }
-    
-    g_pulse_active = true;
-    gpio_set_level(SIGNAL_GPIO, 1);
-    ESP_LOGI(TAG, "Pulse started - GPIO %d HIGH", SIGNAL_GPIO);
-    
-    // Schedule pulse end
-    esp_timer_create_args_t timer_args = {
-        .callback = [](void* arg) {
-            gpio_set_level(SIGNAL_GPIO, 0);
-            g_pulse_active = false;
-            ESP_LOGI(TAG, "Pulse ended - GPIO %d LOW", SIGNAL_GPIO);
-            
-            // Small delay to ensure GPIO state is stable
-            vTaskDelay(pdMS_TO_TICKS(10));
-            
-            // Update Matter attribute back to OFF
-            esp_matter_attr_val_t val = esp_matter_bool(false);
-            esp_err_t err = attribute::update(g_switch_endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id, &val);
-            if (err == ESP_OK) {
-                ESP_LOGI(TAG, "Matter attribute updated to OFF successfully");
-            } else {
-                ESP_LOGE(TAG, "Failed to update Matter attribute to OFF: %s", esp_err_to_name(err));
-            }
-        },
-        .arg = nullptr,
-        .name = "pulse_timer"
+    app_busy_stats_t stats;
+    app_busy_get_stats(&stats);
+    printf("state: %s\n", app_busy_is_busy() ? "busy" : "idle");
+    printf("triggers: %" PRIu32 ", playbacks: %" PRIu32 ", unsolicited: %" PRIu32 ", timeouts: %" PRIu32
+           ", pend retries: %" PRIu32 "\n",
+           stats.triggers, stats.playbacks, stats.unsolicited, stats.timeouts, stats.pend_retries);
+    print_busy_hist("trigger to busy", stats.latency_hist);
+    print_busy_hist("playback duration", stats.duration_hist);
+    return 0;
+}
+
+static void register_busy_console_cmd()
+{
+    esp_console_cmd_t cmd = {
+        .command = "busy",
+        .help = "Print animatronic busy line state, trigger latency and playback duration histograms",
+        .hint = NULL,
+        .func = &busy_cmd,
     };
-    
-    esp_timer_handle_t timer;
-    esp_timer_create(&timer_args, &timer);
-    esp_timer_start_once(timer, PULSE_DURATION_MS * 1000); // Convert to microseconds
+    esp_console_cmd_register(&cmd);
 }
+#endif
 
-static void stop_pulse()
+#if CONFIG_SKULL_PIR_INPUT
+// Console command to print the fused occupancy state and per-sensor counters
+static int pir_cmd(int argc, char **argv)
 {
-    gpio_set_level(SIGNAL_GPIO, 0);
-    g_pulse_active = false;
-    ESP_LOGI(TAG, "Pulse stopped - GPIO %d LOW", SIGNAL_GPIO);
+    if (argc != 1) {
+        printf("Usage: pir\n");
+        return 1;
+    }
+    app_pir_state_t state;
+    app_pir_get_state(&state);
+    printf("%s, periods: %" PRIu32 ", pend retries: %" PRIu32 ", order:", state.occupied ? "occupied" : "unoccupied",
+           state.periods, state.pend_retries);
+    for (uint8_t i = 0; i < state.order_len; i++) {
+        printf(" %u", state.order[i]);
+    }
+    printf("\n");
+    int64_t now_us = esp_timer_get_time();
+    app_pir_sensor_stats_t stats;
+    for (uint8_t i = 0; app_pir_get_sensor_stats(i, &stats) == ESP_OK; i++) {
+        printf("PIR %u: %s, rises: %" PRIu32 ", bounces: %" PRIu32 ", first: %" PRIu32, i,
+               (state.active_mask & (1 << i)) ? "high" : "low", stats.rises, stats.bounces, stats.first);
+        if (stats.last_rise_us) {
+            printf(", last rise %" PRId64 " ms ago", (now_us - stats.last_rise_us) / 1000);
+        }
+        printf("\n");
+    }
+    return 0;
 }
 
-// This callback is called for every attribute update. The callback implementation shall
-// handle the desired attributes and return an appropriate error code. If the attribute
-// is not of your interest, please do not return an error code and strictly return ESP_OK.
-static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
-                                         uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+static void register_pir_console_cmd()
 {
-    if (type == PRE_UPDATE) {
-        // Handle On/Off cluster commands
-        if (cluster_id == OnOff::Id && attribute_id == OnOff::Attributes::OnOff::Id) {
-            bool new_state = val->val.b;
-            ESP_LOGI(TAG, "On/Off command received: %s", new_state ? "ON" : "OFF");
-            
-            if (new_state) {
-                // Matter "ON" command - start pulse
-                start_pulse();
-            } else {
-                // Matter "OFF" command - stop pulse immediately
-                stop_pulse();
+    esp_console_cmd_t cmd = {
+        .command = "pir",
+        .help = "Print occupancy, the order PIR sensors fired in and per-sensor counters",
+        .hint = NULL,
+        .func = &pir_cmd,
+    };
+    esp_console_cmd_register(&cmd);
+}
+#endif
+
+// Console command to list, play and upload the on-flash pattern library
+static int pattern_cmd(int argc, char **argv)
+{
+    esp_err_t err = ESP_OK;
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "list") == 0)) {
+        size_t count = app_pattern_count();
+        printf("%u patterns\n", (unsigned)count);
+        for (size_t i = 0; i < count; i++) {
+            uint8_t id = app_pattern_id_at(i);
+            app_pattern_info_t info;
+            if (app_pattern_find(id, &info) == ESP_OK) {
+                printf("%3u: %5u steps, high %" PRIu32 " ms of %" PRIu32 " ms\n", id, info.step_count,
+                       info.high_us / 1000, info.total_us / 1000);
             }
         }
-    } else if (type == POST_UPDATE) {
-        // Handle post-update to ensure HomeKit gets the final state
-        if (cluster_id == OnOff::Id && attribute_id == OnOff::Attributes::OnOff::Id) {
-            ESP_LOGI(TAG, "Post-update: On/Off attribute updated to %s", val->val.b ? "ON" : "OFF");
+        return 0;
+    } else if (argc == 3 && strcmp(argv[1], "play") == 0) {
+        // Id 0 would fall back to a plain pulse
+        uint8_t pattern_id = (uint8_t)strtoul(argv[2], NULL, 10);
+        err = pattern_id != 0 ? run_repl_trigger(APP_EVTLOG_SRC_CONSOLE, 1, pattern_id) : ESP_ERR_INVALID_ARG;
+    } else if (argc == 3 && strcmp(argv[1], "begin") == 0) {
+        err = app_pattern_upload_begin(strtoul(argv[2], NULL, 10));
+    } else if (argc == 4 && strcmp(argv[1], "data") == 0) {
+        // One chunk of hex bytes; tools/pattern_compile.py --console emits these lines
+        uint8_t chunk[96];
+        size_t hex_len = strlen(argv[3]);
+        if (hex_len % 2 != 0 || hex_len / 2 > sizeof(chunk)) {
+            printf("Expected up to %u bytes as an even number of hex digits\n", (unsigned)sizeof(chunk));
+            return 1;
         }
+        for (size_t i = 0; i < hex_len / 2; i++) {
+            char byte[3] = {argv[3][2 * i], argv[3][2 * i + 1], '\0'};
+            char *end;
+            chunk[i] = (uint8_t)strtoul(byte, &end, 16);
+            if (*end != '\0') {
+                printf("Bad hex digit at byte %u\n", (unsigned)i);
+                return 1;
+            }
+        }
+        err = app_pattern_upload_write(strtoul(argv[2], NULL, 10), chunk, hex_len / 2);
+    } else if (argc == 2 && strcmp(argv[1], "commit") == 0) {
+        err = app_pattern_upload_commit();
+        if (err == ESP_OK) {
+            printf("Loaded %u patterns\n", (unsigned)app_pattern_count());
+        }
+    } else {
+        printf("Usage: pattern [list | play <id> | begin <length> | data <offset> <hex> | commit]\n");
+        return 1;
     }
-    return ESP_OK;
+    if (err != ESP_OK) {
+        printf("Failed: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    return 0;
 }
 
-static esp_err_t factory_reset_button_register()
+static void register_pattern_console_cmd()
 {
-    // Create button configurations
-    button_config_t button_config = {
-        .long_press_time = 5000,     // 5 seconds for long press
-        .short_press_time = 50,      // 50ms for short press
+    esp_console_cmd_t cmd = {
+        .command = "pattern",
+        .help = "List or play library patterns; 'begin', 'data' and 'commit' upload a new library",
+        .hint = NULL,
+        .func = &pattern_cmd,
     };
-    
-    button_gpio_config_t gpio_config = {
-        .gpio_num = 9,               // GPIO 9 (BOOT button on ESP32-C3 SuperMini)
-        .active_level = 0,           // Active low
-        .enable_power_save = false,  // No power save
-        .disable_pull = false,       // Use internal pull-up
+    esp_console_cmd_register(&cmd);
+}
+
+// Console command to print the heap timeline
+static int heap_cmd(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "check") == 0) {
+        // Non-zero when the post-commissioning profile reclaimed less than expected, for test rigs
+        int32_t reclaimed;
+        esp_err_t err = check_reclaimed(&reclaimed);
+        if (err == ESP_ERR_NOT_FOUND) {
+            printf("No commissioning this boot\n");
+            return 1;
+        }
+        printf("Reclaimed %" PRId32 " bytes after commissioning, expected %d KB or more: %s\n", reclaimed,
+               CONFIG_SKULL_HEAP_RECLAIM_MIN_KB, err == ESP_OK ? "ok" : "FAIL");
+        return err == ESP_OK ? 0 : 1;
+    }
+    if (argc != 1) {
+        printf("Usage: heap [check]\n");
+        return 1;
+    }
+    app_heap_dump();
+    return 0;
+}
+
+static void register_heap_console_cmd()
+{
+    esp_console_cmd_t cmd = {
+        .command = "heap",
+        .help = "Print free internal heap at each boot and commissioning step, and now: heap [check]",
+        .hint = NULL,
+        .func = &heap_cmd,
     };
-    
-    button_handle_t push_button = NULL;
-    
-    // Create the GPIO button device
-    esp_err_t err = iot_button_new_gpio_device(&button_config, &gpio_config, &push_button);
+    esp_console_cmd_register(&cmd);
+}
+
+// Starts a trace with a first record holding the state a replay starts from
+static esp_err_t start_trace(size_t records)
+{
+    esp_err_t err = app_trace_start(records);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create button device: %s", esp_err_to_name(err));
         return err;
     }
-    
-    return app_reset_button_register(push_button);
+#if CONFIG_SKULL_BUSY_INPUT
+    bool busy = app_busy_is_busy();
+#else
+    bool busy = false;
+#endif
+#if CONFIG_SKULL_THERMAL
+    uint32_t thermal_pct = app_thermal_scale_pct();
+#else
+    uint32_t thermal_pct = 100;
+#endif
+    app_trace_append(APP_TRACE_START, busy, (uint16_t)app_settings_get_pulse_ms(),
+                     app_settings_get()->pir_hold_s | thermal_pct << 16);
+    return ESP_OK;
 }
 
-// AFTER factory_reset_button_register(), add switch button callback registration
-
-/* -------------------------------------------------------------------------- */
-/* Generic Switch button callback                                             */
-/* -------------------------------------------------------------------------- */
-
-
+// Console command to record inputs and print them for tools/trace_replay.py
+static int trace_cmd(int argc, char **argv)
+{
+    if (argc == 1) {
+        app_trace_stats_t stats;
+        app_trace_get_stats(&stats);
+        printf("trace: %s, %" PRIu32 "/%" PRIu32 " records, %" PRIu32 " overwritten\n",
+               stats.recording ? "recording" : "stopped", stats.count, stats.capacity, stats.overwritten);
+        return 0;
+    }
+    if (strcmp(argv[1], "start") == 0 && argc <= 3) {
+        size_t records = argc == 3 ? strtoul(argv[2], NULL, 10) : CONFIG_SKULL_TRACE_RECORDS;
+        esp_err_t err = start_trace(records);
+        if (err != ESP_OK) {
+            printf("Failed to start trace: %s\n", esp_err_to_name(err));
+            return 1;
+        }
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        app_trace_stop();
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+        app_trace_dump();
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "free") == 0) {
+        app_trace_free();
+        return 0;
+    }
+    printf("Usage: trace [start [records] | stop | dump | free]\n");
+    return 1;
+}
 
+static void register_trace_console_cmd()
+{
+    esp_console_cmd_t cmd = {
+        .command = "trace",
+        .help = "Record external inputs for replay on the host: trace [start [records] | stop | dump | free]",
+        .hint = NULL,
+        .func = &trace_cmd,
+    };
+    esp_console_cmd_register(&cmd);
+}
 
+// Console command to print button gesture counters and press latency
+static int button_cmd(int argc, char **argv)
+{
+    if (argc != 1) {
+        printf("Usage: button\n");
+        return 1;
+    }
+    for (int i = 0; i < APP_GESTURE_COUNT; i++) {
+        app_gesture_stats_t stats;
+        app_gesture_get_stats((app_gesture_t)i, &stats);
+        printf("%-10s %6" PRIu32 ", latency: last %" PRIu32 " us, worst %" PRIu32 " us\n",
+               app_gesture_name((app_gesture_t)i), stats.count, stats.last_latency_us, stats.max_latency_us);
+    }
+    printf("pend retries: %" PRIu32 "\n", app_gesture_pend_retries());
+    return 0;
+}
 
-// Physical button handling removed - GPIO control is now via Matter commands only
+static void register_button_console_cmd()
+{
+    esp_console_cmd_t cmd = {
+        .command = "button",
+        .help = "Print BOOT button gesture counts and first-press-to-dispatch latency",
+        .hint = NULL,
+        .func = &button_cmd,
+    };
+    esp_console_cmd_register(&cmd);
+}
 
-// Button registration removed - GPIO control is now via Matter commands only
+// Runs in the REPL task; the trigger itself runs on the Matter thread and its result goes back
+// to the host
+static esp_err_t hostlink_fire_cb(uint8_t pulses, uint8_t pattern_id, void *user_data)
+{
+    return run_repl_trigger(APP_EVTLOG_SRC_HOST, pulses == 0 ? 1 : pulses, pattern_id);
+}
 
-// Simple factory reset trigger - will reset after 10 seconds
-static void trigger_factory_reset_timer(void)
+// Keeps the PulseDuration attribute in step with a pulse width set by the host
+static void hostlink_settings_cb(const app_settings_t *settings, void *user_data)
 {
-    ESP_LOGW(TAG, "=== FACTORY RESET TRIGGERED ===");
-    ESP_LOGW(TAG, "Device will reset in 10 seconds...");
-    ESP_LOGW(TAG, "Unplug power now if you want to cancel!");
-    
-    vTaskDelay(pdMS_TO_TICKS(10000)); // Wait 10 seconds
-    
-    ESP_LOGI(TAG, "Starting factory reset NOW");
-    esp_matter::factory_reset();
+    if (!esp_matter::is_started()) {
+        return; // the attribute is seeded from the settings when it is created
+    }
+    esp_matter_attr_val_t val = esp_matter_uint16(settings->pulse_ms);
+    lock::chip_stack_lock(portMAX_DELAY);
+    esp_err_t err = attribute::update(g_switch_endpoint_id, SkullControl::Id, SkullControl::Attributes::PulseDuration::Id,
+                                      &val);
+    lock::chip_stack_unlock();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to update PulseDuration: %s", esp_err_to_name(err));
+    }
 }
 
-// Console command for factory reset
-static int factory_reset_cmd(int argc, char **argv)
+// Console command that hands the UART to the binary host protocol until the host is done
+static int hostlink_cmd(int argc, char **argv)
 {
-    if (argc == 2 && strcmp(argv[1], "confirm") == 0) {
-        // Start the reset in a new task
-        xTaskCreate([](void*){ trigger_factory_reset_timer(); vTaskDelete(NULL); }, 
-                   "factory_reset", 4096, NULL, 5, NULL);
-        return 0;
-    } else {
-        printf("Usage: factory_reset confirm\n");
-        printf("WARNING: This will erase all pairing data!\n");
+    if (argc != 1) {
+        printf("Usage: hostlink\n");
         return 1;
     }
+    app_hostlink_config_t config;
+    config.uart_num = CONFIG_ESP_CONSOLE_UART_NUM;
+    config.idle_timeout_ms = CONFIG_SKULL_HOSTLINK_IDLE_MS;
+    config.profile_name = AppProfile::kProfile.name;
+    config.fire_cb = hostlink_fire_cb;
+    config.settings_cb = hostlink_settings_cb;
+    esp_err_t err = app_hostlink_session(&config);
+
+    app_hostlink_stats_t stats;
+    app_hostlink_get_stats(&stats);
+    printf("hostlink: %s; %" PRIu32 " requests, %" PRIu32 " bytes discarded, %" PRIu32 " log lines sent, %" PRIu32
+           " dropped\n", err == ESP_OK ? "done" : esp_err_to_name(err), stats.requests, stats.rx_errors,
+           stats.log_lines, stats.log_dropped);
+    return err == ESP_ERR_NO_MEM ? 1 : 0;
+}
+
+static void register_hostlink_console_cmd()
+{
+    esp_console_cmd_t cmd = {
+        .command = "hostlink",
+        .help = "Switch the console to the binary host protocol (tools/hostlink.py) until the host exits",
+        .hint = NULL,
+        .func = &hostlink_cmd,
+    };
+    esp_console_cmd_register(&cmd);
 }
 
 static void register_factory_reset_console_cmd()
@@ -292,26 +1625,106 @@ static void register_factory_reset_console_cmd()
 
 extern "C" void app_main()
 {
+    app_heap_mark("boot");
+    ESP_LOGI(TAG, "Profile %s: tile %d, status LED %d, link %d, busy %d, PIR %u, SHTC3 %d, thermal %d, bench %d",
+             AppProfile::kProfile.name, AppProfile::kProfile.ui_endpoint, AppProfile::kProfile.status_led,
+             AppProfile::kProfile.controller_link, AppProfile::kProfile.busy_input, AppProfile::kProfile.pir_sensors,
+             AppProfile::kProfile.shtc3, AppProfile::kProfile.thermal, AppProfile::kProfile.bench);
+
     /* Initialize the ESP NVS layer */
     nvs_flash_init();
 
-    /* Initialize console for factory reset command */
-    esp_console_repl_t *repl = NULL;
-    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
-    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
-    esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    /* Open the event log first so the reset reason is recorded even if init fails later */
+    app_evtlog_init();
+
+    /* Load persisted application settings before anything reads them */
+    esp_err_t err = app_settings_init();
+    ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize settings, err:%d", err));
+
+#if CONFIG_SKULL_TRACE_AT_BOOT
+    /* Record from the first input on; the busy line reads idle until it is initialized */
+    err = start_trace(CONFIG_SKULL_TRACE_RECORDS);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Input trace not started, err:%d", err);
+    }
+#endif
+
+    /* Initialize console for factory reset command; the device works without it */
+    esp_err_t console_err = app_console_init(CONFIG_SKULL_CONSOLE_HISTORY);
     register_factory_reset_console_cmd();
-    esp_console_start_repl(repl);
+#if CONFIG_SKULL_BENCH
+    register_bench_console_cmd();
+#endif
+    register_button_console_cmd();
+    register_heap_console_cmd();
+    register_hostlink_console_cmd();
+    register_trace_console_cmd();
+#if CONFIG_SKULL_BUSY_INPUT
+    register_busy_console_cmd();
+#endif
+#if CONFIG_SKULL_PIR_INPUT
+    register_pir_console_cmd();
+#endif
+    register_trigger_console_cmd();
+    register_pattern_console_cmd();
+    register_evtlog_console_cmd();
+    register_dedupe_console_cmd();
+    if (console_err == ESP_OK) {
+        console_err = app_console_start();
+    }
+    if (console_err != ESP_OK) {
+        ESP_LOGE(TAG, "Console unavailable, err:%d", console_err);
+    }
+    app_heap_mark("console");
 
-    /* Initialize push button on the dev-kit to reset the device */
-    esp_err_t err = factory_reset_button_register();
+    /* Initialize the BOOT button: click gestures test-fire, a long press resets the device */
+    err = init_button_gestures();
     ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize reset button, err:%d", err));
 
+    /* Map the pattern library; without one every trigger is a plain pulse */
+    err = app_pattern_init();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Pattern library unavailable, err:%d", err);
+    }
+
     /* Initialize signal GPIO */
     err = init_signal_gpio();
     ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize signal GPIO, err:%d", err));
 
+#if CONFIG_SKULL_STATUS_LED
+    /* Initialize the status LED used for trigger activity and Identify */
+    err = init_status_led();
+    ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize status LED, err:%d", err));
+#endif
+
+#if CONFIG_SKULL_LINK_UART
+    /* Initialize the framed UART link to the animatronic controller */
+    err = init_controller_link();
+    ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize controller link, err:%d", err));
+#endif
+
+#if CONFIG_SKULL_BUSY_INPUT
+    /* Initialize the busy line from the animatronic controller */
+    err = init_busy_input();
+    ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize busy input, err:%d", err));
+#endif
+
+#if CONFIG_SKULL_PIR_INPUT
+    /* Initialize the PIR motion sensors */
+    err = init_pir_input();
+    ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize PIR sensors, err:%d", err));
+#endif
+
+#if CONFIG_SKULL_SHTC3
+    /* Start polling the SHTC3; the sensor itself may show up later */
+    err = init_temperature_sensor();
+    ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize SHTC3, err:%d", err));
+#endif
 
+    /* Initialize the scheduled trigger wheel */
+    err = app_sched_init();
+    ABORT_APP_ON_FAILURE(ESP_OK == err, ESP_LOGE(TAG, "Failed to initialize trigger scheduler, err:%d", err));
+    app_heap_mark("peripherals");
 
     /* Create a Matter node and add the mandatory Root Node device type on endpoint 0 */
     node::config_t node_config{}; // Explicitly zero-initialize
@@ -346,7 +1759,17 @@ extern "C" void app_main()
     ABORT_APP_ON_FAILURE(switch_ep != nullptr, ESP_LOGE(TAG, "Failed to create on_off_switch endpoint"));
 
     g_switch_endpoint_id = endpoint::get_id(switch_ep);
+    register_onoff_command_cbs(switch_ep);
+
+    // Vendor control cluster for delayed / wall-clock-timed triggers
+    cluster_t *control_cluster = app_control_cluster_create(switch_ep);
+    ABORT_APP_ON_FAILURE(control_cluster != nullptr, ESP_LOGE(TAG, "Failed to create control cluster"));
 
+    // Vendor diagnostics cluster: trigger counters and latency, read on demand
+    cluster_t *diag_cluster = app_diag_cluster_create(switch_ep);
+    ABORT_APP_ON_FAILURE(diag_cluster != nullptr, ESP_LOGE(TAG, "Failed to create diagnostics cluster"));
+
+#if CONFIG_SKULL_UI_ENDPOINT
     // ------------------------------------------------------------------
     // Create On/Off Light endpoint for UI representation (stateful tile)
     // ------------------------------------------------------------------
@@ -355,13 +1778,17 @@ extern "C" void app_main()
     endpoint_t *ui_ep = endpoint::on_off_light::create(node, &light_cfg, ENDPOINT_FLAG_NONE, NULL);
     ABORT_APP_ON_FAILURE(ui_ep != nullptr, ESP_LOGE(TAG, "Failed to create on_off_light endpoint"));
     g_ui_endpoint_id = endpoint::get_id(ui_ep);
+    register_onoff_command_cbs(ui_ep);
 
-    // Ensure OnOff starts at false (off)
+    // Ensure OnOff starts at false (off). The stack has not started, so no command can race it.
     {
         esp_matter_attr_val_t off_val = esp_matter_bool(false);
+        g_local_update = true;
         attribute::update(g_ui_endpoint_id, chip::app::Clusters::OnOff::Id,
                           chip::app::Clusters::OnOff::Attributes::OnOff::Id, &off_val);
+        g_local_update = false;
     }
+#endif
 
     // GPIO control is now handled via Matter commands only
 
@@ -378,6 +1805,17 @@ extern "C" void app_main()
     /* Matter start */
     err = esp_matter::start(app_event_cb);
     ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to start Matter, err:%d", err));
+    app_heap_mark("matter started");
+
+#if CONFIG_SKULL_SCHED_SNTP
+    // Shared wall-clock time base for "trigger at" across props. Any other source that sets
+    // the system clock (e.g. Matter time sync) works as well.
+    esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_SKULL_SCHED_SNTP_SERVER);
+    err = esp_netif_sntp_init(&sntp_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start SNTP, err:%d", err);
+    }
+#endif
 
     // PrintOnboardingCodes will log the necessary VID/PID and commissioning info
     chip::DeviceLayer::StackLock lock; // RAII lock for Matter stack
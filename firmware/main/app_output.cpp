@@ -0,0 +1,383 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <freertos/FreeRTOS.h>
+
+#include "sdkconfig.h"
+
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+#include <driver/rmt_tx.h>
+#include <esp_attr.h>
+#include <soc/soc_caps.h>
+#endif
+
+#include "app_output.h"
+
+static const char *TAG = "app_output";
+
+#define RMT_DURATION_MAX    0x7FFF  // 15-bit duration field of a symbol half
+
+typedef struct {
+    bool is_initialized;
+    app_output_channel_t id;
+    gpio_num_t gpio_num;
+    uint32_t idle_level;    // 1 for active-low lines; step levels are XORed with it
+    app_output_done_cb_t done_cb;
+    void *user_data;
+    // Fires on every step for the GPIO backend. For RMT it is armed by the transmit-done
+    // interrupt, so the done callback still runs in the esp_timer task.
+    esp_timer_handle_t timer;
+    volatile bool active;
+    // Step storage for app_output_pulse()
+    app_output_step_t pulse_step;
+    // GPIO backend cursor
+    const app_output_step_t *steps;
+    uint16_t step_count;
+    uint16_t next_step;
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    rmt_channel_handle_t rmt_chan;
+    rmt_encoder_handle_t copy_encoder;
+    rmt_symbol_word_t symbols[CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS];
+#endif
+} output_channel_t;
+
+static output_channel_t s_channels[APP_OUTPUT_CHANNEL_COUNT];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+size_t app_output_rmt_encode(const app_output_pattern_t *pattern, uint32_t ticks_per_us, uint32_t *symbols,
+                             size_t max_symbols)
+{
+    if (!pattern || !pattern->steps || !symbols || ticks_per_us == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    bool half_filled = false; // symbols[count - 1] only has its first half set
+
+    auto emit = [&](uint32_t level, uint64_t ticks) -> bool {
+        while (ticks > 0) {
+            uint32_t chunk = ticks > RMT_DURATION_MAX ? RMT_DURATION_MAX : (uint32_t)ticks;
+            ticks -= chunk;
+            uint32_t half = chunk | (level << 15);
+            if (half_filled) {
+                symbols[count - 1] |= half << 16;
+                half_filled = false;
+            } else {
+                if (count == max_symbols) {
+                    return false;
+                }
+                symbols[count++] = half;
+                half_filled = true;
+            }
+        }
+        return true;
+    };
+
+    // Merge runs of the same level so they cost as few symbol halves as possible.
+    uint32_t run_level = 0;
+    uint64_t run_ticks = 0;
+    for (uint16_t i = 0; i < pattern->step_count; i++) {
+        const app_output_step_t &step = pattern->steps[i];
+        uint64_t ticks = (uint64_t)step.duration_us * ticks_per_us;
+        if (ticks == 0) {
+            continue;
+        }
+        if (run_ticks > 0 && step.level == run_level) {
+            run_ticks += ticks;
+            continue;
+        }
+        if (run_ticks > 0 && !emit(run_level, run_ticks)) {
+            return 0;
+        }
+        run_level = step.level;
+        run_ticks = ticks;
+    }
+    if (run_ticks > 0 && !emit(run_level, run_ticks)) {
+        return 0;
+    }
+    // A trailing half with zero duration acts as the end marker.
+    return count;
+}
+
+static inline bool output_uses_rmt(const output_channel_t *ch)
+{
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    return ch->rmt_chan != NULL;
+#else
+    return false;
+#endif
+}
+
+static bool output_take_active(output_channel_t *ch)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool was_active = ch->active;
+    ch->active = false;
+    portEXIT_CRITICAL(&s_lock);
+    return was_active;
+}
+
+// Drives the next step, or the idle level after the last one. Called with s_lock held, so a
+// concurrent app_output_stop() either runs before (active is false, nothing is driven) or after
+// (it sees the re-armed timer and stops it). Returns true when the pattern has completed.
+static bool output_gpio_advance_locked(output_channel_t *ch)
+{
+    if (ch->next_step >= ch->step_count) {
+        gpio_set_level(ch->gpio_num, ch->idle_level);
+        ch->active = false;
+        return true;
+    }
+    const app_output_step_t &step = ch->steps[ch->next_step++];
+    gpio_set_level(ch->gpio_num, step.level ^ ch->idle_level);
+    esp_timer_start_once(ch->timer, step.duration_us);
+    return false;
+}
+
+static void output_timer_cb(void *arg)
+{
+    output_channel_t *ch = (output_channel_t *)arg;
+    bool done;
+    portENTER_CRITICAL(&s_lock);
+    if (!ch->active) {
+        portEXIT_CRITICAL(&s_lock);
+        return; // stopped while the callback was pending
+    }
+    if (output_uses_rmt(ch)) {
+        // The edges were produced by hardware; this is only bookkeeping.
+        ch->active = false;
+        done = true;
+    } else {
+        done = output_gpio_advance_locked(ch);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (done && ch->done_cb) {
+        ch->done_cb(ch->id, ch->user_data);
+    }
+}
+
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+// Runs in the RMT interrupt once the last symbol has left the peripheral
+static bool IRAM_ATTR output_rmt_done_isr(rmt_channel_handle_t chan, const rmt_tx_done_event_data_t *edata,
+                                          void *user_ctx)
+{
+    output_channel_t *ch = (output_channel_t *)user_ctx;
+    if (ch->active) {
+        esp_timer_start_once(ch->timer, 0);
+    }
+    return false;
+}
+
+static esp_err_t output_rmt_init(output_channel_t *ch)
+{
+    rmt_tx_channel_config_t tx_config = {};
+    tx_config.gpio_num = ch->gpio_num;
+    tx_config.clk_src = RMT_CLK_SRC_DEFAULT;
+    tx_config.resolution_hz = CONFIG_SKULL_OUTPUT_RMT_TICKS_PER_US * 1000000;
+    tx_config.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+    tx_config.trans_queue_depth = 1;
+    tx_config.flags.invert_out = ch->idle_level;
+
+    esp_err_t err = rmt_new_tx_channel(&tx_config, &ch->rmt_chan);
+    if (err != ESP_OK) {
+        ch->rmt_chan = NULL;
+        return err;
+    }
+
+    rmt_tx_event_callbacks_t callbacks = {};
+    callbacks.on_trans_done = output_rmt_done_isr;
+    err = rmt_tx_register_event_callbacks(ch->rmt_chan, &callbacks, ch);
+    rmt_copy_encoder_config_t encoder_config = {};
+    if (err == ESP_OK) {
+        err = rmt_new_copy_encoder(&encoder_config, &ch->copy_encoder);
+    }
+    if (err == ESP_OK) {
+        err = rmt_enable(ch->rmt_chan);
+    }
+    if (err != ESP_OK) {
+        if (ch->copy_encoder) {
+            rmt_del_encoder(ch->copy_encoder);
+            ch->copy_encoder = NULL;
+        }
+        rmt_del_channel(ch->rmt_chan);
+        ch->rmt_chan = NULL;
+    }
+    return err;
+}
+
+static esp_err_t output_rmt_play(output_channel_t *ch, const app_output_pattern_t *pattern)
+{
+    static_assert(sizeof(rmt_symbol_word_t) == sizeof(uint32_t), "unexpected RMT symbol layout");
+    size_t count = app_output_rmt_encode(pattern, CONFIG_SKULL_OUTPUT_RMT_TICKS_PER_US,
+                                         (uint32_t *)ch->symbols, CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS);
+    if (count == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    rmt_transmit_config_t tx_config = {};
+    tx_config.loop_count = 0;
+    tx_config.flags.eot_level = 0;
+    // The caller may be the Matter thread; a full queue is an error, never a wait
+    tx_config.flags.queue_nonblocking = 1;
+    return rmt_transmit(ch->rmt_chan, ch->copy_encoder, ch->symbols, count * sizeof(rmt_symbol_word_t), &tx_config);
+}
+#endif
+
+esp_err_t app_output_init(app_output_channel_t channel, const app_output_config_t *config)
+{
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    output_channel_t *ch = &s_channels[channel];
+    if (ch->is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ch->id = channel;
+    ch->gpio_num = (gpio_num_t)config->gpio_num;
+    ch->idle_level = config->active_low ? 1 : 0;
+    ch->done_cb = config->done_cb;
+    ch->user_data = config->user_data;
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << ch->gpio_num),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure GPIO %d: %s", ch->gpio_num, esp_err_to_name(err));
+        return err;
+    }
+    gpio_set_level(ch->gpio_num, ch->idle_level);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = output_timer_cb,
+        .arg = ch,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "output_timer",
+        .skip_unhandled_events = false,
+    };
+    err = esp_timer_create(&timer_args, &ch->timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create output timer: %s", esp_err_to_name(err));
+        return err;
+    }
+
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    err = output_rmt_init(ch);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "RMT unavailable on GPIO %d (%s), falling back to software GPIO", ch->gpio_num,
+                 esp_err_to_name(err));
+    }
+#endif
+
+    ch->is_initialized = true;
+    ESP_LOGI(TAG, "Output channel %d on GPIO %d initialized (%s)", channel, ch->gpio_num,
+             output_uses_rmt(ch) ? "RMT" : "GPIO");
+    return ESP_OK;
+}
+
+esp_err_t app_output_play(app_output_channel_t channel, const app_output_pattern_t *pattern)
+{
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT || !pattern || !pattern->steps || pattern->step_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    output_channel_t *ch = &s_channels[channel];
+    if (!ch->is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    if (ch->rmt_chan) {
+        portENTER_CRITICAL(&s_lock);
+        bool busy = ch->active;
+        ch->active = true;
+        portEXIT_CRITICAL(&s_lock);
+        if (busy) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        esp_err_t err = output_rmt_play(ch, pattern);
+        if (err != ESP_OK) {
+            output_take_active(ch);
+        }
+        return err;
+    }
+#endif
+
+    bool busy;
+    bool done = false;
+    portENTER_CRITICAL(&s_lock);
+    busy = ch->active;
+    if (!busy) {
+        ch->active = true;
+        ch->steps = pattern->steps;
+        ch->step_count = pattern->step_count;
+        ch->next_step = 0;
+        done = output_gpio_advance_locked(ch);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (done && ch->done_cb) {
+        ch->done_cb(ch->id, ch->user_data);
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_output_pulse(app_output_channel_t channel, uint32_t duration_us)
+{
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    output_channel_t *ch = &s_channels[channel];
+    if (ch->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ch->pulse_step.level = 1;
+    ch->pulse_step.duration_us = duration_us;
+    app_output_pattern_t pattern = {
+        .steps = &ch->pulse_step,
+        .step_count = 1,
+    };
+    return app_output_play(channel, &pattern);
+}
+
+void app_output_stop(app_output_channel_t channel)
+{
+    if (channel >= APP_OUTPUT_CHANNEL_COUNT || !s_channels[channel].is_initialized) {
+        return;
+    }
+    output_channel_t *ch = &s_channels[channel];
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    if (ch->rmt_chan) {
+        output_take_active(ch);
+        esp_timer_stop(ch->timer);
+        // Disabling the channel aborts the transaction in flight; the line returns to idle.
+        rmt_disable(ch->rmt_chan);
+        rmt_enable(ch->rmt_chan);
+        return;
+    }
+#endif
+    // Under the lock so a step callback cannot drive the line or re-arm the timer after this
+    portENTER_CRITICAL(&s_lock);
+    ch->active = false;
+    esp_timer_stop(ch->timer);
+    gpio_set_level(ch->gpio_num, ch->idle_level);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool app_output_is_active(app_output_channel_t channel)
+{
+    return channel < APP_OUTPUT_CHANNEL_COUNT && s_channels[channel].active;
+}
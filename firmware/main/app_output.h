@@ -0,0 +1,114 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Output sequencer for the trigger lines.
+//
+// A pattern is a list of level/duration steps. Depending on Kconfig it is rendered either by
+// the RMT peripheral from a pre-encoded symbol buffer (edges are timed by hardware) or by the
+// software GPIO backend, which steps through the pattern from esp_timer callbacks.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    APP_OUTPUT_CHANNEL_SIGNAL = 0, // "GO!" line to the animatronic controller
+    APP_OUTPUT_CHANNEL_STATUS,     // status LED: trigger activity and Identify effects
+    APP_OUTPUT_CHANNEL_COUNT,
+} app_output_channel_t;
+
+typedef struct {
+    uint32_t duration_us : 31;
+    uint32_t level : 1;
+} app_output_step_t;
+
+typedef struct {
+    const app_output_step_t *steps;
+    uint16_t step_count;
+} app_output_pattern_t;
+
+// Called from the esp_timer task once a pattern has played to completion (not when it is stopped).
+using app_output_done_cb_t = void (*)(app_output_channel_t channel, void *user_data);
+
+typedef struct {
+    // GPIO driven by this channel
+    int gpio_num;
+    // invert the line so it idles HIGH, e.g. for an LED wired to 3V3
+    bool active_low = false;
+    // called when playback completes, may be NULL
+    app_output_done_cb_t done_cb = NULL;
+    // user data
+    void *user_data = NULL;
+} app_output_config_t;
+
+/**
+ * @brief Initialize an output channel. The line is driven to its idle level until a pattern is played.
+ *
+ * @param channel channel to initialize.
+ * @param config  channel configuration. It is copied, so it does not need to outlive the call.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the channel or config is invalid.
+ * @return error in case of failure.
+ */
+esp_err_t app_output_init(app_output_channel_t channel, const app_output_config_t *config);
+
+/**
+ * @brief Play a pattern on a channel. The line returns to its idle level after the last step.
+ *
+ * @param channel channel to play on.
+ * @param pattern pattern to play. The step array must stay valid until playback completes.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_STATE if the channel is not initialized or already playing.
+ * @return ESP_ERR_INVALID_SIZE if the pattern does not fit in the RMT symbol buffer.
+ * @return error in case of failure.
+ */
+esp_err_t app_output_play(app_output_channel_t channel, const app_output_pattern_t *pattern);
+
+/**
+ * @brief Play a single HIGH pulse of the given width.
+ *
+ * @return same as app_output_play().
+ */
+esp_err_t app_output_pulse(app_output_channel_t channel, uint32_t duration_us);
+
+/**
+ * @brief Abort playback and drive the line to its idle level. The done callback is not invoked.
+ */
+void app_output_stop(app_output_channel_t channel);
+
+/**
+ * @brief Check whether a pattern is currently playing on the channel.
+ */
+bool app_output_is_active(app_output_channel_t channel);
+
+/**
+ * @brief Encode a pattern into RMT symbol words.
+ *
+ * Each word uses the rmt_symbol_word_t layout (duration0:15, level0:1, duration1:15, level1:1).
+ * Adjacent steps with the same level are merged, steps longer than the 15-bit duration field
+ * are split, and zero-length steps are dropped. This has no driver dependency so it can be
+ * built on the host.
+ *
+ * @param pattern      pattern to encode.
+ * @param ticks_per_us RMT channel resolution in ticks per microsecond.
+ * @param symbols      output buffer.
+ * @param max_symbols  capacity of the output buffer.
+ *
+ * @return number of symbols written, or 0 if the pattern is empty or does not fit.
+ */
+size_t app_output_rmt_encode(const app_output_pattern_t *pattern, uint32_t ticks_per_us, uint32_t *symbols,
+                             size_t max_symbols);
+
+// Most symbols app_output_rmt_encode() writes for `steps` steps lasting `total_us` together: each
+// step wastes at most one symbol half on its remainder. For compile-time checks that a caller's
+// longest pattern fits CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS.
+#define APP_OUTPUT_RMT_SYMBOLS_MAX(total_us, steps, ticks_per_us) \
+    (((uint64_t)(total_us) * (ticks_per_us) / 0x7FFF + (steps) + 1) / 2)
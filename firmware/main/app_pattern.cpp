@@ -0,0 +1,281 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "app_pattern.h"
+
+static const char *TAG = "app_pattern";
+
+#define PATTERN_PARTITION_LABEL "patterns"
+#define PATTERN_SECTOR_SIZE     4096
+
+static_assert(sizeof(app_pattern_header_t) == 16, "header must stay 16 bytes");
+static_assert(sizeof(app_pattern_entry_t) == 16, "index entry must stay 16 bytes");
+static_assert(sizeof(app_output_step_t) == sizeof(uint32_t), "step words are played in place");
+
+static const esp_partition_t *s_partition;
+static esp_partition_mmap_handle_t s_mmap_handle;
+static bool s_mapped;
+static SemaphoreHandle_t s_mutex;           // serializes playback against uploads
+
+// Loaded library, guarded by s_mutex
+static const uint8_t *s_image;
+static const app_pattern_entry_t *s_index;
+static uint16_t s_count;
+static uint8_t s_slot[APP_PATTERN_MAX_ID + 1];     // id -> index position + 1, 0 if absent
+static uint32_t s_playing_mask;                     // channels that were handed steps from s_image
+
+// Upload in progress
+static size_t s_upload_length;
+
+static void pattern_lock(void)
+{
+    if (s_mutex) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+    }
+}
+
+static void pattern_unlock(void)
+{
+    if (s_mutex) {
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+static void pattern_unload_locked(void)
+{
+    s_image = NULL;
+    s_index = NULL;
+    s_count = 0;
+    memset(s_slot, 0, sizeof(s_slot));
+}
+
+static esp_err_t pattern_load_locked(const void *image, size_t size)
+{
+    pattern_unload_locked();
+    if (!image || size < sizeof(app_pattern_header_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)image;
+    app_pattern_header_t header;
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != APP_PATTERN_MAGIC) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (header.version != APP_PATTERN_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    size_t index_end = sizeof(header) + (size_t)header.count * sizeof(app_pattern_entry_t);
+    if (header.count == 0 || header.count > APP_PATTERN_MAX_ID || header.length > size || header.length < index_end) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (esp_rom_crc32_le(0, bytes + sizeof(header), header.length - sizeof(header)) != header.crc32) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // The index sits right after the 16-byte header, so it is 4-byte aligned whenever the image is.
+    // The CRC does not cover the header, so the step arrays must fill the rest of the image back to
+    // back in index order: a corrupted count or length then cannot leave a shorter valid library.
+    const app_pattern_entry_t *index = (const app_pattern_entry_t *)(bytes + sizeof(header));
+    size_t next_offset = index_end;
+    for (uint16_t i = 0; i < header.count; i++) {
+        const app_pattern_entry_t &entry = index[i];
+        size_t steps_end = (size_t)entry.offset + (size_t)entry.step_count * sizeof(app_output_step_t);
+        if (entry.id == 0 || entry.id > APP_PATTERN_MAX_ID || s_slot[entry.id] != 0 || entry.step_count == 0 ||
+            entry.offset != next_offset || steps_end > header.length) {
+            ESP_LOGW(TAG, "Bad index entry %u (id %u)", i, entry.id);
+            pattern_unload_locked();
+            return ESP_ERR_INVALID_ARG;
+        }
+        const app_output_step_t *steps = (const app_output_step_t *)(bytes + entry.offset);
+        uint64_t high_us = 0;
+        uint64_t total_us = 0;
+        for (uint16_t s = 0; s < entry.step_count; s++) {
+            total_us += steps[s].duration_us;
+            high_us += steps[s].level ? steps[s].duration_us : 0;
+        }
+        if (total_us == 0 || total_us != entry.total_us || high_us != entry.high_us) {
+            ESP_LOGW(TAG, "Pattern %u: durations do not match its index entry", entry.id);
+            pattern_unload_locked();
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_slot[entry.id] = (uint8_t)(i + 1);
+        next_offset = steps_end;
+    }
+    if (next_offset != header.length) {
+        ESP_LOGW(TAG, "%u bytes after the last pattern", (unsigned)(header.length - next_offset));
+        pattern_unload_locked();
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    s_image = bytes;
+    s_index = index;
+    s_count = header.count;
+    return ESP_OK;
+}
+
+esp_err_t app_pattern_load(const void *image, size_t size)
+{
+    pattern_lock();
+    esp_err_t err = pattern_load_locked(image, size);
+    pattern_unlock();
+    return err;
+}
+
+static esp_err_t pattern_map_and_load(void)
+{
+    const void *image = NULL;
+    esp_err_t err = esp_partition_mmap(s_partition, 0, s_partition->size, ESP_PARTITION_MMAP_DATA, &image,
+                                       &s_mmap_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map pattern partition: %s", esp_err_to_name(err));
+        return err;
+    }
+    s_mapped = true;
+
+    pattern_lock();
+    err = pattern_load_locked(image, s_partition->size);
+    pattern_unlock();
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Pattern library loaded: %u patterns", s_count);
+    } else {
+        ESP_LOGW(TAG, "No valid pattern library: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t app_pattern_init(void)
+{
+    if (s_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PATTERN_PARTITION_LABEL);
+    if (!s_partition) {
+        ESP_LOGW(TAG, "No \"%s\" partition, pattern library disabled", PATTERN_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        s_partition = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = pattern_map_and_load();
+    // An empty or stale partition is not an error; the firmware falls back to plain pulses
+    return err == ESP_ERR_NO_MEM ? err : ESP_OK;
+}
+
+size_t app_pattern_count(void)
+{
+    return s_count;
+}
+
+uint8_t app_pattern_id_at(size_t n)
+{
+    pattern_lock();
+    uint8_t id = n < s_count ? (uint8_t)s_index[n].id : 0;
+    pattern_unlock();
+    return id;
+}
+
+esp_err_t app_pattern_find(uint8_t id, app_pattern_info_t *info)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    pattern_lock();
+    if (s_slot[id] != 0) {
+        const app_pattern_entry_t &entry = s_index[s_slot[id] - 1];
+        if (info) {
+            info->step_count = entry.step_count;
+            info->high_us = entry.high_us;
+            info->total_us = entry.total_us;
+        }
+        err = ESP_OK;
+    }
+    pattern_unlock();
+    return err;
+}
+
+esp_err_t app_pattern_play(app_output_channel_t channel, uint8_t id)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    pattern_lock();
+    if (s_slot[id] != 0) {
+        const app_pattern_entry_t &entry = s_index[s_slot[id] - 1];
+        app_output_pattern_t pattern = {
+            .steps = (const app_output_step_t *)(s_image + entry.offset),
+            .step_count = entry.step_count,
+        };
+        err = app_output_play(channel, &pattern);
+        if (err == ESP_OK) {
+            s_playing_mask |= 1u << channel;
+        }
+    }
+    pattern_unlock();
+    return err;
+}
+
+esp_err_t app_pattern_upload_begin(size_t length)
+{
+    if (!s_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (length < sizeof(app_pattern_header_t) || length > s_partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    pattern_lock();
+    pattern_unload_locked();
+    // The steps of anything still playing from the old image are about to be erased
+    for (int channel = 0; channel < APP_OUTPUT_CHANNEL_COUNT; channel++) {
+        if ((s_playing_mask & (1u << channel)) && app_output_is_active((app_output_channel_t)channel)) {
+            app_output_stop((app_output_channel_t)channel);
+        }
+    }
+    s_playing_mask = 0;
+    if (s_mapped) {
+        esp_partition_munmap(s_mmap_handle);
+        s_mapped = false;
+    }
+    size_t erase_len = (length + PATTERN_SECTOR_SIZE - 1) / PATTERN_SECTOR_SIZE * PATTERN_SECTOR_SIZE;
+    esp_err_t err = esp_partition_erase_range(s_partition, 0, erase_len);
+    s_upload_length = (err == ESP_OK) ? length : 0;
+    pattern_unlock();
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase pattern partition: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t app_pattern_upload_write(size_t offset, const void *data, size_t len)
+{
+    if (s_upload_length == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!data || offset > s_upload_length || len > s_upload_length - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return esp_partition_write(s_partition, offset, data, len);
+}
+
+esp_err_t app_pattern_upload_commit(void)
+{
+    if (s_upload_length == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_upload_length = 0;
+    return pattern_map_and_load();
+}
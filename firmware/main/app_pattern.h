@@ -0,0 +1,123 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Library of output patterns on the "patterns" flash partition.
+//
+// The partition is memory-mapped and validated once, after boot or an upload. Patterns are
+// then played straight from the mapping: the step words have the app_output_step_t layout, so
+// nothing is copied into RAM. A 256-entry table maps pattern ids to index slots for O(1)
+// lookup. tools/pattern_compile.py builds images from a text spec.
+//
+// Image layout, little endian:
+//   header   app_pattern_header_t
+//   index    header.count x app_pattern_entry_t
+//   steps    uint32 words (duration_us:31, level:1), one array per entry in index order,
+//            back to back up to header.length
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_output.h"
+
+#define APP_PATTERN_MAGIC       0x4C504B53  // "SKPL"
+#define APP_PATTERN_VERSION     1
+#define APP_PATTERN_MAX_ID      255         // ids 1-255; 0 means "no pattern"
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;         // index entries
+    uint32_t length;        // image size in bytes, header included
+    uint32_t crc32;         // CRC-32 of bytes [sizeof(header), length)
+} app_pattern_header_t;
+
+typedef struct {
+    uint16_t id;
+    uint16_t step_count;
+    uint32_t offset;        // of the step array, from the start of the image
+    uint32_t high_us;       // sum of the HIGH steps
+    uint32_t total_us;      // sum of all steps
+} app_pattern_entry_t;
+
+typedef struct {
+    uint16_t step_count;
+    uint32_t high_us;
+    uint32_t total_us;
+} app_pattern_info_t;
+
+/**
+ * @brief Map the pattern partition and load the library in it. This function should be called only once.
+ *
+ * @return ESP_OK on success, also when the partition holds no valid library.
+ * @return ESP_ERR_NOT_FOUND if there is no "patterns" partition.
+ * @return error in case of failure.
+ */
+esp_err_t app_pattern_init(void);
+
+/**
+ * @brief Validate an image and make it the active library. Checks the magic, version, length,
+ *        CRC and every index entry (unique ids, step arrays packed in index order, durations).
+ *        Used on the mapped partition; exposed for host tests.
+ *
+ * @param image image to load. Must stay valid and unchanged while it is loaded.
+ * @param size  bytes available at image.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_NOT_FOUND if there is no image (magic mismatch, e.g. an erased partition).
+ * @return ESP_ERR_INVALID_VERSION, ESP_ERR_INVALID_CRC, ESP_ERR_INVALID_SIZE or
+ *         ESP_ERR_INVALID_ARG describing the first problem found; no library is loaded then.
+ */
+esp_err_t app_pattern_load(const void *image, size_t size);
+
+/**
+ * @brief Number of patterns in the loaded library, 0 when none is loaded.
+ */
+size_t app_pattern_count(void);
+
+/**
+ * @brief Look up a pattern.
+ *
+ * @return ESP_ERR_NOT_FOUND if the library has no pattern with that id.
+ */
+esp_err_t app_pattern_find(uint8_t id, app_pattern_info_t *info);
+
+/**
+ * @brief Play a pattern from the library on an output channel, without copying it.
+ *
+ * @return ESP_ERR_NOT_FOUND if the library has no pattern with that id.
+ * @return otherwise the result of app_output_play().
+ */
+esp_err_t app_pattern_play(app_output_channel_t channel, uint8_t id);
+
+/**
+ * @brief Id of the n-th pattern in index order, for listing. Returns 0 past the end.
+ */
+uint8_t app_pattern_id_at(size_t n);
+
+/**
+ * @brief Start replacing the library. Unloads it, stops channels still playing from it and
+ *        erases enough of the partition for an image of `length` bytes.
+ */
+esp_err_t app_pattern_upload_begin(size_t length);
+
+/**
+ * @brief Write part of the new image.
+ *
+ * @return ESP_ERR_INVALID_STATE if no upload is in progress.
+ * @return ESP_ERR_INVALID_SIZE if the chunk does not fit the announced length.
+ */
+esp_err_t app_pattern_upload_write(size_t offset, const void *data, size_t len);
+
+/**
+ * @brief Finish the upload and load the new image.
+ *
+ * @return same as app_pattern_load().
+ */
+esp_err_t app_pattern_upload_commit(void);
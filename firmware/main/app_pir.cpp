@@ -0,0 +1,347 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <driver/gpio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+
+#include "sdkconfig.h"
+
+#include "app_pir.h"
+
+static const char *TAG = "app_pir";
+
+#define EDGE_RING_SIZE  16  // power of two
+#define PEND_RETRY_US   (portTICK_PERIOD_MS * 1000)
+
+typedef struct {
+    int64_t time_us;
+    uint8_t sensor;
+    bool level;
+} pir_edge_t;
+
+typedef struct {
+    bool level;
+    int64_t last_edge_us;   // last accepted edge, 0 if none yet
+    app_pir_sensor_stats_t stats;
+} pir_sensor_t;
+
+static app_pir_config_t s_config;
+static esp_timer_handle_t s_hold_timer;
+static esp_timer_handle_t s_settle_timer;
+static esp_timer_handle_t s_drain_retry_timer;  // hands the ring over again after a full timer queue
+static uint64_t s_settle_us;        // longest debounce of all sensors, plus a margin
+
+// Edges captured by the ISR, drained by the timer task
+static pir_edge_t s_edges[EDGE_RING_SIZE];
+static volatile uint32_t s_edge_head;
+static uint32_t s_edge_tail;
+static volatile bool s_drain_pending;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Fusion state, written by the timer task and read by app_pir_get_*() under s_lock
+static pir_sensor_t s_sensors[APP_PIR_MAX_SENSORS];
+static app_pir_state_t s_state;
+static uint8_t s_seen_mask;         // sensors already in s_state.order
+static uint8_t s_settle_mask;       // sensors whose line must be sampled again after a bounce
+
+void app_pir_handle_edge(uint8_t sensor, bool level, int64_t time_us)
+{
+    if (sensor >= s_config.sensor_count) {
+        return;
+    }
+    pir_sensor_t *pir = &s_sensors[sensor];
+    uint8_t bit = 1 << sensor;
+    bool started = false;
+    bool hold = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (level == pir->level) {
+        portEXIT_CRITICAL(&s_lock);
+        return; // the matching edge was lost or dropped as bounce
+    }
+    if (pir->last_edge_us != 0 && time_us - pir->last_edge_us < (int64_t)s_config.sensors[sensor].debounce_ms * 1000) {
+        pir->stats.bounces++;
+        s_settle_mask |= bit;
+        portEXIT_CRITICAL(&s_lock);
+        if (s_settle_timer && !esp_timer_is_active(s_settle_timer)) {
+            esp_timer_start_once(s_settle_timer, s_settle_us);
+        }
+        return;
+    }
+
+    pir->level = level;
+    pir->last_edge_us = time_us;
+    s_settle_mask &= ~bit;
+    if (level) {
+        pir->stats.rises++;
+        pir->stats.last_rise_us = time_us;
+        if (!s_state.occupied) {
+            s_state.occupied = true;
+            s_state.periods++;
+            s_state.order_len = 0;
+            s_seen_mask = 0;
+            pir->stats.first++;
+            started = true;
+        }
+        if (!(s_seen_mask & bit)) {
+            s_seen_mask |= bit;
+            s_state.order[s_state.order_len++] = sensor;
+        }
+        s_state.active_mask |= bit;
+    } else {
+        s_state.active_mask &= ~bit;
+        hold = s_state.occupied && s_state.active_mask == 0;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (s_hold_timer) {
+        esp_timer_stop(s_hold_timer);
+        if (hold) {
+            esp_timer_start_once(s_hold_timer, (uint64_t)s_config.hold_ms * 1000);
+        }
+    }
+    if (s_config.edge_cb) {
+        s_config.edge_cb(sensor, level, s_config.user_data);
+    }
+    if (started && s_config.occupancy_cb) {
+        s_config.occupancy_cb(true, sensor, s_config.user_data);
+    }
+}
+
+void app_pir_handle_hold_expired(void)
+{
+    bool ended = false;
+    uint8_t first = APP_PIR_NONE;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_state.occupied && s_state.active_mask == 0) {
+        s_state.occupied = false;
+        first = s_state.order_len ? s_state.order[0] : APP_PIR_NONE;
+        ended = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ended && s_config.occupancy_cb) {
+        s_config.occupancy_cb(false, first, s_config.user_data);
+    }
+}
+
+static void pir_drain(void *arg1, uint32_t arg2)
+{
+    s_drain_pending = false;
+    while (s_edge_tail != s_edge_head) {
+        pir_edge_t edge = s_edges[s_edge_tail % EDGE_RING_SIZE];
+        s_edge_tail++;
+        app_pir_handle_edge(edge.sensor, edge.level, edge.time_us);
+    }
+}
+
+static void pir_pended_hold(void *arg1, uint32_t arg2)
+{
+    pir_drain(NULL, 0); // a rising edge that raced the timer keeps the area occupied
+    app_pir_handle_hold_expired();
+}
+
+// Re-reads the lines that bounced, now that they had time to settle
+static void pir_pended_settle(void *arg1, uint32_t arg2)
+{
+    pir_drain(NULL, 0);
+    int64_t now_us = esp_timer_get_time();
+    for (uint8_t i = 0; i < s_config.sensor_count; i++) {
+        if (s_settle_mask & (1 << i)) {
+            app_pir_handle_edge(i, gpio_get_level((gpio_num_t)s_config.sensors[i].gpio_num), now_us);
+        }
+    }
+}
+
+static void IRAM_ATTR pir_count_pend_retry(void)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    s_state.pend_retries++;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+static void IRAM_ATTR pir_isr(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint8_t sensor = (uint8_t)(uintptr_t)arg;
+    bool level = gpio_get_level((gpio_num_t)s_config.sensors[sensor].gpio_num);
+
+    portENTER_CRITICAL_ISR(&s_lock);
+    if (s_edge_head - s_edge_tail < EDGE_RING_SIZE) {
+        s_edges[s_edge_head % EDGE_RING_SIZE] = {.time_us = now_us, .sensor = sensor, .level = level};
+        s_edge_head++;
+    }
+    bool kick = !s_drain_pending;
+    s_drain_pending = true;
+    portEXIT_CRITICAL_ISR(&s_lock);
+
+    if (kick) {
+        BaseType_t woken = pdFALSE;
+        if (xTimerPendFunctionCallFromISR(pir_drain, NULL, 0, &woken) != pdPASS) {
+            // The edges stay in the ring and s_drain_pending stays set until the retry gets through
+            pir_count_pend_retry();
+            esp_timer_start_once(s_drain_retry_timer, PEND_RETRY_US);
+        }
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+// The timers run in the esp_timer task and hand over to the timer task, which owns the state.
+// They never wait for room in its queue, which would hold up every other esp_timer; a full
+// queue is counted and the same timer tried again a tick later. A new edge restarting the hold
+// timer supersedes a pending hold retry.
+static void pir_drain_retry_cb(void *arg)
+{
+    if (xTimerPendFunctionCall(pir_drain, NULL, 0, 0) != pdPASS) {
+        pir_count_pend_retry();
+        esp_timer_start_once(s_drain_retry_timer, PEND_RETRY_US);
+    }
+}
+
+static void pir_hold_timer_cb(void *arg)
+{
+    if (xTimerPendFunctionCall(pir_pended_hold, NULL, 0, 0) != pdPASS) {
+        pir_count_pend_retry();
+        esp_timer_start_once(s_hold_timer, PEND_RETRY_US);
+    }
+}
+
+static void pir_settle_timer_cb(void *arg)
+{
+    if (xTimerPendFunctionCall(pir_pended_settle, NULL, 0, 0) != pdPASS) {
+        pir_count_pend_retry();
+        esp_timer_start_once(s_settle_timer, PEND_RETRY_US);
+    }
+}
+
+esp_err_t app_pir_init(const app_pir_config_t *config)
+{
+    if (!config || config->sensor_count == 0 || config->sensor_count > APP_PIR_MAX_SENSORS || config->hold_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint64_t pin_mask = 0;
+    uint32_t max_debounce_ms = 0;
+    for (uint8_t i = 0; i < config->sensor_count; i++) {
+        if (!GPIO_IS_VALID_GPIO(config->sensors[i].gpio_num)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        pin_mask |= 1ULL << config->sensors[i].gpio_num;
+        if (config->sensors[i].debounce_ms > max_debounce_ms) {
+            max_debounce_ms = config->sensors[i].debounce_ms;
+        }
+    }
+    if (s_hold_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_config = *config;
+    s_settle_us = (uint64_t)max_debounce_ms * 1000 + 1000;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = pir_hold_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "pir_hold",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_hold_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    timer_args.callback = pir_settle_timer_cb;
+    timer_args.name = "pir_settle";
+    err = esp_timer_create(&timer_args, &s_settle_timer);
+    if (err == ESP_OK) {
+        timer_args.callback = pir_drain_retry_cb;
+        timer_args.name = "pir_retry";
+        err = esp_timer_create(&timer_args, &s_drain_retry_timer);
+        if (err != ESP_OK) {
+            esp_timer_delete(s_settle_timer);
+            s_settle_timer = NULL;
+        }
+    }
+    if (err != ESP_OK) {
+        esp_timer_delete(s_hold_timer);
+        s_hold_timer = NULL;
+        return err;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = pin_mask,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    err = gpio_config(&io_conf);
+    if (err == ESP_OK) {
+        // The service may already be installed by another driver
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE) {
+            err = ESP_OK;
+        }
+    }
+    for (uint8_t i = 0; err == ESP_OK && i < config->sensor_count; i++) {
+        err = gpio_isr_handler_add((gpio_num_t)config->sensors[i].gpio_num, pir_isr, (void *)(uintptr_t)i);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up PIR inputs: %s", esp_err_to_name(err));
+        for (uint8_t i = 0; i < config->sensor_count; i++) {
+            gpio_isr_handler_remove((gpio_num_t)config->sensors[i].gpio_num);
+        }
+        esp_timer_delete(s_drain_retry_timer);
+        esp_timer_delete(s_settle_timer);
+        esp_timer_delete(s_hold_timer);
+        s_drain_retry_timer = NULL;
+        s_settle_timer = NULL;
+        s_hold_timer = NULL;
+        return err;
+    }
+
+    // Sensors already high at boot count as occupied, without announcing a new period
+    portENTER_CRITICAL(&s_lock);
+    for (uint8_t i = 0; i < config->sensor_count; i++) {
+        s_sensors[i].level = gpio_get_level((gpio_num_t)config->sensors[i].gpio_num);
+        if (s_sensors[i].level) {
+            s_state.active_mask |= 1 << i;
+        }
+    }
+    s_state.occupied = s_state.active_mask != 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    for (uint8_t i = 0; i < config->sensor_count; i++) {
+        ESP_LOGI(TAG, "PIR %u on GPIO %d, debounce %" PRIu32 " ms, currently %s", i, config->sensors[i].gpio_num,
+                 config->sensors[i].debounce_ms, s_sensors[i].level ? "high" : "low");
+    }
+    ESP_LOGI(TAG, "Occupancy hold %" PRIu32 " ms", config->hold_ms);
+    return ESP_OK;
+}
+
+void app_pir_get_state(app_pir_state_t *state)
+{
+    if (!state) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *state = s_state;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t app_pir_get_sensor_stats(uint8_t sensor, app_pir_sensor_stats_t *stats)
+{
+    if (sensor >= s_config.sensor_count || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_sensors[sensor].stats;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,94 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Motion input from up to APP_PIR_MAX_SENSORS PIR sensors, fused into one occupancy state.
+//
+// Edges are timestamped in the GPIO ISR and handled in the FreeRTOS timer task, like the busy
+// input. Each sensor has its own debounce: an edge arriving sooner than debounce_ms after the
+// sensor's previous accepted edge is dropped and the line is sampled again once it had time to
+// settle. The area becomes occupied on the first accepted rising edge and unoccupied hold_ms
+// after the last sensor went low. For every occupied period the order in which sensors first
+// fired is kept, so rules can tell which side a visitor approached from.
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+#define APP_PIR_MAX_SENSORS 4
+#define APP_PIR_NONE        0xFF    // no sensor has fired in the current period
+
+// Called from the FreeRTOS timer task. first_sensor is the sensor that started the period.
+using app_pir_occupancy_cb_t = void (*)(bool occupied, uint8_t first_sensor, void *user_data);
+// Called from the FreeRTOS timer task for every edge that passed the debounce.
+using app_pir_edge_cb_t = void (*)(uint8_t sensor, bool level, void *user_data);
+
+typedef struct {
+    // GPIO connected to the sensor output, active high
+    int gpio_num;
+    // edges closer together than this are treated as bounce
+    uint32_t debounce_ms;
+} app_pir_sensor_config_t;
+
+typedef struct {
+    app_pir_sensor_config_t sensors[APP_PIR_MAX_SENSORS];
+    uint8_t sensor_count;
+    // time from the last sensor going low to unoccupied
+    uint32_t hold_ms;
+    // occupancy change callback
+    app_pir_occupancy_cb_t occupancy_cb = NULL;
+    // accepted edge callback
+    app_pir_edge_cb_t edge_cb = NULL;
+    // user data
+    void *user_data = NULL;
+} app_pir_config_t;
+
+typedef struct {
+    bool occupied;
+    uint8_t active_mask;                    // bit n set while sensor n is high
+    uint8_t order[APP_PIR_MAX_SENSORS];     // sensors in the order they first fired this period
+    uint8_t order_len;
+    uint32_t periods;                       // occupied periods since boot
+    uint32_t pend_retries;                  // hand-offs to the timer task retried because its queue was full
+} app_pir_state_t;
+
+typedef struct {
+    uint32_t rises;         // accepted rising edges
+    uint32_t bounces;       // edges dropped by the debounce
+    uint32_t first;         // periods this sensor started
+    int64_t last_rise_us;   // esp_timer time of the last accepted rising edge, 0 if none
+} app_pir_sensor_stats_t;
+
+/**
+ * @brief Configure the sensor inputs and start capturing edges. This function should be called only once.
+ *
+ * @param config input configuration. It is copied, so it does not need to outlive the call.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the config is invalid.
+ * @return error in case of failure.
+ */
+esp_err_t app_pir_init(const app_pir_config_t *config);
+
+/**
+ * @brief Copy the fused occupancy state.
+ */
+void app_pir_get_state(app_pir_state_t *state);
+
+/**
+ * @brief Copy the counters of one sensor.
+ *
+ * @return ESP_ERR_INVALID_ARG if the sensor index is out of range.
+ */
+esp_err_t app_pir_get_sensor_stats(uint8_t sensor, app_pir_sensor_stats_t *stats);
+
+/**
+ * @brief Fusion inputs, normally driven by the ISR and the timers. Exposed for host tests;
+ *        callers must not run them concurrently. Each call is O(1) in the number of sensors.
+ */
+void app_pir_handle_edge(uint8_t sensor, bool level, int64_t time_us);
+void app_pir_handle_hold_expired(void);
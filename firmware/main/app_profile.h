@@ -0,0 +1,202 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Device profile: the endpoints, output channels and inputs this image is built with.
+//
+// The profile is picked in Kconfig (SKULL_PROFILE_*), which decides the feature options;
+// main/CMakeLists.txt compiles only the modules they need and app_main() only creates what
+// is here. This header is the one place that spells the result out, and it checks at compile
+// time that no two features of the build claim the same GPIO.
+//
+//   profile   endpoints            channels             inputs
+//   minimal   switch               signal               button
+//   prop      switch, tile         signal, status LED   button
+//   sensor    switch, tile         signal, status LED   button, PIR, SHTC3 (+ thermal derating)
+//   custom    as configured
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#if CONFIG_ESP_CONSOLE_UART && !CONFIG_ESP_CONSOLE_UART_CUSTOM
+#include <soc/uart_pins.h>
+#endif
+
+namespace AppProfile {
+
+struct Profile {
+    const char *name;
+    // endpoints besides the root node and the On/Off Switch
+    bool ui_endpoint;
+    // output channels besides the signal line
+    bool status_led;
+    bool controller_link;
+    // inputs besides the BOOT button
+    bool busy_input;
+    uint8_t pir_sensors;
+    bool shtc3;
+    bool thermal;
+    // console tools
+    bool bench;
+};
+
+static constexpr Profile kProfile = {
+#if CONFIG_SKULL_PROFILE_MINIMAL
+    .name = "minimal",
+#elif CONFIG_SKULL_PROFILE_PROP
+    .name = "prop",
+#elif CONFIG_SKULL_PROFILE_SENSOR
+    .name = "sensor",
+#else
+    .name = "custom",
+#endif
+#if CONFIG_SKULL_UI_ENDPOINT
+    .ui_endpoint = true,
+#else
+    .ui_endpoint = false,
+#endif
+#if CONFIG_SKULL_STATUS_LED
+    .status_led = true,
+#else
+    .status_led = false,
+#endif
+#if CONFIG_SKULL_LINK_UART
+    .controller_link = true,
+#else
+    .controller_link = false,
+#endif
+#if CONFIG_SKULL_BUSY_INPUT
+    .busy_input = true,
+#else
+    .busy_input = false,
+#endif
+#if CONFIG_SKULL_PIR_INPUT
+    .pir_sensors = CONFIG_SKULL_PIR_COUNT,
+#else
+    .pir_sensors = 0,
+#endif
+#if CONFIG_SKULL_SHTC3
+    .shtc3 = true,
+#else
+    .shtc3 = false,
+#endif
+#if CONFIG_SKULL_THERMAL
+    .thermal = true,
+#else
+    .thermal = false,
+#endif
+#if CONFIG_SKULL_BENCH
+    .bench = true,
+#else
+    .bench = false,
+#endif
+};
+
+// The UART console's pins: the ones set in menuconfig, or the target's UART0 pins
+#if CONFIG_ESP_CONSOLE_UART_CUSTOM
+#define APP_PROFILE_CONSOLE_TX_GPIO CONFIG_ESP_CONSOLE_UART_TX_GPIO
+#define APP_PROFILE_CONSOLE_RX_GPIO CONFIG_ESP_CONSOLE_UART_RX_GPIO
+#elif CONFIG_ESP_CONSOLE_UART
+#define APP_PROFILE_CONSOLE_TX_GPIO U0TXD_GPIO_NUM
+#define APP_PROFILE_CONSOLE_RX_GPIO U0RXD_GPIO_NUM
+#endif
+
+struct PinClaim {
+    const char *owner;
+    int gpio;
+};
+
+// Default GPIOs of everything in the build, and the pins the module itself needs. The signal
+// GPIO can be moved at runtime through the settings; the check covers the compiled-in default
+// and app_settings vets a moved one with pin_owner().
+static constexpr PinClaim kPins[] = {
+    {"signal", CONFIG_SKULL_SIGNAL_GPIO},
+    {"button", CONFIG_SKULL_BUTTON_GPIO},
+#if CONFIG_IDF_TARGET_ESP32C3
+    // Wired to the SPI flash and the USB Serial/JTAG port on every ESP32-C3 module
+    {"SPI flash supply", 11},
+    {"SPI flash HD", 12},
+    {"SPI flash WP", 13},
+    {"SPI flash CS", 14},
+    {"SPI flash CLK", 15},
+    {"SPI flash D", 16},
+    {"SPI flash Q", 17},
+    {"USB D-", 18},
+    {"USB D+", 19},
+#endif
+#if CONFIG_ESP_CONSOLE_UART
+    {"console TX", APP_PROFILE_CONSOLE_TX_GPIO},
+    {"console RX", APP_PROFILE_CONSOLE_RX_GPIO},
+#endif
+#if CONFIG_SKULL_STATUS_LED
+    {"status LED", CONFIG_SKULL_STATUS_LED_GPIO},
+#endif
+#if CONFIG_SKULL_LINK_UART
+    {"link TX", CONFIG_SKULL_LINK_TX_GPIO},
+#if CONFIG_SKULL_LINK_ACK_TIMEOUT_MS > 0
+    {"link RX", CONFIG_SKULL_LINK_RX_GPIO},
+#endif
+#endif
+#if CONFIG_SKULL_BUSY_INPUT
+    {"busy input", CONFIG_SKULL_BUSY_GPIO},
+#endif
+#if CONFIG_SKULL_PIR_INPUT
+    {"PIR 1", CONFIG_SKULL_PIR1_GPIO},
+#if CONFIG_SKULL_PIR_COUNT >= 2
+    {"PIR 2", CONFIG_SKULL_PIR2_GPIO},
+#endif
+#if CONFIG_SKULL_PIR_COUNT >= 3
+    {"PIR 3", CONFIG_SKULL_PIR3_GPIO},
+#endif
+#if CONFIG_SKULL_PIR_COUNT >= 4
+    {"PIR 4", CONFIG_SKULL_PIR4_GPIO},
+#endif
+#endif
+#if CONFIG_SKULL_SHTC3
+    {"SHTC3 SDA", CONFIG_SHTC3_I2C_SDA_PIN},
+    {"SHTC3 SCL", CONFIG_SHTC3_I2C_SCL_PIN},
+#endif
+#if CONFIG_SKULL_BENCH
+    {"bench", CONFIG_SKULL_BENCH_GPIO},
+#endif
+};
+
+static constexpr bool pins_distinct()
+{
+    constexpr size_t count = sizeof(kPins) / sizeof(kPins[0]);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = i + 1; j < count; j++) {
+            if (kPins[i].gpio == kPins[j].gpio) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(pins_distinct(), "Two features of this build share a GPIO; see AppProfile::kPins in app_profile.h");
+
+#if CONFIG_SKULL_LINK_UART && CONFIG_ESP_CONSOLE_UART
+static_assert(CONFIG_SKULL_LINK_UART_NUM != CONFIG_ESP_CONSOLE_UART_NUM,
+              "The controller link needs a UART other than the console's; see SKULL_LINK_UART_NUM");
+#endif
+
+// Feature of this build other than `except` that claims gpio, or NULL if there is none
+static inline const char *pin_owner(int gpio, const char *except)
+{
+    for (const PinClaim &claim : kPins) {
+        if (claim.gpio == gpio && strcmp(claim.owner, except) != 0) {
+            return claim.owner;
+        }
+    }
+    return NULL;
+}
+
+} // namespace AppProfile
@@ -0,0 +1,252 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <sys/time.h>
+
+#include "sdkconfig.h"
+
+#include "app_sched.h"
+
+static const char *TAG = "app_sched";
+
+#define WHEEL_SLOTS         256                             // must be a power of two
+#define WHEEL_MASK          (WHEEL_SLOTS - 1)
+#define TICK_US             (CONFIG_SKULL_SCHED_TICK_MS * 1000)
+#define MIN_VALID_EPOCH_S   1704067200                      // 2024-01-01, anything earlier means "clock not set"
+
+typedef struct sched_entry {
+    struct sched_entry *next;
+    app_sched_cb_t cb;
+    void *arg;
+    int64_t fire_at_us;     // esp_timer time the caller asked for
+    uint32_t rounds;        // full wheel revolutions left before this entry is due
+} sched_entry_t;
+
+static sched_entry_t s_pool[CONFIG_SKULL_SCHED_MAX_PENDING];
+static sched_entry_t *s_free_list;
+static sched_entry_t *s_slots[WHEEL_SLOTS];
+
+static SemaphoreHandle_t s_mutex;
+static esp_timer_handle_t s_tick_timer;
+static bool s_running;
+static int64_t s_origin_us;     // esp_timer time of tick 0
+static uint32_t s_tick;         // ticks processed since s_origin_us
+static size_t s_pending;
+static app_sched_stats_t s_stats;
+
+static void sched_tick_cb(void *arg)
+{
+    sched_entry_t *due = NULL;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_tick++;
+    sched_entry_t **link = &s_slots[s_tick & WHEEL_MASK];
+    while (*link) {
+        sched_entry_t *entry = *link;
+        if (entry->rounds > 0) {
+            entry->rounds--;
+            link = &entry->next;
+            continue;
+        }
+        *link = entry->next;
+        entry->next = due;
+        due = entry;
+        s_pending--;
+    }
+    if (s_pending == 0) {
+        esp_timer_stop(s_tick_timer);
+        s_running = false;
+    }
+    xSemaphoreGive(s_mutex);
+
+    int64_t now = esp_timer_get_time();
+    while (due) {
+        sched_entry_t *entry = due;
+        due = entry->next;
+
+        int32_t lag_us = (int32_t)(now - entry->fire_at_us);
+        entry->cb(entry->arg);
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        if (lag_us > s_stats.max_lag_us) {
+            s_stats.max_lag_us = lag_us;
+        }
+        s_stats.fired++;
+        entry->next = s_free_list;
+        s_free_list = entry;
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+static esp_err_t sched_insert(int64_t fire_at_us, bool late, app_sched_cb_t cb, void *arg)
+{
+    if (!cb || !s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    sched_entry_t *entry = s_free_list;
+    if (!entry) {
+        s_stats.dropped++;
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+    s_free_list = entry->next;
+
+    int64_t now = esp_timer_get_time();
+    if (!s_running) {
+        s_origin_us = now;
+        s_tick = 0;
+    }
+
+    // First tick at or after the requested time, but never one that has already run.
+    uint32_t next_tick = s_tick + 1;
+    uint32_t target_tick = next_tick;
+    if (fire_at_us > s_origin_us) {
+        uint64_t ticks = (fire_at_us - s_origin_us + TICK_US - 1) / TICK_US;
+        if (ticks > next_tick) {
+            target_tick = (uint32_t)ticks;
+        }
+    }
+
+    entry->cb = cb;
+    entry->arg = arg;
+    entry->fire_at_us = fire_at_us;
+    entry->rounds = (target_tick - next_tick) / WHEEL_SLOTS;
+    entry->next = s_slots[target_tick & WHEEL_MASK];
+    s_slots[target_tick & WHEEL_MASK] = entry;
+    s_pending++;
+    s_stats.scheduled++;
+    if (late) {
+        s_stats.late++;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (!s_running) {
+        err = esp_timer_start_periodic(s_tick_timer, TICK_US);
+        s_running = (err == ESP_OK);
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start wheel timer: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t app_sched_init(void)
+{
+    if (s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (size_t i = 0; i < CONFIG_SKULL_SCHED_MAX_PENDING; i++) {
+        s_pool[i].next = s_free_list;
+        s_free_list = &s_pool[i];
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = sched_tick_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "sched_wheel",
+        .skip_unhandled_events = false,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_tick_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create wheel timer: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        esp_timer_delete(s_tick_timer);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Trigger scheduler ready: %d slots x %d ms, %d entries", WHEEL_SLOTS, CONFIG_SKULL_SCHED_TICK_MS,
+             CONFIG_SKULL_SCHED_MAX_PENDING);
+    return ESP_OK;
+}
+
+esp_err_t app_sched_after(uint32_t delay_ms, app_sched_cb_t cb, void *arg)
+{
+    if (delay_ms > CONFIG_SKULL_SCHED_MAX_DELAY_MS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sched_insert(esp_timer_get_time() + (int64_t)delay_ms * 1000, false, cb, arg);
+}
+
+esp_err_t app_sched_at_utc(uint64_t utc_ms, app_sched_cb_t cb, void *arg)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < MIN_VALID_EPOCH_S) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Sample both clocks back to back so the conversion error stays in the microsecond range.
+    int64_t now_us = esp_timer_get_time();
+    int64_t utc_now_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    int64_t delay_us = (int64_t)utc_ms * 1000 - utc_now_us;
+    if (delay_us > (int64_t)CONFIG_SKULL_SCHED_MAX_DELAY_MS * 1000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sched_insert(now_us + delay_us, delay_us < 0, cb, arg);
+}
+
+void app_sched_cancel_all(void)
+{
+    if (!s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < WHEEL_SLOTS; i++) {
+        while (s_slots[i]) {
+            sched_entry_t *entry = s_slots[i];
+            s_slots[i] = entry->next;
+            entry->next = s_free_list;
+            s_free_list = entry;
+        }
+    }
+    s_pending = 0;
+    if (s_running) {
+        esp_timer_stop(s_tick_timer);
+        s_running = false;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+size_t app_sched_pending(void)
+{
+    if (!s_mutex) {
+        return 0;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    size_t pending = s_pending;
+    xSemaphoreGive(s_mutex);
+    return pending;
+}
+
+void app_sched_get_stats(app_sched_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!s_mutex) {
+        *stats = {};
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_mutex);
+}
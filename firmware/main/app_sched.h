@@ -0,0 +1,75 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Scheduled trigger facility.
+//
+// Pending actions are kept in a hashed timer wheel backed by a fixed pool, so insert and expiry
+// are O(1) and nothing is allocated after init. The wheel is advanced by a periodic esp_timer
+// that only runs while something is pending. Callbacks run in the esp_timer task.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+using app_sched_cb_t = void (*)(void *arg);
+
+typedef struct {
+    uint32_t scheduled;  // accepted by app_sched_after()/app_sched_at_utc()
+    uint32_t fired;      // callbacks invoked
+    uint32_t late;       // absolute triggers whose fire time had already passed when scheduled
+    uint32_t dropped;    // rejected because the pool was full
+    int32_t max_lag_us;  // worst observed fire time minus requested time
+} app_sched_stats_t;
+
+/**
+ * @brief Initialize the scheduler. This function should be called only once.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_sched_init(void);
+
+/**
+ * @brief Run a callback after a relative delay.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the delay exceeds CONFIG_SKULL_SCHED_MAX_DELAY_MS.
+ * @return ESP_ERR_NO_MEM if all CONFIG_SKULL_SCHED_MAX_PENDING entries are in use.
+ */
+esp_err_t app_sched_after(uint32_t delay_ms, app_sched_cb_t cb, void *arg);
+
+/**
+ * @brief Run a callback at an absolute wall-clock time.
+ *
+ * The system clock must have been set (SNTP, Matter time sync, ...). Boards sharing a
+ * synchronized clock fire within one wheel tick plus their clock error of each other.
+ * A time in the past fires on the next tick and is counted as late.
+ *
+ * @param utc_ms Unix time in milliseconds.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_STATE if the system clock has not been set.
+ * @return same errors as app_sched_after() otherwise.
+ */
+esp_err_t app_sched_at_utc(uint64_t utc_ms, app_sched_cb_t cb, void *arg);
+
+/**
+ * @brief Drop every pending entry without running it.
+ */
+void app_sched_cancel_all(void);
+
+/**
+ * @brief Number of entries waiting in the wheel.
+ */
+size_t app_sched_pending(void);
+
+/**
+ * @brief Copy the scheduler counters.
+ */
+void app_sched_get_stats(app_sched_stats_t *stats);
@@ -0,0 +1,370 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <atomic>
+#include <inttypes.h>
+#include <string.h>
+
+#include <driver/gpio.h>
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+#include <nvs.h>
+
+#include "sdkconfig.h"
+
+#include "app_profile.h"
+#include "app_settings.h"
+
+static const char *TAG = "app_settings";
+
+#define SETTINGS_NAMESPACE      "skull_cfg"
+#define SETTINGS_KEY_BLOB       "cfg"
+#define SETTINGS_KEY_PULSE_MS   "pulse_ms"  // v1: the only setting, stored as its own key
+
+// Blob layout, little endian:
+//   u16 magic, u8 version, u8 payload length, u32 CRC-32 of the payload, payload.
+// New versions only append payload fields, so any newer payload starts with a valid older one.
+#define BLOB_MAGIC              0x4B53      // "SK"
+#define BLOB_HEADER_LEN         8
+#define PAYLOAD_V2_LEN          10          // pulse_ms u16, signal_gpio i8, reserved u8, pir_hold_s u16,
+                                            // shtc3_interval_ms u32
+
+#define PIR_HOLD_S_MIN          5
+#define PIR_HOLD_S_MAX          1800
+#define SHTC3_INTERVAL_MS_MIN   1000
+#define SHTC3_INTERVAL_MS_MAX   3600000
+#define SHTC3_INTERVAL_MS_DEFAULT 5000
+
+static app_settings_t s_boot;                   // constant after init
+static std::atomic<uint32_t> s_pulse_ms{CONFIG_SKULL_PULSE_DURATION_MS};
+static app_settings_t s_staged;                 // next blob to save, pulse_ms excluded
+static app_settings_t s_saved;                  // contents of the blob in flash
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static TimerHandle_t s_save_timer = NULL;
+static uint8_t s_newer_version;                 // version of a blob from newer firmware, never written over
+
+static bool pulse_ms_valid(uint32_t pulse_ms)
+{
+    return pulse_ms >= APP_SETTINGS_PULSE_MS_MIN && pulse_ms <= APP_SETTINGS_PULSE_MS_MAX;
+}
+
+// The signal line may move to any output-capable GPIO that no other feature of the build
+// claims and the module does not need for its flash, USB or console. A blob that points it at
+// the button or the LED would otherwise fight that driver on every boot.
+esp_err_t app_settings_check_signal_gpio(int gpio, const char **owner)
+{
+    if (owner) {
+        *owner = NULL;
+    }
+    if (gpio >= GPIO_NUM_MAX || !GPIO_IS_VALID_OUTPUT_GPIO(gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *claimed_by = AppProfile::pin_owner(gpio, "signal");
+    if (claimed_by) {
+        if (owner) {
+            *owner = claimed_by;
+        }
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static bool signal_gpio_valid(int gpio)
+{
+    return app_settings_check_signal_gpio(gpio, NULL) == ESP_OK;
+}
+
+static bool settings_valid(const app_settings_t *settings)
+{
+    return pulse_ms_valid(settings->pulse_ms) && signal_gpio_valid(settings->signal_gpio) &&
+           settings->pir_hold_s >= PIR_HOLD_S_MIN && settings->pir_hold_s <= PIR_HOLD_S_MAX &&
+           settings->shtc3_interval_ms >= SHTC3_INTERVAL_MS_MIN && settings->shtc3_interval_ms <= SHTC3_INTERVAL_MS_MAX;
+}
+
+static bool settings_equal(const app_settings_t *a, const app_settings_t *b)
+{
+    return a->pulse_ms == b->pulse_ms && a->signal_gpio == b->signal_gpio && a->pir_hold_s == b->pir_hold_s &&
+           a->shtc3_interval_ms == b->shtc3_interval_ms;
+}
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+void app_settings_defaults(app_settings_t *settings)
+{
+    settings->pulse_ms = CONFIG_SKULL_PULSE_DURATION_MS;
+    settings->signal_gpio = CONFIG_SKULL_SIGNAL_GPIO;
+    settings->pir_hold_s = CONFIG_PIR_OCCUPIED_TO_UNOCCUPIED_DELAY_SECONDS;
+    settings->shtc3_interval_ms = SHTC3_INTERVAL_MS_DEFAULT;
+}
+
+size_t app_settings_encode(const app_settings_t *settings, uint8_t *blob, size_t size)
+{
+    if (size < BLOB_HEADER_LEN + PAYLOAD_V2_LEN) {
+        return 0;
+    }
+    uint8_t *payload = blob + BLOB_HEADER_LEN;
+    put_u16(payload + 0, settings->pulse_ms);
+    payload[2] = (uint8_t)settings->signal_gpio;
+    payload[3] = 0;
+    put_u16(payload + 4, settings->pir_hold_s);
+    put_u32(payload + 6, settings->shtc3_interval_ms);
+
+    put_u16(blob, BLOB_MAGIC);
+    blob[2] = APP_SETTINGS_VERSION;
+    blob[3] = PAYLOAD_V2_LEN;
+    put_u32(blob + 4, esp_rom_crc32_le(0, payload, PAYLOAD_V2_LEN));
+    return BLOB_HEADER_LEN + PAYLOAD_V2_LEN;
+}
+
+esp_err_t app_settings_decode(const uint8_t *blob, size_t len, app_settings_t *settings)
+{
+    app_settings_t defaults;
+    app_settings_defaults(&defaults);
+    *settings = defaults;
+
+    if (len < BLOB_HEADER_LEN || get_u16(blob) != BLOB_MAGIC || blob[3] != len - BLOB_HEADER_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t version = blob[2];
+    const uint8_t *payload = blob + BLOB_HEADER_LEN;
+    size_t payload_len = blob[3];
+    if (version < 2 || (version == 2 && payload_len != PAYLOAD_V2_LEN) || payload_len < PAYLOAD_V2_LEN) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (get_u32(blob + 4) != esp_rom_crc32_le(0, payload, payload_len)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // v2 fields; a newer blob (after a downgrade) is read as its v2 prefix
+    settings->pulse_ms = get_u16(payload + 0);
+    settings->signal_gpio = (int8_t)payload[2];
+    settings->pir_hold_s = get_u16(payload + 4);
+    settings->shtc3_interval_ms = get_u32(payload + 6);
+
+    // Repair individual fields rather than dropping the whole blob
+    if (!pulse_ms_valid(settings->pulse_ms)) {
+        settings->pulse_ms = defaults.pulse_ms;
+    }
+    if (!signal_gpio_valid(settings->signal_gpio)) {
+        ESP_LOGW(TAG, "Signal GPIO %d unusable, using GPIO %d", settings->signal_gpio, defaults.signal_gpio);
+        settings->signal_gpio = defaults.signal_gpio;
+    }
+    if (settings->pir_hold_s < PIR_HOLD_S_MIN || settings->pir_hold_s > PIR_HOLD_S_MAX) {
+        settings->pir_hold_s = defaults.pir_hold_s;
+    }
+    if (settings->shtc3_interval_ms < SHTC3_INTERVAL_MS_MIN || settings->shtc3_interval_ms > SHTC3_INTERVAL_MS_MAX) {
+        settings->shtc3_interval_ms = defaults.shtc3_interval_ms;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t settings_write(const app_settings_t *settings, bool erase_v1)
+{
+    uint8_t blob[APP_SETTINGS_BLOB_MAX];
+    size_t len = app_settings_encode(settings, blob, sizeof(blob));
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(handle, SETTINGS_KEY_BLOB, blob, len);
+    if (err == ESP_OK && erase_v1) {
+        nvs_erase_key(handle, SETTINGS_KEY_PULSE_MS);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+// Runs in the FreeRTOS timer task, one window after the first unsaved change
+static void settings_save_timer_cb(TimerHandle_t timer)
+{
+    app_settings_t settings;
+    portENTER_CRITICAL(&s_lock);
+    settings = s_staged;
+    portEXIT_CRITICAL(&s_lock);
+    settings.pulse_ms = (uint16_t)s_pulse_ms.load(std::memory_order_relaxed);
+
+    if (settings_equal(&settings, &s_saved)) {
+        return; // changed and changed back within the window
+    }
+    if (s_newer_version) {
+        // Writing v2 would lose the fields of the newer layout for the firmware they belong to
+        ESP_LOGW(TAG, "Settings blob is v%u, newer than this firmware; pulse %u ms not saved", s_newer_version,
+                 settings.pulse_ms);
+        return;
+    }
+    esp_err_t err = settings_write(&settings, false);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save settings: %s", esp_err_to_name(err));
+        return;
+    }
+    s_saved = settings;
+    ESP_LOGI(TAG, "Saved settings (pulse %u ms)", settings.pulse_ms);
+}
+
+static void settings_schedule_save(void)
+{
+    // The window is not restarted by later writes, so a slider drag costs at most
+    // one flash write per window and the final value lands within one window.
+    if (s_save_timer && xTimerIsTimerActive(s_save_timer) == pdFALSE) {
+        xTimerStart(s_save_timer, 0);
+    }
+}
+
+// Reads the blob, or builds one from the v1 keys. Returns true if the result must be written back.
+// A blob from newer firmware is read as its v2 prefix and left as it is; *newer_version is set to
+// its version.
+static bool settings_load(nvs_handle_t handle, app_settings_t *settings, bool *erase_v1, uint8_t *newer_version)
+{
+    uint8_t blob[APP_SETTINGS_BLOB_MAX];
+    size_t len = sizeof(blob);
+    esp_err_t err = nvs_get_blob(handle, SETTINGS_KEY_BLOB, blob, &len);
+    if (err == ESP_OK) {
+        err = app_settings_decode(blob, len, settings);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Settings blob rejected (%s), using defaults", esp_err_to_name(err));
+            return false;   // keep the bad blob until something changes, in case it is worth a look
+        }
+        if (blob[2] > APP_SETTINGS_VERSION) {
+            ESP_LOGW(TAG, "Settings blob v%u is newer than this firmware, reading it without saving", blob[2]);
+            *newer_version = blob[2];
+        }
+        return blob[2] < APP_SETTINGS_VERSION;
+    }
+    if (err == ESP_ERR_NVS_INVALID_LENGTH) {
+        ESP_LOGW(TAG, "Settings blob larger than %d bytes, using defaults", APP_SETTINGS_BLOB_MAX);
+        return false;
+    }
+
+    // v1 -> v2: pulse_ms was stored as a separate u16 key
+    uint16_t pulse_ms = 0;
+    if (nvs_get_u16(handle, SETTINGS_KEY_PULSE_MS, &pulse_ms) == ESP_OK) {
+        if (pulse_ms_valid(pulse_ms)) {
+            settings->pulse_ms = pulse_ms;
+        }
+        ESP_LOGI(TAG, "Migrating v1 settings");
+        *erase_v1 = true;
+        return true;
+    }
+    return false;
+}
+
+esp_err_t app_settings_init(void)
+{
+    if (s_save_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    app_settings_t settings;
+    app_settings_defaults(&settings);
+    bool write_back = false;
+    bool erase_v1 = false;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SETTINGS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        write_back = settings_load(handle, &settings, &erase_v1, &s_newer_version);
+        nvs_close(handle);
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Failed to open settings, using defaults: %s", esp_err_to_name(err));
+    }
+
+    if (write_back) {
+        err = settings_write(&settings, erase_v1);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to write migrated settings: %s", esp_err_to_name(err));
+        }
+    }
+
+    s_boot = settings;
+    s_staged = settings;
+    s_saved = settings;
+    s_pulse_ms.store(settings.pulse_ms, std::memory_order_relaxed);
+
+    s_save_timer = xTimerCreate("settings_save", pdMS_TO_TICKS(CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS),
+                                pdFALSE /* one-shot */, NULL, settings_save_timer_cb);
+    if (!s_save_timer) {
+        ESP_LOGE(TAG, "Failed to create settings save timer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Settings v%d: pulse %u ms, signal GPIO %d, PIR hold %u s, SHTC3 every %" PRIu32 " ms",
+             APP_SETTINGS_VERSION, settings.pulse_ms, settings.signal_gpio, settings.pir_hold_s,
+             settings.shtc3_interval_ms);
+    return ESP_OK;
+}
+
+const app_settings_t *app_settings_get(void)
+{
+    return &s_boot;
+}
+
+void app_settings_get_staged(app_settings_t *settings)
+{
+    portENTER_CRITICAL(&s_lock);
+    *settings = s_staged;
+    portEXIT_CRITICAL(&s_lock);
+    settings->pulse_ms = (uint16_t)s_pulse_ms.load(std::memory_order_relaxed);
+}
+
+uint32_t app_settings_get_pulse_ms(void)
+{
+    return s_pulse_ms.load(std::memory_order_relaxed);
+}
+
+esp_err_t app_settings_set_pulse_ms(uint32_t pulse_ms)
+{
+    if (!pulse_ms_valid(pulse_ms)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pulse_ms.store(pulse_ms, std::memory_order_relaxed);
+    settings_schedule_save();
+    return ESP_OK;
+}
+
+esp_err_t app_settings_stage(const app_settings_t *settings)
+{
+    if (!settings || !settings_valid(settings)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_newer_version) {
+        return ESP_ERR_INVALID_STATE;   // nothing staged could reach the next boot
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_staged = *settings;
+    portEXIT_CRITICAL(&s_lock);
+    s_pulse_ms.store(settings->pulse_ms, std::memory_order_relaxed);
+    settings_schedule_save();
+    return ESP_OK;
+}
@@ -0,0 +1,112 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Persistent application settings.
+//
+// All settings are stored together as one versioned, CRC-protected NVS blob that is read once
+// at boot into a struct that is constant afterwards. Older layouts (including the v1 per-key
+// format) are migrated forward on load, and a blob that fails its checks falls back to the
+// Kconfig defaults. A blob from newer firmware (after a rollback) is read as the prefix this
+// version knows and is never written over, so the fields it adds survive for that firmware. The pulse duration can also change at runtime and lives in an atomic so
+// hot paths read it without NVS calls or the Matter lock. Changes are written back as a single
+// blob at most once per CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS; NVS replaces a blob atomically.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_SETTINGS_PULSE_MS_MIN   50
+#define APP_SETTINGS_PULSE_MS_MAX   5000
+
+#define APP_SETTINGS_VERSION        2
+#define APP_SETTINGS_BLOB_MAX       32
+
+typedef struct {
+    uint16_t pulse_ms;              // signal pulse width
+    int8_t signal_gpio;             // GPIO of the signal output channel
+    uint16_t pir_hold_s;            // occupied to unoccupied delay of the PIR
+    uint32_t shtc3_interval_ms;     // SHTC3 polling interval
+} app_settings_t;
+
+/**
+ * @brief Load settings from NVS, migrating older layouts. NVS must already be initialized.
+ *
+ * A missing or invalid blob, or out-of-range fields, fall back to their Kconfig defaults.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_settings_init(void);
+
+/**
+ * @brief Settings as loaded at boot. The struct does not change after app_settings_init().
+ */
+const app_settings_t *app_settings_get(void);
+
+/**
+ * @brief Settings the next boot will use: the last staged set with the current pulse duration.
+ */
+void app_settings_get_staged(app_settings_t *settings);
+
+/**
+ * @brief Current pulse duration in milliseconds. Safe to call from any context.
+ */
+uint32_t app_settings_get_pulse_ms(void);
+
+/**
+ * @brief Change the pulse duration. Takes effect on the next pulse and is persisted later,
+ *        unless the blob in flash is from newer firmware.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if outside APP_SETTINGS_PULSE_MS_MIN..APP_SETTINGS_PULSE_MS_MAX.
+ */
+esp_err_t app_settings_set_pulse_ms(uint32_t pulse_ms);
+
+/**
+ * @brief Persist a new set of settings. The pulse duration applies immediately, every other
+ *        field on the next boot.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if a field is out of range, or the signal GPIO cannot drive an
+ *         output or is claimed by another feature of the build (AppProfile::kPins).
+ * @return ESP_ERR_INVALID_STATE if the blob in flash is from newer firmware.
+ */
+esp_err_t app_settings_stage(const app_settings_t *settings);
+
+/**
+ * @brief Check a GPIO for the signal output channel, as app_settings_stage() does.
+ *
+ * @param owner if not NULL, set to the feature of the build that claims the pin, or NULL.
+ *
+ * @return ESP_OK if the pin can drive an output and no other feature claims it.
+ * @return ESP_ERR_INVALID_ARG otherwise.
+ */
+esp_err_t app_settings_check_signal_gpio(int gpio, const char **owner);
+
+/**
+ * @brief Fill a struct with the Kconfig defaults.
+ */
+void app_settings_defaults(app_settings_t *settings);
+
+/**
+ * @brief Serialize settings into the current blob layout.
+ *
+ * @return blob length, or 0 if the buffer is too small.
+ */
+size_t app_settings_encode(const app_settings_t *settings, uint8_t *blob, size_t size);
+
+/**
+ * @brief Parse a blob of any known version. Fields the blob does not carry, and fields that
+ *        are out of range, are set to their defaults.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_SIZE / ESP_ERR_INVALID_VERSION / ESP_ERR_INVALID_CRC if the blob is
+ *         unusable; the output then holds the defaults.
+ */
+esp_err_t app_settings_decode(const uint8_t *blob, size_t len, app_settings_t *settings);
@@ -0,0 +1,144 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <atomic>
+
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+#include "app_stats.h"
+
+#define SUB_BITS        2                           // 4 sub-buckets per power of two
+#define SUB_BUCKETS     (1 << SUB_BITS)
+#define MAX_EXPONENT    24                          // ~16 s, everything above lands in the last bucket
+#define BUCKETS         ((MAX_EXPONENT + 1) * SUB_BUCKETS)
+
+static_assert(BUCKETS == APP_STATS_LATENCY_BUCKETS, "histogram size changed");
+
+static std::atomic<uint32_t> s_triggers{0};
+static std::atomic<uint32_t> s_ignored{0};
+static std::atomic<uint32_t> s_rate_limited{0};
+static std::atomic<uint32_t> s_last_latency_us{0};
+static std::atomic<uint32_t> s_pir_edges{0};
+static std::atomic<uint32_t> s_sensor_errors{0};
+static std::atomic<uint32_t> s_reports_saved{0};
+static std::atomic<uint32_t> s_thermal_throttle{0};
+static std::atomic<uint32_t> s_latency_hist[BUCKETS];
+
+// Values below SUB_BUCKETS get a bucket each; above that, the top SUB_BITS bits after the
+// leading one select the sub-bucket.
+static uint32_t latency_bucket(uint32_t us)
+{
+    if (us < SUB_BUCKETS) {
+        return us;
+    }
+    uint32_t exponent = 31 - __builtin_clz(us);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+    uint32_t sub = (us >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+static uint32_t bucket_upper_bound(uint32_t bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    uint32_t exponent = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    uint32_t sub = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << (exponent - SUB_BITS)) - 1;
+}
+
+void app_stats_trigger(uint32_t latency_us)
+{
+    s_triggers.fetch_add(1, std::memory_order_relaxed);
+    s_last_latency_us.store(latency_us, std::memory_order_relaxed);
+    s_latency_hist[latency_bucket(latency_us)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void app_stats_ignored(void)
+{
+    s_ignored.fetch_add(1, std::memory_order_relaxed);
+}
+
+void app_stats_rate_limited(void)
+{
+    s_rate_limited.fetch_add(1, std::memory_order_relaxed);
+}
+
+void IRAM_ATTR app_stats_pir_edge(void)
+{
+    s_pir_edges.fetch_add(1, std::memory_order_relaxed);
+}
+
+void app_stats_sensor_error(void)
+{
+    s_sensor_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void app_stats_reports_saved(uint32_t reports)
+{
+    s_reports_saved.fetch_add(reports, std::memory_order_relaxed);
+}
+
+void app_stats_thermal_throttle(uint8_t percent)
+{
+    s_thermal_throttle.store(percent, std::memory_order_relaxed);
+}
+
+uint32_t app_stats_latency_percentile(uint32_t percent)
+{
+    uint32_t counts[BUCKETS];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < BUCKETS; i++) {
+        counts[i] = s_latency_hist[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return bucket_upper_bound(i);
+        }
+    }
+    return bucket_upper_bound(BUCKETS - 1);
+}
+
+size_t app_stats_latency_histogram(app_stats_bucket_t *buckets, size_t max)
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < BUCKETS && count < max; i++) {
+        uint32_t n = s_latency_hist[i].load(std::memory_order_relaxed);
+        if (n) {
+            buckets[count].upper_us = bucket_upper_bound(i);
+            buckets[count].count = n;
+            count++;
+        }
+    }
+    return count;
+}
+
+void app_stats_snapshot(app_stats_snapshot_t *snapshot)
+{
+    snapshot->triggers = s_triggers.load(std::memory_order_relaxed);
+    snapshot->ignored = s_ignored.load(std::memory_order_relaxed);
+    snapshot->rate_limited = s_rate_limited.load(std::memory_order_relaxed);
+    snapshot->last_latency_us = s_last_latency_us.load(std::memory_order_relaxed);
+    snapshot->p99_latency_us = app_stats_latency_percentile(99);
+    snapshot->pir_edges = s_pir_edges.load(std::memory_order_relaxed);
+    snapshot->sensor_errors = s_sensor_errors.load(std::memory_order_relaxed);
+    snapshot->uptime_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    snapshot->reports_saved = s_reports_saved.load(std::memory_order_relaxed);
+    snapshot->thermal_throttle = s_thermal_throttle.load(std::memory_order_relaxed);
+}
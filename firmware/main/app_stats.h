@@ -0,0 +1,65 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Runtime statistics for the diagnostics cluster.
+//
+// Hot paths only bump relaxed atomics; nothing is formatted, stored or reported until someone
+// asks for a snapshot. Trigger latency goes into a log-linear histogram (4 sub-buckets per
+// power of two) from which percentiles are estimated on read.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_STATS_LATENCY_BUCKETS   100     // 25 powers of two, 4 sub-buckets each
+
+typedef struct {
+    uint32_t triggers;          // pulses started
+    uint32_t ignored;           // triggers dropped as busy, playing or duplicate
+    uint32_t rate_limited;      // triggers rejected by the rate limiter or the thermal cutoff
+    uint32_t last_latency_us;   // request to pulse start of the last trigger
+    uint32_t p99_latency_us;    // upper bound of the bucket holding the 99th percentile
+    uint32_t pir_edges;
+    uint32_t sensor_errors;     // failed SHTC3 reads
+    uint32_t uptime_s;
+    uint32_t reports_saved;     // OnOff subscription reports avoided by coalescing
+    uint32_t thermal_throttle;  // percent the trigger budget is cut by thermal derating
+} app_stats_snapshot_t;
+
+typedef struct {
+    uint32_t upper_us;          // largest latency the bucket holds
+    uint32_t count;
+} app_stats_bucket_t;
+
+void app_stats_trigger(uint32_t latency_us);
+void app_stats_ignored(void);
+void app_stats_rate_limited(void);
+void app_stats_pir_edge(void);      // ISR-safe
+void app_stats_sensor_error(void);
+void app_stats_reports_saved(uint32_t reports);
+void app_stats_thermal_throttle(uint8_t percent);
+
+/**
+ * @brief Collect the current values. Safe to call from any task.
+ */
+void app_stats_snapshot(app_stats_snapshot_t *snapshot);
+
+/**
+ * @brief Estimate a latency percentile from the histogram.
+ *
+ * @param percent 1..100
+ * @return upper bound of the bucket holding the percentile in microseconds, 0 if there is no data.
+ */
+uint32_t app_stats_latency_percentile(uint32_t percent);
+
+/**
+ * @brief Copy the non-empty buckets of the latency histogram, lowest first.
+ *
+ * @return number of buckets copied.
+ */
+size_t app_stats_latency_histogram(app_stats_bucket_t *buckets, size_t max);
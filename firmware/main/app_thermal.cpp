@@ -0,0 +1,114 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <atomic>
+#include <math.h>
+
+#include <esp_log.h>
+
+#include "app_thermal.h"
+
+static const char *TAG = "app_thermal";
+
+#define TEMP_UNKNOWN    INT16_MIN
+
+static app_thermal_config_t s_config;
+static bool s_cut_off;                      // sensor task only
+
+static std::atomic<uint8_t> s_scale_pct{100};
+static std::atomic<int16_t> s_temperature_dc{TEMP_UNKNOWN};
+static std::atomic<uint32_t> s_samples{0};
+static std::atomic<uint32_t> s_changes{0};
+
+esp_err_t app_thermal_init(const app_thermal_config_t *config)
+{
+    if (!config || config->derate_start_c >= config->derate_full_c || config->derate_full_c >= config->cutoff_c ||
+        config->min_scale_pct > 100 || config->unknown_scale_pct > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_config = *config;
+    s_cut_off = false;
+    s_temperature_dc.store(TEMP_UNKNOWN, std::memory_order_relaxed);
+    s_scale_pct.store(config->unknown_scale_pct, std::memory_order_relaxed);
+    ESP_LOGI(TAG, "Derating from %d C to %u%% at %d C, cutoff at %d C", config->derate_start_c,
+             config->min_scale_pct, config->derate_full_c, config->cutoff_c);
+    return ESP_OK;
+}
+
+// Piecewise-linear curve in 0.1 degrees C, with the cutoff latched until it has cooled by the hysteresis
+static uint8_t curve_pct(int32_t dc)
+{
+    int32_t cutoff_dc = s_config.cutoff_c * 10;
+    if (dc >= cutoff_dc || (s_cut_off && dc > cutoff_dc - s_config.hysteresis_c * 10)) {
+        s_cut_off = true;
+        return 0;
+    }
+    s_cut_off = false;
+
+    int32_t start_dc = s_config.derate_start_c * 10;
+    int32_t full_dc = s_config.derate_full_c * 10;
+    if (dc <= start_dc) {
+        return 100;
+    }
+    if (dc >= full_dc) {
+        return s_config.min_scale_pct;
+    }
+    return (uint8_t)(100 - (100 - s_config.min_scale_pct) * (dc - start_dc) / (full_dc - start_dc));
+}
+
+uint8_t app_thermal_update(float celsius)
+{
+    uint8_t scale;
+    if (isnan(celsius)) {
+        s_temperature_dc.store(TEMP_UNKNOWN, std::memory_order_relaxed);
+        s_cut_off = false;
+        scale = s_config.unknown_scale_pct;
+    } else {
+        int32_t dc = (int32_t)lroundf(celsius * 10);
+        dc = dc < INT16_MIN + 1 ? INT16_MIN + 1 : (dc > INT16_MAX ? INT16_MAX : dc);
+        s_temperature_dc.store((int16_t)dc, std::memory_order_relaxed);
+        scale = curve_pct(dc);
+    }
+    s_samples.fetch_add(1, std::memory_order_relaxed);
+
+    uint8_t previous = s_scale_pct.exchange(scale, std::memory_order_relaxed);
+    if (previous != scale) {
+        s_changes.fetch_add(1, std::memory_order_relaxed);
+        if (scale == 0) {
+            ESP_LOGW(TAG, "Enclosure at %.1f C, triggers stopped", celsius);
+        } else if (previous == 0 || scale == 100) {
+            ESP_LOGI(TAG, "Trigger budget back to %u%%", scale);
+        } else {
+            ESP_LOGD(TAG, "Trigger budget %u%% at %.1f C", scale, celsius);
+        }
+    }
+    return scale;
+}
+
+uint8_t app_thermal_scale_pct(void)
+{
+    return s_scale_pct.load(std::memory_order_relaxed);
+}
+
+uint32_t app_thermal_max_pulse_ms(uint8_t scale_pct, uint32_t min_ms)
+{
+    uint32_t max_ms = s_config.max_pulse_ms * scale_pct / 100;
+    return max_ms < min_ms ? min_ms : max_ms;
+}
+
+void app_thermal_get_stats(app_thermal_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    stats->temperature_dc = s_temperature_dc.load(std::memory_order_relaxed);
+    stats->scale_pct = s_scale_pct.load(std::memory_order_relaxed);
+    stats->cut_off = (stats->scale_pct == 0);
+    stats->samples = s_samples.load(std::memory_order_relaxed);
+    stats->changes = s_changes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Thermal derating of the trigger output, driven by the enclosure temperature.
+//
+// The sensor task feeds samples in; each one is mapped through a piecewise-linear curve to a
+// scale (percent of the normal trigger budget) that is published in an atomic. The trigger
+// path only loads that byte: no I2C, no lock. Between the derating start and full points the
+// scale falls linearly to the floor; at the cutoff it drops to 0 and stays there until the
+// temperature is a hysteresis below the cutoff again.
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+typedef struct {
+    // below this the output runs unthrottled, in degrees C
+    int16_t derate_start_c = 40;
+    // from here up to the cutoff the scale stays at min_scale_pct
+    int16_t derate_full_c = 55;
+    uint8_t min_scale_pct = 25;
+    // triggers are refused from here on
+    int16_t cutoff_c = 60;
+    uint8_t hysteresis_c = 3;
+    // scale while there is no valid sample (no sensor yet, or the sensor failed)
+    uint8_t unknown_scale_pct = 100;
+    // widest pulse allowed when cool; it shrinks with the scale
+    uint32_t max_pulse_ms = 1000;
+} app_thermal_config_t;
+
+typedef struct {
+    int16_t temperature_dc;     // last sample in 0.1 degrees C, INT16_MIN if unknown
+    uint8_t scale_pct;
+    bool cut_off;
+    uint32_t samples;
+    uint32_t changes;           // times the scale changed
+} app_thermal_stats_t;
+
+/**
+ * @brief Check and apply the curve. Until the first sample the scale is unknown_scale_pct.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the points are not start < full < cutoff or a percentage is over 100.
+ */
+esp_err_t app_thermal_init(const app_thermal_config_t *config);
+
+/**
+ * @brief Feed a temperature sample. Call from one task only (the sensor task).
+ *
+ * @param celsius NAN when the sensor has failed.
+ * @return the new scale in percent.
+ */
+uint8_t app_thermal_update(float celsius);
+
+/**
+ * @brief Share of the normal trigger rate and duty budget allowed right now, 0-100. Lock-free.
+ */
+uint8_t app_thermal_scale_pct(void);
+
+/**
+ * @brief Widest pulse allowed at the given scale, never below min_ms.
+ */
+uint32_t app_thermal_max_pulse_ms(uint8_t scale_pct, uint32_t min_ms);
+
+void app_thermal_get_stats(app_thermal_stats_t *stats);
@@ -0,0 +1,156 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include "app_trace.h"
+
+static const char *TAG = "app_trace";
+
+#define MIN_VALID_EPOCH_S   1704067200      // as app_sched.cpp: earlier means the clock is not set
+
+static_assert(sizeof(app_trace_record_t) == 16, "trace records are decoded as 16 bytes");
+
+static app_trace_record_t *s_ring;
+static uint32_t s_capacity;
+static uint32_t s_head;                     // next slot to write
+static uint32_t s_count;
+static uint32_t s_overwritten;
+static bool s_recording;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t app_trace_start(size_t records)
+{
+    if (records == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    app_trace_stop();
+    if (s_ring && s_capacity != records) {
+        app_trace_free();
+    }
+    if (!s_ring) {
+        app_trace_record_t *ring = (app_trace_record_t *)calloc(records, sizeof(app_trace_record_t));
+        if (!ring) {
+            ESP_LOGE(TAG, "No memory for %u trace records", (unsigned)records);
+            return ESP_ERR_NO_MEM;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_ring = ring;
+        s_capacity = records;
+        portEXIT_CRITICAL(&s_lock);
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_head = 0;
+    s_count = 0;
+    s_overwritten = 0;
+    s_recording = true;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Recording up to %u inputs", (unsigned)records);
+    return ESP_OK;
+}
+
+void app_trace_stop(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_recording = false;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void app_trace_free(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    app_trace_record_t *ring = s_ring;
+    s_recording = false;
+    s_ring = NULL;
+    s_capacity = 0;
+    s_head = 0;
+    s_count = 0;
+    s_overwritten = 0;
+    portEXIT_CRITICAL(&s_lock);
+    free(ring);
+}
+
+void app_trace_append(app_trace_type_t type, uint8_t arg, uint16_t a, uint32_t b)
+{
+    // Unlocked peek; a record racing a start or stop may land on either side of it
+    if (!s_recording) {
+        return;
+    }
+    app_trace_record_t record = {
+        .time_us = esp_timer_get_time(),
+        .type = (uint8_t)type,
+        .arg = arg,
+        .a = a,
+        .b = b,
+    };
+    portENTER_CRITICAL(&s_lock);
+    if (s_recording) {
+        s_ring[s_head] = record;
+        s_head = (s_head + 1) % s_capacity;
+        if (s_count < s_capacity) {
+            s_count++;
+        } else {
+            s_overwritten++;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t app_trace_dump(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool was_recording = s_recording;
+    s_recording = false;
+    uint32_t count = s_count;
+    uint32_t first = (s_head + s_capacity - s_count) % (s_capacity ? s_capacity : 1);
+    uint32_t overwritten = s_overwritten;
+    portEXIT_CRITICAL(&s_lock);
+
+    // Sample both clocks back to back, as app_sched_at_utc() does
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t now_us = esp_timer_get_time();
+    printf("trace v%d: %" PRIu32 " records, %" PRIu32 " overwritten, ", APP_TRACE_VERSION, count, overwritten);
+    if (tv.tv_sec >= MIN_VALID_EPOCH_S) {
+        printf("utc offset %" PRId64 " us\n", (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - now_us);
+    } else {
+        printf("utc offset unknown\n");
+    }
+
+    // The ring cannot change underneath: appends are paused and start/free come from the console
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *bytes = (const uint8_t *)&s_ring[(first + i) % s_capacity];
+        char hex[2 * sizeof(app_trace_record_t) + 1];
+        for (size_t j = 0; j < sizeof(app_trace_record_t); j++) {
+            snprintf(hex + 2 * j, 3, "%02x", bytes[j]);
+        }
+        printf("trace %s\n", hex);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_recording = was_recording;
+    portEXIT_CRITICAL(&s_lock);
+    return count;
+}
+
+void app_trace_get_stats(app_trace_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_lock);
+    stats->recording = s_recording;
+    stats->capacity = s_capacity;
+    stats->count = s_count;
+    stats->overwritten = s_overwritten;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,100 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Input trace for record and replay.
+//
+// While recording, every external input the trigger logic reacts to is appended to a RAM ring
+// with its esp_timer time: On/Off and control cluster writes, debounced PIR edges, button
+// gestures, busy line edges, SHTC3 samples and console or host fires. The outcome of every
+// trigger is recorded as well, so a replay can be checked against what the device did. The
+// ring keeps the newest records and is only allocated while a trace is held. Appending takes
+// a spinlock for a 16-byte copy and is safe from any task, never from an ISR.
+// app_trace_dump() prints the ring as hex records that tools/trace_replay.py decodes and
+// replays.
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_TRACE_VERSION   1
+
+typedef enum {
+    APP_TRACE_START = 1,        // arg: busy line level, a: pulse width in ms,
+                                // b: PIR hold in s (low 16 bits), thermal scale in % (bits 16-23)
+    APP_TRACE_ONOFF,            // arg: endpoint, a: new value
+    APP_TRACE_CONTROL,          // arg: app_trace_control_t, b: value (TriggerAtUtc: low 32 bits, a: bits 32-47)
+    APP_TRACE_PIR_EDGE,         // arg: sensor index, a: level
+    APP_TRACE_BUTTON,           // arg: app_gesture_t, b: first press to dispatch in us
+    APP_TRACE_BUSY,             // a: level of the busy line
+    APP_TRACE_TEMPERATURE,      // a: centi-degrees C as int16, INT16_MIN for no reading, b: the float's bits
+    APP_TRACE_FIRE,             // arg: app_evtlog_source_t (console or host), a: pulses, b: pattern id
+    APP_TRACE_TRIGGER,          // arg: app_evtlog_source_t, a: pulse width (high time for patterns) in ms,
+                                // b: request to start in us (low 24 bits), pulses or 0 for a pattern (top 8)
+    APP_TRACE_IGNORED,          // arg: app_evtlog_source_t, a: app_evtlog_ignore_reason_t
+} app_trace_type_t;
+
+typedef enum {
+    APP_TRACE_TRIGGER_DELAY = 0,
+    APP_TRACE_TRIGGER_AT_UTC,
+    APP_TRACE_PULSE_DURATION,
+    APP_TRACE_TRIGGER_PATTERN,
+} app_trace_control_t;
+
+typedef struct {
+    int64_t time_us;            // esp_timer_get_time()
+    uint8_t type;               // app_trace_type_t
+    uint8_t arg;
+    uint16_t a;
+    uint32_t b;
+} app_trace_record_t;
+
+typedef struct {
+    bool recording;
+    uint32_t capacity;          // records the ring holds
+    uint32_t count;             // records held
+    uint32_t overwritten;       // oldest records lost to newer ones
+} app_trace_stats_t;
+
+/**
+ * @brief Allocate the ring if needed, clear it and start recording.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if records is 0.
+ * @return ESP_ERR_NO_MEM if the ring could not be allocated.
+ */
+esp_err_t app_trace_start(size_t records);
+
+/**
+ * @brief Stop recording. The records stay until app_trace_free() or the next start.
+ */
+void app_trace_stop(void);
+
+/**
+ * @brief Stop recording and release the ring.
+ */
+void app_trace_free(void);
+
+/**
+ * @brief Append a record stamped with the current time. Does nothing unless recording.
+ */
+void app_trace_append(app_trace_type_t type, uint8_t arg, uint16_t a, uint32_t b);
+
+/**
+ * @brief Print the held records oldest first, one "trace <hex>" line each, after a header line
+ *        that carries the offset from esp_timer time to UTC when the clock is set. Recording
+ *        pauses while printing.
+ *
+ * @return number of records printed.
+ */
+uint32_t app_trace_dump(void);
+
+/**
+ * @brief Copy the trace counters.
+ */
+void app_trace_get_stats(app_trace_stats_t *stats);
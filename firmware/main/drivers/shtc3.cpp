@@ -6,17 +6,15 @@
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/timers.h>
-#include <esp_heap_caps.h>
 #include <string.h>
 #include <math.h>
+#include <driver/gpio.h>
 #include <driver/i2c.h> // Use legacy I2C driver
+#include <esp_rom_sys.h>
 #include <cmath> // For NAN
 #include <inttypes.h> // For PRIu32
 
-#include <lib/support/CodeUtils.h>
-#include <esp_matter.h> // For chip::app::Clusters and esp_matter_invalid
-#include <app/ConcreteAttributePath.h> // For chip::app::Clusters definitions
+#include "sdkconfig.h"
 
 #include "shtc3.h"
 
@@ -26,71 +24,119 @@
 #define I2C_MASTER_FREQ_HZ          400000                        /*!< I2C master clock frequency */
 #define SHTC3_SENSOR_ADDR           0x70                          /*!< slave address for SHTC3 sensor */
 
-// SHTC3 Commands (Needed for shtc3_sensor_init internal operations)
-#define SHTC3_WAKE_UP_COMMAND_MSB           0x35
-#define SHTC3_WAKE_UP_COMMAND_LSB           0x17
-#define SHTC3_SLEEP_COMMAND_MSB             0xB0
-#define SHTC3_SLEEP_COMMAND_LSB             0x98
-#define SHTC3_READ_ID_COMMAND_MSB           0xEF
-#define SHTC3_READ_ID_COMMAND_LSB           0xC8
-#define SHTC3_MEASURE_T_FIRST_MSB           0x7C // Low power, T first, Clock stretching enabled
-#define SHTC3_MEASURE_T_FIRST_LSB           0xA2 // Low power, T first, Clock stretching enabled
+// SHTC3 Commands
+#define SHTC3_WAKE_UP_COMMAND               0x3517
+#define SHTC3_SLEEP_COMMAND                 0xB098
+#define SHTC3_SOFT_RESET_COMMAND            0x805D
+#define SHTC3_READ_ID_COMMAND               0xEFC8
+#define SHTC3_MEASURE_T_FIRST               0x7866 // Normal mode, T first, no clock stretching
 
 static const char *TAG = "shtc3_driver";
 
 #define SHTC3_PRODUCT_CODE_MASK             0x083F // From datasheet, bits 5 and 11-15 are don't care
 #define SHTC3_PRODUCT_CODE_SHTC3            0x0807 // SHTC3 product code is 0b0000_1000_0xxx_0111
 
-#define SHTC3_PRODUCT_CODE_SIZE_BYTES       2
+// Recovery tuning. A healthy transaction takes well under 1 ms at 400 kHz; nothing stretches the
+// clock since measurements are polled, so a transaction that needs longer is a stuck bus.
+#define SHTC3_I2C_TIMEOUT_MS                20
+#define SHTC3_WAKE_UP_US                    240    // datasheet max
+#define SHTC3_SOFT_RESET_US                 240
+#define SHTC3_MEASURE_WAIT_MS               13     // normal mode, datasheet max 12.1 ms
+#define SHTC3_FAILURES_BEFORE_DEGRADED      3
+#define SHTC3_BACKOFF_MAX_MS                300000
+#define SHTC3_CLOCK_OUT_PULSES              9      // enough for a slave stuck mid-byte to release SDA
+#define SHTC3_CLOCK_OUT_HALF_PERIOD_US      5
+
+typedef enum {
+    SHTC3_STATE_DETECTING,      // not seen yet, or lost; probing by product ID
+    SHTC3_STATE_RUNNING,
+    SHTC3_STATE_DEGRADED,       // reported as failed; probing with backoff
+} shtc3_state_t;
 
 // Global static variable to store the sensor configuration
 static shtc3_sensor_config_t *g_sensor_config = NULL;
-// Global static variable for the timer handle
-static TimerHandle_t g_sensor_timer_handle = NULL;
 static bool g_is_sensor_initialized = false;
 
-static esp_err_t shtc3_read(uint8_t *data, size_t size)
+// Owned by the polling task
+static shtc3_state_t g_state = SHTC3_STATE_DETECTING;
+static uint8_t g_failures = 0;
+static uint32_t g_backoff_ms = 0;
+
+static esp_err_t shtc3_bus_install(void)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (SHTC3_SENSOR_ADDR << 1) | I2C_MASTER_WRITE, true /* enable_ack */);
-    // Read temperature first then humidity, with clock stretching enabled
-    // SHTC3 specific command: Wakeup (0x3517) then Read Temp/RH High Precision with Clock Stretching (0x7CA2)
-    // However, simpler approach is to send measurement command, wait, then read.
-    // Command: Measure T & RH, clock stretching, high precision (0x7CA2)
-    i2c_master_write_byte(cmd, 0x7C, true /* enable_ack */); // SHTC3_CMD_MEASURE_HPM
-    i2c_master_write_byte(cmd, 0xA2, true /* enable_ack */); // 
-    i2c_master_stop(cmd);
-    esp_err_t err = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_MASTER_SDA_IO,
+        .scl_io_num = I2C_MASTER_SCL_IO,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master = {.clk_speed = I2C_MASTER_FREQ_HZ},
+        .clk_flags = 0, // Explicitly initialize clk_flags
+    };
+    esp_err_t err = i2c_param_config(I2C_MASTER_NUM, &conf);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "SHTC3: Failed to send measurement command: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "I2C master config failed: %s", esp_err_to_name(err));
         return err;
     }
-    cmd = NULL;
-
-    // Wait for measurement to complete. SHTC3 datasheet specifies max 12.1 ms for HPM.
-    vTaskDelay(pdMS_TO_TICKS(15)); 
-
-    cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (SHTC3_SENSOR_ADDR << 1) | I2C_MASTER_READ, true /* enable_ack */);
-    // Read 6 bytes: Temp_MSB, Temp_LSB, Temp_CRC, RH_MSB, RH_LSB, RH_CRC
-    err = i2c_master_read(cmd, data, size, I2C_MASTER_LAST_NACK);
-     if (err != ESP_OK) { // Check error after read setup
-        ESP_LOGE(TAG, "SHTC3: Failed to setup read: %s", esp_err_to_name(err));
-        i2c_cmd_link_delete(cmd);
-        return err;
+    err = i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "I2C driver install failed: %s", esp_err_to_name(err));
     }
-    i2c_master_stop(cmd);
-    err = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
+    return err;
+}
 
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to receive data from SHTC3, err:%d (%s)", err, esp_err_to_name(err));
-        return err;
+// A slave reset or interrupted mid-transfer can keep SDA low forever. Take the pins back from the
+// controller, clock SCL until SDA is released, finish with a STOP and reinstall the driver.
+static void shtc3_bus_recover(void)
+{
+    i2c_driver_delete(I2C_MASTER_NUM);
+
+    gpio_config_t conf = {
+        .pin_bit_mask = (1ULL << I2C_MASTER_SCL_IO) | (1ULL << I2C_MASTER_SDA_IO),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&conf);
+    gpio_set_level((gpio_num_t)I2C_MASTER_SDA_IO, 1);
+    gpio_set_level((gpio_num_t)I2C_MASTER_SCL_IO, 1);
+    esp_rom_delay_us(SHTC3_CLOCK_OUT_HALF_PERIOD_US);
+
+    int pulses = 0;
+    while (pulses < SHTC3_CLOCK_OUT_PULSES && gpio_get_level((gpio_num_t)I2C_MASTER_SDA_IO) == 0) {
+        gpio_set_level((gpio_num_t)I2C_MASTER_SCL_IO, 0);
+        esp_rom_delay_us(SHTC3_CLOCK_OUT_HALF_PERIOD_US);
+        gpio_set_level((gpio_num_t)I2C_MASTER_SCL_IO, 1);
+        esp_rom_delay_us(SHTC3_CLOCK_OUT_HALF_PERIOD_US);
+        pulses++;
     }
-    return ESP_OK;
+    // STOP: SDA rises while SCL is high
+    gpio_set_level((gpio_num_t)I2C_MASTER_SCL_IO, 0);
+    esp_rom_delay_us(SHTC3_CLOCK_OUT_HALF_PERIOD_US);
+    gpio_set_level((gpio_num_t)I2C_MASTER_SDA_IO, 0);
+    esp_rom_delay_us(SHTC3_CLOCK_OUT_HALF_PERIOD_US);
+    gpio_set_level((gpio_num_t)I2C_MASTER_SCL_IO, 1);
+    esp_rom_delay_us(SHTC3_CLOCK_OUT_HALF_PERIOD_US);
+    gpio_set_level((gpio_num_t)I2C_MASTER_SDA_IO, 1);
+    esp_rom_delay_us(SHTC3_CLOCK_OUT_HALF_PERIOD_US);
+
+    bool released = gpio_get_level((gpio_num_t)I2C_MASTER_SDA_IO) != 0;
+    ESP_LOGD(TAG, "Bus recovery: %d clock pulses, SDA %s", pulses, released ? "released" : "still low");
+    shtc3_bus_install();
+}
+
+static esp_err_t shtc3_command(uint16_t command)
+{
+    uint8_t buf[2] = {(uint8_t)(command >> 8), (uint8_t)(command & 0xFF)};
+    return i2c_master_write_to_device(I2C_MASTER_NUM, SHTC3_SENSOR_ADDR, buf, sizeof(buf),
+                                      pdMS_TO_TICKS(SHTC3_I2C_TIMEOUT_MS));
+}
+
+static esp_err_t shtc3_read(uint8_t *data, size_t size)
+{
+    return i2c_master_read_from_device(I2C_MASTER_NUM, SHTC3_SENSOR_ADDR, data, size,
+                                       pdMS_TO_TICKS(SHTC3_I2C_TIMEOUT_MS));
 }
 
 // SHTC3 CRC checksum function
@@ -110,65 +156,163 @@ static uint8_t shtc3_crc8(const uint8_t *data, int len)
     return crc;
 }
 
+// Wakes the sensor, checks its product code and soft-resets it into a known state
+static esp_err_t shtc3_detect(void)
+{
+    esp_err_t err = shtc3_command(SHTC3_WAKE_UP_COMMAND);
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_rom_delay_us(SHTC3_WAKE_UP_US);
+
+    uint8_t id_data[3]; // code MSB, LSB, CRC
+    err = shtc3_command(SHTC3_READ_ID_COMMAND);
+    if (err == ESP_OK) {
+        err = shtc3_read(id_data, sizeof(id_data));
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (shtc3_crc8(id_data, 2) != id_data[2]) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    uint16_t product_code = (id_data[0] << 8) | id_data[1];
+    if ((product_code & SHTC3_PRODUCT_CODE_MASK) != SHTC3_PRODUCT_CODE_SHTC3) {
+        ESP_LOGW(TAG, "SHTC3 product code mismatch. Expected: 0x%04X, Got: 0x%04X", SHTC3_PRODUCT_CODE_SHTC3,
+                 product_code);
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "SHTC3 Product code: 0x%04X", product_code);
+
+    err = shtc3_command(SHTC3_SOFT_RESET_COMMAND);
+    esp_rom_delay_us(SHTC3_SOFT_RESET_US);
+    return err;
+}
 
-static void shtc3_sensor_report_task(void *pvParameters)
+// One measurement; the sensor is woken for it and put back to sleep afterwards
+static esp_err_t shtc3_measure(float *temperature, float *humidity)
 {
-    if (!g_sensor_config) {
-        ESP_LOGE(TAG, "Sensor not configured, cannot report.");
-        vTaskDelete(NULL);
-        return;
+    esp_err_t err = shtc3_command(SHTC3_WAKE_UP_COMMAND);
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_rom_delay_us(SHTC3_WAKE_UP_US);
+    err = shtc3_command(SHTC3_MEASURE_T_FIRST);
+    if (err != ESP_OK) {
+        return err;
     }
 
+    // Without clock stretching the sensor NACKs its address until the result is ready
+    vTaskDelay(pdMS_TO_TICKS(SHTC3_MEASURE_WAIT_MS) + 1);
+
     uint8_t data_rd[6]; // Temp MSB, LSB, CRC, RH MSB, LSB, CRC
-    esp_err_t err = shtc3_read(data_rd, sizeof(data_rd));
+    err = shtc3_read(data_rd, sizeof(data_rd));
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (shtc3_crc8(data_rd, 2) != data_rd[2] || shtc3_crc8(data_rd + 3, 2) != data_rd[5]) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    uint16_t temp_raw = (data_rd[0] << 8) | data_rd[1];
+    uint16_t humidity_raw = (data_rd[3] << 8) | data_rd[4];
+    *temperature = -45.0f + 175.0f * (temp_raw / 65535.0f);
+    *humidity = 100.0f * (humidity_raw / 65535.0f);
+    // Ensure humidity is within 0-100%
+    *humidity = (*humidity < 0.0f) ? 0.0f : *humidity;
+    *humidity = (*humidity > 100.0f) ? 100.0f : *humidity;
+
+    if (shtc3_command(SHTC3_SLEEP_COMMAND) != ESP_OK) {
+        ESP_LOGD(TAG, "Failed to put SHTC3 to sleep"); // costs power, not data
+    }
+    return ESP_OK;
+}
 
-    if (err == ESP_OK) {
-        uint16_t temp_raw = (data_rd[0] << 8) | data_rd[1];
-        uint8_t temp_crc = data_rd[2];
-        uint16_t humidity_raw = (data_rd[3] << 8) | data_rd[4];
-        uint8_t humidity_crc = data_rd[5];
-
-        if (shtc3_crc8(data_rd, 2) != temp_crc) {
-            ESP_LOGE(TAG, "Temperature CRC check failed");
-        } else {
-            float temperature = -45.0f + 175.0f * (temp_raw / 65535.0f);
-            ESP_LOGI(TAG, "Temperature: %.2f C", temperature);
-            if (g_sensor_config->temperature.cb) {
-                g_sensor_config->temperature.cb(g_sensor_config->temperature.endpoint_id, temperature, g_sensor_config->user_data);
-            }
-        }
+static void shtc3_report(float temperature, float humidity)
+{
+    if (g_sensor_config->temperature.cb) {
+        g_sensor_config->temperature.cb(g_sensor_config->temperature.endpoint_id, temperature,
+                                        g_sensor_config->user_data);
+    }
+    if (g_sensor_config->humidity.cb) {
+        g_sensor_config->humidity.cb(g_sensor_config->humidity.endpoint_id, humidity, g_sensor_config->user_data);
+    }
+}
 
-        if (shtc3_crc8(data_rd + 3, 2) != humidity_crc) {
-            ESP_LOGE(TAG, "Humidity CRC check failed");
-        } else {
-            float humidity = 100.0f * (humidity_raw / 65535.0f);
-            // Ensure humidity is within 0-100%
-            humidity = (humidity < 0.0f) ? 0.0f : humidity;
-            humidity = (humidity > 100.0f) ? 100.0f : humidity;
-            ESP_LOGI(TAG, "Humidity: %.2f %%", humidity);
-            if (g_sensor_config->humidity.cb) {
-                g_sensor_config->humidity.cb(g_sensor_config->humidity.endpoint_id, humidity, g_sensor_config->user_data);
-            }
+static void shtc3_status(shtc3_status_t status, esp_err_t err)
+{
+    if (g_sensor_config->status_cb) {
+        g_sensor_config->status_cb(status, err, g_sensor_config->user_data);
+    }
+}
+
+// Returns the delay until the next poll
+static uint32_t shtc3_handle_failure(esp_err_t err)
+{
+    shtc3_status(SHTC3_STATUS_READ_FAILED, err);
+    // A NACK means nobody answered; only a timeout or a bus error points at a stuck bus
+    if (err == ESP_ERR_TIMEOUT || err == ESP_ERR_INVALID_STATE) {
+        shtc3_bus_recover();
+    }
+
+    if (g_state != SHTC3_STATE_DEGRADED) {
+        if (++g_failures < SHTC3_FAILURES_BEFORE_DEGRADED) {
+            ESP_LOGW(TAG, "SHTC3 poll failed (%u/%d): %s", g_failures, SHTC3_FAILURES_BEFORE_DEGRADED,
+                     esp_err_to_name(err));
+            return g_sensor_config->interval_ms;
         }
-    } else {
-        ESP_LOGE(TAG, "Failed to read from SHTC3 sensor");
-        // Optionally, report a default/error value or NaN
-        if (g_sensor_config->temperature.cb) {
-             g_sensor_config->temperature.cb(g_sensor_config->temperature.endpoint_id, NAN, g_sensor_config->user_data);
+        ESP_LOGE(TAG, "SHTC3 degraded after %d failed polls (%s), probing with backoff",
+                 SHTC3_FAILURES_BEFORE_DEGRADED, esp_err_to_name(err));
+        g_state = SHTC3_STATE_DEGRADED;
+        g_backoff_ms = g_sensor_config->interval_ms;
+        shtc3_status(SHTC3_STATUS_DEGRADED, err);
+        shtc3_report(NAN, NAN); // once, so controllers see the values are gone
+        return g_backoff_ms;
+    }
+
+    ESP_LOGD(TAG, "SHTC3 still not answering: %s", esp_err_to_name(err));
+    g_backoff_ms = (g_backoff_ms > SHTC3_BACKOFF_MAX_MS / 2) ? SHTC3_BACKOFF_MAX_MS : g_backoff_ms * 2;
+    return g_backoff_ms;
+}
+
+uint32_t shtc3_sensor_poll(void)
+{
+    if (!g_sensor_config) {
+        return SHTC3_BACKOFF_MAX_MS;
+    }
+
+    esp_err_t err;
+    if (g_state != SHTC3_STATE_RUNNING) {
+        err = shtc3_detect();
+        if (err != ESP_OK) {
+            return shtc3_handle_failure(err);
         }
-        if (g_sensor_config->humidity.cb) {
-            g_sensor_config->humidity.cb(g_sensor_config->humidity.endpoint_id, NAN, g_sensor_config->user_data);
+        if (g_state == SHTC3_STATE_DEGRADED) {
+            ESP_LOGI(TAG, "SHTC3 recovered");
+            shtc3_status(SHTC3_STATUS_RECOVERED, ESP_OK);
         }
+        g_state = SHTC3_STATE_RUNNING;
+        g_failures = 0;
     }
-    vTaskDelete(NULL);
-}
 
+    float temperature;
+    float humidity;
+    err = shtc3_measure(&temperature, &humidity);
+    if (err != ESP_OK) {
+        // Once degraded the state is no longer RUNNING, so the next poll starts with the ID check
+        return shtc3_handle_failure(err);
+    }
+    g_failures = 0;
+    ESP_LOGD(TAG, "Temperature: %.2f C, humidity: %.2f %%", temperature, humidity);
+    shtc3_report(temperature, humidity);
+    return g_sensor_config->interval_ms;
+}
 
-static void shtc3_sensor_timer_cb(TimerHandle_t xTimer)
+static void shtc3_sensor_task(void *pvParameters)
 {
-    // Create a task to handle sensor reading and reporting
-    // This avoids blocking the timer callback, which should be short
-    xTaskCreate(shtc3_sensor_report_task, "shtc3_report", 2048, NULL, 5, NULL);
+    for (;;) {
+        uint32_t delay_ms = shtc3_sensor_poll();
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    }
 }
 
 esp_err_t shtc3_sensor_init(shtc3_sensor_config_t *config_param)
@@ -176,7 +320,7 @@ esp_err_t shtc3_sensor_init(shtc3_sensor_config_t *config_param)
     ESP_LOGI(TAG, "Initializing SHTC3 sensor");
     if (g_is_sensor_initialized) {
         ESP_LOGI(TAG, "SHTC3 sensor already initialized");
-        return ESP_OK;
+        return ESP_ERR_INVALID_STATE;
     }
 
     if (!config_param) {
@@ -188,125 +332,24 @@ esp_err_t shtc3_sensor_init(shtc3_sensor_config_t *config_param)
         return ESP_ERR_INVALID_ARG;
     }
 
-    g_sensor_config = config_param; // Store the provided config
-
-    // Initialize I2C master
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master = {.clk_speed = I2C_MASTER_FREQ_HZ},
-        .clk_flags = 0, // Explicitly initialize clk_flags
-    };
-    esp_err_t err = i2c_param_config(I2C_MASTER_NUM, &conf);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "I2C master config failed: %s", esp_err_to_name(err));
-        g_sensor_config = NULL;
-        return err;
-    }
-    err = i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "I2C driver install failed: %s", esp_err_to_name(err));
-        g_sensor_config = NULL;
-        return err;
-    }
-
-    // Verify sensor presence and product code (simplified from shtc3_init)
-    // Wake up sensor
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (SHTC3_SENSOR_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, SHTC3_WAKE_UP_COMMAND_MSB, true);
-    i2c_master_write_byte(cmd, SHTC3_WAKE_UP_COMMAND_LSB, true);
-    i2c_master_stop(cmd);
-    err = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
+    esp_err_t err = shtc3_bus_install();
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to wake up SHTC3 during init: %s", esp_err_to_name(err));
-        i2c_driver_delete(I2C_MASTER_NUM);
-        g_sensor_config = NULL;
-        return err;
-    }
-    vTaskDelay(pdMS_TO_TICKS(1)); // Short delay after wakeup
-
-    // Read ID
-    uint8_t id_data[SHTC3_PRODUCT_CODE_SIZE_BYTES];
-    cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (SHTC3_SENSOR_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, SHTC3_READ_ID_COMMAND_MSB, true);
-    i2c_master_write_byte(cmd, SHTC3_READ_ID_COMMAND_LSB, true);
-    i2c_master_stop(cmd);
-    err = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to send read ID command SHTC3: %s", esp_err_to_name(err));
-        i2c_driver_delete(I2C_MASTER_NUM);
-        g_sensor_config = NULL;
         return err;
     }
-    vTaskDelay(pdMS_TO_TICKS(1)); // Short delay
-
-    cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (SHTC3_SENSOR_ADDR << 1) | I2C_MASTER_READ, true);
-    i2c_master_read(cmd, id_data, SHTC3_PRODUCT_CODE_SIZE_BYTES, I2C_MASTER_LAST_NACK);
-    i2c_master_stop(cmd);
-    err = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read SHTC3 product code: %s", esp_err_to_name(err));
-        i2c_driver_delete(I2C_MASTER_NUM);
-        g_sensor_config = NULL;
-        return err;
-    }
-
-    uint16_t product_code = (id_data[0] << 8) | id_data[1];
-    if ((product_code & SHTC3_PRODUCT_CODE_MASK) != SHTC3_PRODUCT_CODE_SHTC3) {
-        ESP_LOGE(TAG, "SHTC3 product code mismatch. Expected: 0x%04X, Got: 0x%04X", SHTC3_PRODUCT_CODE_SHTC3, product_code);
-        i2c_driver_delete(I2C_MASTER_NUM);
-        g_sensor_config = NULL;
-        return ESP_FAIL;
-    }
-    ESP_LOGI(TAG, "SHTC3 Product code: 0x%04X", product_code);
-
-    // Put sensor to sleep
-    cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (SHTC3_SENSOR_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, SHTC3_SLEEP_COMMAND_MSB, true);
-    i2c_master_write_byte(cmd, SHTC3_SLEEP_COMMAND_LSB, true);
-    i2c_master_stop(cmd);
-    err = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(1000));
-    i2c_cmd_link_delete(cmd);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to put SHTC3 to sleep during init: %s", esp_err_to_name(err));
-        // Not a fatal error for init, sensor might just consume more power
-    }
-
-
-    // Create timer for periodic reading
-    g_sensor_timer_handle = xTimerCreate("shtc3_timer", pdMS_TO_TICKS(g_sensor_config->interval_ms),
-                                       true /* auto-reload */, NULL /* timer ID */, shtc3_sensor_timer_cb);
-    if (g_sensor_timer_handle == NULL) {
-        ESP_LOGE(TAG, "Failed to create SHTC3 timer");
-        i2c_driver_delete(I2C_MASTER_NUM);
-        g_sensor_config = NULL;
-        return ESP_FAIL;
-    }
+    g_sensor_config = config_param; // Store the provided config
+    g_state = SHTC3_STATE_DETECTING;
+    g_failures = 0;
 
-    if (xTimerStart(g_sensor_timer_handle, 0) != pdPASS) {
-        ESP_LOGE(TAG, "Failed to start SHTC3 timer");
-        xTimerDelete(g_sensor_timer_handle, 0);
-        g_sensor_timer_handle = NULL;
+    // Polls block for at most a few short I2C timeouts, so they get their own low-priority task
+    // instead of the timer task
+    if (xTaskCreate(shtc3_sensor_task, "shtc3", 3072, NULL, 2, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create SHTC3 task");
         i2c_driver_delete(I2C_MASTER_NUM);
         g_sensor_config = NULL;
-        return ESP_FAIL;
+        return ESP_ERR_NO_MEM;
     }
 
     g_is_sensor_initialized = true;
-    ESP_LOGI(TAG, "SHTC3 sensor initialized successfully, polling every %" PRIu32 " ms", g_sensor_config->interval_ms);
+    ESP_LOGI(TAG, "SHTC3 sensor initialized, polling every %" PRIu32 " ms", g_sensor_config->interval_ms);
     return ESP_OK;
 }
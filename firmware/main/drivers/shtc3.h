@@ -9,14 +9,29 @@
 // This file implements the SHTC3 temperature and humidity sensor driver.
 // This is implemented keeping the Matter requirements in mind.
 //
+// A missing or wedged sensor never blocks the poller for long: every I2C transaction has a
+// short timeout, a timed-out bus is recovered by clocking SCL until the sensor lets go of
+// SDA, and after a few failed polls the driver declares the sensor degraded. That is
+// reported once (NAN to the value callbacks), after which the sensor is probed for its
+// product ID with exponential backoff and picked up again automatically when it answers.
+//
 // Datasheet: https://sensirion.com/media/documents/643F9C8E/63A5A436/Datasheet_SHTC3.pdf
 
 #pragma once
 
 #include <esp_err.h>
+#include <stdint.h>
 
 using shtc3_sensor_cb_t = void (*)(uint16_t endpoint_id, float value, void *user_data);
 
+typedef enum {
+    SHTC3_STATUS_READ_FAILED,   // one failed poll; err says why
+    SHTC3_STATUS_DEGRADED,      // entered once after repeated failures; values are NAN until recovered
+    SHTC3_STATUS_RECOVERED,     // the sensor answered with its product ID again
+} shtc3_status_t;
+
+using shtc3_status_cb_t = void (*)(shtc3_status_t status, esp_err_t err, void *user_data);
+
 typedef struct {
     struct {
         // This callback functon will be called periodically to report the temperature.
@@ -32,6 +47,9 @@ typedef struct {
         uint16_t endpoint_id;
     } humidity;
 
+    // Optional. Called from the polling task on every failed poll and on state changes.
+    shtc3_status_cb_t status_cb = NULL;
+
     // user data
     void *user_data = NULL;
 
@@ -42,7 +60,8 @@ typedef struct {
 /**
  * @brief Initialize sensor driver. This function should be called only once
  *        When initializing, at least one callback should be provided, else it
- *        returns ESP_ERR_INVALID_ARG.
+ *        returns ESP_ERR_INVALID_ARG. The sensor itself is detected by the polling task,
+ *        so a missing sensor does not fail initialization.
  *
  * @param config sensor configurations. This should last for the lifetime of the driver
  *               as driver layer do not make a copy of this object.
@@ -53,3 +72,11 @@ typedef struct {
  *                     appropriate error code otherwise
  */
 esp_err_t shtc3_sensor_init(shtc3_sensor_config_t *config);
+
+/**
+ * @brief Run one poll of the sensor state machine: detect, measure or recover.
+ *        Normally called by the driver's polling task; exposed for host tests.
+ *
+ * @return milliseconds until the next poll.
+ */
+uint32_t shtc3_sensor_poll(void);
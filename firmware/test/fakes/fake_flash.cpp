@@ -0,0 +1,209 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <esp_partition.h>
+
+#include "host_fakes.h"
+#include "host_sched.h"
+
+#define FLASH_SECTOR_SIZE   4096
+
+// Lives in shared memory so a forked boot that loses power leaves its writes behind
+typedef struct {
+    esp_partition_t partition;
+    host_flash_stats_t stats;
+    uint8_t data[];
+} host_flash_t;
+
+typedef struct {
+    int64_t cut_after_bytes;    // < 0: never
+    int64_t cut_in_erase;       // < 0: never
+} host_power_t;
+
+static std::vector<host_flash_t *> s_flashes;
+static host_power_t s_power = {-1, -1};
+
+static host_flash_t *flash_of(const esp_partition_t *partition)
+{
+    for (host_flash_t *flash : s_flashes) {
+        if (&flash->partition == partition) {
+            return flash;
+        }
+    }
+    return NULL;
+}
+
+static host_flash_t *flash_by_label(const char *label)
+{
+    for (host_flash_t *flash : s_flashes) {
+        if (strcmp(flash->partition.label, label) == 0) {
+            return flash;
+        }
+    }
+    return NULL;
+}
+
+const esp_partition_t *host_flash_add_partition(const char *label, uint32_t size)
+{
+    host_flash_t *flash = flash_by_label(label);
+    if (flash) {
+        return &flash->partition;
+    }
+    void *mem = mmap(NULL, sizeof(host_flash_t) + size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+    flash = (host_flash_t *)mem;
+    memset(&flash->partition, 0, sizeof(flash->partition));
+    flash->partition.type = ESP_PARTITION_TYPE_DATA;
+    flash->partition.subtype = (esp_partition_subtype_t)0x40;
+    flash->partition.address = 0x3E0000 + 0x10000 * (uint32_t)s_flashes.size();
+    flash->partition.size = size;
+    flash->partition.erase_size = FLASH_SECTOR_SIZE;
+    strncpy(flash->partition.label, label, sizeof(flash->partition.label) - 1);
+    memset(flash->data, 0xFF, size);
+    s_flashes.push_back(flash);
+    return &flash->partition;
+}
+
+uint8_t *host_flash_data(const char *label)
+{
+    host_flash_t *flash = flash_by_label(label);
+    return flash ? flash->data : NULL;
+}
+
+void host_flash_format(const char *label)
+{
+    host_flash_t *flash = flash_by_label(label);
+    if (flash) {
+        memset(flash->data, 0xFF, flash->partition.size);
+        memset(&flash->stats, 0, sizeof(flash->stats));
+    }
+}
+
+host_flash_stats_t host_flash_stats(const char *label)
+{
+    host_flash_t *flash = flash_by_label(label);
+    return flash ? flash->stats : host_flash_stats_t{};
+}
+
+void host_flash_cut_power_after(int64_t bytes)
+{
+    s_power.cut_after_bytes = bytes;
+}
+
+void host_flash_cut_power_in_erase(int64_t nth)
+{
+    s_power.cut_in_erase = nth;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    host_flash_t *flash = label ? flash_by_label(label) : NULL;
+    if (!flash || (type != ESP_PARTITION_TYPE_ANY && type != flash->partition.type)) {
+        return NULL;
+    }
+    return &flash->partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    host_flash_t *flash = flash_of(partition);
+    if (!flash || !dst || src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, flash->data + src_offset, size);
+    flash->stats.bytes_read += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    host_flash_t *flash = flash_of(partition);
+    if (!flash || !src || dst_offset > partition->size || size > partition->size - dst_offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t programmed = size;
+    bool cut = false;
+    if (s_power.cut_after_bytes >= 0 && (int64_t)size >= s_power.cut_after_bytes) {
+        programmed = (size_t)s_power.cut_after_bytes;
+        cut = true;
+    }
+    // NOR flash only clears bits; programming over written data ANDs it in
+    const uint8_t *bytes = (const uint8_t *)src;
+    for (size_t i = 0; i < programmed; i++) {
+        flash->data[dst_offset + i] &= bytes[i];
+    }
+    flash->stats.writes++;
+    flash->stats.bytes_written += programmed;
+    if (cut) {
+        _exit(HOST_EXIT_POWER_CUT);
+    }
+    if (s_power.cut_after_bytes >= 0) {
+        s_power.cut_after_bytes -= size;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    host_flash_t *flash = flash_of(partition);
+    if (!flash || offset % FLASH_SECTOR_SIZE || size % FLASH_SECTOR_SIZE || offset > partition->size ||
+        size > partition->size - offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t sector = offset; sector < offset + size; sector += FLASH_SECTOR_SIZE) {
+        if (s_power.cut_in_erase == 0) {
+            // An interrupted erase leaves the sector in an undefined state; model half of it done
+            memset(flash->data + sector, 0xFF, FLASH_SECTOR_SIZE / 2);
+            _exit(HOST_EXIT_POWER_CUT);
+        }
+        if (s_power.cut_in_erase > 0) {
+            s_power.cut_in_erase--;
+        }
+        memset(flash->data + sector, 0xFF, FLASH_SECTOR_SIZE);
+        flash->stats.erases++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    host_flash_t *flash = flash_of(partition);
+    if (!flash || !out_ptr || !out_handle || offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ptr = flash->data + offset;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+}
+
+static void flash_reset(void)
+{
+    s_power = {-1, -1};
+}
+
+static struct flash_reset_hook {
+    flash_reset_hook()
+    {
+        host_on_reset(flash_reset);
+    }
+} s_reset_hook;
@@ -0,0 +1,128 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <driver/i2c.h>
+#include <esp_rom_sys.h>
+
+#include "host_fakes.h"
+#include "host_sched.h"
+
+#define US_PER_TICK (1000000 / configTICK_RATE_HZ)
+
+static host_i2c_device_t s_device;
+static host_i2c_stats_t s_stats;
+static bool s_installed;
+static uint32_t s_clk_speed;
+
+// A 9-bit frame per byte, address included
+static int64_t wire_time_us(size_t bytes)
+{
+    uint32_t hz = s_clk_speed ? s_clk_speed : 100000;
+    return ((int64_t)(bytes + 1) * 9 * 1000000 + hz - 1) / hz;
+}
+
+static esp_err_t transfer(uint8_t address, bool read, uint8_t *data, size_t len, TickType_t ticks_to_wait)
+{
+    if (!s_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_stats.transactions++;
+    esp_err_t err = s_device ? s_device(address, read, data, len) : ESP_FAIL;
+    int64_t start_us = host_now_us();
+    switch (err) {
+    case ESP_OK:
+        host_advance_us(wire_time_us(len));
+        break;
+    case ESP_ERR_TIMEOUT:
+        // The driver gives up once the whole wait has passed
+        s_stats.timeouts++;
+        host_advance_us((int64_t)ticks_to_wait * US_PER_TICK);
+        break;
+    default:
+        // NACK on the address byte
+        s_stats.nacks++;
+        host_advance_us(wire_time_us(0));
+        break;
+    }
+    int64_t took_us = host_now_us() - start_us;
+    s_stats.longest_us = took_us > s_stats.longest_us ? took_us : s_stats.longest_us;
+    return err;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config)
+{
+    if (port != I2C_NUM_0 || !config || config->mode != I2C_MODE_MASTER || !GPIO_IS_VALID_GPIO(config->sda_io_num) ||
+        !GPIO_IS_VALID_GPIO(config->scl_io_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_clk_speed = config->master.clk_speed;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags)
+{
+    if (port != I2C_NUM_0 || s_installed) {
+        return ESP_FAIL;
+    }
+    s_installed = true;
+    s_stats.installs++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t port)
+{
+    if (port != I2C_NUM_0 || !s_installed) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_installed = false;
+    s_stats.deletes++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t device_address, const uint8_t *write_buffer,
+                                     size_t write_size, TickType_t ticks_to_wait)
+{
+    return transfer(device_address, false, (uint8_t *)write_buffer, write_size, ticks_to_wait);
+}
+
+esp_err_t i2c_master_read_from_device(i2c_port_t port, uint8_t device_address, uint8_t *read_buffer,
+                                      size_t read_size, TickType_t ticks_to_wait)
+{
+    return transfer(device_address, true, read_buffer, read_size, ticks_to_wait);
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    host_advance_us(us);
+}
+
+void host_i2c_set_device(host_i2c_device_t device)
+{
+    s_device = device;
+}
+
+host_i2c_stats_t host_i2c_stats(void)
+{
+    return s_stats;
+}
+
+static void i2c_reset(void)
+{
+    s_device = nullptr;
+    s_stats = {};
+    s_installed = false;
+    s_clk_speed = 0;
+}
+
+static struct i2c_reset_hook {
+    i2c_reset_hook()
+    {
+        host_on_reset(i2c_reset);
+    }
+} s_reset_hook;
@@ -0,0 +1,788 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <freertos/timers.h>
+
+#include "host_fakes.h"
+#include "host_sched.h"
+
+#define US_PER_TICK (1000000 / configTICK_RATE_HZ)
+
+// ---------------------------------------------------------------------------------------------
+// Clock and event queue
+
+typedef struct {
+    uint64_t id;
+    std::function<void()> fn;
+} host_event_t;
+
+static int64_t s_now_us;
+static uint64_t s_next_event_id = 1;
+static std::multimap<int64_t, host_event_t> s_events;
+static bool s_in_isr;
+static bool s_in_esp_timer;   // an esp_timer callback is running
+
+int64_t host_now_us(void)
+{
+    return s_now_us;
+}
+
+uint64_t host_schedule(int64_t at_us, std::function<void()> fn)
+{
+    uint64_t id = s_next_event_id++;
+    s_events.emplace(at_us < s_now_us ? s_now_us : at_us, host_event_t{id, std::move(fn)});
+    return id;
+}
+
+void host_cancel(uint64_t event_id)
+{
+    for (auto it = s_events.begin(); it != s_events.end(); ++it) {
+        if (it->second.id == event_id) {
+            s_events.erase(it);
+            return;
+        }
+    }
+}
+
+bool host_pending(uint64_t event_id)
+{
+    for (const auto &entry : s_events) {
+        if (entry.second.id == event_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function-local so fakes in other translation units can register from static constructors
+static std::vector<void (*)(void)> &reset_hooks(void)
+{
+    static std::vector<void (*)(void)> hooks;
+    return hooks;
+}
+
+void host_on_reset(void (*fn)(void))
+{
+    reset_hooks().push_back(fn);
+}
+
+void host_set_isr_context(bool in_isr)
+{
+    s_in_isr = in_isr;
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+    return s_in_isr ? pdTRUE : pdFALSE;
+}
+
+static void run_pended(void);
+
+void host_advance_us(int64_t us)
+{
+    int64_t target = s_now_us + us;
+    run_pended();
+    while (!s_events.empty() && s_events.begin()->first <= target) {
+        auto it = s_events.begin();
+        s_now_us = it->first;
+        std::function<void()> fn = std::move(it->second.fn);
+        s_events.erase(it);
+        fn();
+        run_pended();
+    }
+    s_now_us = target;
+}
+
+// ---------------------------------------------------------------------------------------------
+// esp_timer
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    uint64_t event_id;
+    uint64_t period_us;
+};
+
+static std::vector<esp_timer *> s_esp_timers;
+
+static void esp_timer_arm(esp_timer *timer, uint64_t timeout_us)
+{
+    timer->event_id = host_schedule(s_now_us + (int64_t)timeout_us, [timer]() {
+        timer->event_id = 0;
+        if (timer->period_us) {
+            esp_timer_arm(timer, timer->period_us);
+        }
+        s_in_esp_timer = true;
+        timer->callback(timer->arg);
+        s_in_esp_timer = false;
+    });
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (!args || !args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_timer *timer = new esp_timer{args->callback, args->arg, 0, 0};
+    s_esp_timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->event_id) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = 0;
+    esp_timer_arm(timer, timeout_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    if (!timer || period_us == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->event_id) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = period_us;
+    esp_timer_arm(timer, period_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (!timer || !timer->event_id) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    host_cancel(timer->event_id);
+    if (timer->period_us) {
+        timer->period_us = timeout_us;
+    }
+    esp_timer_arm(timer, timeout_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer || !timer->event_id) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    host_cancel(timer->event_id);
+    timer->event_id = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->event_id) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (auto it = s_esp_timers.begin(); it != s_esp_timers.end(); ++it) {
+        if (*it == timer) {
+            s_esp_timers.erase(it);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer && timer->event_id != 0;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+// ---------------------------------------------------------------------------------------------
+// FreeRTOS software timers and pended calls
+
+struct host_sw_timer {
+    TimerCallbackFunction_t cb;
+    void *id;
+    TickType_t period;
+    bool auto_reload;
+    uint64_t event_id;
+};
+
+typedef struct {
+    PendedFunction_t fn;
+    void *arg1;
+    uint32_t arg2;
+} host_pended_t;
+
+static std::vector<host_sw_timer *> s_sw_timers;
+static std::deque<host_pended_t> s_pended;
+static int s_fail_pends;
+static uint32_t s_pend_failures;
+
+static void sw_timer_arm(host_sw_timer *timer)
+{
+    timer->event_id = host_schedule(s_now_us + (int64_t)timer->period * US_PER_TICK, [timer]() {
+        timer->event_id = 0;
+        if (timer->auto_reload) {
+            sw_timer_arm(timer);
+        }
+        timer->cb((TimerHandle_t)timer);
+    });
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload, void *id,
+                           TimerCallbackFunction_t cb)
+{
+    if (period == 0 || !cb) {
+        return NULL;
+    }
+    host_sw_timer *timer = new host_sw_timer{cb, id, period, auto_reload != 0, 0};
+    s_sw_timers.push_back(timer);
+    return (TimerHandle_t)timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t handle, TickType_t wait)
+{
+    host_sw_timer *timer = (host_sw_timer *)handle;
+    if (timer->event_id) {
+        host_cancel(timer->event_id);
+    }
+    sw_timer_arm(timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t handle, TickType_t wait)
+{
+    return xTimerStart(handle, wait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t handle, TickType_t wait)
+{
+    host_sw_timer *timer = (host_sw_timer *)handle;
+    if (timer->event_id) {
+        host_cancel(timer->event_id);
+        timer->event_id = 0;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t handle, TickType_t wait)
+{
+    xTimerStop(handle, wait);
+    for (auto it = s_sw_timers.begin(); it != s_sw_timers.end(); ++it) {
+        if (*it == (host_sw_timer *)handle) {
+            s_sw_timers.erase(it);
+            break;
+        }
+    }
+    delete (host_sw_timer *)handle;
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t handle, TickType_t period, TickType_t wait)
+{
+    host_sw_timer *timer = (host_sw_timer *)handle;
+    timer->period = period;
+    return xTimerStart(handle, wait);
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t handle)
+{
+    return ((host_sw_timer *)handle)->event_id ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t handle)
+{
+    return ((host_sw_timer *)handle)->id;
+}
+
+BaseType_t xTimerPendFunctionCall(PendedFunction_t fn, void *arg1, uint32_t arg2, TickType_t wait)
+{
+    // On the device a full timer queue would stall every other esp_timer behind this one
+    if (s_in_esp_timer && wait != 0) {
+        fprintf(stderr, "xTimerPendFunctionCall() from an esp_timer callback may block the esp_timer task\n");
+        abort();
+    }
+    if (s_fail_pends > 0) {
+        s_fail_pends--;
+        s_pend_failures++;
+        return pdFAIL;
+    }
+    s_pended.push_back({fn, arg1, arg2});
+    return pdPASS;
+}
+
+BaseType_t xTimerPendFunctionCallFromISR(PendedFunction_t fn, void *arg1, uint32_t arg2, BaseType_t *woken)
+{
+    return xTimerPendFunctionCall(fn, arg1, arg2, 0);
+}
+
+static void run_pended(void)
+{
+    while (!s_pended.empty()) {
+        host_pended_t call = s_pended.front();
+        s_pended.pop_front();
+        call.fn(call.arg1, call.arg2);
+    }
+}
+
+void host_run_pended(void)
+{
+    run_pended();
+}
+
+void host_fail_pends(int count)
+{
+    s_fail_pends = count;
+}
+
+uint32_t host_pend_failures(void)
+{
+    return s_pend_failures;
+}
+
+size_t host_active_timers(void)
+{
+    size_t count = 0;
+    for (const esp_timer *timer : s_esp_timers) {
+        count += timer->event_id != 0;
+    }
+    for (const host_sw_timer *timer : s_sw_timers) {
+        count += timer->event_id != 0;
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Semaphores, queues and tasks
+
+typedef struct {
+    size_t item_size;
+    size_t length;
+    std::deque<std::vector<uint8_t>> items;
+} host_queue_t;
+
+static int s_mutex_token;
+static int s_task_token;
+static uint32_t s_task_notifies;
+static uint32_t s_notify_value;     // notifications given and not yet taken
+
+// With threaded tasks, queues are the one thing a task shares with the test thread
+static bool s_threaded_tasks;
+static std::vector<std::thread> s_task_threads;
+static std::mutex s_queue_lock;
+static std::condition_variable s_queue_changed;
+
+// Waits until ready() holds, for as long as a task thread could still make it hold
+template <typename Ready>
+static bool queue_wait(std::unique_lock<std::mutex> &lock, TickType_t wait, Ready ready)
+{
+    if (ready() || !s_threaded_tasks || wait == 0) {
+        return ready();
+    }
+    if (wait == portMAX_DELAY) {
+        s_queue_changed.wait(lock, ready);
+        return true;
+    }
+    return s_queue_changed.wait_for(lock, std::chrono::microseconds((int64_t)wait * US_PER_TICK), ready);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return &s_mutex_token;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return new host_queue_t{item_size, length, {}};
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void *item, TickType_t wait)
+{
+    host_queue_t *queue = (host_queue_t *)handle;
+    std::unique_lock<std::mutex> lock(s_queue_lock);
+    if (!queue_wait(lock, wait, [queue]() { return queue->items.size() < queue->length; })) {
+        return pdFAIL;
+    }
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    s_queue_changed.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t handle, const void *item, BaseType_t *woken)
+{
+    return xQueueSend(handle, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void *item, TickType_t wait)
+{
+    host_queue_t *queue = (host_queue_t *)handle;
+    std::unique_lock<std::mutex> lock(s_queue_lock);
+    if (!queue_wait(lock, wait, [queue]() { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    s_queue_changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle)
+{
+    std::lock_guard<std::mutex> lock(s_queue_lock);
+    return ((host_queue_t *)handle)->items.size();
+}
+
+void vQueueDelete(QueueHandle_t handle)
+{
+    delete (host_queue_t *)handle;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                       TaskHandle_t *out_handle)
+{
+    if (out_handle) {
+        *out_handle = &s_task_token;
+    }
+    if (s_threaded_tasks) {
+        s_task_threads.emplace_back(fn, arg);
+    }
+    return pdPASS;
+}
+
+void host_set_threaded_tasks(bool threaded)
+{
+    s_threaded_tasks = threaded;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return 1;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    host_advance_us((int64_t)ticks * US_PER_TICK);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(s_now_us / US_PER_TICK);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return &s_task_token;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    s_task_notifies++;
+    s_notify_value++;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    s_task_notifies++;
+    s_notify_value++;
+}
+
+uint32_t host_task_notifies(void)
+{
+    return s_task_notifies;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    // The wait passes on the simulated clock, running whatever comes due until a notification
+    // arrives. With nothing left to run, an endless wait gives up instead of hanging the test.
+    int64_t deadline = wait == portMAX_DELAY ? INT64_MAX : s_now_us + (int64_t)wait * US_PER_TICK;
+    run_pended();
+    while (s_notify_value == 0 && !s_events.empty() && s_events.begin()->first <= deadline) {
+        host_advance_us(s_events.begin()->first - s_now_us);
+    }
+    if (s_notify_value == 0 && deadline != INT64_MAX) {
+        host_advance_us(deadline - s_now_us);
+    }
+    uint32_t value = s_notify_value;
+    s_notify_value = clear ? 0 : (value ? value - 1 : 0);
+    return value;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------------
+// GPIO
+
+typedef struct {
+    uint32_t level;
+    gpio_int_type_t intr_type;
+    gpio_isr_t isr;
+    void *isr_arg;
+    bool intr_enabled;
+} host_pin_t;
+
+static host_pin_t s_pins[GPIO_NUM_MAX];
+static host_gpio_bus_t s_bus[GPIO_NUM_MAX];
+static std::vector<host_edge_t> s_edges;
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    if (!config || config->pin_bit_mask == 0 || (config->pin_bit_mask >> GPIO_NUM_MAX) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (config->pin_bit_mask & (1ULL << i)) {
+            s_pins[i].intr_type = config->intr_type;
+            s_pins[i].intr_enabled = config->intr_type != GPIO_INTR_DISABLE;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    return GPIO_IS_VALID_GPIO(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    level = level ? 1 : 0;
+    if (s_pins[gpio_num].level != level) {
+        s_pins[gpio_num].level = level;
+        s_edges.push_back({s_now_us, gpio_num, level});
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num)) {
+        return 0;
+    }
+    // Wired-AND: whoever else is on the line can only pull it low
+    uint32_t level = s_pins[gpio_num].level;
+    return (int)(s_bus[gpio_num] ? level & s_bus[gpio_num]() : level);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    return GPIO_IS_VALID_GPIO(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    return GPIO_IS_VALID_GPIO(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t type)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].intr_type = type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    return ESP_OK;
+}
+
+void gpio_uninstall_isr_service(void)
+{
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t handler, void *arg)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].isr = handler;
+    s_pins[gpio_num].isr_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    if (!GPIO_IS_VALID_GPIO(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio_num].isr = NULL;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    s_pins[gpio_num].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    s_pins[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+uint32_t host_gpio_level(int gpio_num)
+{
+    return s_pins[gpio_num].level;
+}
+
+const std::vector<host_edge_t> &host_gpio_edges(void)
+{
+    return s_edges;
+}
+
+void host_gpio_clear_edges(void)
+{
+    s_edges.clear();
+}
+
+void host_gpio_set_bus(int gpio_num, host_gpio_bus_t bus)
+{
+    s_bus[gpio_num] = bus;
+}
+
+void host_gpio_input(int gpio_num, uint32_t level)
+{
+    host_pin_t &pin = s_pins[gpio_num];
+    level = level ? 1 : 0;
+    if (pin.level == level) {
+        return;
+    }
+    pin.level = level;
+    s_edges.push_back({s_now_us, gpio_num, level});
+    bool fire = pin.intr_type == GPIO_INTR_ANYEDGE || (pin.intr_type == GPIO_INTR_POSEDGE && level) ||
+                (pin.intr_type == GPIO_INTR_NEGEDGE && !level);
+    if (fire && pin.intr_enabled && pin.isr) {
+        s_in_isr = true;
+        pin.isr(pin.isr_arg);
+        s_in_isr = false;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_CRC:
+        return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:
+        return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_INVALID_LENGTH:
+        return "ESP_ERR_NVS_INVALID_LENGTH";
+    default:
+        return "ERROR";
+    }
+}
+
+void host_reset(void)
+{
+    s_events.clear();
+    s_now_us = 0;
+    for (esp_timer *timer : s_esp_timers) {
+        timer->event_id = 0;
+    }
+    for (host_sw_timer *timer : s_sw_timers) {
+        timer->event_id = 0;
+    }
+    s_pended.clear();
+    s_fail_pends = 0;
+    s_pend_failures = 0;
+    memset(s_pins, 0, sizeof(s_pins));
+    for (host_gpio_bus_t &bus : s_bus) {
+        bus = nullptr;
+    }
+    s_edges.clear();
+    s_in_isr = false;
+    s_in_esp_timer = false;
+    s_task_notifies = 0;
+    s_notify_value = 0;
+    // Threaded tasks have to have returned by now
+    for (std::thread &thread : s_task_threads) {
+        thread.join();
+    }
+    s_task_threads.clear();
+    s_threaded_tasks = false;
+    for (auto hook : reset_hooks()) {
+        hook();
+    }
+}
@@ -0,0 +1,245 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <nvs.h>
+
+#include "host_fakes.h"
+#include "host_sched.h"
+
+#define NVS_MAX_ENTRIES     32
+#define NVS_MAX_HANDLES     8
+#define NVS_NAME_LEN        16      // 15 characters and the terminator, as on the device
+#define NVS_VALUE_MAX       64
+
+typedef enum {
+    NVS_TYPE_FREE = 0,
+    NVS_TYPE_NAMESPACE,     // a namespace exists once it was opened read-write
+    NVS_TYPE_U16,
+    NVS_TYPE_BLOB,
+} nvs_type_t;
+
+typedef struct {
+    nvs_type_t type;
+    char namespace_name[NVS_NAME_LEN];
+    char key[NVS_NAME_LEN];
+    size_t length;
+    uint8_t value[NVS_VALUE_MAX];
+} nvs_entry_t;
+
+// Lives in shared memory so a forked boot's writes are there for the next one
+typedef struct {
+    nvs_entry_t entries[NVS_MAX_ENTRIES];
+    uint32_t writes;
+} nvs_store_t;
+
+typedef struct {
+    bool open;
+    bool writable;
+    char namespace_name[NVS_NAME_LEN];
+} nvs_open_handle_t;
+
+static nvs_store_t *s_store;
+static nvs_open_handle_t s_handles[NVS_MAX_HANDLES];
+
+static nvs_store_t *store(void)
+{
+    if (!s_store) {
+        void *mem = mmap(NULL, sizeof(nvs_store_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        s_store = (nvs_store_t *)mem;
+        memset(s_store, 0, sizeof(*s_store));
+    }
+    return s_store;
+}
+
+static nvs_entry_t *find(const char *namespace_name, const char *key, nvs_type_t type)
+{
+    for (nvs_entry_t &entry : store()->entries) {
+        if (entry.type != NVS_TYPE_FREE && strcmp(entry.namespace_name, namespace_name) == 0 &&
+            strcmp(entry.key, key) == 0 && (type == NVS_TYPE_FREE || entry.type == type)) {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+static nvs_entry_t *allocate(const char *namespace_name, const char *key, nvs_type_t type)
+{
+    for (nvs_entry_t &entry : store()->entries) {
+        if (entry.type == NVS_TYPE_FREE) {
+            entry.type = type;
+            strncpy(entry.namespace_name, namespace_name, NVS_NAME_LEN - 1);
+            strncpy(entry.key, key, NVS_NAME_LEN - 1);
+            entry.length = 0;
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+static nvs_open_handle_t *handle_of(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > NVS_MAX_HANDLES || !s_handles[handle - 1].open) {
+        return NULL;
+    }
+    return &s_handles[handle - 1];
+}
+
+static esp_err_t set_value(nvs_handle_t handle, const char *key, nvs_type_t type, const void *value, size_t length)
+{
+    nvs_open_handle_t *open = handle_of(handle);
+    if (!open) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!open->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (length > NVS_VALUE_MAX) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+    nvs_entry_t *entry = find(open->namespace_name, key, NVS_TYPE_FREE);
+    if (entry && entry->type != type) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+    if (!entry) {
+        entry = allocate(open->namespace_name, key, type);
+    }
+    if (!entry) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    store()->writes++;
+    return ESP_OK;
+}
+
+void host_nvs_erase_all(void)
+{
+    memset(store(), 0, sizeof(nvs_store_t));
+}
+
+uint32_t host_nvs_writes(void)
+{
+    return store()->writes;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!namespace_name || !out_handle || strlen(namespace_name) >= NVS_NAME_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!find(namespace_name, "", NVS_TYPE_NAMESPACE)) {
+        if (open_mode == NVS_READONLY) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        if (!allocate(namespace_name, "", NVS_TYPE_NAMESPACE)) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+    for (size_t i = 0; i < NVS_MAX_HANDLES; i++) {
+        if (!s_handles[i].open) {
+            s_handles[i].open = true;
+            s_handles[i].writable = (open_mode == NVS_READWRITE);
+            strncpy(s_handles[i].namespace_name, namespace_name, NVS_NAME_LEN - 1);
+            *out_handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    nvs_open_handle_t *open = handle_of(handle);
+    if (open) {
+        memset(open, 0, sizeof(*open));
+    }
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return handle_of(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    nvs_open_handle_t *open = handle_of(handle);
+    if (!open) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!open->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    nvs_entry_t *entry = find(open->namespace_name, key, NVS_TYPE_FREE);
+    if (!entry || entry->type == NVS_TYPE_NAMESPACE) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    memset(entry, 0, sizeof(*entry));
+    store()->writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *out_value)
+{
+    nvs_open_handle_t *open = handle_of(handle);
+    if (!open) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    nvs_entry_t *entry = find(open->namespace_name, key, NVS_TYPE_U16);
+    if (!entry) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    memcpy(out_value, entry->value, sizeof(*out_value));
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value)
+{
+    return set_value(handle, key, NVS_TYPE_U16, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    nvs_open_handle_t *open = handle_of(handle);
+    if (!open) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    nvs_entry_t *entry = find(open->namespace_name, key, NVS_TYPE_BLOB);
+    if (!entry) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    // As on the device: a NULL buffer asks for the length, a short one is an error
+    if (out_value && *length < entry->length) {
+        *length = entry->length;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    if (out_value) {
+        memcpy(out_value, entry->value, entry->length);
+    }
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return set_value(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+static void nvs_reset(void)
+{
+    memset(s_handles, 0, sizeof(s_handles));
+}
+
+static struct nvs_reset_hook {
+    nvs_reset_hook()
+    {
+        host_on_reset(nvs_reset);
+    }
+} s_reset_hook;
@@ -0,0 +1,217 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include <driver/rmt_tx.h>
+
+#include "host_fakes.h"
+#include "host_sched.h"
+
+struct rmt_channel_t {
+    rmt_tx_channel_config_t config;
+    rmt_tx_event_callbacks_t callbacks;
+    void *user_data;
+    bool enabled;
+    // Transfers accepted by rmt_transmit(); the front one is on the wire
+    std::deque<std::vector<uint32_t>> queue;
+    std::vector<uint64_t> events;   // pending edge and done events of the transfer on the wire
+};
+
+struct rmt_encoder_t {
+    int unused;
+};
+
+static std::vector<rmt_channel_t *> s_channels;
+static std::vector<host_rmt_transmit_t> s_transmits;
+static bool s_fail_new_channel;
+
+static void rmt_start_next(rmt_channel_t *chan);
+
+static void rmt_drive(rmt_channel_t *chan, uint32_t level)
+{
+    gpio_set_level(chan->config.gpio_num, level ^ chan->config.flags.invert_out);
+}
+
+static void rmt_finish(rmt_channel_t *chan)
+{
+    chan->events.clear();
+    size_t num_symbols = chan->queue.front().size();
+    chan->queue.pop_front();
+    rmt_drive(chan, 0);
+    if (chan->callbacks.on_trans_done) {
+        rmt_tx_done_event_data_t edata = {num_symbols};
+        host_set_isr_context(true);
+        chan->callbacks.on_trans_done(chan, &edata, chan->user_data);
+        host_set_isr_context(false);
+    }
+    rmt_start_next(chan);
+}
+
+// Schedules the edges of the transfer at the front of the queue; a zero duration ends it.
+static void rmt_start_next(rmt_channel_t *chan)
+{
+    if (chan->queue.empty() || !chan->enabled) {
+        return;
+    }
+    uint32_t ticks_per_us = chan->config.resolution_hz / 1000000;
+    int64_t at = host_now_us();
+    for (uint32_t word : chan->queue.front()) {
+        for (int half = 0; half < 2; half++) {
+            uint32_t bits = half ? word >> 16 : word & 0xFFFF;
+            uint32_t duration = bits & 0x7FFF;
+            if (duration == 0) {
+                goto done;
+            }
+            uint32_t level = bits >> 15;
+            chan->events.push_back(host_schedule(at, [chan, level]() { rmt_drive(chan, level); }));
+            at += (duration + ticks_per_us - 1) / ticks_per_us;
+        }
+    }
+done:
+    chan->events.push_back(host_schedule(at, [chan]() { rmt_finish(chan); }));
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan)
+{
+    if (!config || !ret_chan || config->trans_queue_depth == 0 || config->resolution_hz < 1000000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_fail_new_channel) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    rmt_channel_t *chan = new rmt_channel_t();
+    chan->config = *config;
+    s_channels.push_back(chan);
+    *ret_chan = chan;
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_chan, const rmt_tx_event_callbacks_t *cbs,
+                                          void *user_data)
+{
+    if (!tx_chan || !cbs || tx_chan->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    tx_chan->callbacks = *cbs;
+    tx_chan->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    *ret_encoder = new rmt_encoder_t();
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    delete encoder;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel)
+{
+    for (auto it = s_channels.begin(); it != s_channels.end(); ++it) {
+        if (*it == channel) {
+            s_channels.erase(it);
+            break;
+        }
+    }
+    delete channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel)
+{
+    if (channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel)
+{
+    if (!channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Aborts the transfer on the wire and drops the queued ones without a done event
+    for (uint64_t id : channel->events) {
+        host_cancel(id);
+    }
+    channel->events.clear();
+    channel->queue.clear();
+    channel->enabled = false;
+    rmt_drive(channel, 0);
+    return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_chan, rmt_encoder_handle_t encoder, const void *payload,
+                       size_t payload_bytes, const rmt_transmit_config_t *config)
+{
+    if (!tx_chan || !encoder || !payload || payload_bytes == 0 || payload_bytes % sizeof(uint32_t) || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!tx_chan->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (tx_chan->queue.size() >= tx_chan->config.trans_queue_depth) {
+        if (config->flags.queue_nonblocking) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        // On the device the caller would sleep until the transfer on the wire is done
+        fprintf(stderr, "rmt_transmit() would block the calling task on a full queue\n");
+        abort();
+    }
+    const uint32_t *words = (const uint32_t *)payload;
+    std::vector<uint32_t> symbols(words, words + payload_bytes / sizeof(uint32_t));
+    s_transmits.push_back({host_now_us(), symbols});
+    tx_chan->queue.push_back(std::move(symbols));
+    if (tx_chan->queue.size() == 1) {
+        rmt_start_next(tx_chan);
+    }
+    return ESP_OK;
+}
+
+const std::vector<host_rmt_transmit_t> &host_rmt_transmits(void)
+{
+    return s_transmits;
+}
+
+size_t host_rmt_channels(void)
+{
+    return s_channels.size();
+}
+
+void host_rmt_fail_new_channel(bool fail)
+{
+    s_fail_new_channel = fail;
+}
+
+static void rmt_reset(void)
+{
+    for (rmt_channel_t *chan : s_channels) {
+        chan->events.clear();
+        chan->queue.clear();
+    }
+    s_transmits.clear();
+    s_fail_new_channel = false;
+}
+
+static struct rmt_reset_hook {
+    rmt_reset_hook()
+    {
+        host_on_reset(rmt_reset);
+    }
+} s_reset_hook;
@@ -0,0 +1,168 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include <esp_heap_caps.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+
+#include "host_fakes.h"
+#include "host_sched.h"
+
+static esp_reset_reason_t s_reset_reason = ESP_RST_POWERON;
+static std::vector<shutdown_handler_t> s_shutdown_handlers;
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return s_reset_reason;
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler)
+{
+    s_shutdown_handlers.push_back(handler);
+    return ESP_OK;
+}
+
+void esp_restart(void)
+{
+    host_run_shutdown_handlers();
+    exit(HOST_EXIT_RESTART);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 200 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 180 * 1024;
+}
+
+#define HOST_HEAP_SIZE  (200 * 1024)
+
+static size_t s_heap_free = HOST_HEAP_SIZE;
+static size_t s_heap_min_free = HOST_HEAP_SIZE;
+static size_t s_heap_largest = HOST_HEAP_SIZE;
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return s_heap_free;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return s_heap_min_free;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return s_heap_largest;
+}
+
+void host_heap_set(uint32_t free_bytes, uint32_t largest_block)
+{
+    s_heap_free = free_bytes;
+    s_heap_min_free = free_bytes < s_heap_min_free ? free_bytes : s_heap_min_free;
+    s_heap_largest = largest_block;
+}
+
+static void heap_reset(void)
+{
+    s_heap_free = s_heap_min_free = s_heap_largest = HOST_HEAP_SIZE;
+}
+
+static struct heap_reset_hook {
+    heap_reset_hook()
+    {
+        host_on_reset(heap_reset);
+    }
+} s_reset_hook;
+
+// Wall clock: the simulated clock plus an offset. Until a test sets one it reads 1970, like a
+// device that has not synced over SNTP. Firmware calls reach it through -Wl,--wrap.
+static int64_t s_utc_offset_us;
+
+extern "C" int __wrap_gettimeofday(struct timeval *tv, void *tz)
+{
+    int64_t utc_us = host_now_us() + s_utc_offset_us;
+    tv->tv_sec = (time_t)(utc_us / 1000000);
+    tv->tv_usec = (suseconds_t)(utc_us % 1000000);
+    return 0;
+}
+
+void host_set_utc_offset_us(int64_t offset_us)
+{
+    s_utc_offset_us = offset_us;
+}
+
+static void utc_reset(void)
+{
+    s_utc_offset_us = 0;
+}
+
+static struct utc_reset_hook {
+    utc_reset_hook()
+    {
+        host_on_reset(utc_reset);
+    }
+} s_utc_reset_hook;
+
+void host_set_reset_reason(int reason)
+{
+    s_reset_reason = (esp_reset_reason_t)reason;
+}
+
+void host_run_shutdown_handlers(void)
+{
+    for (shutdown_handler_t handler : s_shutdown_handlers) {
+        handler();
+    }
+}
+
+// Reflected CRCs with the inversion the ROM routines apply on entry and exit
+
+uint8_t esp_rom_crc8_le(uint8_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (uint8_t)((crc >> 1) ^ 0xE0) : (uint8_t)(crc >> 1);
+        }
+    }
+    return ~crc;
+}
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+        }
+    }
+    return ~crc;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+    }
+    return ~crc;
+}
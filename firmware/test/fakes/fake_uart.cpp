@@ -0,0 +1,140 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <driver/uart.h>
+#include <esp_log.h>
+
+#include "host_fakes.h"
+#include "host_sched.h"
+
+#define US_PER_TICK (1000000 / configTICK_RATE_HZ)
+
+static int s_fds[UART_NUM_MAX] = {-1, -1, -1};
+static int s_tx_buffer[UART_NUM_MAX];
+static vprintf_like_t s_log_vprintf = vprintf;
+
+static int port_fd(uart_port_t uart_num)
+{
+    return uart_num >= 0 && uart_num < UART_NUM_MAX ? s_fds[uart_num] : -1;
+}
+
+// Installing only checks the port and keeps the TX buffer size; the pins and line settings
+// mean nothing to a file descriptor
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              void *uart_queue, int intr_alloc_flags)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || rx_buffer_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_tx_buffer[uart_num] = tx_buffer_size;
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    return uart_num >= 0 && uart_num < UART_NUM_MAX && uart_config->baud_rate > 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    return uart_num >= 0 && uart_num < UART_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// Waits in real time for the peer; a wait that ends empty also passes on the simulated clock
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    int fd = port_fd(uart_num);
+    if (fd < 0) {
+        return -1;
+    }
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, (int)(ticks_to_wait * portTICK_PERIOD_MS));
+    if (ready <= 0 || !(pfd.revents & POLLIN)) {
+        host_advance_us((int64_t)ticks_to_wait * US_PER_TICK);
+        return 0;
+    }
+    ssize_t n = read(fd, buf, length);
+    return n < 0 ? (errno == EAGAIN ? 0 : -1) : (int)n;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    int fd = port_fd(uart_num);
+    if (fd < 0) {
+        return -1;
+    }
+    const uint8_t *p = (const uint8_t *)src;
+    size_t left = size;
+    while (left) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        left -= n;
+    }
+    return (int)size;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    int fd = port_fd(uart_num);
+    int available = 0;
+    if (fd < 0 || ioctl(fd, FIONREAD, &available) != 0) {
+        return ESP_FAIL;
+    }
+    *size = (size_t)available;
+    return ESP_OK;
+}
+
+// Writes go straight to the descriptor, so the whole TX buffer is always free
+esp_err_t uart_get_tx_buffer_free_size(uart_port_t uart_num, size_t *size)
+{
+    if (port_fd(uart_num) < 0) {
+        return ESP_FAIL;
+    }
+    *size = (size_t)s_tx_buffer[uart_num];
+    return ESP_OK;
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    vprintf_like_t previous = s_log_vprintf;
+    s_log_vprintf = func;
+    return previous;
+}
+
+void host_uart_attach(int uart_num, int fd)
+{
+    s_fds[uart_num] = fd;
+}
+
+static void uart_reset(void)
+{
+    for (int &fd : s_fds) {
+        fd = -1;
+    }
+    memset(s_tx_buffer, 0, sizeof(s_tx_buffer));
+    s_log_vprintf = vprintf;
+}
+
+static struct uart_reset_hook {
+    uart_reset_hook()
+    {
+        host_on_reset(uart_reset);
+    }
+} s_reset_hook;
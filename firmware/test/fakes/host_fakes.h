@@ -0,0 +1,144 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Test-side controls for the host fakes.
+//
+// The firmware modules are built unchanged against the headers in stubs/. Time only moves
+// when a test calls host_advance_us(); due esp_timers, FreeRTOS software timers and pended
+// function calls then run in deadline order on the calling thread, as the esp_timer task and
+// the timer service task would on the device.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include <driver/gpio.h>
+#include <esp_partition.h>
+
+// Exit codes of a forked boot, see host_boot() in test_support.h
+#define HOST_EXIT_POWER_CUT 99
+#define HOST_EXIT_RESTART   98
+
+typedef struct {
+    int64_t time_us;
+    int gpio_num;
+    uint32_t level;
+} host_edge_t;
+
+typedef struct {
+    int64_t time_us;
+    std::vector<uint32_t> symbols;
+} host_rmt_transmit_t;
+
+// Reset every fake to power-on state: time 0, no timers, all pins low, no RMT channels.
+void host_reset(void);
+
+// Run everything due up to now + us, then leave the clock there.
+void host_advance_us(int64_t us);
+
+// Run the pended function calls queued so far without moving the clock.
+void host_run_pended(void);
+
+// Make the next `count` xTimerPendFunctionCall() calls fail, as with a full timer queue. A call
+// that could block from inside an esp_timer callback aborts the test.
+void host_fail_pends(int count);
+uint32_t host_pend_failures(void);
+
+// Marks the code that follows as running in interrupt context, for xPortInIsrContext()
+void host_set_isr_context(bool in_isr);
+
+// xTaskNotifyGive() calls, from tasks and ISRs, since the last reset. ulTaskNotifyTake() waits
+// on the simulated clock, running what comes due, until one of them is given.
+uint32_t host_task_notifies(void);
+
+// Start each task xTaskCreate() makes from now on on a thread of its own, with queues that block
+// for real; for code that needs a second task to answer, such as the queue benchmark. Such a
+// task may only share queues with the test, and must have returned by the next reset.
+void host_set_threaded_tasks(bool threaded);
+
+// Number of esp_timers / software timers currently armed
+size_t host_active_timers(void);
+
+uint32_t host_gpio_level(int gpio_num);
+const std::vector<host_edge_t> &host_gpio_edges(void);
+void host_gpio_clear_edges(void);
+// Drive an input pin; calls the registered ISR when the edge matches its interrupt type.
+void host_gpio_input(int gpio_num, uint32_t level);
+// Put an open-drain line on a bus: gpio_get_level() reads the driven level ANDed with what
+// `bus` returns for the other devices on it. nullptr takes the pin off the bus again.
+using host_gpio_bus_t = std::function<uint32_t(void)>;
+void host_gpio_set_bus(int gpio_num, host_gpio_bus_t bus);
+
+// Mock RMT: each rmt_transmit() is recorded, and the transfer completes (on_trans_done is
+// called) once the simulated time of its symbols has passed. Queue depth follows the channel
+// config; with queue_nonblocking a full queue fails, otherwise the mock fails the test.
+const std::vector<host_rmt_transmit_t> &host_rmt_transmits(void);
+size_t host_rmt_channels(void);
+void host_rmt_fail_new_channel(bool fail);
+
+// Mock legacy I2C master: every transaction goes to the device model set here, which fills
+// `data` on reads and answers ESP_OK, ESP_FAIL for a NACK or ESP_ERR_TIMEOUT for a stuck bus.
+// A transaction takes its wire time at the configured clock, or its whole wait on a timeout.
+// Without a driver installed transactions fail with ESP_ERR_INVALID_STATE.
+using host_i2c_device_t = std::function<esp_err_t(uint8_t address, bool read, uint8_t *data, size_t len)>;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint32_t installs;
+    uint32_t deletes;
+    int64_t longest_us;     // longest single transaction
+} host_i2c_stats_t;
+
+void host_i2c_set_device(host_i2c_device_t device);
+host_i2c_stats_t host_i2c_stats(void);
+
+// UART driver on a file descriptor, e.g. the master side of a pseudo-terminal a host tool opens
+// the other side of. A read that waits without data advances the simulated clock by its wait.
+void host_uart_attach(int uart_num, int fd);
+
+// Emulated NOR flash: erase sets a 4 KiB sector to 0xFF, writes can only clear bits. Contents
+// and counters live in shared memory, so a forked boot leaves them behind for the next one.
+// host_reset() does not touch them; use host_flash_format().
+typedef struct {
+    uint32_t erases;
+    uint32_t writes;
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+} host_flash_stats_t;
+
+const esp_partition_t *host_flash_add_partition(const char *label, uint32_t size);
+uint8_t *host_flash_data(const char *label);
+void host_flash_format(const char *label);
+host_flash_stats_t host_flash_stats(const char *label);
+// Cut the power once `bytes` more bytes have been programmed: the write in progress stops
+// part way and the process exits with HOST_EXIT_POWER_CUT. A negative count disarms it.
+void host_flash_cut_power_after(int64_t bytes);
+// Cut the power during the erase after the next `nth` ones, leaving that sector half erased
+void host_flash_cut_power_in_erase(int64_t nth);
+
+// Emulated NVS: keys live in shared memory like the flash, so a forked boot's writes are there
+// for the next one. host_reset() leaves them alone; host_nvs_erase_all() wipes the partition.
+void host_nvs_erase_all(void);
+// nvs_set_*() and nvs_erase_key() calls that changed something, since the last erase-all
+uint32_t host_nvs_writes(void);
+
+// Internal heap as heap_caps_*() report it; the low-water mark follows the lowest free figure
+// set since the last reset. host_reset() goes back to 200 KB free in one block.
+void host_heap_set(uint32_t free_bytes, uint32_t largest_block);
+
+// gettimeofday() for firmware code: the simulated clock plus this offset, 0 after a reset
+void host_set_utc_offset_us(int64_t offset_us);
+
+void host_set_reset_reason(int reason);
+// What esp_restart() runs before the reset
+void host_run_shutdown_handlers(void);
@@ -0,0 +1,22 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Simulated clock shared by the fakes. Events due at the same time run in the order they
+// were scheduled.
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+
+int64_t host_now_us(void);
+uint64_t host_schedule(int64_t at_us, std::function<void()> fn);
+void host_cancel(uint64_t event_id);
+bool host_pending(uint64_t event_id);
+// Hooks run by host_reset() so each fake can clear its own state
+void host_on_reset(void (*fn)(void));
@@ -0,0 +1,90 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// A prop for tools/hostlink.py to talk to: app_settings and app_hostlink on the simulated
+// clock, with the console UART on a pseudo-terminal. Prints the terminal's path on stdout, then
+// serves a session each time `hostlink` is entered, like the firmware's console, until killed.
+// Everything else it prints goes to stderr.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <driver/uart.h>
+
+#include "app_hostlink.h"
+#include "app_settings.h"
+#include "host_fakes.h"
+
+#define CONSOLE_UART    0
+
+static void settings_cb(const app_settings_t *settings, void *user_data)
+{
+    printf("staged: pulse %u ms, signal GPIO %d, PIR hold %u s, SHTC3 every %u ms\n", settings->pulse_ms,
+           settings->signal_gpio, settings->pir_hold_s, (unsigned)settings->shtc3_interval_ms);
+}
+
+int main(void)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char *path = ptsname(master);
+    // Held open so the master side keeps working while no tool has the terminal open
+    int slave = open(path, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror(path);
+        return 1;
+    }
+    struct termios attrs;
+    tcgetattr(slave, &attrs);
+    cfmakeraw(&attrs);
+    tcsetattr(slave, TCSANOW, &attrs);
+
+    printf("%s\n", path);
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (app_settings_init() != ESP_OK) {
+        return 1;
+    }
+    host_uart_attach(CONSOLE_UART, master);
+
+    app_hostlink_config_t config;
+    config.uart_num = CONSOLE_UART;
+    config.profile_name = "host";
+    config.settings_cb = settings_cb;
+
+    std::string line;
+    for (;;) {
+        char c;
+        int n = uart_read_bytes(CONSOLE_UART, &c, 1, pdMS_TO_TICKS(100));
+        if (n < 0) {
+            return 1;
+        }
+        if (n == 0) {
+            continue;
+        }
+        if (c != '\r' && c != '\n') {
+            line += c;
+            continue;
+        }
+        if (line == "hostlink") {
+            esp_err_t err = app_hostlink_session(&config);
+            printf("session ended: %s\n", esp_err_to_name(err));
+        }
+        line.clear();
+    }
+}
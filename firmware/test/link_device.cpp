@@ -0,0 +1,97 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// The prop's end of the controller link for tools/uart_link.py to talk to: app_link on the
+// simulated clock, with its UART on a pseudo-terminal and acks on. Prints the terminal's path,
+// then takes one command per line on stdin and answers each with one line on stdout:
+//
+//   play TRACK VOLUME EFFECT   queue a PLAY frame            -> ESP_OK or the error
+//   stop                       queue a STOP frame            -> ESP_OK or the error
+//   receive MS                 read acks for up to MS        -> ok
+//   wait MS                    advance the simulated clock   -> ok
+//   stats                      the app_link counters         -> name=value ...
+//
+// The link's logs go to stderr.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "app_link.h"
+#include "host_fakes.h"
+
+#define LINK_UART           1
+#define LINK_ACK_TIMEOUT_MS 50      // test_app_link.py waits on these two
+#define LINK_RETRIES        1
+
+int main(void)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char *path = ptsname(master);
+    // Held open so the master side keeps working while no tool has the terminal open
+    int slave = open(path, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror(path);
+        return 1;
+    }
+    struct termios attrs;
+    tcgetattr(slave, &attrs);
+    cfmakeraw(&attrs);
+    tcsetattr(slave, TCSANOW, &attrs);
+
+    FILE *replies = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(replies, NULL, _IOLBF, 0);
+    fprintf(replies, "%s\n", path);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    host_uart_attach(LINK_UART, master);
+    app_link_config_t config = {
+        .uart_num = LINK_UART,
+        .tx_gpio = 7,
+        .rx_gpio = 6,
+        .baud_rate = 115200,
+        .ack_timeout_ms = LINK_ACK_TIMEOUT_MS,
+        .retries = LINK_RETRIES,
+    };
+    if (app_link_init(&config) != ESP_OK) {
+        return 1;
+    }
+
+    char line[64];
+    while (fgets(line, sizeof(line), stdin)) {
+        unsigned track, volume, effect, ms;
+        if (sscanf(line, "play %u %u %u", &track, &volume, &effect) == 3) {
+            fprintf(replies, "%s\n", esp_err_to_name(app_link_play(track, volume, effect)));
+        } else if (strncmp(line, "stop", 4) == 0) {
+            fprintf(replies, "%s\n", esp_err_to_name(app_link_stop()));
+        } else if (sscanf(line, "receive %u", &ms) == 1) {
+            app_link_receive(ms);
+            fprintf(replies, "ok\n");
+        } else if (sscanf(line, "wait %u", &ms) == 1) {
+            host_advance_us((int64_t)ms * 1000);
+            fprintf(replies, "ok\n");
+        } else if (strncmp(line, "stats", 5) == 0) {
+            app_link_stats_t stats;
+            app_link_get_stats(&stats);
+            fprintf(replies,
+                    "sent=%u resent=%u acked=%u timeouts=%u superseded=%u tx_full=%u rx_errors=%u\n",
+                    (unsigned)stats.sent, (unsigned)stats.resent, (unsigned)stats.acked, (unsigned)stats.timeouts,
+                    (unsigned)stats.superseded, (unsigned)stats.tx_full, (unsigned)stats.rx_errors);
+        } else {
+            fprintf(replies, "unknown command\n");
+        }
+    }
+    return 0;
+}
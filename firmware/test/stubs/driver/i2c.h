@@ -0,0 +1,39 @@
+// Host build stand-in for the legacy ESP-IDF I2C driver header. Transactions go to the device
+// model a test installs with host_i2c_set_device().
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int i2c_port_t;
+
+#define I2C_NUM_0   0
+
+typedef enum {
+    I2C_MODE_SLAVE = 0,
+    I2C_MODE_MASTER,
+} i2c_mode_t;
+
+typedef struct {
+    i2c_mode_t mode;
+    int sda_io_num;
+    int scl_io_num;
+    bool sda_pullup_en;
+    bool scl_pullup_en;
+    struct {
+        uint32_t clk_speed;
+    } master;
+    uint32_t clk_flags;
+} i2c_config_t;
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config);
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags);
+esp_err_t i2c_driver_delete(i2c_port_t port);
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t device_address, const uint8_t *write_buffer,
+                                     size_t write_size, TickType_t ticks_to_wait);
+esp_err_t i2c_master_read_from_device(i2c_port_t port, uint8_t device_address, uint8_t *read_buffer,
+                                      size_t read_size, TickType_t ticks_to_wait);
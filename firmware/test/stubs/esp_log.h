@@ -0,0 +1,21 @@
+// Host build stand-in for the ESP-IDF header of the same name
+#pragma once
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#define HOST_LOG(letter, tag, fmt, ...) printf(letter " (%s) " fmt "\n", tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG("I", tag, fmt, ##__VA_ARGS__)
+// Compiled out like below the default log level, but the arguments are still type-checked and used
+#define ESP_LOGD(tag, fmt, ...) do { if (0) HOST_LOG("D", tag, fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, fmt, ...) do { if (0) HOST_LOG("V", tag, fmt, ##__VA_ARGS__); } while (0)
+#define ESP_EARLY_LOGW(tag, fmt, ...) HOST_LOG("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_DRAM_LOGW(tag, fmt, ...) HOST_LOG("W", tag, fmt, ##__VA_ARGS__)
+
+// Host logs go straight to stdout; the function set here is only stored and handed back
+typedef int (*vprintf_like_t)(const char *, va_list);
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
@@ -0,0 +1,9 @@
+// Host build stand-in for the ESP-IDF header of the same name. Same results as the ROM
+// routines: crc32_le matches zlib's crc32().
+#pragma once
+
+#include <stdint.h>
+
+uint8_t esp_rom_crc8_le(uint8_t crc, const uint8_t *buf, uint32_t len);
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len);
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
@@ -0,0 +1,7 @@
+// Host build stand-in for the ESP-IDF header of the same name. Busy waits move the simulated
+// clock.
+#pragma once
+
+#include <stdint.h>
+
+void esp_rom_delay_us(uint32_t us);
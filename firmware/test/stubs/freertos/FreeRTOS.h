@@ -0,0 +1,37 @@
+// Host build stand-in for the FreeRTOS header of the same name. Firmware code runs on one thread
+// (threaded tasks only share queues), so critical sections are no-ops; a 100 Hz tick is assumed
+// as on the device.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_attr.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define pdFAIL              0
+#define portMAX_DELAY       0xffffffffu
+#define configTICK_RATE_HZ  100
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(m)       (void)(m)
+#define portEXIT_CRITICAL(m)        (void)(m)
+#define portENTER_CRITICAL_ISR(m)   (void)(m)
+#define portEXIT_CRITICAL_ISR(m)    (void)(m)
+#define portENTER_CRITICAL_SAFE(m)  (void)(m)
+#define portEXIT_CRITICAL_SAFE(m)   (void)(m)
+#define portYIELD_FROM_ISR(...)     do {} while (0)
+
+BaseType_t xPortInIsrContext(void);
@@ -0,0 +1,158 @@
+// Kconfig defaults for the host build. A test target overrides any of them with a compile
+// definition; see CMakeLists.txt.
+#pragma once
+
+#define CONFIG_IDF_TARGET_ESP32C3 1
+#define CONFIG_SOC_RMT_SUPPORTED 1
+#define CONFIG_ESP_CONSOLE_UART_DEFAULT 1
+#define CONFIG_ESP_CONSOLE_UART 1
+#define CONFIG_ESP_CONSOLE_UART_NUM 0
+
+// Example Configuration
+#ifndef CONFIG_SHTC3_I2C_SDA_PIN
+#define CONFIG_SHTC3_I2C_SDA_PIN 8
+#endif
+#ifndef CONFIG_SHTC3_I2C_SCL_PIN
+#define CONFIG_SHTC3_I2C_SCL_PIN 9
+#endif
+
+// Occupancy Sensor Configuration
+#ifndef CONFIG_PIR_OCCUPIED_TO_UNOCCUPIED_DELAY_SECONDS
+#define CONFIG_PIR_OCCUPIED_TO_UNOCCUPIED_DELAY_SECONDS 10
+#endif
+
+// Skull Switch Output
+#ifndef CONFIG_SKULL_SIGNAL_GPIO
+#define CONFIG_SKULL_SIGNAL_GPIO 4
+#endif
+#if !defined(CONFIG_SKULL_OUTPUT_BACKEND_GPIO) && !defined(CONFIG_SKULL_OUTPUT_BACKEND_RMT)
+#define CONFIG_SKULL_OUTPUT_BACKEND_RMT 1
+#endif
+#ifndef CONFIG_SKULL_OUTPUT_RMT_TICKS_PER_US
+#define CONFIG_SKULL_OUTPUT_RMT_TICKS_PER_US 1
+#endif
+#ifndef CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS
+#define CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS 256
+#endif
+#ifndef CONFIG_SKULL_PULSE_DURATION_MS
+#define CONFIG_SKULL_PULSE_DURATION_MS 500
+#endif
+#ifndef CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS
+#define CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS 2000
+#endif
+
+// Skull Switch Scheduled Triggers (no SNTP on the host)
+#ifndef CONFIG_SKULL_SCHED_TICK_MS
+#define CONFIG_SKULL_SCHED_TICK_MS 1
+#endif
+#ifndef CONFIG_SKULL_SCHED_MAX_PENDING
+#define CONFIG_SKULL_SCHED_MAX_PENDING 16
+#endif
+#ifndef CONFIG_SKULL_SCHED_MAX_DELAY_MS
+#define CONFIG_SKULL_SCHED_MAX_DELAY_MS 3600000
+#endif
+
+// Skull Switch Event Log
+#ifndef CONFIG_SKULL_EVTLOG_BUFFER_RECORDS
+#define CONFIG_SKULL_EVTLOG_BUFFER_RECORDS 32
+#endif
+#ifndef CONFIG_SKULL_EVTLOG_FLUSH_THRESHOLD
+#define CONFIG_SKULL_EVTLOG_FLUSH_THRESHOLD 24
+#endif
+#ifndef CONFIG_SKULL_EVTLOG_FLUSH_INTERVAL_MS
+#define CONFIG_SKULL_EVTLOG_FLUSH_INTERVAL_MS 30000
+#endif
+
+// Skull Switch Duplicate Suppression
+#ifndef CONFIG_SKULL_DEDUPE_WINDOW_MS
+#define CONFIG_SKULL_DEDUPE_WINDOW_MS 300
+#endif
+
+// Skull Switch Rate Limiter
+#ifndef CONFIG_SKULL_LIMIT_BURST
+#define CONFIG_SKULL_LIMIT_BURST 3
+#endif
+#ifndef CONFIG_SKULL_LIMIT_REFILL_MS
+#define CONFIG_SKULL_LIMIT_REFILL_MS 2000
+#endif
+#ifndef CONFIG_SKULL_LIMIT_DUTY_WINDOW_MS
+#define CONFIG_SKULL_LIMIT_DUTY_WINDOW_MS 60000
+#endif
+#ifndef CONFIG_SKULL_LIMIT_MAX_DUTY_PCT
+#define CONFIG_SKULL_LIMIT_MAX_DUTY_PCT 25
+#endif
+
+// Skull Switch Benchmarks
+#ifndef CONFIG_SKULL_BENCH_GPIO
+#define CONFIG_SKULL_BENCH_GPIO 5
+#endif
+
+// Skull Switch Motion Sensors (CONFIG_SKULL_PIR_INPUT is up to the target)
+#ifndef CONFIG_SKULL_PIR_COUNT
+#define CONFIG_SKULL_PIR_COUNT 1
+#endif
+#ifndef CONFIG_SKULL_PIR1_GPIO
+#define CONFIG_SKULL_PIR1_GPIO 0
+#endif
+#ifndef CONFIG_SKULL_PIR2_GPIO
+#define CONFIG_SKULL_PIR2_GPIO 1
+#endif
+#ifndef CONFIG_SKULL_PIR3_GPIO
+#define CONFIG_SKULL_PIR3_GPIO 3
+#endif
+#ifndef CONFIG_SKULL_PIR4_GPIO
+#define CONFIG_SKULL_PIR4_GPIO 10
+#endif
+#ifndef CONFIG_SKULL_PIR_DEBOUNCE_MS
+#define CONFIG_SKULL_PIR_DEBOUNCE_MS 50
+#endif
+
+// Skull Switch Button
+#ifndef CONFIG_SKULL_BUTTON_GPIO
+#define CONFIG_SKULL_BUTTON_GPIO 9
+#endif
+#ifndef CONFIG_SKULL_BUTTON_DEBOUNCE_MS
+#define CONFIG_SKULL_BUTTON_DEBOUNCE_MS 20
+#endif
+#ifndef CONFIG_SKULL_BUTTON_CLICK_GAP_MS
+#define CONFIG_SKULL_BUTTON_CLICK_GAP_MS 300
+#endif
+#ifndef CONFIG_SKULL_BUTTON_LONG_PRESS_MS
+#define CONFIG_SKULL_BUTTON_LONG_PRESS_MS 5000
+#endif
+#ifndef CONFIG_SKULL_BUTTON_BURST_GAP_MS
+#define CONFIG_SKULL_BUTTON_BURST_GAP_MS 250
+#endif
+
+// Skull Switch Status LED
+#ifndef CONFIG_SKULL_STATUS_LED_GPIO
+#define CONFIG_SKULL_STATUS_LED_GPIO 8
+#endif
+
+// Skull Switch Memory
+#ifndef CONFIG_SKULL_HEAP_RECLAIM_MIN_KB
+#define CONFIG_SKULL_HEAP_RECLAIM_MIN_KB 40
+#endif
+
+// Skull Switch Thermal Derating (CONFIG_SKULL_THERMAL is up to the target)
+#ifndef CONFIG_SKULL_THERMAL_DERATE_START_C
+#define CONFIG_SKULL_THERMAL_DERATE_START_C 40
+#endif
+#ifndef CONFIG_SKULL_THERMAL_DERATE_FULL_C
+#define CONFIG_SKULL_THERMAL_DERATE_FULL_C 55
+#endif
+#ifndef CONFIG_SKULL_THERMAL_MIN_SCALE_PCT
+#define CONFIG_SKULL_THERMAL_MIN_SCALE_PCT 25
+#endif
+#ifndef CONFIG_SKULL_THERMAL_CUTOFF_C
+#define CONFIG_SKULL_THERMAL_CUTOFF_C 60
+#endif
+#ifndef CONFIG_SKULL_THERMAL_HYSTERESIS_C
+#define CONFIG_SKULL_THERMAL_HYSTERESIS_C 3
+#endif
+#ifndef CONFIG_SKULL_THERMAL_MAX_PULSE_MS
+#define CONFIG_SKULL_THERMAL_MAX_PULSE_MS 1000
+#endif
+#ifndef CONFIG_SKULL_THERMAL_UNKNOWN_SCALE_PCT
+#define CONFIG_SKULL_THERMAL_UNKNOWN_SCALE_PCT 100
+#endif
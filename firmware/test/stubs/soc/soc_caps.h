@@ -0,0 +1,5 @@
+// Host build stand-in for the ESP-IDF header of the same name (ESP32-C3 values)
+#pragma once
+
+#define SOC_RMT_SUPPORTED               1
+#define SOC_RMT_MEM_WORDS_PER_CHANNEL   48
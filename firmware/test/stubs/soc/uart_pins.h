@@ -0,0 +1,5 @@
+// Host build stand-in for the ESP-IDF header of the same name (ESP32-C3 values)
+#pragma once
+
+#define U0TXD_GPIO_NUM 21
+#define U0RXD_GPIO_NUM 20
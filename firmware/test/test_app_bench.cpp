@@ -0,0 +1,82 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_bench as the Linux target builds it: the timer benchmark on the simulated clock, the queue
+// benchmark against an echo task on a real thread, and the device-only benchmarks refused.
+
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "app_bench.h"
+#include "test_support.h"
+
+#define ITERATIONS 200
+
+// Simulated time has no dispatch latency, so every callback is exactly on time; what is left to
+// check is that each iteration waits for its own callback and is counted once
+static void test_timer_on_the_simulated_clock(void)
+{
+    app_bench_config_t config;
+    app_bench_result_t result;
+    CHECK_EQ(app_bench_run(APP_BENCH_TIMER, &config, ITERATIONS, &result), ESP_OK);
+    CHECK_EQ(result.iterations, ITERATIONS);
+    CHECK_EQ(result.mean_ns, 0);
+    CHECK_EQ(result.max_ns, 0);
+    CHECK_EQ(result.stddev_ns, 0);
+    CHECK_EQ(esp_timer_get_time(), (int64_t)ITERATIONS * 1000);
+    CHECK_EQ(host_task_notifies(), ITERATIONS);
+    CHECK_EQ(host_active_timers(), 0);
+}
+
+// A real round trip between two threads, timed with the monotonic clock
+static void test_queue_round_trip(void)
+{
+    host_set_threaded_tasks(true);
+    app_bench_config_t config;
+    app_bench_result_t result;
+    CHECK_EQ(app_bench_run(APP_BENCH_QUEUE, &config, ITERATIONS, &result), ESP_OK);
+    CHECK_EQ(result.iterations, ITERATIONS);
+    CHECK(result.min_ns > 0);
+    CHECK(result.min_ns <= result.mean_ns);
+    CHECK(result.mean_ns <= result.max_ns);
+    printf("  %-22s mean %u ns, min %u ns, max %u ns\n", "queue round trip", (unsigned)result.mean_ns,
+           (unsigned)result.min_ns, (unsigned)result.max_ns);
+}
+
+// Without a task to answer, the first receive times out and the benchmark says so
+static void test_queue_without_echo_task(void)
+{
+    app_bench_config_t config;
+    app_bench_result_t result;
+    CHECK_EQ(app_bench_run(APP_BENCH_QUEUE, &config, ITERATIONS, &result), ESP_ERR_TIMEOUT);
+    CHECK_EQ(result.iterations, 0);
+}
+
+static void test_device_only_and_invalid(void)
+{
+    app_bench_config_t config;
+    app_bench_result_t result;
+    const app_bench_id_t device_only[] = {APP_BENCH_GPIO, APP_BENCH_ATTR, APP_BENCH_ATTR_LOCKED, APP_BENCH_I2C};
+    for (app_bench_id_t id : device_only) {
+        CHECK_EQ(app_bench_run(id, &config, ITERATIONS, &result), ESP_ERR_NOT_SUPPORTED);
+    }
+    CHECK_EQ(app_bench_run(APP_BENCH_COUNT, &config, ITERATIONS, &result), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(app_bench_run(APP_BENCH_TIMER, &config, 0, &result), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(app_bench_run(APP_BENCH_TIMER, NULL, ITERATIONS, &result), ESP_ERR_INVALID_ARG);
+    CHECK(strcmp(app_bench_name(APP_BENCH_QUEUE), "queue") == 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_timer_on_the_simulated_clock);
+    RUN_TEST(test_queue_round_trip);
+    RUN_TEST(test_queue_without_echo_task);
+    RUN_TEST(test_device_only_and_invalid);
+    return TEST_EXIT();
+}
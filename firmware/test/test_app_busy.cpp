@@ -0,0 +1,250 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_busy against busy-line waveforms driven through the GPIO ISR: playback, unanswered
+// triggers, glitches, an edge racing the start timeout, and a full timer queue on both the ISR
+// and the esp_timer hand-off.
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include <vector>
+
+#include "app_busy.h"
+#include "test_support.h"
+
+#define BUSY_GPIO           3
+#define START_TIMEOUT_MS    1000
+#define TICK_US             (portTICK_PERIOD_MS * 1000)
+#define BOOT_US             (1000 * 1000)   // waveform time 0; esp_timer time 0 never follows a boot
+
+typedef enum {
+    EV_TRIGGER,     // app_busy_note_trigger()
+    EV_LINE,        // busy line to value (electrical level)
+    EV_FAIL_PENDS,  // the next value hand-offs to the timer task find its queue full
+} wave_event_type_t;
+
+typedef struct {
+    int64_t at_us;
+    wave_event_type_t type;
+    int value;
+} wave_event_t;
+
+typedef struct {
+    int64_t at_us;
+    bool busy;
+} state_change_t;
+
+typedef struct {
+    uint32_t triggers;
+    uint32_t playbacks;
+    uint32_t unsolicited;
+    uint32_t timeouts;
+    uint32_t pend_retries;
+} wave_stats_t;
+
+typedef struct {
+    const char *name;
+    int active_level;
+    std::vector<wave_event_t> events;
+    std::vector<state_change_t> expected;
+    wave_stats_t stats;
+} waveform_t;
+
+static std::vector<state_change_t> s_changes;
+static const waveform_t *s_wave;
+
+static void state_cb(bool busy, void *user_data)
+{
+    s_changes.push_back({esp_timer_get_time() - BOOT_US, busy});
+}
+
+static void boot_play_waveform(void)
+{
+    const waveform_t &wave = *s_wave;
+    // The line idles inactive before the input is set up
+    host_gpio_input(BUSY_GPIO, !wave.active_level);
+    app_busy_config_t config = {
+        .gpio_num = BUSY_GPIO,
+        .active_level = wave.active_level,
+        .start_timeout_ms = START_TIMEOUT_MS,
+        .state_cb = state_cb,
+    };
+    CHECK_EQ(app_busy_init(&config), ESP_OK);
+    CHECK(!app_busy_is_busy());
+
+    for (const wave_event_t &event : wave.events) {
+        host_advance_us(BOOT_US + event.at_us - esp_timer_get_time());
+        switch (event.type) {
+        case EV_TRIGGER:
+            app_busy_note_trigger(esp_timer_get_time());
+            break;
+        case EV_LINE:
+            host_gpio_input(BUSY_GPIO, event.value);
+            break;
+        case EV_FAIL_PENDS:
+            host_fail_pends(event.value);
+            break;
+        }
+    }
+    host_advance_us(5 * 1000 * 1000);
+
+    CHECK_EQ(s_changes.size(), wave.expected.size());
+    for (size_t i = 0; i < s_changes.size() && i < wave.expected.size(); i++) {
+        if (s_changes[i].at_us != wave.expected[i].at_us || s_changes[i].busy != wave.expected[i].busy) {
+            printf("  change %zu: %s at %lld us, expected %s at %lld us\n", i, s_changes[i].busy ? "busy" : "idle",
+                   (long long)s_changes[i].at_us, wave.expected[i].busy ? "busy" : "idle",
+                   (long long)wave.expected[i].at_us);
+            CHECK(false);
+        }
+    }
+
+    app_busy_stats_t stats;
+    app_busy_get_stats(&stats);
+    CHECK_EQ(stats.triggers, wave.stats.triggers);
+    CHECK_EQ(stats.playbacks, wave.stats.playbacks);
+    CHECK_EQ(stats.unsolicited, wave.stats.unsolicited);
+    CHECK_EQ(stats.timeouts, wave.stats.timeouts);
+    CHECK_EQ(stats.pend_retries, wave.stats.pend_retries);
+    CHECK_EQ(host_active_timers(), 0);
+}
+
+#define MS(ms) ((int64_t)(ms) * 1000)
+
+static const waveform_t s_waveforms[] = {
+    {
+        "playback",
+        1,
+        {{0, EV_TRIGGER, 0}, {MS(120), EV_LINE, 1}, {MS(3120), EV_LINE, 0}},
+        {{MS(120), true}, {MS(3120), false}},
+        {.triggers = 1, .playbacks = 1},
+    },
+    {
+        "active-low playback",
+        0,
+        {{0, EV_TRIGGER, 0}, {MS(80), EV_LINE, 0}, {MS(2080), EV_LINE, 1}},
+        {{MS(80), true}, {MS(2080), false}},
+        {.triggers = 1, .playbacks = 1},
+    },
+    {
+        "unanswered trigger",
+        1,
+        {{0, EV_TRIGGER, 0}},
+        {{MS(START_TIMEOUT_MS), false}},
+        {.triggers = 1, .timeouts = 1},
+    },
+    {
+        "prop's own sensor",
+        1,
+        {{MS(500), EV_LINE, 1}, {MS(2500), EV_LINE, 0}},
+        {{MS(500), true}, {MS(2500), false}},
+        {.unsolicited = 1},
+    },
+    {
+        // Both edges land in the ring before the timer task drains it
+        "glitch",
+        1,
+        {{MS(500), EV_LINE, 1}, {MS(500), EV_LINE, 0}},
+        {{MS(500), true}, {MS(500), false}},
+        {.unsolicited = 1},
+    },
+    {
+        // A trigger while already busy is answered by the next busy edge, not the current one
+        "retrigger while playing",
+        1,
+        {{0, EV_TRIGGER, 0}, {MS(100), EV_LINE, 1}, {MS(600), EV_TRIGGER, 0}, {MS(900), EV_LINE, 0},
+         {MS(950), EV_LINE, 1}, {MS(1900), EV_LINE, 0}},
+        {{MS(100), true}, {MS(900), false}, {MS(950), true}, {MS(1900), false}},
+        {.triggers = 2, .playbacks = 2},
+    },
+    {
+        // The start timeout's hand-off finds the queue full and is retried a tick later
+        "timeout hand-off retried",
+        1,
+        {{0, EV_TRIGGER, 0}, {MS(500), EV_FAIL_PENDS, 3}},
+        {{MS(START_TIMEOUT_MS) + 3 * TICK_US, false}},
+        {.triggers = 1, .timeouts = 1, .pend_retries = 3},
+    },
+    {
+        // The ISR's hand-off fails; the edge waits in the ring for the retry
+        "edge hand-off retried",
+        1,
+        {{0, EV_TRIGGER, 0}, {MS(200), EV_FAIL_PENDS, 2}, {MS(200), EV_LINE, 1}, {MS(1500), EV_LINE, 0}},
+        {{MS(200) + 2 * TICK_US, true}, {MS(1500), false}},
+        {.triggers = 1, .playbacks = 1, .pend_retries = 2},
+    },
+    {
+        // The busy edge is stuck in the ring when the start timeout fires: the edge wins
+        "edge racing the timeout",
+        1,
+        {{0, EV_TRIGGER, 0}, {MS(START_TIMEOUT_MS) - 2000, EV_FAIL_PENDS, 1},
+         {MS(START_TIMEOUT_MS) - 2000, EV_LINE, 1}, {MS(2500), EV_LINE, 0}},
+        {{MS(START_TIMEOUT_MS), true}, {MS(2500), false}},
+        {.triggers = 1, .playbacks = 1, .pend_retries = 1},
+    },
+};
+
+static void test_waveforms(void)
+{
+    for (const waveform_t &wave : s_waveforms) {
+        host_reset();
+        s_wave = &wave;
+        int result = host_boot(boot_play_waveform);
+        printf("  %-26s %s\n", wave.name, result == 0 ? "ok" : "FAILED");
+        CHECK_EQ(result, 0);
+    }
+}
+
+// Playback latency and duration land in their log2 buckets
+static void boot_histograms(void)
+{
+    host_gpio_input(BUSY_GPIO, 0);
+    app_busy_config_t config = {.gpio_num = BUSY_GPIO, .active_level = 1, .start_timeout_ms = START_TIMEOUT_MS};
+    CHECK_EQ(app_busy_init(&config), ESP_OK);
+    host_advance_us(BOOT_US);
+
+    const struct {
+        uint32_t latency_ms;
+        uint32_t duration_ms;
+    } plays[] = {{0, 500}, {120, 3000}, {120, 3100}, {900, 30000}, {999, 600000}};
+    for (auto &play : plays) {
+        app_busy_note_trigger(esp_timer_get_time());
+        host_advance_us(MS(play.latency_ms));
+        host_gpio_input(BUSY_GPIO, 1);
+        host_advance_us(MS(play.duration_ms));
+        host_gpio_input(BUSY_GPIO, 0);
+        host_advance_us(MS(10));
+    }
+
+    app_busy_stats_t stats;
+    app_busy_get_stats(&stats);
+    CHECK_EQ(stats.playbacks, 5);
+    CHECK_EQ(stats.timeouts, 0);
+    CHECK_EQ(stats.latency_hist[app_busy_hist_bucket(0)], 1);
+    CHECK_EQ(stats.latency_hist[app_busy_hist_bucket(120)], 2);
+    CHECK_EQ(stats.latency_hist[app_busy_hist_bucket(999)], 2);
+    CHECK_EQ(stats.duration_hist[app_busy_hist_bucket(3000)], 2);
+    CHECK_EQ(stats.duration_hist[APP_BUSY_HIST_BUCKETS - 1], 2);   // 30 s and 10 min: open-ended bucket
+}
+
+static void test_histograms(void)
+{
+    CHECK_EQ(host_boot(boot_histograms), 0);
+    CHECK_EQ(app_busy_hist_bucket(0), 0);
+    CHECK_EQ(app_busy_hist_bucket(1), 1);
+    CHECK_EQ(app_busy_hist_bucket(127), 7);
+    CHECK_EQ(app_busy_hist_bucket(128), 8);
+    CHECK_EQ(app_busy_hist_bucket(UINT32_MAX), APP_BUSY_HIST_BUCKETS - 1);
+}
+
+int main(void)
+{
+    RUN_TEST(test_waveforms);
+    RUN_TEST(test_histograms);
+    return TEST_EXIT();
+}
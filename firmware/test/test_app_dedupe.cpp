@@ -0,0 +1,175 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_dedupe against multi-fabric command traces: the same automation delivered by several
+// ecosystems, interleaved ON/OFF from different fabrics, and the per-fabric counters.
+
+#include "app_dedupe.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define WINDOW_MS CONFIG_SKULL_DEDUPE_WINDOW_MS
+
+typedef struct {
+    uint32_t at_ms;
+    uint16_t endpoint_id;
+    bool value;
+    uint8_t fabric_index;
+    bool suppressed;    // expected decision
+} trace_step_t;
+
+// Feeds a trace the way the Matter thread does: the attribute callback decides, then the
+// command callback attributes the decision to the sending fabric
+static void replay(const trace_step_t *steps, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const trace_step_t &step = steps[i];
+        bool suppressed = app_dedupe_check(step.endpoint_id, step.value, (int64_t)step.at_ms * 1000);
+        app_dedupe_commit(step.fabric_index);
+        if (suppressed != step.suppressed) {
+            printf("step %zu (%u ms, ep %u, %s, fabric %u): %s, expected %s\n", i, (unsigned)step.at_ms,
+                   step.endpoint_id, step.value ? "ON" : "OFF", step.fabric_index,
+                   suppressed ? "suppressed" : "accepted", step.suppressed ? "suppressed" : "accepted");
+        }
+        CHECK_EQ(suppressed, step.suppressed);
+    }
+}
+
+static void check_stats(uint8_t fabric_index, uint32_t accepted, uint32_t suppressed, uint32_t cross_fabric)
+{
+    app_dedupe_fabric_stats_t stats;
+    app_dedupe_get_stats(fabric_index, &stats);
+    CHECK_EQ(stats.accepted, accepted);
+    CHECK_EQ(stats.suppressed, suppressed);
+    CHECK_EQ(stats.cross_fabric, cross_fabric);
+}
+
+// One automation, three ecosystems: only the first delivery triggers
+static void boot_same_automation_three_fabrics(void)
+{
+    const trace_step_t trace[] = {
+        {1000, 1, true, 1, false},
+        {1012, 1, true, 2, true},
+        {1090, 1, true, 3, true},
+        {3000, 1, false, 2, false},
+        {3004, 1, false, 1, true},
+        {3050, 1, false, 3, true},
+    };
+    replay(trace, sizeof(trace) / sizeof(trace[0]));
+    check_stats(1, 1, 1, 1);
+    check_stats(2, 1, 1, 1);
+    check_stats(3, 0, 2, 2);
+}
+
+// A repeat from the same fabric is a duplicate too, but not counted as cross-fabric
+static void boot_same_fabric_repeat(void)
+{
+    const trace_step_t trace[] = {
+        {500, 1, true, 1, false},
+        {520, 1, true, 1, true},
+    };
+    replay(trace, sizeof(trace) / sizeof(trace[0]));
+    check_stats(1, 1, 1, 0);
+}
+
+// ON, OFF, ON inside one window are three real changes: the OFF ends the first ON's window
+static void boot_opposite_value_invalidates(void)
+{
+    const trace_step_t trace[] = {
+        {1000, 1, true, 1, false},
+        {1050, 1, false, 2, false},
+        {1100, 1, true, 3, false},
+        {1150, 1, true, 1, true},   // now a duplicate of fabric 3's ON
+        {1200, 1, false, 2, false},
+        {1210, 1, false, 1, true},
+    };
+    replay(trace, sizeof(trace) / sizeof(trace[0]));
+    check_stats(1, 1, 2, 2);
+    check_stats(2, 2, 0, 0);
+    check_stats(3, 1, 0, 0);
+}
+
+// Invalidation is per endpoint: the UI endpoint's OFF leaves the switch's ON window alone
+static void boot_endpoints_independent(void)
+{
+    const trace_step_t trace[] = {
+        {1000, 1, true, 1, false},
+        {1005, 2, true, 1, false},
+        {1010, 2, false, 2, false},
+        {1020, 1, true, 2, true},
+        {1030, 2, true, 3, false},
+    };
+    replay(trace, sizeof(trace) / sizeof(trace[0]));
+    check_stats(2, 1, 1, 1);
+}
+
+// The window is measured from the accepted command, not the last duplicate
+static void boot_window_edges(void)
+{
+    const trace_step_t trace[] = {
+        {1000, 1, true, 1, false},
+        {1000 + WINDOW_MS - 1, 1, true, 2, true},
+        {1000 + WINDOW_MS, 1, true, 3, false},
+        {1000 + 2 * WINDOW_MS - 1, 1, true, 1, true},
+    };
+    replay(trace, sizeof(trace) / sizeof(trace[0]));
+    check_stats(3, 1, 0, 0);
+}
+
+// A steady stream of distinct fabrics' automations cycles through the whole table
+static void boot_table_wrap(void)
+{
+    for (uint32_t i = 0; i < 4 * APP_DEDUPE_TABLE_SIZE; i++) {
+        int64_t now_us = (int64_t)i * 10 * 1000;
+        uint16_t endpoint_id = (uint16_t)(i % (2 * APP_DEDUPE_TABLE_SIZE));
+        CHECK(!app_dedupe_check(endpoint_id, true, now_us));
+        app_dedupe_commit(1);
+    }
+    check_stats(1, 4 * APP_DEDUPE_TABLE_SIZE, 0, 0);
+}
+
+// Commands that never reached the attribute callback, and fabric indexes out of range
+static void boot_unchanged_and_bounds(void)
+{
+    app_dedupe_commit(4);
+    app_dedupe_commit(4);
+    app_dedupe_fabric_stats_t stats;
+    app_dedupe_get_stats(4, &stats);
+    CHECK_EQ(stats.unchanged, 2);
+
+    CHECK(!app_dedupe_check(1, true, 0));
+    app_dedupe_commit(APP_DEDUPE_MAX_FABRICS + 3);
+    check_stats(0, 1, 0, 0);
+
+    app_dedupe_get_stats(APP_DEDUPE_MAX_FABRICS, &stats);
+    CHECK_EQ(stats.accepted, 0);
+}
+
+#define BOOT_CASE(fn)                                                                          \
+    static void fn(void) { CHECK_EQ(host_boot(boot_##fn), 0); }
+
+BOOT_CASE(same_automation_three_fabrics)
+BOOT_CASE(same_fabric_repeat)
+BOOT_CASE(opposite_value_invalidates)
+BOOT_CASE(endpoints_independent)
+BOOT_CASE(window_edges)
+BOOT_CASE(table_wrap)
+BOOT_CASE(unchanged_and_bounds)
+
+int main(void)
+{
+    // Every case runs in its own process so the dedupe table starts empty
+    RUN_TEST(same_automation_three_fabrics);
+    RUN_TEST(same_fabric_repeat);
+    RUN_TEST(opposite_value_invalidates);
+    RUN_TEST(endpoints_independent);
+    RUN_TEST(window_edges);
+    RUN_TEST(table_wrap);
+    RUN_TEST(unchanged_and_bounds);
+    return TEST_EXIT();
+}
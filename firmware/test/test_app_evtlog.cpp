@@ -0,0 +1,260 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_evtlog on emulated NOR flash: write amplification of batched commits, ring wrap-around,
+// and crash consistency with the power cut at every point of a run of flushes.
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "app_evtlog.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define PARTITION_SIZE      0x10000
+#define SECTORS             (PARTITION_SIZE / 4096)
+#define RECORD_SIZE         12
+#define HEADER_SIZE         16
+#define RECORDS_PER_SECTOR  ((4096 - HEADER_SIZE) / RECORD_SIZE)
+#define BATCH               CONFIG_SKULL_EVTLOG_FLUSH_THRESHOLD
+#define CONTINUE_RECORDS    (RECORDS_PER_SECTOR + BATCH)
+
+// Shared with the forked boots
+typedef struct {
+    uint32_t appended;      // records the boot accepted, its BOOT record included
+    uint32_t committed;     // of those, how many a successful flush acknowledged
+    uint32_t recovered;     // valid records a later boot read back
+    uint16_t boot;          // boot number the later boot was given
+} shared_t;
+
+static shared_t *s_shared;
+
+// Appends and commits the way the log task does once the threshold is reached
+static void append_batches(uint32_t records)
+{
+    for (uint32_t i = 0; i < records; i++) {
+        app_evtlog_append(APP_EVTLOG_TRIGGER, APP_EVTLOG_SRC_MATTER, (uint16_t)i);
+        s_shared->appended++;
+        host_advance_us(1000);
+        if ((i + 1) % BATCH == 0 || i + 1 == records) {
+            if (app_evtlog_flush() == ESP_OK) {
+                s_shared->committed = s_shared->appended;
+            }
+        }
+    }
+}
+
+static void boot_and_write(void)
+{
+    s_shared->appended = 1; // the BOOT record init commits
+    s_shared->committed = 0;
+    CHECK_EQ(app_evtlog_init(), ESP_OK);
+    s_shared->committed = 1;
+    append_batches(RECORDS_PER_SECTOR + 3 * BATCH);
+}
+
+static void boot_and_count(void)
+{
+    CHECK_EQ(app_evtlog_init(), ESP_OK);
+    app_evtlog_stats_t stats;
+    app_evtlog_get_stats(&stats);
+    // This boot's own BOOT record is part of the dump
+    s_shared->recovered = app_evtlog_dump() - 1;
+    s_shared->boot = 0;
+    CHECK_EQ(stats.appended, 1);
+}
+
+// Fills more than a sector, so the next sector has to be opened on top of whatever the crash left
+static void boot_and_continue(void)
+{
+    CHECK_EQ(app_evtlog_init(), ESP_OK);
+    s_shared->appended = s_shared->committed = 1;
+    append_batches(CONTINUE_RECORDS);
+    CHECK_EQ(s_shared->committed, s_shared->appended);
+}
+
+static void test_write_amplification(void)
+{
+    host_flash_format("evtlog");
+    CHECK_EQ(host_boot([] {
+        CHECK_EQ(app_evtlog_init(), ESP_OK);
+        // 2000 events in threshold-sized batches: every event byte is written once, plus one
+        // 16-byte header and one erase per sector filled
+        const uint32_t events = 2000;
+        for (uint32_t i = 0; i < events; i++) {
+            app_evtlog_append(APP_EVTLOG_TRIGGER, APP_EVTLOG_SRC_CONSOLE, (uint16_t)i);
+            if ((i + 1) % BATCH == 0) {
+                CHECK_EQ(app_evtlog_flush(), ESP_OK);
+            }
+        }
+        CHECK_EQ(app_evtlog_flush(), ESP_OK);
+
+        uint32_t records = events + 1;
+        uint32_t sectors = (records + RECORDS_PER_SECTOR - 1) / RECORDS_PER_SECTOR;
+        host_flash_stats_t flash = host_flash_stats("evtlog");
+        CHECK_EQ(flash.bytes_written, (uint64_t)records * RECORD_SIZE + sectors * HEADER_SIZE);
+        CHECK_EQ(flash.erases, sectors);
+        double amplification = (double)flash.bytes_written / (records * RECORD_SIZE);
+        printf("write amplification %.4f, %u erases for %u records\n", amplification, flash.erases, records);
+        CHECK(amplification < 1.01);
+        // One program operation per batch, two more when a batch spans a sector boundary
+        uint32_t batches = events / BATCH + 2;
+        CHECK(flash.writes <= batches + 3 * sectors);
+
+        app_evtlog_stats_t stats;
+        app_evtlog_get_stats(&stats);
+        CHECK_EQ(stats.bytes_written, flash.bytes_written);
+        CHECK_EQ(stats.erases, flash.erases);
+        CHECK_EQ(stats.dropped, 0);
+    }), 0);
+}
+
+static void test_threshold_wakes_log_task(void)
+{
+    host_flash_format("evtlog");
+    CHECK_EQ(host_boot([] {
+        CHECK_EQ(app_evtlog_init(), ESP_OK);
+        uint32_t writes = host_flash_stats("evtlog").writes;
+        for (uint32_t i = 0; i < BATCH - 1; i++) {
+            app_evtlog_append(APP_EVTLOG_PIR_EDGE, 0, i & 1);
+        }
+        CHECK_EQ(host_task_notifies(), 0);
+        // From an ISR as well; appending never touches flash itself
+        host_set_isr_context(true);
+        app_evtlog_append(APP_EVTLOG_PIR_EDGE, 0, 1);
+        app_evtlog_append(APP_EVTLOG_PIR_EDGE, 0, 0);
+        host_set_isr_context(false);
+        CHECK_EQ(host_task_notifies(), 1);
+        CHECK_EQ(host_flash_stats("evtlog").writes, writes);
+        // A full buffer drops and counts instead of blocking
+        for (uint32_t i = 0; i < CONFIG_SKULL_EVTLOG_BUFFER_RECORDS; i++) {
+            app_evtlog_append(APP_EVTLOG_PIR_EDGE, 0, 1);
+        }
+        app_evtlog_stats_t stats;
+        app_evtlog_get_stats(&stats);
+        CHECK_EQ(stats.dropped, BATCH + 1);
+        CHECK_EQ(app_evtlog_flush(), ESP_OK);
+        CHECK_EQ(host_flash_stats("evtlog").writes, writes + 1);
+    }), 0);
+}
+
+static void test_ring_wraps_and_boots_count_up(void)
+{
+    host_flash_format("evtlog");
+    for (int boot = 1; boot <= 3; boot++) {
+        CHECK_EQ(host_boot([] {
+            CHECK_EQ(app_evtlog_init(), ESP_OK);
+            // More than the whole ring each boot
+            for (uint32_t i = 0; i < SECTORS * RECORDS_PER_SECTOR + 100; i++) {
+                app_evtlog_append(APP_EVTLOG_TRIGGER, APP_EVTLOG_SRC_MOTION, (uint16_t)i);
+                if ((i + 1) % BATCH == 0) {
+                    app_evtlog_flush();
+                }
+            }
+            app_evtlog_flush();
+        }), 0);
+    }
+    CHECK_EQ(host_boot([] {
+        CHECK_EQ(app_evtlog_init(), ESP_OK);
+        uint32_t printed = app_evtlog_dump();
+        // Everything but the sector that is about to be erased next is readable
+        CHECK(printed >= (SECTORS - 1) * RECORDS_PER_SECTOR);
+        CHECK(printed <= SECTORS * RECORDS_PER_SECTOR);
+    }, true), 0);
+    // Boot numbers come from the records, so the 4th boot logs itself as boot 4
+    const uint8_t *flash = host_flash_data("evtlog");
+    uint16_t newest_boot = 0;
+    for (uint32_t sector = 0; sector < SECTORS; sector++) {
+        for (uint32_t slot = 0; slot < RECORDS_PER_SECTOR; slot++) {
+            const uint8_t *record = flash + sector * 4096 + HEADER_SIZE + slot * RECORD_SIZE;
+            uint16_t boot;
+            memcpy(&boot, record + 4, sizeof(boot));
+            if (boot != 0xFFFF && boot > newest_boot) {
+                newest_boot = boot;
+            }
+        }
+    }
+    CHECK_EQ(newest_boot, 4);
+}
+
+// Cuts the power at `cut` and checks what the next two boots make of the log
+static bool crash_case(int64_t cut_bytes, int64_t cut_erase)
+{
+    host_flash_format("evtlog");
+    memset(s_shared, 0, sizeof(*s_shared));
+    host_flash_cut_power_after(cut_bytes);
+    host_flash_cut_power_in_erase(cut_erase);
+    int result = host_boot(boot_and_write, true);
+    host_flash_cut_power_after(-1);
+    host_flash_cut_power_in_erase(-1);
+    if (result != HOST_EXIT_POWER_CUT) {
+        return false; // ran to completion: the sweep is past the end
+    }
+    shared_t written = *s_shared;
+
+    // The next boot must mount the log and find every acknowledged record, and no more than
+    // were appended
+    CHECK_EQ(host_boot(boot_and_count, true), 0);
+    uint32_t recovered = s_shared->recovered;
+    if (recovered < written.committed || recovered > written.appended) {
+        printf("power cut at byte %lld / erase %lld: %u recovered, %u committed, %u appended\n",
+               (long long)cut_bytes, (long long)cut_erase, recovered, written.committed, written.appended);
+        s_test_failures++;
+    }
+
+    // And the log keeps working: two more boots that each open a new sector lose nothing
+    CHECK_EQ(host_boot(boot_and_continue, true), 0);
+    CHECK_EQ(host_boot(boot_and_continue, true), 0);
+    CHECK_EQ(host_boot(boot_and_count, true), 0);
+    uint32_t expected = recovered + 1 + 2 * (1 + CONTINUE_RECORDS);
+    if (s_shared->recovered != expected) {
+        printf("power cut at byte %lld / erase %lld: log did not continue (%u recovered, then %u of %u)\n",
+               (long long)cut_bytes, (long long)cut_erase, recovered, s_shared->recovered, expected);
+        s_test_failures++;
+    }
+    return true;
+}
+
+static void test_power_cut_during_writes(void)
+{
+    int cases = 0;
+    // Every byte of the sector headers and of the records around them, every 7th elsewhere
+    const int64_t sector_open = HEADER_SIZE + RECORDS_PER_SECTOR * RECORD_SIZE;
+    for (int64_t cut = 0; crash_case(cut, -1); cut++) {
+        cases++;
+        bool near_header = cut < 4 * HEADER_SIZE || (cut >= sector_open - 2 * RECORD_SIZE &&
+                                                     cut < sector_open + 4 * HEADER_SIZE);
+        if (!near_header) {
+            cut += 6;
+        }
+    }
+    printf("%d power cuts during writes\n", cases);
+    CHECK(cases > (int)(RECORDS_PER_SECTOR * RECORD_SIZE / 7));
+}
+
+static void test_power_cut_during_erase(void)
+{
+    int cases = 0;
+    for (int64_t nth = 0; crash_case(-1, nth); nth++) {
+        cases++;
+    }
+    // The first format and the sector opened when the first one fills
+    CHECK_EQ(cases, 2);
+}
+
+int main(void)
+{
+    s_shared = (shared_t *)mmap(NULL, sizeof(shared_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    host_flash_add_partition("evtlog", PARTITION_SIZE);
+    RUN_TEST(test_write_amplification);
+    RUN_TEST(test_threshold_wakes_log_task);
+    RUN_TEST(test_ring_wraps_and_boots_count_up);
+    RUN_TEST(test_power_cut_during_writes);
+    RUN_TEST(test_power_cut_during_erase);
+    return TEST_EXIT();
+}
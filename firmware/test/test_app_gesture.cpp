@@ -0,0 +1,242 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_gesture against button waveforms driven through the GPIO ISR with the Kconfig default
+// timings: clicks, long presses, contact bounce, and a full timer queue on the edge, gap and
+// long-press hand-offs.
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include <vector>
+
+#include "app_gesture.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define BUTTON_GPIO     CONFIG_SKULL_BUTTON_GPIO
+#define DEBOUNCE_MS     CONFIG_SKULL_BUTTON_DEBOUNCE_MS
+#define GAP_MS          CONFIG_SKULL_BUTTON_CLICK_GAP_MS
+#define LONG_MS         CONFIG_SKULL_BUTTON_LONG_PRESS_MS
+#define SETTLE_MS       (DEBOUNCE_MS + 1)
+#define TICK_US         (portTICK_PERIOD_MS * 1000)
+#define BOOT_US         (1000 * 1000)   // waveform time 0; esp_timer time 0 never follows a boot
+
+typedef enum {
+    EV_PRESS,
+    EV_RELEASE,
+    EV_FAIL_PENDS,  // the next value hand-offs to the timer task find its queue full
+} wave_event_type_t;
+
+typedef struct {
+    int64_t at_us;
+    wave_event_type_t type;
+    int value;
+} wave_event_t;
+
+typedef struct {
+    int64_t at_us;
+    app_gesture_t gesture;
+    int64_t press_us;
+} dispatch_t;
+
+typedef struct {
+    const char *name;
+    std::vector<wave_event_t> events;
+    std::vector<dispatch_t> expected;
+    uint32_t pend_retries;
+} waveform_t;
+
+static std::vector<dispatch_t> s_dispatched;
+static const waveform_t *s_wave;
+
+static void gesture_cb(app_gesture_t gesture, int64_t press_us, void *user_data)
+{
+    s_dispatched.push_back({esp_timer_get_time() - BOOT_US, gesture, press_us - BOOT_US});
+}
+
+static void boot_play_waveform(void)
+{
+    const waveform_t &wave = *s_wave;
+    // Active low with the pull-up, like the BOOT button
+    host_gpio_input(BUTTON_GPIO, 1);
+    app_gesture_config_t config = {
+        .gpio_num = BUTTON_GPIO,
+        .active_level = 0,
+        .debounce_ms = DEBOUNCE_MS,
+        .click_gap_ms = GAP_MS,
+        .long_press_ms = LONG_MS,
+        .cb = gesture_cb,
+    };
+    CHECK_EQ(app_gesture_init(&config), ESP_OK);
+
+    for (const wave_event_t &event : wave.events) {
+        host_advance_us(BOOT_US + event.at_us - esp_timer_get_time());
+        switch (event.type) {
+        case EV_PRESS:
+            host_gpio_input(BUTTON_GPIO, 0);
+            break;
+        case EV_RELEASE:
+            host_gpio_input(BUTTON_GPIO, 1);
+            break;
+        case EV_FAIL_PENDS:
+            host_fail_pends(event.value);
+            break;
+        }
+    }
+    host_advance_us(10 * 1000 * 1000);
+
+    CHECK_EQ(s_dispatched.size(), wave.expected.size());
+    uint32_t counts[APP_GESTURE_COUNT] = {};
+    for (size_t i = 0; i < s_dispatched.size() && i < wave.expected.size(); i++) {
+        const dispatch_t &got = s_dispatched[i];
+        const dispatch_t &want = wave.expected[i];
+        if (got.at_us != want.at_us || got.gesture != want.gesture || got.press_us != want.press_us) {
+            printf("  dispatch %zu: %s at %lld us (press %lld us), expected %s at %lld us (press %lld us)\n", i,
+                   app_gesture_name(got.gesture), (long long)got.at_us, (long long)got.press_us,
+                   app_gesture_name(want.gesture), (long long)want.at_us, (long long)want.press_us);
+            CHECK(false);
+        }
+        counts[want.gesture]++;
+    }
+
+    for (int i = 0; i < APP_GESTURE_COUNT; i++) {
+        app_gesture_stats_t stats;
+        CHECK_EQ(app_gesture_get_stats((app_gesture_t)i, &stats), ESP_OK);
+        CHECK_EQ(stats.count, counts[i]);
+    }
+    if (!wave.expected.empty()) {
+        // The latency recorded is first press to dispatch
+        const dispatch_t &last = wave.expected.back();
+        app_gesture_stats_t stats;
+        app_gesture_get_stats(last.gesture, &stats);
+        CHECK_EQ(stats.last_latency_us, (uint32_t)(last.at_us - last.press_us));
+    }
+    CHECK_EQ(app_gesture_pend_retries(), wave.pend_retries);
+    CHECK_EQ(host_active_timers(), 0);
+}
+
+#define MS(ms) ((int64_t)(ms) * 1000)
+
+static const waveform_t s_waveforms[] = {
+    {
+        "single click",
+        {{0, EV_PRESS}, {MS(100), EV_RELEASE}},
+        {{MS(100 + GAP_MS), APP_GESTURE_SINGLE, 0}},
+    },
+    {
+        "double click",
+        {{0, EV_PRESS}, {MS(100), EV_RELEASE}, {MS(250), EV_PRESS}, {MS(350), EV_RELEASE}},
+        {{MS(350 + GAP_MS), APP_GESTURE_DOUBLE, 0}},
+    },
+    {
+        // Nothing longer to wait for: dispatched on the last release
+        "triple click",
+        {{0, EV_PRESS}, {MS(100), EV_RELEASE}, {MS(200), EV_PRESS}, {MS(300), EV_RELEASE}, {MS(400), EV_PRESS},
+         {MS(500), EV_RELEASE}},
+        {{MS(500), APP_GESTURE_TRIPLE, 0}},
+    },
+    {
+        "long press",
+        {{0, EV_PRESS}, {MS(LONG_MS + 1000), EV_RELEASE}},
+        {{MS(LONG_MS), APP_GESTURE_LONG_HOLD, 0}, {MS(LONG_MS + 1000), APP_GESTURE_LONG_PRESS, 0}},
+    },
+    {
+        // A long press ends the gesture, whatever clicks came before it
+        "click then long press",
+        {{0, EV_PRESS}, {MS(100), EV_RELEASE}, {MS(250), EV_PRESS}, {MS(LONG_MS + 1000), EV_RELEASE}},
+        {{MS(250 + LONG_MS), APP_GESTURE_LONG_HOLD, MS(250)}, {MS(LONG_MS + 1000), APP_GESTURE_LONG_PRESS, MS(250)}},
+    },
+    {
+        // The bounce is dropped and the settle sample finds the button still pressed
+        "bounce on press",
+        {{0, EV_PRESS}, {MS(5), EV_RELEASE}, {MS(10), EV_PRESS}, {MS(200), EV_RELEASE}},
+        {{MS(200 + GAP_MS), APP_GESTURE_SINGLE, 0}},
+    },
+    {
+        // The release lands inside the debounce; only the settle sample sees it, so the button
+        // cannot be left looking held
+        "release inside debounce",
+        {{0, EV_PRESS}, {MS(10), EV_RELEASE}},
+        {{MS(10 + SETTLE_MS + GAP_MS), APP_GESTURE_SINGLE, 0}},
+    },
+    {
+        // The ISR's hand-off fails; the press waits in the ring with its ISR timestamp
+        "edge hand-off retried",
+        {{0, EV_FAIL_PENDS, 1}, {0, EV_PRESS}, {MS(100), EV_RELEASE}},
+        {{MS(100 + GAP_MS), APP_GESTURE_SINGLE, 0}},
+        1,
+    },
+    {
+        "gap hand-off retried",
+        {{0, EV_PRESS}, {MS(100), EV_RELEASE}, {MS(200), EV_FAIL_PENDS, 2}},
+        {{MS(100 + GAP_MS) + 2 * TICK_US, APP_GESTURE_SINGLE, 0}},
+        2,
+    },
+    {
+        "long hand-off retried",
+        {{0, EV_PRESS}, {MS(2000), EV_FAIL_PENDS, 1}, {MS(LONG_MS + 1000), EV_RELEASE}},
+        {{MS(LONG_MS) + TICK_US, APP_GESTURE_LONG_HOLD, 0}, {MS(LONG_MS + 1000), APP_GESTURE_LONG_PRESS, 0}},
+        1,
+    },
+    {
+        // A press is stuck in the ring when the gap expires: it still counts as the second click
+        "press racing the gap",
+        {{0, EV_PRESS}, {MS(100), EV_RELEASE}, {MS(100 + GAP_MS - 2), EV_FAIL_PENDS, 1},
+         {MS(100 + GAP_MS - 2), EV_PRESS}, {MS(500), EV_RELEASE}},
+        {{MS(500 + GAP_MS), APP_GESTURE_DOUBLE, 0}},
+        1,
+    },
+};
+
+static void test_waveforms(void)
+{
+    for (const waveform_t &wave : s_waveforms) {
+        host_reset();
+        s_wave = &wave;
+        int result = host_boot(boot_play_waveform);
+        printf("  %-26s %s\n", wave.name, result == 0 ? "ok" : "FAILED");
+        CHECK_EQ(result, 0);
+    }
+}
+
+// Configs the module must refuse, and a second init
+static void boot_init_checks(void)
+{
+    app_gesture_config_t config = {
+        .gpio_num = -1,
+        .active_level = 0,
+        .debounce_ms = DEBOUNCE_MS,
+        .click_gap_ms = GAP_MS,
+        .long_press_ms = LONG_MS,
+    };
+    CHECK_EQ(app_gesture_init(&config), ESP_ERR_INVALID_ARG);
+    config.gpio_num = BUTTON_GPIO;
+    config.click_gap_ms = 0;
+    CHECK_EQ(app_gesture_init(&config), ESP_ERR_INVALID_ARG);
+    config.click_gap_ms = LONG_MS;
+    CHECK_EQ(app_gesture_init(&config), ESP_ERR_INVALID_ARG);
+    config.click_gap_ms = GAP_MS;
+    CHECK_EQ(app_gesture_init(&config), ESP_OK);
+    CHECK_EQ(app_gesture_init(&config), ESP_ERR_INVALID_STATE);
+
+    app_gesture_stats_t stats;
+    CHECK_EQ(app_gesture_get_stats(APP_GESTURE_COUNT, &stats), ESP_ERR_INVALID_ARG);
+}
+
+static void test_init_checks(void)
+{
+    CHECK_EQ(host_boot(boot_init_checks), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_waveforms);
+    RUN_TEST(test_init_checks);
+    return TEST_EXIT();
+}
@@ -0,0 +1,149 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_heap: the timeline keeps the first sample of each name, and the post-commissioning check
+// passes on the reclaim CONFIG_SKULL_HEAP_RECLAIM_MIN_KB asks for and fails one byte short of
+// it, when the teardown gives nothing back, or when the heap shrinks.
+
+#include <vector>
+
+#include "app_heap.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define MIN_RECLAIM     (CONFIG_SKULL_HEAP_RECLAIM_MIN_KB * 1024)
+#define KB(kb)          ((uint32_t)(kb) * 1024)
+
+typedef struct {
+    const char *name;
+    uint32_t free;
+} step_t;
+
+// The boot and commissioning sequence of app_main, with "ble released" freeing `reclaimed`
+static std::vector<step_t> commissioning(int32_t reclaimed)
+{
+    return {
+        {"boot", KB(240)},
+        {"console", KB(236)},
+        {"peripherals", KB(230)},
+        {"matter started", KB(118)},
+        {"commissioned", KB(96)},
+        {"ble released", (uint32_t)(KB(96) + reclaimed)},
+    };
+}
+
+static void play(const std::vector<step_t> &steps)
+{
+    for (const step_t &step : steps) {
+        host_heap_set(step.free, step.free / 2);
+        host_advance_us(250 * 1000);
+        app_heap_mark(step.name);
+    }
+}
+
+typedef struct {
+    const char *name;
+    int32_t reclaimed;
+    esp_err_t expected;
+} reclaim_case_t;
+
+static const reclaim_case_t s_cases[] = {
+    {"NimBLE released", 62 * 1024, ESP_OK},
+    {"exactly the minimum", MIN_RECLAIM, ESP_OK},
+    {"one byte short", MIN_RECLAIM - 1, ESP_ERR_INVALID_SIZE},
+    {"half the minimum", MIN_RECLAIM / 2, ESP_ERR_INVALID_SIZE},
+    {"BLE kept", 0, ESP_ERR_INVALID_SIZE},
+    {"heap shrank", -2048, ESP_ERR_INVALID_SIZE},
+};
+
+static void boot_reclaim_case(const reclaim_case_t &c)
+{
+    play(commissioning(c.reclaimed));
+    int32_t gain = 0x7777;
+    esp_err_t err = app_heap_check_gain("commissioned", "ble released", MIN_RECLAIM, &gain);
+    if (err != c.expected || gain != c.reclaimed) {
+        printf("  %s: %s, %ld bytes\n", c.name, esp_err_to_name(err), (long)gain);
+    }
+    CHECK_EQ(err, c.expected);
+    CHECK_EQ(gain, c.reclaimed);
+}
+
+static const reclaim_case_t *s_case;
+
+static void boot_current_case(void)
+{
+    boot_reclaim_case(*s_case);
+}
+
+static void test_reclaim_check(void)
+{
+    for (const reclaim_case_t &c : s_cases) {
+        s_case = &c;
+        int result = host_boot(boot_current_case);
+        printf("  %-22s %s\n", c.name, result == 0 ? "ok" : "FAILED");
+        CHECK_EQ(result, 0);
+    }
+}
+
+// A boot that finds fabrics never marks "commissioned": nothing to check
+static void boot_already_commissioned(void)
+{
+    play({{"boot", KB(240)}, {"matter started", KB(118)}, {"ble released", KB(180)}});
+    int32_t gain = 0x7777;
+    CHECK_EQ(app_heap_check_gain("commissioned", "ble released", MIN_RECLAIM, &gain), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(gain, 0x7777);
+    CHECK_EQ(app_heap_check_gain("boot", "ble released", KB(60), NULL), ESP_ERR_INVALID_SIZE);
+}
+
+static void test_already_commissioned(void)
+{
+    CHECK_EQ(host_boot(boot_already_commissioned), 0);
+}
+
+// The first sample of a name is the one kept; the timeline holds APP_HEAP_MAX_MARKS names
+static void boot_timeline(void)
+{
+    host_heap_set(KB(200), KB(150));
+    app_heap_mark_t mark;
+    app_heap_mark("boot", &mark);
+    CHECK_EQ(mark.free, KB(200));
+    CHECK_EQ(mark.largest, KB(150));
+    host_heap_set(KB(120), KB(100));
+    host_heap_set(KB(190), KB(90));
+    host_advance_us(1500 * 1000);
+    app_heap_mark("boot", &mark);
+    CHECK_EQ(mark.free, KB(190));
+    CHECK_EQ(mark.min_free, KB(120));
+    CHECK_EQ(mark.time_ms, 1500);
+
+    CHECK_EQ(app_heap_find("boot", &mark), ESP_OK);
+    CHECK_EQ(mark.free, KB(200));
+    CHECK_EQ(mark.time_ms, 0);
+    CHECK_EQ(app_heap_find("console", &mark), ESP_ERR_NOT_FOUND);
+
+    static const char *const names[] = {"m1", "m2", "m3", "m4", "m5", "m6", "m7", "m8", "m9", "m10", "m11", "m12"};
+    for (const char *name : names) {
+        app_heap_mark(name);
+    }
+    CHECK_EQ(app_heap_find(names[APP_HEAP_MAX_MARKS - 2], &mark), ESP_OK);
+    CHECK_EQ(app_heap_find(names[APP_HEAP_MAX_MARKS - 1], &mark), ESP_ERR_NOT_FOUND);
+    app_heap_dump();
+}
+
+static void test_timeline(void)
+{
+    CHECK_EQ(host_boot(boot_timeline), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_reclaim_check);
+    RUN_TEST(test_already_commissioned);
+    RUN_TEST(test_timeline);
+    return TEST_EXIT();
+}
@@ -0,0 +1,273 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_identify on the status channel next to the signal line: a trigger landing anywhere in any
+// effect starts its pulse within one tick and keeps its width, takes the LED over, and the
+// effect comes back once the LED pulse ends, unless Identify was stopped meanwhile. Also the
+// effect lengths, FINISH and STOP.
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include "app_identify.h"
+#include "app_output.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define SIGNAL_GPIO     CONFIG_SKULL_SIGNAL_GPIO
+#define STATUS_GPIO     CONFIG_SKULL_STATUS_LED_GPIO
+#define PULSE_US        (CONFIG_SKULL_PULSE_DURATION_MS * 1000)
+#define TICK_US         (portTICK_PERIOD_MS * 1000)
+#define BOOT_US         (1000 * 1000)
+#define MS(ms)          ((int64_t)(ms) * 1000)
+
+// Mirrors app_main: the status channel's done callback drives the effect repeats
+static void status_done_cb(app_output_channel_t channel, void *user_data)
+{
+    app_identify_handle_done();
+}
+
+static void init_channels(void)
+{
+    app_output_config_t signal = {.gpio_num = SIGNAL_GPIO};
+    CHECK_EQ(app_output_init(APP_OUTPUT_CHANNEL_SIGNAL, &signal), ESP_OK);
+    // On the RMT build the status LED is the channel that falls back to the GPIO sequencer
+    host_rmt_fail_new_channel(true);
+    app_output_config_t status = {.gpio_num = STATUS_GPIO, .done_cb = status_done_cb};
+    CHECK_EQ(app_output_init(APP_OUTPUT_CHANNEL_STATUS, &status), ESP_OK);
+    host_rmt_fail_new_channel(false);
+    CHECK_EQ(app_identify_init(APP_OUTPUT_CHANNEL_STATUS), ESP_OK);
+    host_advance_us(BOOT_US);
+}
+
+// The output half of start_trigger(): the signal line first, then the LED is taken over
+static void trigger(void)
+{
+    CHECK_EQ(app_output_pulse(APP_OUTPUT_CHANNEL_SIGNAL, PULSE_US), ESP_OK);
+    app_identify_preempt();
+    app_output_stop(APP_OUTPUT_CHANNEL_STATUS);
+    app_output_pulse(APP_OUTPUT_CHANNEL_STATUS, PULSE_US);
+}
+
+// Time the signal line went high at or after since_us, -1 if it did not
+static int64_t signal_rise_at(int64_t since_us)
+{
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    for (const host_rmt_transmit_t &transmit : host_rmt_transmits()) {
+        if (transmit.time_us >= since_us) {
+            return transmit.time_us;
+        }
+    }
+#else
+    for (const host_edge_t &edge : host_gpio_edges()) {
+        if (edge.gpio_num == SIGNAL_GPIO && edge.level == 1 && edge.time_us >= since_us) {
+            return edge.time_us;
+        }
+    }
+#endif
+    return -1;
+}
+
+// Status LED edges recorded after the first `skip` edges
+static std::vector<host_edge_t> status_edges(size_t skip)
+{
+    std::vector<host_edge_t> edges;
+    for (size_t i = skip; i < host_gpio_edges().size(); i++) {
+        if (host_gpio_edges()[i].gpio_num == STATUS_GPIO) {
+            edges.push_back(host_gpio_edges()[i]);
+        }
+    }
+    return edges;
+}
+
+typedef struct {
+    const char *name;
+    int effect_id;          // -1: app_identify_start()
+    int64_t length_us;      // how far into the effect triggers are sampled
+} effect_case_t;
+
+static const effect_case_t s_effects[] = {
+    {"identify", -1, MS(5000)},
+    {"blink", APP_IDENTIFY_EFFECT_BLINK, MS(1000)},
+    {"breathe", APP_IDENTIFY_EFFECT_BREATHE, MS(15 * 960)},
+    {"okay", APP_IDENTIFY_EFFECT_OKAY, MS(1000)},
+    {"channel change", APP_IDENTIFY_EFFECT_CHANNEL_CHANGE, MS(8000)},
+};
+
+// A trigger at every phase of every effect, including the done callbacks between repeats
+static void boot_trigger_during_effects(void)
+{
+    init_channels();
+    uint32_t rng = 1;
+    int64_t worst_us = 0;
+    int samples = 0;
+    for (const effect_case_t &effect : s_effects) {
+        for (int64_t offset_us = 0; offset_us < effect.length_us;) {
+            if (effect.effect_id < 0) {
+                CHECK_EQ(app_identify_start(), ESP_OK);
+            } else {
+                CHECK_EQ(app_identify_effect((uint8_t)effect.effect_id), ESP_OK);
+            }
+            host_advance_us(offset_us);
+            CHECK(app_identify_is_active());
+
+            int64_t request_us = esp_timer_get_time();
+            size_t edges_before = host_gpio_edges().size();
+            trigger();
+            CHECK(!app_identify_is_active());
+            host_advance_us(PULSE_US - 1);
+            CHECK(!app_identify_is_active());
+            // The LED pulse is done and the effect restarts the iteration it was cut in
+            host_advance_us(1);
+            CHECK(app_identify_is_active());
+            CHECK_EQ(host_gpio_level(STATUS_GPIO), 1);
+            app_identify_stop();
+            host_advance_us(MS(2000));
+
+            int64_t rise_us = signal_rise_at(request_us);
+            CHECK(rise_us >= request_us);
+            CHECK(rise_us - request_us <= TICK_US);
+            worst_us = rise_us - request_us > worst_us ? rise_us - request_us : worst_us;
+#if !CONFIG_SKULL_OUTPUT_BACKEND_RMT
+            CHECK_EQ(host_gpio_level(SIGNAL_GPIO), 0);
+            CHECK_EQ(host_gpio_edges().back().time_us - rise_us, PULSE_US);
+#endif
+
+            // The effect is cut (the LED may go off first), the LED shows the trigger, the effect
+            // comes back on at once and goes off with the stop
+            std::vector<host_edge_t> edges = status_edges(edges_before);
+            size_t on = !edges.empty() && edges[0].level == 0 ? 1 : 0;
+            CHECK_EQ(edges.size(), on + 4);
+            if (edges.size() == on + 4) {
+                CHECK(edges[on].level == 1 && edges[on].time_us == request_us);
+                CHECK(edges[on + 1].level == 0 && edges[on + 1].time_us == request_us + PULSE_US);
+                CHECK(edges[on + 2].level == 1 && edges[on + 2].time_us == request_us + PULSE_US);
+                CHECK(edges[on + 3].level == 0 && edges[on + 3].time_us == request_us + PULSE_US);
+            }
+            CHECK_EQ(host_gpio_level(STATUS_GPIO), 0);
+            CHECK(!app_identify_is_active());
+            host_gpio_clear_edges();
+            samples++;
+
+            rng = rng * 1103515245u + 12345u;
+            offset_us += MS(37) + (rng >> 8) % MS(250);
+        }
+    }
+    printf("  %d triggers, worst request to rising edge %lld us\n", samples, (long long)worst_us);
+}
+
+// Effects run their iterations and stop on their own; FINISH lets the iteration end, STOP cuts it
+static void boot_effect_lengths(void)
+{
+    init_channels();
+    const struct {
+        uint8_t effect_id;
+        int64_t length_us;
+    } lengths[] = {
+        {APP_IDENTIFY_EFFECT_BLINK, MS(1000)},
+        {APP_IDENTIFY_EFFECT_OKAY, MS(1000)},
+        {APP_IDENTIFY_EFFECT_CHANNEL_CHANGE, MS(8000)},
+        {APP_IDENTIFY_EFFECT_BREATHE, MS(15 * 960)},
+    };
+    for (auto &length : lengths) {
+        CHECK_EQ(app_identify_effect(length.effect_id), ESP_OK);
+        host_advance_us(length.length_us - 1);
+        CHECK(app_identify_is_active());
+        host_advance_us(1);
+        CHECK(!app_identify_is_active());
+        CHECK_EQ(host_gpio_level(STATUS_GPIO), 0);
+    }
+
+    CHECK_EQ(app_identify_start(), ESP_OK);
+    host_advance_us(MS(10250));
+    CHECK(app_identify_is_active());
+    CHECK_EQ(app_identify_effect(APP_IDENTIFY_EFFECT_FINISH), ESP_OK);
+    host_advance_us(MS(749));
+    CHECK(app_identify_is_active());
+    host_advance_us(MS(1));
+    CHECK(!app_identify_is_active());
+
+    CHECK_EQ(app_identify_effect(APP_IDENTIFY_EFFECT_BREATHE), ESP_OK);
+    host_advance_us(MS(100));
+    CHECK_EQ(app_identify_effect(APP_IDENTIFY_EFFECT_STOP), ESP_OK);
+    CHECK(!app_identify_is_active());
+    CHECK_EQ(host_gpio_level(STATUS_GPIO), 0);
+    CHECK_EQ(app_identify_effect(0x42), ESP_ERR_NOT_SUPPORTED);
+
+    // The signal line never moved
+    for (const host_edge_t &edge : host_gpio_edges()) {
+        CHECK(edge.gpio_num != SIGNAL_GPIO);
+    }
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    CHECK_EQ(host_rmt_transmits().size(), 0);
+#endif
+}
+
+// Identify ending during the trigger, a trigger stopped early, and FINISH while cut short
+static void boot_resume_after_trigger(void)
+{
+    init_channels();
+    CHECK_EQ(app_identify_start(), ESP_OK);
+    host_advance_us(MS(700));
+    trigger();
+    // IdentifyTime runs out while the LED shows the trigger
+    app_identify_stop();
+    host_advance_us(PULSE_US + MS(1000));
+    CHECK(!app_identify_is_active());
+    CHECK_EQ(host_gpio_level(STATUS_GPIO), 0);
+
+    // stop_pulse(): a stopped LED pulse has no done callback, so it resumes the effect itself
+    CHECK_EQ(app_identify_start(), ESP_OK);
+    host_advance_us(MS(200));
+    trigger();
+    host_advance_us(MS(50));
+    app_output_stop(APP_OUTPUT_CHANNEL_SIGNAL);
+    app_output_stop(APP_OUTPUT_CHANNEL_STATUS);
+    CHECK(!app_identify_is_active());
+    app_identify_resume();
+    CHECK(app_identify_is_active());
+    CHECK_EQ(host_gpio_level(STATUS_GPIO), 1);
+    // Nothing left to resume
+    app_identify_resume();
+    CHECK(app_identify_is_active());
+
+    // FINISH while the effect waits: the restarted iteration is its last
+    host_advance_us(MS(300));
+    trigger();
+    CHECK_EQ(app_identify_effect(APP_IDENTIFY_EFFECT_FINISH), ESP_OK);
+    host_advance_us(PULSE_US);
+    CHECK(app_identify_is_active());
+    host_advance_us(MS(1000) - 1);
+    CHECK(app_identify_is_active());
+    host_advance_us(1);
+    CHECK(!app_identify_is_active());
+    CHECK_EQ(host_gpio_level(STATUS_GPIO), 0);
+}
+
+static void test_trigger_during_effects(void)
+{
+    CHECK_EQ(host_boot(boot_trigger_during_effects), 0);
+}
+
+static void test_effect_lengths(void)
+{
+    CHECK_EQ(host_boot(boot_effect_lengths), 0);
+}
+
+static void test_resume_after_trigger(void)
+{
+    CHECK_EQ(host_boot(boot_resume_after_trigger), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_trigger_during_effects);
+    RUN_TEST(test_effect_lengths);
+    RUN_TEST(test_resume_after_trigger);
+    return TEST_EXIT();
+}
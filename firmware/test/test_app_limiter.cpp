@@ -0,0 +1,272 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_limiter under saturating command streams: the long-run rate a flood gets, the duty budget
+// against an exact sliding window, how competing streams on one channel share the tokens, and
+// isolation between channels.
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "app_limiter.h"
+#include "test_support.h"
+
+#define MINUTE_US   (60LL * 1000 * 1000)
+
+static app_limiter_config_t make_config(uint16_t burst, uint32_t refill_ms, uint32_t window_ms, uint8_t duty_pct)
+{
+    app_limiter_config_t config;
+    config.burst = burst;
+    config.refill_ms = refill_ms;
+    config.duty_window_ms = window_ms;
+    config.max_duty_pct = duty_pct;
+    return config;
+}
+
+// Deterministic arrival jitter, so streams with the same period do not phase-lock
+static uint32_t s_rng = 1;
+
+static int64_t jitter_us(int64_t max_us)
+{
+    s_rng = s_rng * 1103515245u + 12345u;
+    return (int64_t)((s_rng >> 8) % (uint32_t)max_us);
+}
+
+typedef struct {
+    int64_t period_us;
+    int64_t next_us;
+    uint32_t high_us;
+    uint32_t allowed;
+    uint32_t requests;
+} stream_t;
+
+// Runs the streams against one channel until end_us, always serving the earliest request next
+static void run_streams(app_output_channel_t channel, stream_t *streams, size_t count, int64_t end_us,
+                        uint8_t scale_pct = 100)
+{
+    for (;;) {
+        stream_t *next = NULL;
+        for (size_t i = 0; i < count; i++) {
+            if (!next || streams[i].next_us < next->next_us) {
+                next = &streams[i];
+            }
+        }
+        if (next->next_us >= end_us) {
+            return;
+        }
+        next->requests++;
+        if (app_limiter_acquire(channel, next->high_us, next->next_us, scale_pct) == APP_LIMITER_ALLOWED) {
+            next->allowed++;
+        }
+        next->next_us += next->period_us - next->period_us / 4 + jitter_us(next->period_us / 2);
+    }
+}
+
+// Whatever the flood rate, ten minutes of it get the burst plus one trigger per refill period
+static void test_saturating_stream_settles_at_refill_rate(void)
+{
+    const uint32_t rates_hz[] = {1, 5, 20, 100, 1000};
+    for (uint32_t rate_hz : rates_hz) {
+        app_limiter_config_t config = make_config(3, 2000, 60000, 25);
+        CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+        stream_t stream = {.period_us = 1000000 / rate_hz, .next_us = 0, .high_us = 200000};
+        run_streams(APP_OUTPUT_CHANNEL_SIGNAL, &stream, 1, 10 * MINUTE_US);
+
+        uint32_t expected = 3 + 10 * 60 / 2;
+        printf("  %4" PRIu32 " Hz: %" PRIu32 " of %" PRIu32 " accepted\n", rate_hz, stream.allowed, stream.requests);
+        CHECK(stream.allowed <= expected);
+        CHECK(stream.allowed + (rate_hz == 1 ? 10 : 1) >= expected);
+
+        app_limiter_stats_t stats;
+        app_limiter_get_stats(APP_OUTPUT_CHANNEL_SIGNAL, 10 * MINUTE_US, &stats);
+        CHECK_EQ(stats.allowed, stream.allowed);
+        CHECK_EQ(stats.rejected_rate, stream.requests - stream.allowed);
+        CHECK_EQ(stats.rejected_duty, 0);
+    }
+}
+
+// HIGH time charged inside any window never exceeds the budget. The ring drops a sub-window at
+// once, so the exact check covers pulses newer than the window minus one sub-window.
+static void test_duty_budget_holds_on_sliding_window(void)
+{
+    const uint32_t window_ms = 60000;
+    const int64_t bucket_us = (int64_t)window_ms * 1000 / 16;
+    const int64_t budget_us = (int64_t)window_ms * 1000 * 25 / 100;
+    app_limiter_config_t config = make_config(100, 100, window_ms, 25);
+    CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+
+    std::vector<std::pair<int64_t, uint32_t>> accepted;
+    int64_t total_high_us = 0;
+    int violations = 0;
+    for (int64_t now = 0; now < 30 * MINUTE_US; now += 100000 + jitter_us(100000)) {
+        uint32_t high_us = 50000 + (uint32_t)jitter_us(4950000);
+        if (app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, high_us, now) != APP_LIMITER_ALLOWED) {
+            continue;
+        }
+        accepted.push_back({now, high_us});
+        total_high_us += high_us;
+        int64_t in_window = 0;
+        for (auto it = accepted.rbegin(); it != accepted.rend() && it->first > now - (window_ms * 1000LL - bucket_us);
+             ++it) {
+            in_window += it->second;
+        }
+        if (in_window > budget_us) {
+            violations++;
+        }
+    }
+    CHECK_EQ(violations, 0);
+
+    // The flood still gets close to the budget it is allowed, not a fraction of it
+    int64_t allowed_us = budget_us * 30;
+    printf("  %zu pulses, %lld of %lld ms HIGH\n", accepted.size(), (long long)(total_high_us / 1000),
+           (long long)(allowed_us / 1000));
+    CHECK(total_high_us <= allowed_us + budget_us / 16);
+    CHECK(total_high_us * 10 >= allowed_us * 8);
+}
+
+// Two floods on one channel split the tokens by how often they ask: nobody is locked out and
+// the channel total stays at the refill rate
+static void test_competing_streams_share_by_rate(void)
+{
+    struct {
+        int64_t period_a_us;
+        int64_t period_b_us;
+        int share_min_pct;
+        int share_max_pct;
+    } cases[] = {
+        {50000, 50000, 40, 60},
+        {50000, 200000, 70, 90},
+        {10000, 1000000, 90, 100},
+    };
+    for (auto &c : cases) {
+        app_limiter_config_t config = make_config(3, 2000, 60000, 25);
+        CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+        stream_t streams[2] = {
+            {.period_us = c.period_a_us, .next_us = 0, .high_us = 100000},
+            {.period_us = c.period_b_us, .next_us = 1000, .high_us = 100000},
+        };
+        run_streams(APP_OUTPUT_CHANNEL_SIGNAL, streams, 2, 60 * MINUTE_US);
+
+        uint32_t total = streams[0].allowed + streams[1].allowed;
+        int share_a = (int)(streams[0].allowed * 100 / total);
+        printf("  %lld ms vs %lld ms: %" PRIu32 " / %" PRIu32 " accepted (%d%%)\n", (long long)(c.period_a_us / 1000),
+               (long long)(c.period_b_us / 1000), streams[0].allowed, streams[1].allowed, share_a);
+        CHECK(total <= 3 + 60 * 60 / 2);
+        CHECK(total + 1 >= 3 + 60 * 60 / 2);
+        CHECK(share_a >= c.share_min_pct);
+        CHECK(share_a <= c.share_max_pct);
+        CHECK(streams[1].allowed > 0);
+    }
+}
+
+// A flood on the signal line leaves the status channel's budget alone
+static void test_channels_are_isolated(void)
+{
+    app_limiter_config_t config = make_config(3, 2000, 60000, 25);
+    CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+    CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_STATUS, &config), ESP_OK);
+
+    uint32_t status_allowed = 0;
+    uint32_t status_requests = 0;
+    for (int64_t now = 0; now < 10 * MINUTE_US; now += 10000) {
+        app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 200000, now);
+        if (now % 2500000 == 0) {
+            status_requests++;
+            status_allowed += app_limiter_acquire(APP_OUTPUT_CHANNEL_STATUS, 200000, now) == APP_LIMITER_ALLOWED;
+        }
+    }
+    CHECK_EQ(status_allowed, status_requests);
+}
+
+// Once a flood stops, a normal trigger gets through within one refill period and the full
+// burst is back after burst refill periods
+static void test_recovery_after_flood(void)
+{
+    app_limiter_config_t config = make_config(3, 2000, 60000, 25);
+    CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+    int64_t now = 0;
+    for (; now < MINUTE_US; now += 20000) {
+        app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 100000, now);
+    }
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 100000, now + 2000000), APP_LIMITER_ALLOWED);
+
+    now += 2000000 + 3 * 2000000;
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 100000, now + i), APP_LIMITER_ALLOWED);
+    }
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 100000, now + 3), APP_LIMITER_REJECTED_RATE);
+}
+
+// Derating slows the refill in proportion, and the time before a change is credited at the old
+// scale
+static void test_scaled_flood(void)
+{
+    const uint8_t scales[] = {100, 50, 25, 0};
+    for (uint8_t scale_pct : scales) {
+        // A burst of two, so the refill lost while a full bucket waits for the next request
+        // does not blur the rate
+        app_limiter_config_t config = make_config(2, 1000, 60000, 100);
+        CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+        stream_t stream = {.period_us = 50000, .next_us = 0, .high_us = 10000};
+        run_streams(APP_OUTPUT_CHANNEL_SIGNAL, &stream, 1, 10 * MINUTE_US, scale_pct);
+        uint32_t expected = 2 + 600 * scale_pct / 100;
+        if (scale_pct == 0) {
+            expected = 0;   // the first request already runs at scale 0
+        }
+        printf("  %3u%%: %" PRIu32 " accepted\n", scale_pct, stream.allowed);
+        CHECK(stream.allowed <= expected + 1);
+        CHECK(stream.allowed + 1 >= expected);
+    }
+
+    app_limiter_config_t config = make_config(1, 1000, 60000, 100);
+    CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 1000, 0, 100), APP_LIMITER_ALLOWED);
+    // 600 ms at 100% then 800 ms at 50%: exactly one token
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 1000, 600000, 50), APP_LIMITER_REJECTED_RATE);
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 1000, 1399999, 50), APP_LIMITER_REJECTED_RATE);
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 1000, 1400000, 50), APP_LIMITER_ALLOWED);
+}
+
+// A trigger whose output failed to start gets its token and HIGH time back, and only those
+static void test_refund_of_a_failed_start(void)
+{
+    app_limiter_config_t config = make_config(2, 10000, 60000, 25);
+    CHECK_EQ(app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 10000000, 0), APP_LIMITER_ALLOWED);
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 5000000, 1000000), APP_LIMITER_ALLOWED);
+    app_limiter_refund(APP_OUTPUT_CHANNEL_SIGNAL, 5000000, 1000000);
+
+    app_limiter_stats_t stats;
+    app_limiter_get_stats(APP_OUTPUT_CHANNEL_SIGNAL, 1000000, &stats);
+    CHECK_EQ(stats.allowed, 1);
+    CHECK_EQ(stats.tokens, 1);
+    CHECK_EQ(stats.duty_permille, 166);
+    // Without the refund the second token and 5 s of the 15 s budget would be gone
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 5000000, 1000000), APP_LIMITER_ALLOWED);
+
+    // A refund for a charge that slid out of the window leaves the newer HIGH time alone
+    CHECK_EQ(app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, 1000000, 65000000), APP_LIMITER_ALLOWED);
+    app_limiter_refund(APP_OUTPUT_CHANNEL_SIGNAL, 1000000, 1000000);
+    app_limiter_get_stats(APP_OUTPUT_CHANNEL_SIGNAL, 65000000, &stats);
+    CHECK_EQ(stats.duty_permille, 16);
+    CHECK_EQ(stats.tokens, 2);
+}
+
+int main(void)
+{
+    RUN_TEST(test_saturating_stream_settles_at_refill_rate);
+    RUN_TEST(test_duty_budget_holds_on_sliding_window);
+    RUN_TEST(test_competing_streams_share_by_rate);
+    RUN_TEST(test_channels_are_isolated);
+    RUN_TEST(test_recovery_after_flood);
+    RUN_TEST(test_scaled_flood);
+    RUN_TEST(test_refund_of_a_failed_start);
+    return TEST_EXIT();
+}
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Run tools/uart_link.py against the firmware's controller link.
+
+The argument is the link_device host binary: app_link with acks on, its UART on a
+pseudo-terminal, driven a line at a time on stdin. This script plays the controller with
+uart_link.py's encoder and parser. Every frame the firmware sends has to match
+uart_link.encode() byte for byte, and the acks sent back, behind noise and a corrupted frame,
+have to be matched with the same bytes discarded as uart_link.Parser counts. Resends, giving
+up, and a STOP replacing an unacked PLAY are checked on the link's counters.
+"""
+
+import os
+import select
+import subprocess
+import sys
+import time
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+
+import uart_link  # noqa: E402
+
+# link_device.cpp's ack timeout; it allows one resend
+ACK_TIMEOUT_MS = 50
+PLAY_FRAME_LEN = len(uart_link.encode_play(0, 0))
+STOP_FRAME_LEN = len(uart_link.encode(0, uart_link.CMD_STOP))
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        failures += 1
+        print(f'FAIL {what}')
+
+
+class Device:
+    def __init__(self, binary):
+        self.proc = subprocess.Popen([binary], stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True)
+        self.path = self.proc.stdout.readline().strip()
+        self.seq = 0
+
+    def cmd(self, line):
+        self.proc.stdin.write(line + '\n')
+        self.proc.stdin.flush()
+        return self.proc.stdout.readline().strip()
+
+    def send(self, line):
+        """Queue a frame; returns the sequence number it went out with."""
+        check(self.cmd(line) == 'ESP_OK', f'{line} refused')
+        seq, self.seq = self.seq, (self.seq + 1) & 0xFF
+        return seq
+
+    def stats(self):
+        return {k: int(v) for k, v in (field.split('=') for field in self.cmd('stats').split())}
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait(timeout=5)
+
+
+def read_wire(fd, count, timeout=2.0):
+    """Up to count bytes the firmware wrote, or fewer if it goes quiet for timeout."""
+    data = b''
+    while len(data) < count and select.select([fd], [], [], timeout)[0]:
+        data += os.read(fd, count - len(data))
+    return data
+
+
+def ack(seq, cmd):
+    return uart_link.encode(seq, cmd | uart_link.ACK, b'\x00')
+
+
+def test_frames(device, fd):
+    before = device.stats()
+    # 0xA5 in the payload must not be taken for the start of a frame
+    for track, volume, effect in ((1, 200, 0), (0xA5A5, 0xA5, 0xA5), (65535, 0, 3)):
+        seq = device.send(f'play {track} {volume} {effect}')
+        wire = read_wire(fd, PLAY_FRAME_LEN)
+        check(wire == uart_link.encode_play(seq, track, volume, effect), f'PLAY {track}: {wire.hex()}')
+        parsed = uart_link.Parser().feed(wire)
+        check(len(parsed) == 1 and parsed[0][:2] == (seq, uart_link.CMD_PLAY), f'PLAY {track} parsed as {parsed}')
+        os.write(fd, ack(seq, uart_link.CMD_PLAY))
+        device.cmd('receive 100')
+    seq = device.send('stop')
+    wire = read_wire(fd, STOP_FRAME_LEN)
+    check(wire == uart_link.encode(seq, uart_link.CMD_STOP), f'STOP: {wire.hex()}')
+    os.write(fd, ack(seq, uart_link.CMD_STOP))
+    device.cmd('receive 100')
+
+    after = device.stats()
+    check(after['sent'] - before['sent'] == 4 and after['acked'] - before['acked'] == 4, f'counters {after}')
+    check(after['resent'] == after['superseded'] == after['rx_errors'] == 0, f'counters {after}')
+
+
+def test_resync(device, fd):
+    before = device.stats()
+    seq = device.send('play 7 200 1')
+    read_wire(fd, PLAY_FRAME_LEN)
+    bad = bytearray(ack(seq, uart_link.CMD_PLAY))
+    bad[4] ^= 0xFF
+    noise = b'\x00\xA5\xFF' + bytes(bad) + ack(seq, uart_link.CMD_PLAY)
+    model = uart_link.Parser()
+    check(model.feed(noise) == [(seq, uart_link.CMD_PLAY | uart_link.ACK, b'\x00')], 'model parse of the noise')
+    os.write(fd, noise)
+    device.cmd('receive 100')
+
+    after = device.stats()
+    check(after['acked'] == before['acked'] + 1, f'ack behind noise not matched: {after}')
+    check(after['rx_errors'] - before['rx_errors'] == model.errors,
+          f'{after["rx_errors"] - before["rx_errors"]} bytes discarded, uart_link.Parser counts {model.errors}')
+
+
+def test_resend_and_give_up(device, fd):
+    before = device.stats()
+    seq = device.send('play 3 100 0')
+    frame = read_wire(fd, PLAY_FRAME_LEN)
+    device.cmd(f'wait {ACK_TIMEOUT_MS}')
+    check(read_wire(fd, PLAY_FRAME_LEN) == frame, 'no identical resend after the ack timeout')
+    device.cmd(f'wait {ACK_TIMEOUT_MS}')
+    check(read_wire(fd, 1, timeout=0.1) == b'', 'a second resend with one allowed')
+    # An ack after giving up counts for nothing
+    os.write(fd, ack(seq, uart_link.CMD_PLAY))
+    device.cmd('receive 100')
+
+    after = device.stats()
+    check(after['resent'] - before['resent'] == 1 and after['timeouts'] - before['timeouts'] == 1,
+          f'counters {after}')
+    check(after['acked'] == before['acked'], f'late ack matched: {after}')
+
+
+def test_stop_replaces_play(device, fd):
+    before = device.stats()
+    play = device.send('play 9 200 0')
+    stop = device.send('stop')
+    wire = read_wire(fd, PLAY_FRAME_LEN + STOP_FRAME_LEN)
+    check(wire == uart_link.encode_play(play, 9, 200, 0) + uart_link.encode(stop, uart_link.CMD_STOP),
+          f'PLAY then STOP: {wire.hex()}')
+    # The PLAY no longer waits for its ack; the STOP does
+    os.write(fd, ack(play, uart_link.CMD_PLAY))
+    device.cmd('receive 100')
+    check(device.stats()['acked'] == before['acked'], 'ack of the replaced PLAY matched')
+    os.write(fd, ack(stop, uart_link.CMD_STOP))
+    device.cmd('receive 100')
+    device.cmd(f'wait {2 * ACK_TIMEOUT_MS}')
+    check(read_wire(fd, 1, timeout=0.1) == b'', 'resend after the STOP was acked')
+
+    after = device.stats()
+    check(after['superseded'] - before['superseded'] == 1, f'replaced PLAY not counted: {after}')
+    check(after['acked'] - before['acked'] == 1 and after['timeouts'] == before['timeouts'], f'counters {after}')
+
+
+def main():
+    device = Device(sys.argv[1])
+    try:
+        check(device.path.startswith('/dev/'), f'device terminal {device.path!r}')
+        if device.path.startswith('/dev/'):
+            fd = os.open(device.path, os.O_RDWR | os.O_NOCTTY)
+            tty.setraw(fd)
+            try:
+                for test in (test_frames, test_resync, test_resend_and_give_up, test_stop_replaces_play):
+                    start = time.perf_counter()
+                    test(device, fd)
+                    print(f'  {test.__name__:<26} {(time.perf_counter() - start) * 1000:.0f} ms')
+            finally:
+                os.close(fd)
+    finally:
+        device.close()
+    print('FAIL' if failures else 'PASS')
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,280 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_output on both backends: RMT symbol encoding, playback against the mock RMT channel and
+// the software GPIO sequencer.
+
+#include <esp_timer.h>
+
+#include "app_gesture.h"
+#include "app_output.h"
+#include "app_settings.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define SIGNAL_GPIO CONFIG_SKULL_SIGNAL_GPIO
+#define STATUS_GPIO 8
+
+static int s_done_count;
+static int64_t s_done_at;
+
+static void done_cb(app_output_channel_t channel, void *user_data)
+{
+    s_done_count++;
+    s_done_at = esp_timer_get_time();
+}
+
+static void init_channels(void)
+{
+    static bool initialized;
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+    app_output_config_t config = {.gpio_num = SIGNAL_GPIO, .done_cb = done_cb};
+    CHECK_EQ(app_output_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+    // The status LED idles high, and on the RMT build it is the channel that falls back to GPIO
+    host_rmt_fail_new_channel(true);
+    app_output_config_t status = {.gpio_num = STATUS_GPIO, .active_low = true, .done_cb = done_cb};
+    CHECK_EQ(app_output_init(APP_OUTPUT_CHANNEL_STATUS, &status), ESP_OK);
+    host_rmt_fail_new_channel(false);
+}
+
+static void reset_case(void)
+{
+    init_channels();
+    app_output_stop(APP_OUTPUT_CHANNEL_SIGNAL);
+    app_output_stop(APP_OUTPUT_CHANNEL_STATUS);
+    host_gpio_clear_edges();
+    s_done_count = 0;
+    s_done_at = -1;
+}
+
+static uint64_t half_ticks(uint32_t half)
+{
+    return half & 0x7FFF;
+}
+
+static void test_encode_long_pulse_splits_at_15_bits(void)
+{
+    app_output_step_t step = {.duration_us = 500000, .level = 1};
+    app_output_pattern_t pattern = {&step, 1};
+    uint32_t symbols[16] = {};
+    size_t count = app_output_rmt_encode(&pattern, 1, symbols, 16);
+    // 500000 ticks need 16 halves of at most 0x7FFF; the driver appends the end marker itself
+    CHECK_EQ(count, 8);
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (int half = 0; half < 2; half++) {
+            uint32_t bits = half ? symbols[i] >> 16 : symbols[i] & 0xFFFF;
+            CHECK(half_ticks(bits) > 0);
+            CHECK_EQ(bits >> 15, 1);
+            total += half_ticks(bits);
+        }
+    }
+    CHECK_EQ(total, 500000);
+}
+
+static void test_encode_merges_runs_and_scales(void)
+{
+    app_output_step_t steps[] = {
+        {.duration_us = 100, .level = 1},
+        {.duration_us = 200, .level = 1},
+        {.duration_us = 0, .level = 0},
+        {.duration_us = 50, .level = 0},
+    };
+    app_output_pattern_t pattern = {steps, 4};
+    uint32_t symbols[4] = {};
+    CHECK_EQ(app_output_rmt_encode(&pattern, 10, symbols, 4), 1);
+    CHECK_EQ(symbols[0], (0x8000u | 3000) | (500u << 16));
+}
+
+static void test_encode_rejects_overflow(void)
+{
+    app_output_step_t steps[8];
+    for (int i = 0; i < 8; i++) {
+        steps[i] = {.duration_us = 100, .level = (uint32_t)(i & 1) ^ 1};
+    }
+    app_output_pattern_t pattern = {steps, 8};
+    uint32_t symbols[4];
+    CHECK_EQ(app_output_rmt_encode(&pattern, 1, symbols, 4), 4);
+    CHECK_EQ(app_output_rmt_encode(&pattern, 1, symbols, 3), 0);
+    CHECK_EQ(app_output_rmt_encode(NULL, 1, symbols, 4), 0);
+    CHECK_EQ(app_output_rmt_encode(&pattern, 0, symbols, 4), 0);
+}
+
+static void check_edges(int gpio, const uint32_t *levels, const int64_t *times, size_t count)
+{
+    size_t seen = 0;
+    for (const host_edge_t &edge : host_gpio_edges()) {
+        if (edge.gpio_num != gpio) {
+            continue;
+        }
+        if (seen < count) {
+            CHECK_EQ(edge.level, levels[seen]);
+            CHECK_EQ(edge.time_us, times[seen]);
+        }
+        seen++;
+    }
+    CHECK_EQ(seen, count);
+}
+
+// high 1000 us, low 500 us, high 2000 us
+static const app_output_step_t s_steps[] = {
+    {.duration_us = 1000, .level = 1},
+    {.duration_us = 500, .level = 0},
+    {.duration_us = 2000, .level = 1},
+};
+static const app_output_pattern_t s_pattern = {s_steps, 3};
+
+static void play_and_check_waveform(app_output_channel_t channel, int gpio, uint32_t idle)
+{
+    int64_t start = esp_timer_get_time();
+    CHECK_EQ(app_output_play(channel, &s_pattern), ESP_OK);
+    CHECK(app_output_is_active(channel));
+    CHECK_EQ(app_output_play(channel, &s_pattern), ESP_ERR_INVALID_STATE);
+
+    host_advance_us(3499);
+    CHECK_EQ(s_done_count, 0);
+    CHECK(app_output_is_active(channel));
+    host_advance_us(1);
+    CHECK_EQ(s_done_count, 1);
+    CHECK_EQ(s_done_at, start + 3500);
+    CHECK(!app_output_is_active(channel));
+    CHECK_EQ(host_gpio_level(gpio), idle);
+
+    const uint32_t levels[] = {1u ^ idle, 0u ^ idle, 1u ^ idle, 0u ^ idle};
+    const int64_t times[] = {start, start + 1000, start + 1500, start + 3500};
+    check_edges(gpio, levels, times, 4);
+    CHECK_EQ(host_active_timers(), 0);
+}
+
+static void test_gpio_backend_waveform(void)
+{
+    reset_case();
+    play_and_check_waveform(APP_OUTPUT_CHANNEL_STATUS, STATUS_GPIO, 1);
+}
+
+static void test_gpio_stop_mid_pattern(void)
+{
+    reset_case();
+    CHECK_EQ(app_output_play(APP_OUTPUT_CHANNEL_STATUS, &s_pattern), ESP_OK);
+    host_advance_us(1200);
+    app_output_stop(APP_OUTPUT_CHANNEL_STATUS);
+    CHECK_EQ(host_gpio_level(STATUS_GPIO), 1);
+    CHECK(!app_output_is_active(APP_OUTPUT_CHANNEL_STATUS));
+    // Nothing may drive the line or re-arm the step timer after a stop
+    CHECK_EQ(host_active_timers(), 0);
+    size_t edges = host_gpio_edges().size();
+    host_advance_us(10000);
+    CHECK_EQ(host_gpio_edges().size(), edges);
+    CHECK_EQ(s_done_count, 0);
+}
+
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+static void test_rmt_waveform_and_done_from_hardware(void)
+{
+    reset_case();
+    CHECK_EQ(host_rmt_channels(), 1);
+    play_and_check_waveform(APP_OUTPUT_CHANNEL_SIGNAL, SIGNAL_GPIO, 0);
+    const std::vector<host_rmt_transmit_t> &transmits = host_rmt_transmits();
+    CHECK_EQ(transmits.size(), 1);
+    if (!transmits.empty()) {
+        CHECK_EQ(transmits[0].symbols.size(), 2);
+        CHECK_EQ(transmits[0].symbols[0], (0x8000u | 1000) | (500u << 16));
+        CHECK_EQ(transmits[0].symbols[1], 0x8000u | 2000);
+    }
+}
+
+static void test_rmt_stop_aborts_without_done(void)
+{
+    reset_case();
+    CHECK_EQ(app_output_pulse(APP_OUTPUT_CHANNEL_SIGNAL, 500000), ESP_OK);
+    host_advance_us(100000);
+    CHECK_EQ(host_gpio_level(SIGNAL_GPIO), 1);
+    app_output_stop(APP_OUTPUT_CHANNEL_SIGNAL);
+    CHECK_EQ(host_gpio_level(SIGNAL_GPIO), 0);
+    host_advance_us(1000000);
+    CHECK_EQ(s_done_count, 0);
+    // The channel takes the next transfer straight away
+    CHECK_EQ(app_output_pulse(APP_OUTPUT_CHANNEL_SIGNAL, 1000), ESP_OK);
+    host_advance_us(1000);
+    CHECK_EQ(s_done_count, 1);
+}
+
+static void test_rmt_oversized_pattern_is_rejected(void)
+{
+    reset_case();
+    static app_output_step_t steps[2 * CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS + 2];
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        steps[i] = {.duration_us = 10, .level = (uint32_t)(i & 1) ^ 1};
+    }
+    app_output_pattern_t pattern = {steps, (uint16_t)(sizeof(steps) / sizeof(steps[0]))};
+    CHECK_EQ(app_output_play(APP_OUTPUT_CHANNEL_SIGNAL, &pattern), ESP_ERR_INVALID_SIZE);
+    CHECK(!app_output_is_active(APP_OUTPUT_CHANNEL_SIGNAL));
+    CHECK_EQ(host_rmt_transmits().size(), 0);
+}
+
+// A triple click at the widest pulse the settings allow, as start_trigger() builds it; app_main's
+// static_assert holds the default buffer to this
+static void test_rmt_longest_burst_fits(void)
+{
+    reset_case();
+    const uint32_t pulse_us = APP_SETTINGS_PULSE_MS_MAX * 1000, gap_us = CONFIG_SKULL_BUTTON_BURST_GAP_MS * 1000;
+    app_output_step_t steps[2 * APP_GESTURE_MAX_CLICKS - 1];
+    uint16_t count = 0;
+    for (int i = 0; i < APP_GESTURE_MAX_CLICKS; i++) {
+        if (i > 0) {
+            steps[count++] = {.duration_us = gap_us, .level = 0};
+        }
+        steps[count++] = {.duration_us = pulse_us, .level = 1};
+    }
+    app_output_pattern_t pattern = {steps, count};
+    uint64_t total_us = APP_GESTURE_MAX_CLICKS * (uint64_t)pulse_us + (APP_GESTURE_MAX_CLICKS - 1) * gap_us;
+
+    static uint32_t symbols[CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS];
+    size_t encoded = app_output_rmt_encode(&pattern, CONFIG_SKULL_OUTPUT_RMT_TICKS_PER_US, symbols,
+                                           CONFIG_SKULL_OUTPUT_RMT_MAX_SYMBOLS);
+    CHECK(encoded > 0);
+    CHECK(encoded <= APP_OUTPUT_RMT_SYMBOLS_MAX(total_us, count, CONFIG_SKULL_OUTPUT_RMT_TICKS_PER_US));
+
+    int64_t start = esp_timer_get_time();
+    CHECK_EQ(app_output_play(APP_OUTPUT_CHANNEL_SIGNAL, &pattern), ESP_OK);
+    host_advance_us((int64_t)total_us);
+    CHECK_EQ(s_done_count, 1);
+    CHECK(!app_output_is_active(APP_OUTPUT_CHANNEL_SIGNAL));
+    const uint32_t levels[] = {1, 0, 1, 0, 1, 0};
+    const int64_t times[] = {start, start + pulse_us, start + pulse_us + gap_us, start + 2 * pulse_us + gap_us,
+                             start + 2 * (pulse_us + gap_us), start + (int64_t)total_us};
+    check_edges(SIGNAL_GPIO, levels, times, 6);
+}
+#else
+static void test_gpio_backend_on_signal(void)
+{
+    reset_case();
+    play_and_check_waveform(APP_OUTPUT_CHANNEL_SIGNAL, SIGNAL_GPIO, 0);
+}
+#endif
+
+int main(void)
+{
+    RUN_TEST(test_encode_long_pulse_splits_at_15_bits);
+    RUN_TEST(test_encode_merges_runs_and_scales);
+    RUN_TEST(test_encode_rejects_overflow);
+    RUN_TEST(test_gpio_backend_waveform);
+    RUN_TEST(test_gpio_stop_mid_pattern);
+#if CONFIG_SKULL_OUTPUT_BACKEND_RMT
+    RUN_TEST(test_rmt_waveform_and_done_from_hardware);
+    RUN_TEST(test_rmt_stop_aborts_without_done);
+    RUN_TEST(test_rmt_oversized_pattern_is_rejected);
+    RUN_TEST(test_rmt_longest_burst_fits);
+#else
+    RUN_TEST(test_gpio_backend_on_signal);
+#endif
+    return TEST_EXIT();
+}
@@ -0,0 +1,390 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_pattern: parsing a library image, every bounds check of the loader, corruption by
+// truncation and single bit flips, an image from tools/pattern_compile.py, and the edge timing
+// of patterns uploaded to the partition and played from the mapping.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <functional>
+#include <vector>
+
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+
+#include "app_output.h"
+#include "app_pattern.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define SIGNAL_GPIO     CONFIG_SKULL_SIGNAL_GPIO
+#define PARTITION_SIZE  0xA000
+#define BOOT_US         (1000 * 1000)
+#define MS(ms)          ((uint32_t)(ms) * 1000)
+
+typedef struct {
+    uint16_t id;
+    std::vector<app_output_step_t> steps;
+} test_pattern_t;
+
+// Word storage keeps the image 4-byte aligned, like the mapped partition
+typedef std::vector<uint32_t> image_t;
+
+static app_pattern_header_t *header_of(image_t &image)
+{
+    return (app_pattern_header_t *)image.data();
+}
+
+static app_pattern_entry_t *entry_of(image_t &image, size_t i)
+{
+    return (app_pattern_entry_t *)((uint8_t *)image.data() + sizeof(app_pattern_header_t)) + i;
+}
+
+static size_t bytes_of(const image_t &image)
+{
+    return image.size() * sizeof(uint32_t);
+}
+
+// Recomputes the CRC after an edit, so the check after it is the one exercised
+static void seal(image_t &image)
+{
+    app_pattern_header_t *header = header_of(image);
+    header->crc32 = esp_rom_crc32_le(0, (const uint8_t *)image.data() + sizeof(*header),
+                                     header->length - sizeof(*header));
+}
+
+// Same layout as tools/pattern_compile.py build_image()
+static image_t build_image(const std::vector<test_pattern_t> &patterns)
+{
+    size_t words = (sizeof(app_pattern_header_t) + patterns.size() * sizeof(app_pattern_entry_t)) / 4;
+    for (const test_pattern_t &pattern : patterns) {
+        words += pattern.steps.size();
+    }
+    image_t image(words);
+    app_pattern_header_t *header = header_of(image);
+    header->magic = APP_PATTERN_MAGIC;
+    header->version = APP_PATTERN_VERSION;
+    header->count = (uint16_t)patterns.size();
+    header->length = (uint32_t)bytes_of(image);
+
+    uint32_t offset = sizeof(app_pattern_header_t) + patterns.size() * sizeof(app_pattern_entry_t);
+    for (size_t i = 0; i < patterns.size(); i++) {
+        app_pattern_entry_t *entry = entry_of(image, i);
+        entry->id = patterns[i].id;
+        entry->step_count = (uint16_t)patterns[i].steps.size();
+        entry->offset = offset;
+        for (const app_output_step_t &step : patterns[i].steps) {
+            entry->total_us += step.duration_us;
+            entry->high_us += step.level ? step.duration_us : 0;
+            memcpy((uint8_t *)image.data() + offset, &step, sizeof(step));
+            offset += sizeof(step);
+        }
+    }
+    seal(image);
+    return image;
+}
+
+static const std::vector<test_pattern_t> s_library = {
+    {1, {{MS(120), 1}, {MS(80), 0}, {MS(120), 1}, {MS(80), 0}, {MS(1500), 1}}},
+    {200, {{MS(10), 1}}},
+    {255, {{MS(500), 0}, {MS(250), 1}, {MS(250), 1}, {MS(40), 0}}},
+};
+
+static void check_not_loaded(void)
+{
+    CHECK_EQ(app_pattern_count(), 0);
+    CHECK_EQ(app_pattern_find(1, NULL), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(app_pattern_id_at(0), 0);
+}
+
+static void test_parse_library(void)
+{
+    image_t image = build_image(s_library);
+    CHECK_EQ(app_pattern_load(image.data(), bytes_of(image)), ESP_OK);
+    CHECK_EQ(app_pattern_count(), 3);
+    CHECK_EQ(app_pattern_id_at(0), 1);
+    CHECK_EQ(app_pattern_id_at(1), 200);
+    CHECK_EQ(app_pattern_id_at(2), 255);
+    CHECK_EQ(app_pattern_id_at(3), 0);
+
+    app_pattern_info_t info;
+    CHECK_EQ(app_pattern_find(1, &info), ESP_OK);
+    CHECK_EQ(info.step_count, 5);
+    CHECK_EQ(info.high_us, MS(1740));
+    CHECK_EQ(info.total_us, MS(1900));
+    CHECK_EQ(app_pattern_find(255, &info), ESP_OK);
+    CHECK_EQ(info.high_us, MS(500));
+    CHECK_EQ(info.total_us, MS(1040));
+    CHECK_EQ(app_pattern_find(200, NULL), ESP_OK);
+    for (int id = 0; id <= APP_PATTERN_MAX_ID; id++) {
+        if (id != 1 && id != 200 && id != 255) {
+            CHECK_EQ(app_pattern_find((uint8_t)id, NULL), ESP_ERR_NOT_FOUND);
+        }
+    }
+
+    // Spare room after the image is fine
+    image_t padded = image;
+    padded.resize(padded.size() + 100, 0xFFFFFFFF);
+    CHECK_EQ(app_pattern_load(padded.data(), bytes_of(padded)), ESP_OK);
+    CHECK_EQ(app_pattern_count(), 3);
+}
+
+typedef struct {
+    const char *name;
+    esp_err_t expected;
+    std::function<void(image_t &)> edit;
+    bool reseal;
+} mutation_t;
+
+// Each loader check on its own; a failed load always leaves no library behind
+static void test_bounds(void)
+{
+    const mutation_t mutations[] = {
+        {"erased", ESP_ERR_NOT_FOUND, [](image_t &i) { header_of(i)->magic = 0xFFFFFFFF; }, false},
+        {"version", ESP_ERR_INVALID_VERSION, [](image_t &i) { header_of(i)->version = 2; }, false},
+        {"no patterns", ESP_ERR_INVALID_SIZE, [](image_t &i) { header_of(i)->count = 0; }, false},
+        {"too many patterns", ESP_ERR_INVALID_SIZE, [](image_t &i) { header_of(i)->count = 256; }, false},
+        {"length past buffer", ESP_ERR_INVALID_SIZE, [](image_t &i) { header_of(i)->length += 4; }, false},
+        {"length inside index", ESP_ERR_INVALID_SIZE, [](image_t &i) { header_of(i)->length = 16 + 2 * 16; }, false},
+        {"CRC", ESP_ERR_INVALID_CRC, [](image_t &i) { header_of(i)->crc32 ^= 1; }, false},
+        {"id 0", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 1)->id = 0; }, true},
+        {"id 256", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 1)->id = 256; }, true},
+        {"duplicate id", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 2)->id = 1; }, true},
+        {"no steps", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 1)->step_count = 0; }, true},
+        {"unaligned steps", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 0)->offset += 2; }, true},
+        {"steps in index", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 0)->offset = 16; }, true},
+        {"steps out of order", ESP_ERR_INVALID_ARG, [](image_t &i) { std::swap(*entry_of(i, 0), *entry_of(i, 1)); },
+         true},
+        {"gap before steps", ESP_ERR_INVALID_ARG,
+         [](image_t &i) {
+             // One word between the index and the first step array
+             i.insert(i.begin() + (sizeof(app_pattern_header_t) + 3 * sizeof(app_pattern_entry_t)) / 4, 0);
+             header_of(i)->length += 4;
+             for (int e = 0; e < 3; e++) {
+                 entry_of(i, e)->offset += 4;
+             }
+         },
+         true},
+        {"bytes after the steps", ESP_ERR_INVALID_SIZE,
+         [](image_t &i) {
+             i.push_back(0);
+             header_of(i)->length += 4;
+         },
+         true},
+        {"steps past end", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 2)->step_count++; }, true},
+        {"offset past end", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 0)->offset = 0x7FFFFFFC; }, true},
+        {"high time", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 0)->high_us--; }, true},
+        {"total time", ESP_ERR_INVALID_ARG, [](image_t &i) { entry_of(i, 0)->total_us++; }, true},
+    };
+    for (const mutation_t &mutation : mutations) {
+        image_t image = build_image(s_library);
+        CHECK_EQ(app_pattern_load(image.data(), bytes_of(image)), ESP_OK);
+        mutation.edit(image);
+        if (mutation.reseal) {
+            seal(image);
+        }
+        esp_err_t err = app_pattern_load(image.data(), bytes_of(image));
+        if (err != mutation.expected) {
+            printf("  %s: %s, expected %s\n", mutation.name, esp_err_to_name(err), esp_err_to_name(mutation.expected));
+        }
+        CHECK_EQ(err, mutation.expected);
+        check_not_loaded();
+    }
+
+    // A pattern of zero-length steps would play nothing
+    image_t silent = build_image({{9, {{0, 1}, {0, 0}}}});
+    CHECK_EQ(app_pattern_load(silent.data(), bytes_of(silent)), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(app_pattern_load(NULL, 1024), ESP_ERR_INVALID_SIZE);
+    image_t image = build_image(s_library);
+    CHECK_EQ(app_pattern_load(image.data(), sizeof(app_pattern_header_t) - 1), ESP_ERR_INVALID_SIZE);
+    check_not_loaded();
+}
+
+// No truncation and no single bit flip anywhere in the image gets a library loaded
+static void test_corruption(void)
+{
+    const image_t good = build_image(s_library);
+    for (size_t size = 0; size < bytes_of(good); size++) {
+        CHECK(app_pattern_load(good.data(), size) != ESP_OK);
+        check_not_loaded();
+    }
+    int flips = 0;
+    for (size_t bit = 0; bit < bytes_of(good) * 8; bit++) {
+        image_t image = good;
+        ((uint8_t *)image.data())[bit / 8] ^= 1 << (bit % 8);
+        if (app_pattern_load(image.data(), bytes_of(image)) == ESP_OK) {
+            printf("  bit %zu flipped: accepted\n", bit);
+            CHECK(false);
+        }
+        flips++;
+    }
+    check_not_loaded();
+    printf("  %zu truncations, %d bit flips rejected\n", bytes_of(good), flips);
+}
+
+// The image test_pattern_compile.py writes from its SAMPLE_SPEC
+static void test_compiled_image(void)
+{
+    FILE *f = fopen(PATTERN_IMAGE_PATH, "rb");
+    if (!f) {
+        printf("  %s not found, skipped (needs Python)\n", PATTERN_IMAGE_PATH);
+        return;
+    }
+    image_t image(PARTITION_SIZE / 4, 0xFFFFFFFF);
+    size_t len = fread(image.data(), 1, PARTITION_SIZE, f);
+    fclose(f);
+    CHECK(len > 0);
+    CHECK_EQ(app_pattern_load(image.data(), bytes_of(image)), ESP_OK);
+    CHECK_EQ(app_pattern_count(), 2);
+    app_pattern_info_t info;
+    CHECK_EQ(app_pattern_find(1, &info), ESP_OK);
+    CHECK_EQ(info.step_count, 7);
+    CHECK_EQ(info.high_us, 3 * MS(120) + MS(1500));
+    CHECK_EQ(info.total_us, 3 * MS(200) + MS(1500));
+    CHECK_EQ(app_pattern_find(7, &info), ESP_OK);
+    CHECK_EQ(info.step_count, 3);
+    CHECK_EQ(info.high_us, 250 + MS(2000));
+    CHECK_EQ(info.total_us, 250 + MS(3000));
+}
+
+static int s_done_count;
+static int64_t s_done_us;
+
+static void done_cb(app_output_channel_t channel, void *user_data)
+{
+    s_done_count++;
+    s_done_us = esp_timer_get_time();
+}
+
+static void upload(const image_t &image, size_t chunk)
+{
+    CHECK_EQ(app_pattern_upload_begin(bytes_of(image)), ESP_OK);
+    const uint8_t *bytes = (const uint8_t *)image.data();
+    for (size_t offset = 0; offset < bytes_of(image); offset += chunk) {
+        size_t len = bytes_of(image) - offset < chunk ? bytes_of(image) - offset : chunk;
+        CHECK_EQ(app_pattern_upload_write(offset, bytes + offset, len), ESP_OK);
+    }
+    CHECK_EQ(app_pattern_upload_commit(), ESP_OK);
+}
+
+// Every level change lands at its step boundary, to the microsecond, and the line idles after
+static void check_playback(const test_pattern_t &pattern)
+{
+    host_gpio_clear_edges();
+    s_done_count = 0;
+    int64_t start_us = esp_timer_get_time();
+    CHECK_EQ(app_pattern_play(APP_OUTPUT_CHANNEL_SIGNAL, (uint8_t)pattern.id), ESP_OK);
+
+    std::vector<host_edge_t> expected;
+    int64_t t = start_us;
+    uint32_t level = 0;
+    for (const app_output_step_t &step : pattern.steps) {
+        if (step.level != level) {
+            expected.push_back({t, SIGNAL_GPIO, step.level});
+            level = step.level;
+        }
+        t += step.duration_us;
+    }
+    if (level) {
+        expected.push_back({t, SIGNAL_GPIO, 0});
+    }
+    host_advance_us(t - start_us + MS(100));
+
+    const std::vector<host_edge_t> &edges = host_gpio_edges();
+    CHECK_EQ(edges.size(), expected.size());
+    for (size_t i = 0; i < edges.size() && i < expected.size(); i++) {
+        if (edges[i].time_us != expected[i].time_us || edges[i].level != expected[i].level) {
+            printf("  pattern %u edge %zu: %" PRIu32 " at +%lld us, expected %" PRIu32 " at +%lld us\n", pattern.id, i,
+                   edges[i].level, (long long)(edges[i].time_us - start_us), expected[i].level,
+                   (long long)(expected[i].time_us - start_us));
+            CHECK(false);
+        }
+    }
+    CHECK_EQ(s_done_count, 1);
+    CHECK_EQ(s_done_us, t);
+}
+
+static void boot_upload_and_play(void)
+{
+    host_flash_add_partition("patterns", PARTITION_SIZE);
+    host_flash_format("patterns");
+    app_output_config_t config = {.gpio_num = SIGNAL_GPIO, .done_cb = done_cb};
+    CHECK_EQ(app_output_init(APP_OUTPUT_CHANNEL_SIGNAL, &config), ESP_OK);
+    // An erased partition is no library, not an error
+    CHECK_EQ(app_pattern_init(), ESP_OK);
+    check_not_loaded();
+    host_advance_us(BOOT_US);
+
+    // Writes outside an upload, or past its announced length, are refused
+    uint8_t byte = 0;
+    CHECK_EQ(app_pattern_upload_write(0, &byte, 1), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(app_pattern_upload_commit(), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(app_pattern_upload_begin(PARTITION_SIZE + 1), ESP_ERR_INVALID_SIZE);
+
+    std::vector<test_pattern_t> patterns = s_library;
+    // A long pattern, and one with steps longer than an RMT symbol can hold
+    test_pattern_t chatter = {42, {}};
+    for (int i = 0; i < 400; i++) {
+        chatter.steps.push_back({MS(3) + (uint32_t)(i % 7) * 111, (uint32_t)(i & 1) ^ 1});
+    }
+    patterns.push_back(chatter);
+    patterns.push_back({43, {{MS(40000), 1}, {1, 0}, {MS(65), 1}}});
+    image_t image = build_image(patterns);
+    CHECK_EQ(app_pattern_upload_begin(bytes_of(image)), ESP_OK);
+    CHECK_EQ(app_pattern_upload_write(bytes_of(image) - 1, &byte, 2), ESP_ERR_INVALID_SIZE);
+    upload(image, 64);
+    CHECK_EQ(app_pattern_count(), patterns.size());
+
+    for (const test_pattern_t &pattern : patterns) {
+        check_playback(pattern);
+    }
+    CHECK_EQ(app_pattern_play(APP_OUTPUT_CHANNEL_SIGNAL, 2), ESP_ERR_NOT_FOUND);
+
+    // Replacing the library mid-playback stops the line before its steps are erased
+    CHECK_EQ(app_pattern_play(APP_OUTPUT_CHANNEL_SIGNAL, 1), ESP_OK);
+    host_advance_us(MS(150));
+    CHECK_EQ(host_gpio_level(SIGNAL_GPIO), 0);
+    host_advance_us(MS(100));
+    CHECK_EQ(host_gpio_level(SIGNAL_GPIO), 1);
+    image_t replacement = build_image({{5, {{MS(20), 1}}}});
+    upload(replacement, 7);
+    CHECK(!app_output_is_active(APP_OUTPUT_CHANNEL_SIGNAL));
+    CHECK_EQ(host_gpio_level(SIGNAL_GPIO), 0);
+    size_t edges = host_gpio_edges().size();
+    host_advance_us(MS(5000));
+    CHECK_EQ(host_gpio_edges().size(), edges);
+    CHECK_EQ(app_pattern_count(), 1);
+    CHECK_EQ(app_pattern_find(1, NULL), ESP_ERR_NOT_FOUND);
+    check_playback({5, {{MS(20), 1}}});
+
+    // A corrupt upload leaves no library
+    image_t corrupt = build_image(s_library);
+    header_of(corrupt)->crc32 ^= 0x80;
+    CHECK_EQ(app_pattern_upload_begin(bytes_of(corrupt)), ESP_OK);
+    CHECK_EQ(app_pattern_upload_write(0, corrupt.data(), bytes_of(corrupt)), ESP_OK);
+    CHECK_EQ(app_pattern_upload_commit(), ESP_ERR_INVALID_CRC);
+    check_not_loaded();
+}
+
+static void test_upload_and_play(void)
+{
+    CHECK_EQ(host_boot(boot_upload_and_play), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_parse_library);
+    RUN_TEST(test_bounds);
+    RUN_TEST(test_corruption);
+    RUN_TEST(test_compiled_image);
+    RUN_TEST(test_upload_and_play);
+    return TEST_EXIT();
+}
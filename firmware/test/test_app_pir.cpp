@@ -0,0 +1,298 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_pir against multi-sensor traces driven through the GPIO ISR: visitors crossing several
+// sensors, re-entry during the hold, bouncing lines, a sensor high at boot, and a full timer
+// queue on the edge, hold and settle hand-offs.
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include <vector>
+
+#include "app_pir.h"
+#include "test_support.h"
+
+#define SENSOR_COUNT    4
+#define DEBOUNCE_MS     50
+#define HOLD_MS         2000
+#define TICK_US         (portTICK_PERIOD_MS * 1000)
+#define BOOT_US         (1000 * 1000)   // trace time 0; esp_timer time 0 never follows a boot
+
+static const int s_gpios[SENSOR_COUNT] = {0, 1, 3, 10};
+
+typedef enum {
+    EV_LINE,        // sensor line to level
+    EV_FAIL_PENDS,  // the next value hand-offs to the timer task find its queue full
+} trace_event_type_t;
+
+typedef struct {
+    int64_t at_us;
+    trace_event_type_t type;
+    uint8_t sensor;
+    int value;
+} trace_event_t;
+
+typedef struct {
+    int64_t at_us;
+    bool occupied;
+    uint8_t first_sensor;
+} occupancy_change_t;
+
+typedef struct {
+    const char *name;
+    uint8_t high_at_boot;   // mask of sensors already high before init
+    std::vector<trace_event_t> events;
+    std::vector<occupancy_change_t> expected;
+    std::vector<uint8_t> order;                 // first-fired order of the last period
+    uint32_t periods;
+    uint32_t rises[SENSOR_COUNT];
+    uint32_t bounces[SENSOR_COUNT];
+    uint32_t pend_retries;
+} trace_t;
+
+static std::vector<occupancy_change_t> s_changes;
+static const trace_t *s_trace;
+
+static void occupancy_cb(bool occupied, uint8_t first_sensor, void *user_data)
+{
+    s_changes.push_back({esp_timer_get_time() - BOOT_US, occupied, first_sensor});
+}
+
+static void boot_replay_trace(void)
+{
+    const trace_t &trace = *s_trace;
+    app_pir_config_t config;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        host_gpio_input(s_gpios[i], (trace.high_at_boot >> i) & 1);
+        config.sensors[i] = {.gpio_num = s_gpios[i], .debounce_ms = DEBOUNCE_MS};
+    }
+    config.sensor_count = SENSOR_COUNT;
+    config.hold_ms = HOLD_MS;
+    config.occupancy_cb = occupancy_cb;
+    CHECK_EQ(app_pir_init(&config), ESP_OK);
+
+    for (const trace_event_t &event : trace.events) {
+        host_advance_us(BOOT_US + event.at_us - esp_timer_get_time());
+        switch (event.type) {
+        case EV_LINE:
+            host_gpio_input(s_gpios[event.sensor], event.value);
+            break;
+        case EV_FAIL_PENDS:
+            host_fail_pends(event.value);
+            break;
+        }
+    }
+    host_advance_us(10 * 1000 * 1000);
+
+    CHECK_EQ(s_changes.size(), trace.expected.size());
+    for (size_t i = 0; i < s_changes.size() && i < trace.expected.size(); i++) {
+        const occupancy_change_t &got = s_changes[i];
+        const occupancy_change_t &want = trace.expected[i];
+        if (got.at_us != want.at_us || got.occupied != want.occupied || got.first_sensor != want.first_sensor) {
+            printf("  change %zu: %s by %u at %lld us, expected %s by %u at %lld us\n", i,
+                   got.occupied ? "occupied" : "unoccupied", got.first_sensor, (long long)got.at_us,
+                   want.occupied ? "occupied" : "unoccupied", want.first_sensor, (long long)want.at_us);
+            CHECK(false);
+        }
+    }
+
+    app_pir_state_t state;
+    app_pir_get_state(&state);
+    CHECK(!state.occupied);
+    CHECK_EQ(state.active_mask, 0);
+    CHECK_EQ(state.periods, trace.periods);
+    CHECK_EQ(state.pend_retries, trace.pend_retries);
+    CHECK_EQ(state.order_len, trace.order.size());
+    for (size_t i = 0; i < state.order_len && i < trace.order.size(); i++) {
+        CHECK_EQ(state.order[i], trace.order[i]);
+    }
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        app_pir_sensor_stats_t stats;
+        CHECK_EQ(app_pir_get_sensor_stats(i, &stats), ESP_OK);
+        CHECK_EQ(stats.rises, trace.rises[i]);
+        CHECK_EQ(stats.bounces, trace.bounces[i]);
+    }
+    CHECK_EQ(host_active_timers(), 0);
+}
+
+#define MS(ms) ((int64_t)(ms) * 1000)
+
+static const trace_t s_traces[] = {
+    {
+        "walk-by left to right",
+        0,
+        {{0, EV_LINE, 0, 1}, {MS(300), EV_LINE, 1, 1}, {MS(700), EV_LINE, 2, 1}, {MS(2000), EV_LINE, 0, 0},
+         {MS(2300), EV_LINE, 1, 0}, {MS(2700), EV_LINE, 2, 0}},
+        {{0, true, 0}, {MS(2700 + HOLD_MS), false, 0}},
+        {0, 1, 2},
+        1,
+        {1, 1, 1, 0},
+        {},
+    },
+    {
+        "walk-by right to left",
+        0,
+        {{0, EV_LINE, 3, 1}, {MS(400), EV_LINE, 2, 1}, {MS(1500), EV_LINE, 3, 0}, {MS(1900), EV_LINE, 2, 0}},
+        {{0, true, 3}, {MS(1900 + HOLD_MS), false, 3}},
+        {3, 2},
+        1,
+        {0, 0, 1, 1},
+        {},
+    },
+    {
+        // A second sensor firing during the hold extends the period instead of starting one
+        "re-entry during the hold",
+        0,
+        {{0, EV_LINE, 0, 1}, {MS(1000), EV_LINE, 0, 0}, {MS(2500), EV_LINE, 1, 1}, {MS(3000), EV_LINE, 1, 0},
+         {MS(3500), EV_LINE, 0, 1}, {MS(3600), EV_LINE, 0, 0}},
+        {{0, true, 0}, {MS(3600 + HOLD_MS), false, 0}},
+        {0, 1},
+        1,
+        {2, 1, 0, 0},
+        {},
+    },
+    {
+        "two visits",
+        0,
+        {{0, EV_LINE, 1, 1}, {MS(500), EV_LINE, 1, 0}, {MS(5000), EV_LINE, 2, 1}, {MS(5100), EV_LINE, 0, 1},
+         {MS(5600), EV_LINE, 2, 0}, {MS(5700), EV_LINE, 0, 0}},
+        {{0, true, 1}, {MS(500 + HOLD_MS), false, 1}, {MS(5000), true, 2}, {MS(5700 + HOLD_MS), false, 2}},
+        {2, 0},
+        2,
+        {1, 1, 1, 0},
+        {},
+    },
+    {
+        // Contact bounce right after the rise: the line settles high and the period goes on
+        "bounce after the rise",
+        0,
+        {{0, EV_LINE, 0, 1}, {MS(10), EV_LINE, 0, 0}, {MS(20), EV_LINE, 0, 1}, {MS(1000), EV_LINE, 0, 0}},
+        {{0, true, 0}, {MS(1000 + HOLD_MS), false, 0}},
+        {0},
+        1,
+        {1, 0, 0, 0},
+        {1, 0, 0, 0},
+    },
+    {
+        // The fall lands inside the debounce and is only seen when the settle timer samples the line
+        "short pulse",
+        0,
+        {{0, EV_LINE, 2, 1}, {MS(30), EV_LINE, 2, 0}},
+        {{0, true, 2}, {MS(30 + DEBOUNCE_MS + 1 + HOLD_MS), false, 2}},
+        {2},
+        1,
+        {0, 0, 1, 0},
+        {0, 0, 1, 0},
+    },
+    {
+        // Sensors high at boot make the area occupied without announcing a period
+        "high at boot",
+        0x3,
+        {{MS(500), EV_LINE, 0, 0}, {MS(800), EV_LINE, 1, 0}},
+        {{MS(800 + HOLD_MS), false, APP_PIR_NONE}},
+        {},
+        0,
+        {},
+        {},
+    },
+    {
+        // The ISR's hand-off fails; the edge waits in the ring for the retry
+        "edge hand-off retried",
+        0,
+        {{MS(500), EV_FAIL_PENDS, 0, 2}, {MS(500), EV_LINE, 1, 1}, {MS(1500), EV_LINE, 1, 0}},
+        {{MS(500) + 2 * TICK_US, true, 1}, {MS(1500 + HOLD_MS), false, 1}},
+        {1},
+        1,
+        {0, 1, 0, 0},
+        {},
+        2,
+    },
+    {
+        "hold hand-off retried",
+        0,
+        {{0, EV_LINE, 0, 1}, {MS(1000), EV_LINE, 0, 0}, {MS(2500), EV_FAIL_PENDS, 0, 3}},
+        {{0, true, 0}, {MS(1000 + HOLD_MS) + 3 * TICK_US, false, 0}},
+        {0},
+        1,
+        {1, 0, 0, 0},
+        {},
+        3,
+    },
+    {
+        "settle hand-off retried",
+        0,
+        {{0, EV_LINE, 2, 1}, {MS(30), EV_LINE, 2, 0}, {MS(40), EV_FAIL_PENDS, 0, 1}},
+        {{0, true, 2}, {MS(30 + DEBOUNCE_MS + 1 + HOLD_MS) + TICK_US, false, 2}},
+        {2},
+        1,
+        {0, 0, 1, 0},
+        {0, 0, 1, 0},
+        1,
+    },
+    {
+        // A rise is stuck in the ring when the hold expires: the rise wins and the period goes on
+        "rise racing the hold",
+        0,
+        {{0, EV_LINE, 0, 1}, {MS(1000), EV_LINE, 0, 0}, {MS(1000 + HOLD_MS - 2), EV_FAIL_PENDS, 0, 1},
+         {MS(1000 + HOLD_MS - 2), EV_LINE, 3, 1}, {MS(4000), EV_LINE, 3, 0}},
+        {{0, true, 0}, {MS(4000 + HOLD_MS), false, 0}},
+        {0, 3},
+        1,
+        {1, 0, 0, 1},
+        {},
+        1,
+    },
+};
+
+static void test_traces(void)
+{
+    for (const trace_t &trace : s_traces) {
+        host_reset();
+        s_trace = &trace;
+        int result = host_boot(boot_replay_trace);
+        printf("  %-26s %s\n", trace.name, result == 0 ? "ok" : "FAILED");
+        CHECK_EQ(result, 0);
+    }
+}
+
+// Configs the module must refuse, and a second init
+static void boot_init_checks(void)
+{
+    app_pir_config_t config;
+    config.sensors[0] = {.gpio_num = s_gpios[0], .debounce_ms = DEBOUNCE_MS};
+    config.sensor_count = 0;
+    config.hold_ms = HOLD_MS;
+    CHECK_EQ(app_pir_init(&config), ESP_ERR_INVALID_ARG);
+    config.sensor_count = APP_PIR_MAX_SENSORS + 1;
+    CHECK_EQ(app_pir_init(&config), ESP_ERR_INVALID_ARG);
+    config.sensor_count = 1;
+    config.hold_ms = 0;
+    CHECK_EQ(app_pir_init(&config), ESP_ERR_INVALID_ARG);
+    config.hold_ms = HOLD_MS;
+    config.sensors[0].gpio_num = -1;
+    CHECK_EQ(app_pir_init(&config), ESP_ERR_INVALID_ARG);
+    config.sensors[0].gpio_num = s_gpios[0];
+    CHECK_EQ(app_pir_init(&config), ESP_OK);
+    CHECK_EQ(app_pir_init(&config), ESP_ERR_INVALID_STATE);
+
+    app_pir_sensor_stats_t stats;
+    CHECK_EQ(app_pir_get_sensor_stats(1, &stats), ESP_ERR_INVALID_ARG);
+}
+
+static void test_init_checks(void)
+{
+    CHECK_EQ(host_boot(boot_init_checks), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_traces);
+    RUN_TEST(test_init_checks);
+    return TEST_EXIT();
+}
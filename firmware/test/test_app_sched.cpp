@@ -0,0 +1,228 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_sched on the simulated clock: the tick an entry fires on, wheel rounds, the pool, and a
+// scene of several props scheduled for one UTC time, measured on the real wheel the way
+// tools/sched_sim.py models it.
+
+#include <esp_timer.h>
+
+#include "app_sched.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define TICK_US     (CONFIG_SKULL_SCHED_TICK_MS * 1000)
+#define UTC_BASE_US 1760000000000000LL  // 2025-10-09, a set clock
+
+static int64_t s_fired_us[CONFIG_SKULL_SCHED_MAX_PENDING + 1];
+static int s_fired;
+
+static void record_cb(void *arg)
+{
+    s_fired_us[(intptr_t)arg] = esp_timer_get_time();
+    s_fired++;
+}
+
+// Runs the clock until every entry has fired or `limit_us` have passed
+static void run_until_idle(int64_t limit_us)
+{
+    for (int64_t spent = 0; app_sched_pending() > 0 && spent < limit_us; spent += TICK_US) {
+        host_advance_us(TICK_US);
+    }
+}
+
+// The wheel starts at the first insert and fires on the first tick at or after the delay
+static void boot_relative_delay_fires_on_tick(void)
+{
+    CHECK_EQ(app_sched_init(), ESP_OK);
+    host_advance_us(1234);
+    CHECK_EQ(app_sched_after(5, record_cb, (void *)0), ESP_OK);
+    host_advance_us(300);
+    CHECK_EQ(app_sched_after(2, record_cb, (void *)1), ESP_OK);
+    CHECK_EQ(app_sched_after(0, record_cb, (void *)2), ESP_OK);
+    run_until_idle(10 * TICK_US);
+    CHECK_EQ(s_fired, 3);
+    CHECK_EQ(s_fired_us[0], 1234 + 5 * TICK_US);
+    // 2.3 ms after the origin rounds up to tick 3; a zero delay still waits for the next tick
+    CHECK_EQ(s_fired_us[1], 1234 + 3 * TICK_US);
+    CHECK_EQ(s_fired_us[2], 1234 + 1 * TICK_US);
+
+    app_sched_stats_t stats;
+    app_sched_get_stats(&stats);
+    CHECK_EQ(stats.scheduled, 3);
+    CHECK_EQ(stats.fired, 3);
+    CHECK_EQ(stats.late, 0);
+    // The two late inserts wait out the 0.7 ms to the next tick of a wheel already running
+    CHECK_EQ(stats.max_lag_us, TICK_US - 300);
+    CHECK_EQ(host_active_timers(), 0);
+
+    CHECK_EQ(app_sched_after(CONFIG_SKULL_SCHED_MAX_DELAY_MS + 1, record_cb, NULL), ESP_ERR_INVALID_ARG);
+}
+
+// An entry more than one revolution out sits in its slot for the whole rounds in between
+static void boot_delay_beyond_one_revolution(void)
+{
+    CHECK_EQ(app_sched_init(), ESP_OK);
+    CHECK_EQ(app_sched_after(700, record_cb, (void *)0), ESP_OK);
+    CHECK_EQ(app_sched_after(700 - 256 * CONFIG_SKULL_SCHED_TICK_MS, record_cb, (void *)1), ESP_OK);
+    run_until_idle(1000 * TICK_US);
+    CHECK_EQ(s_fired, 2);
+    CHECK_EQ(s_fired_us[0], 700 * 1000);
+    CHECK_EQ(s_fired_us[1], (700 - 256 * CONFIG_SKULL_SCHED_TICK_MS) * 1000);
+}
+
+// Absolute times need a set clock; one in the past fires on the next tick and counts as late
+static void boot_utc_clock_and_late(void)
+{
+    CHECK_EQ(app_sched_init(), ESP_OK);
+    CHECK_EQ(app_sched_at_utc(5000, record_cb, NULL), ESP_ERR_INVALID_STATE);
+
+    host_set_utc_offset_us(UTC_BASE_US);
+    int64_t utc_ms = UTC_BASE_US / 1000;
+    CHECK_EQ(app_sched_at_utc(utc_ms - 200, record_cb, (void *)0), ESP_OK);
+    CHECK_EQ(app_sched_at_utc(utc_ms + 40, record_cb, (void *)1), ESP_OK);
+    CHECK_EQ(app_sched_at_utc(utc_ms + (int64_t)CONFIG_SKULL_SCHED_MAX_DELAY_MS + 1, record_cb, NULL),
+             ESP_ERR_INVALID_ARG);
+    run_until_idle(100 * TICK_US);
+    CHECK_EQ(s_fired_us[0], TICK_US);
+    CHECK_EQ(s_fired_us[1], 40 * 1000);
+
+    app_sched_stats_t stats;
+    app_sched_get_stats(&stats);
+    CHECK_EQ(stats.late, 1);
+    CHECK_EQ(stats.max_lag_us, 200 * 1000 + TICK_US);
+}
+
+// A full pool refuses the entry and counts it; cancelling frees every entry and stops the wheel
+static void boot_pool_full_and_cancel(void)
+{
+    CHECK_EQ(app_sched_init(), ESP_OK);
+    for (int i = 0; i < CONFIG_SKULL_SCHED_MAX_PENDING; i++) {
+        CHECK_EQ(app_sched_after(10 + i, record_cb, (void *)(intptr_t)i), ESP_OK);
+    }
+    CHECK_EQ(app_sched_after(10, record_cb, NULL), ESP_ERR_NO_MEM);
+    CHECK_EQ(app_sched_pending(), CONFIG_SKULL_SCHED_MAX_PENDING);
+
+    app_sched_cancel_all();
+    CHECK_EQ(app_sched_pending(), 0);
+    CHECK_EQ(host_active_timers(), 0);
+    host_advance_us(100 * TICK_US);
+    CHECK_EQ(s_fired, 0);
+
+    app_sched_stats_t stats;
+    app_sched_get_stats(&stats);
+    CHECK_EQ(stats.dropped, 1);
+    CHECK_EQ(app_sched_after(10, record_cb, (void *)0), ESP_OK);
+    run_until_idle(20 * TICK_US);
+    CHECK_EQ(s_fired, 1);
+}
+
+typedef struct {
+    int64_t clock_error_us;     // the node's wall clock minus true time
+    int64_t arrival_us;         // when the command reaches it, from the moment it was sent
+} scene_node_t;
+
+// Five props told to fire 500 ms after the controller sent the scene. Offsets within a few ms of
+// each other, as after SNTP or Matter time sync, and Wi-Fi delivery spread over 100 ms.
+static const scene_node_t kScene[] = {
+    {1800, 30000}, {-2300, 52000}, {400, 81000}, {3100, 63000}, {-900, 130000},
+};
+#define SCENE_NODES (sizeof(kScene) / sizeof(kScene[0]))
+#define SCENE_LEAD_US 500000
+
+// sched_sim.py's Node.fire() without the dispatch latency: the wheel starts at arrival and the
+// entry fires on the first tick at or after the node's view of the fire time
+static int64_t modelled_fire_us(const scene_node_t &node, int64_t fire_at_us)
+{
+    int64_t local_target = fire_at_us - node.clock_error_us;
+    int64_t ticks = 1;
+    if (local_target > node.arrival_us) {
+        int64_t needed = (local_target - node.arrival_us + TICK_US - 1) / TICK_US;
+        ticks = needed > ticks ? needed : ticks;
+    }
+    return node.arrival_us + ticks * TICK_US;
+}
+
+static int64_t spread_us(const int64_t *times, size_t count)
+{
+    int64_t low = times[0], high = times[0];
+    for (size_t i = 1; i < count; i++) {
+        low = times[i] < low ? times[i] : low;
+        high = times[i] > high ? times[i] : high;
+    }
+    return high - low;
+}
+
+// Every node runs on this one wheel in turn, a minute of simulated time apart; the wheel stops
+// between them, so each starts from its own arrival as on a separate board. Returns the true
+// times the nodes fired at, from the moment the scene was sent.
+static void run_scene(bool at_utc, int64_t *fired_us)
+{
+    for (size_t i = 0; i < SCENE_NODES; i++) {
+        int64_t sent_us = esp_timer_get_time() + 60000000;
+        host_advance_us(sent_us + kScene[i].arrival_us - esp_timer_get_time());
+        host_set_utc_offset_us(UTC_BASE_US - sent_us + kScene[i].clock_error_us);
+        int fired = s_fired;
+        if (at_utc) {
+            CHECK_EQ(app_sched_at_utc((UTC_BASE_US + SCENE_LEAD_US) / 1000, record_cb, (void *)0), ESP_OK);
+        } else {
+            CHECK_EQ(app_sched_after(SCENE_LEAD_US / 1000, record_cb, (void *)0), ESP_OK);
+        }
+        run_until_idle(2 * SCENE_LEAD_US);
+        CHECK_EQ(s_fired, fired + 1);
+        fired_us[i] = s_fired_us[0] - sent_us;
+    }
+}
+
+static void boot_scene_skew_on_the_wheel(void)
+{
+    CHECK_EQ(app_sched_init(), ESP_OK);
+    int64_t at[SCENE_NODES], delay[SCENE_NODES];
+    run_scene(true, at);
+    run_scene(false, delay);
+
+    int64_t low_error = kScene[0].clock_error_us, high_error = kScene[0].clock_error_us;
+    for (size_t i = 0; i < SCENE_NODES; i++) {
+        CHECK_EQ(at[i], modelled_fire_us(kScene[i], SCENE_LEAD_US));
+        // A relative delay ignores the clock and keeps the network's spread
+        CHECK_EQ(delay[i], kScene[i].arrival_us + SCENE_LEAD_US);
+        low_error = kScene[i].clock_error_us < low_error ? kScene[i].clock_error_us : low_error;
+        high_error = kScene[i].clock_error_us > high_error ? kScene[i].clock_error_us : high_error;
+    }
+    // The bound sched_sim.py prints for "at": clock error range plus one tick
+    int64_t at_spread = spread_us(at, SCENE_NODES);
+    int64_t delay_spread = spread_us(delay, SCENE_NODES);
+    printf("  %-22s at %lld us, delay %lld us\n", "scene spread", (long long)at_spread, (long long)delay_spread);
+    CHECK(at_spread <= high_error - low_error + TICK_US);
+    CHECK(at_spread < delay_spread);
+
+    app_sched_stats_t stats;
+    app_sched_get_stats(&stats);
+    CHECK_EQ(stats.fired, 2 * SCENE_NODES);
+    CHECK_EQ(stats.late, 0);
+}
+
+#define BOOT_CASE(fn)                                                                          \
+    static void fn(void) { CHECK_EQ(host_boot(boot_##fn), 0); }
+
+BOOT_CASE(relative_delay_fires_on_tick)
+BOOT_CASE(delay_beyond_one_revolution)
+BOOT_CASE(utc_clock_and_late)
+BOOT_CASE(pool_full_and_cancel)
+BOOT_CASE(scene_skew_on_the_wheel)
+
+int main(void)
+{
+    // app_sched_init() runs once per boot, so every case gets its own process
+    RUN_TEST(relative_delay_fires_on_tick);
+    RUN_TEST(delay_beyond_one_revolution);
+    RUN_TEST(utc_clock_and_late);
+    RUN_TEST(pool_full_and_cancel);
+    RUN_TEST(scene_skew_on_the_wheel);
+    return TEST_EXIT();
+}
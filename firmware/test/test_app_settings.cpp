@@ -0,0 +1,356 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// app_settings across boots on emulated NVS: v1 migration, newer blobs left unwritten, every
+// single-bit corruption and truncation of the blob, field repair, signal GPIO vetting against the
+// other pins of the build, and save coalescing.
+
+#include <string.h>
+
+#include <esp_rom_crc.h>
+#include <nvs.h>
+#include <soc/uart_pins.h>
+
+#include "app_settings.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define NAMESPACE   "skull_cfg"
+#define KEY_BLOB    "cfg"
+#define KEY_V1      "pulse_ms"
+
+static app_settings_t s_expect;     // what the next boot must load
+
+static app_settings_t defaults(void)
+{
+    app_settings_t settings;
+    app_settings_defaults(&settings);
+    return settings;
+}
+
+static void check_settings(const app_settings_t *actual, const app_settings_t *expected)
+{
+    CHECK_EQ(actual->pulse_ms, expected->pulse_ms);
+    CHECK_EQ(actual->signal_gpio, expected->signal_gpio);
+    CHECK_EQ(actual->pir_hold_s, expected->pir_hold_s);
+    CHECK_EQ(actual->shtc3_interval_ms, expected->shtc3_interval_ms);
+}
+
+static void nvs_put_blob(const uint8_t *blob, size_t len)
+{
+    nvs_handle_t handle;
+    CHECK_EQ(nvs_open(NAMESPACE, NVS_READWRITE, &handle), ESP_OK);
+    CHECK_EQ(nvs_set_blob(handle, KEY_BLOB, blob, len), ESP_OK);
+    nvs_close(handle);
+}
+
+static size_t nvs_read_blob(uint8_t *blob, size_t size)
+{
+    nvs_handle_t handle;
+    if (nvs_open(NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return 0;
+    }
+    size_t len = size;
+    if (nvs_get_blob(handle, KEY_BLOB, blob, &len) != ESP_OK) {
+        len = 0;
+    }
+    nvs_close(handle);
+    return len;
+}
+
+static bool nvs_has_v1_key(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    uint16_t value;
+    bool found = nvs_get_u16(handle, KEY_V1, &value) == ESP_OK;
+    nvs_close(handle);
+    return found;
+}
+
+// A boot that loads the settings and checks them against s_expect
+static void boot_and_check(void)
+{
+    CHECK_EQ(app_settings_init(), ESP_OK);
+    check_settings(app_settings_get(), &s_expect);
+    app_settings_t staged;
+    app_settings_get_staged(&staged);
+    check_settings(&staged, &s_expect);
+}
+
+// Fields a decoded blob may hold; the same limits app_settings_stage() enforces
+static bool fields_valid(const app_settings_t *settings)
+{
+    return settings->pulse_ms >= APP_SETTINGS_PULSE_MS_MIN && settings->pulse_ms <= APP_SETTINGS_PULSE_MS_MAX &&
+           settings->signal_gpio >= 0 && settings->signal_gpio < GPIO_NUM_MAX &&
+           settings->signal_gpio != CONFIG_SKULL_BUTTON_GPIO && settings->signal_gpio != CONFIG_SKULL_STATUS_LED_GPIO &&
+           settings->pir_hold_s >= 5 && settings->pir_hold_s <= 1800 && settings->shtc3_interval_ms >= 1000 &&
+           settings->shtc3_interval_ms <= 3600000;
+}
+
+static app_settings_t custom_settings(void)
+{
+    app_settings_t settings = {.pulse_ms = 1250, .signal_gpio = 5, .pir_hold_s = 90, .shtc3_interval_ms = 20000};
+    return settings;
+}
+
+static void test_fresh_device_uses_defaults(void)
+{
+    host_nvs_erase_all();
+    s_expect = defaults();
+    CHECK_EQ(host_boot(boot_and_check), 0);
+    CHECK_EQ(host_nvs_writes(), 0);
+}
+
+static void test_v1_key_is_migrated_once(void)
+{
+    const struct {
+        uint16_t v1_pulse_ms;
+        uint16_t expected_ms;
+    } cases[] = {
+        {1200, 1200},
+        {APP_SETTINGS_PULSE_MS_MIN, APP_SETTINGS_PULSE_MS_MIN},
+        {20, CONFIG_SKULL_PULSE_DURATION_MS},   // out of range: default, but still migrated
+        {60000, CONFIG_SKULL_PULSE_DURATION_MS},
+    };
+    for (auto &c : cases) {
+        host_nvs_erase_all();
+        nvs_handle_t handle;
+        CHECK_EQ(nvs_open(NAMESPACE, NVS_READWRITE, &handle), ESP_OK);
+        CHECK_EQ(nvs_set_u16(handle, KEY_V1, c.v1_pulse_ms), ESP_OK);
+        nvs_close(handle);
+
+        s_expect = defaults();
+        s_expect.pulse_ms = c.expected_ms;
+        CHECK_EQ(host_boot(boot_and_check), 0);
+        CHECK(!nvs_has_v1_key());
+
+        uint8_t blob[APP_SETTINGS_BLOB_MAX];
+        size_t len = nvs_read_blob(blob, sizeof(blob));
+        CHECK_EQ(blob[2], APP_SETTINGS_VERSION);
+        app_settings_t decoded;
+        CHECK_EQ(app_settings_decode(blob, len, &decoded), ESP_OK);
+        check_settings(&decoded, &s_expect);
+
+        // The next boot reads the blob and writes nothing
+        uint32_t writes = host_nvs_writes();
+        CHECK_EQ(host_boot(boot_and_check), 0);
+        CHECK_EQ(host_nvs_writes(), writes);
+    }
+}
+
+// Runtime changes on top of a newer blob apply but are never saved over it
+static void boot_newer_blob_is_not_written(void)
+{
+    CHECK_EQ(app_settings_init(), ESP_OK);
+    check_settings(app_settings_get(), &s_expect);
+    CHECK_EQ(app_settings_set_pulse_ms(700), ESP_OK);
+    CHECK_EQ(app_settings_get_pulse_ms(), 700);
+    app_settings_t settings = custom_settings();
+    settings.pir_hold_s = 300;
+    CHECK_EQ(app_settings_stage(&settings), ESP_ERR_INVALID_STATE);
+    host_advance_us((int64_t)CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS * 2000);
+}
+
+// A blob from a newer firmware (after a rollback) is read as its v2 prefix and left as it is,
+// so the newer firmware finds its own fields again
+static void test_newer_blob_is_read_as_prefix(void)
+{
+    host_nvs_erase_all();
+    app_settings_t settings = custom_settings();
+    uint8_t blob[APP_SETTINGS_BLOB_MAX];
+    size_t len = app_settings_encode(&settings, blob, sizeof(blob));
+    const uint8_t extra[] = {0xA5, 0x5A, 0x01, 0x02};
+    memcpy(blob + len, extra, sizeof(extra));
+    len += sizeof(extra);
+    blob[2] = APP_SETTINGS_VERSION + 1;
+    blob[3] = (uint8_t)(len - 8);
+    uint32_t crc = esp_rom_crc32_le(0, blob + 8, len - 8);
+    memcpy(blob + 4, &crc, sizeof(crc));
+    nvs_put_blob(blob, len);
+    uint32_t writes = host_nvs_writes();
+
+    s_expect = settings;
+    CHECK_EQ(host_boot(boot_and_check), 0);
+    CHECK_EQ(host_boot(boot_newer_blob_is_not_written), 0);
+    CHECK_EQ(host_nvs_writes(), writes);
+    uint8_t stored[APP_SETTINGS_BLOB_MAX];
+    size_t stored_len = nvs_read_blob(stored, sizeof(stored));
+    CHECK_EQ(stored_len, len);
+    CHECK(memcmp(stored, blob, len) == 0);
+}
+
+// No single flipped bit yields a setting outside its range; nearly all are caught by a header
+// check or the CRC, and a rejected blob gives the defaults
+static void test_every_bit_flip_is_rejected_or_valid(void)
+{
+    app_settings_t settings = custom_settings();
+    uint8_t blob[APP_SETTINGS_BLOB_MAX];
+    size_t len = app_settings_encode(&settings, blob, sizeof(blob));
+    app_settings_t fallback = defaults();
+
+    int accepted = 0;
+    for (size_t bit = 0; bit < len * 8; bit++) {
+        uint8_t corrupt[APP_SETTINGS_BLOB_MAX];
+        memcpy(corrupt, blob, len);
+        corrupt[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        app_settings_t decoded;
+        esp_err_t err = app_settings_decode(corrupt, len, &decoded);
+        if (err == ESP_OK) {
+            accepted++;
+            CHECK_EQ(bit / 8, 2);
+            CHECK(fields_valid(&decoded));
+        } else {
+            check_settings(&decoded, &fallback);
+        }
+    }
+    // Only the version bits that turn v2 into a later version get through, and a later version
+    // is read as its v2 prefix, which is the unchanged payload
+    printf("  %d of %zu flips accepted\n", accepted, len * 8);
+    CHECK_EQ(accepted, 7);
+
+    for (size_t cut = 0; cut < len; cut++) {
+        app_settings_t decoded;
+        CHECK(app_settings_decode(blob, cut, &decoded) != ESP_OK);
+        check_settings(&decoded, &fallback);
+    }
+}
+
+// A corrupt blob in flash gives the defaults at boot and is left alone for a post-mortem
+static void test_corrupt_blob_boots_with_defaults(void)
+{
+    app_settings_t settings = custom_settings();
+    uint8_t blob[APP_SETTINGS_BLOB_MAX];
+    size_t len = app_settings_encode(&settings, blob, sizeof(blob));
+
+    const size_t flips[] = {0, 3, 5, 8, 10, len - 1};
+    for (size_t byte : flips) {
+        host_nvs_erase_all();
+        uint8_t corrupt[APP_SETTINGS_BLOB_MAX];
+        memcpy(corrupt, blob, len);
+        corrupt[byte] ^= 0x10;
+        nvs_put_blob(corrupt, len);
+        uint32_t writes = host_nvs_writes();
+
+        s_expect = defaults();
+        CHECK_EQ(host_boot(boot_and_check), 0);
+        CHECK_EQ(host_nvs_writes(), writes);
+        uint8_t stored[APP_SETTINGS_BLOB_MAX];
+        CHECK_EQ(nvs_read_blob(stored, sizeof(stored)), len);
+        CHECK(memcmp(stored, corrupt, len) == 0);
+    }
+
+    // Larger than any layout this firmware can read
+    host_nvs_erase_all();
+    uint8_t oversized[APP_SETTINGS_BLOB_MAX + 8] = {};
+    nvs_put_blob(oversized, sizeof(oversized));
+    s_expect = defaults();
+    CHECK_EQ(host_boot(boot_and_check), 0);
+}
+
+// A blob with a good CRC but unusable fields keeps the good ones; a signal GPIO on another
+// feature's pin or on no output pin goes back to the default instead of fighting that driver
+static void test_fields_are_repaired(void)
+{
+    const int8_t bad_gpios[] = {CONFIG_SKULL_BUTTON_GPIO, CONFIG_SKULL_STATUS_LED_GPIO, U0TXD_GPIO_NUM, U0RXD_GPIO_NUM,
+                                GPIO_NUM_MAX, 63, 64, 127, -1, -128};
+    for (int8_t gpio : bad_gpios) {
+        app_settings_t settings = custom_settings();
+        settings.signal_gpio = gpio;
+        settings.pulse_ms = 10;
+        uint8_t blob[APP_SETTINGS_BLOB_MAX];
+        size_t len = app_settings_encode(&settings, blob, sizeof(blob));
+        app_settings_t decoded;
+        CHECK_EQ(app_settings_decode(blob, len, &decoded), ESP_OK);
+        CHECK_EQ(decoded.signal_gpio, CONFIG_SKULL_SIGNAL_GPIO);
+        CHECK_EQ(decoded.pulse_ms, CONFIG_SKULL_PULSE_DURATION_MS);
+        CHECK_EQ(decoded.pir_hold_s, settings.pir_hold_s);
+        CHECK_EQ(decoded.shtc3_interval_ms, settings.shtc3_interval_ms);
+    }
+
+    app_settings_t settings = custom_settings();
+    settings.signal_gpio = 2;
+    uint8_t blob[APP_SETTINGS_BLOB_MAX];
+    size_t len = app_settings_encode(&settings, blob, sizeof(blob));
+    app_settings_t decoded;
+    CHECK_EQ(app_settings_decode(blob, len, &decoded), ESP_OK);
+    CHECK_EQ(decoded.signal_gpio, 2);
+}
+
+static void boot_stage_vets_signal_gpio(void)
+{
+    CHECK_EQ(app_settings_init(), ESP_OK);
+    app_settings_t settings = custom_settings();
+    // The button, the LED, the console, the SPI flash and USB, no GPIO
+    const int8_t rejected[] = {CONFIG_SKULL_BUTTON_GPIO, CONFIG_SKULL_STATUS_LED_GPIO, U0RXD_GPIO_NUM, 12, 18,
+                               GPIO_NUM_MAX, 100, -1};
+    for (int8_t gpio : rejected) {
+        settings.signal_gpio = gpio;
+        CHECK_EQ(app_settings_stage(&settings), ESP_ERR_INVALID_ARG);
+    }
+    host_advance_us((int64_t)CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS * 2000);
+    CHECK_EQ(host_nvs_writes(), 0);
+
+    settings = custom_settings();
+    CHECK_EQ(app_settings_stage(&settings), ESP_OK);
+    CHECK_EQ(app_settings_get_pulse_ms(), settings.pulse_ms);
+    CHECK_EQ(app_settings_get()->signal_gpio, CONFIG_SKULL_SIGNAL_GPIO);    // next boot
+    host_advance_us((int64_t)CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS * 1000);
+    CHECK_EQ(host_nvs_writes(), 1);
+}
+
+static void test_stage_vets_signal_gpio(void)
+{
+    host_nvs_erase_all();
+    CHECK_EQ(host_boot(boot_stage_vets_signal_gpio), 0);
+    s_expect = custom_settings();
+    CHECK_EQ(host_boot(boot_and_check), 0);
+}
+
+// A slider drag is one write per window; a change undone inside the window is none
+static void boot_save_coalescing(void)
+{
+    CHECK_EQ(app_settings_init(), ESP_OK);
+    uint32_t writes = host_nvs_writes();
+    for (uint32_t ms = 100; ms <= 1000; ms += 100) {
+        CHECK_EQ(app_settings_set_pulse_ms(ms), ESP_OK);
+        host_advance_us(50000);
+    }
+    CHECK_EQ(app_settings_set_pulse_ms(APP_SETTINGS_PULSE_MS_MAX + 1), ESP_ERR_INVALID_ARG);
+    host_advance_us((int64_t)CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS * 1000);
+    CHECK_EQ(host_nvs_writes(), writes + 1);
+
+    CHECK_EQ(app_settings_set_pulse_ms(300), ESP_OK);
+    CHECK_EQ(app_settings_set_pulse_ms(1000), ESP_OK);
+    host_advance_us((int64_t)CONFIG_SKULL_SETTINGS_SAVE_DELAY_MS * 1000);
+    CHECK_EQ(host_nvs_writes(), writes + 1);
+}
+
+static void test_save_coalescing(void)
+{
+    host_nvs_erase_all();
+    CHECK_EQ(host_boot(boot_save_coalescing), 0);
+    s_expect = defaults();
+    s_expect.pulse_ms = 1000;
+    CHECK_EQ(host_boot(boot_and_check), 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_fresh_device_uses_defaults);
+    RUN_TEST(test_v1_key_is_migrated_once);
+    RUN_TEST(test_newer_blob_is_read_as_prefix);
+    RUN_TEST(test_every_bit_flip_is_rejected_or_valid);
+    RUN_TEST(test_corrupt_blob_boots_with_defaults);
+    RUN_TEST(test_fields_are_repaired);
+    RUN_TEST(test_stage_vets_signal_gpio);
+    RUN_TEST(test_save_coalescing);
+    return TEST_EXIT();
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Apply delta OTA patches to sample firmware images on the host.
+
+The images are synthetic but shaped like a linked firmware: code words drawn from a
+small vocabulary, with absolute pointers into the image. Each case builds a patch the
+way esp_delta_ota expects it (detools, heatshrink, 64-byte header), rebuilds the new
+image with tools/delta_ota.py's apply_patch(), checks it byte for byte, and reports the
+patch size ratio and the apply throughput.
+
+Exits 77, which ctest reports as skipped, when detools is not installed.
+"""
+
+import hashlib
+import io
+import os
+import random
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+
+try:
+    import detools
+except ImportError:
+    print('detools is not installed (pip install detools), skipping')
+    sys.exit(77)
+
+import delta_ota  # noqa: E402
+
+IMAGE_SIZE = 512 * 1024
+LOAD_ADDRESS = 0x42000000
+
+
+def sample_image(seed, functions=None):
+    """Returns (image, functions); functions is a list of (words, pointer slots)."""
+    rng = random.Random(seed)
+    vocabulary = [rng.getrandbits(32) for _ in range(300)]
+    if functions is None:
+        functions = []
+        size = 0
+        while size < IMAGE_SIZE:
+            words = [rng.choice(vocabulary) for _ in range(rng.randint(16, 128))]
+            pointers = sorted(rng.sample(range(len(words)), len(words) // 16))
+            functions.append((words, pointers))
+            size += 4 * len(words)
+    return link(functions), functions
+
+
+def link(functions):
+    """Lays functions out back to back; pointer slots point at the start of another function."""
+    starts = []
+    address = LOAD_ADDRESS
+    for words, _ in functions:
+        starts.append(address)
+        address += 4 * len(words)
+    out = bytearray()
+    for index, (words, pointers) in enumerate(functions):
+        words = list(words)
+        for n, slot in enumerate(pointers):
+            # Calls go to neighbours, like code that was laid out by module
+            words[slot] = starts[(index + n * 7 + 1) % len(starts)]
+        out += struct.pack(f'<{len(words)}I', *words)
+    return bytes(out)
+
+
+def make_patch(base, new):
+    patch = io.BytesIO()
+    detools.create_patch(io.BytesIO(base), io.BytesIO(new), patch, compression='heatshrink')
+    header = struct.pack('<I', delta_ota.DELTA_MAGIC) + hashlib.sha256(base).digest()
+    header += b'\xff' * (delta_ota.DELTA_HEADER_SIZE - len(header))
+    return header + patch.getvalue()
+
+
+def check_case(name, base, new, max_ratio):
+    patch = make_patch(base, new)
+    rebuilt, seconds = delta_ota.apply_patch(base, patch)
+    ratio = len(patch) / len(new)
+    print(f'{name:<28} patch {len(patch):>8} bytes ({100 * ratio:5.1f}% of {len(new)}), '
+          f'apply {len(new) / seconds / 1024:8.0f} KiB/s')
+    ok = rebuilt == new
+    if not ok:
+        print('  FAIL: rebuilt image differs from the new image')
+    if ratio > max_ratio:
+        print(f'  FAIL: patch is over {100 * max_ratio:.0f}% of a full image')
+        ok = False
+    return ok
+
+
+def main():
+    base, functions = sample_image(1)
+    rng = random.Random(2)
+    ok = True
+
+    # A constant changed in one function: nothing moves
+    edited = [(list(w), p) for w, p in functions]
+    words, pointers = edited[len(edited) // 2]
+    free = [i for i in range(len(words)) if i not in pointers]
+    words[free[0]] ^= 0x00100000
+    ok &= check_case('one constant changed', base, link(edited), 0.05)
+
+    # A new function in the middle: everything after it moves and every pointer to it changes
+    grown = [(list(w), p) for w, p in functions]
+    grown.insert(len(grown) * 2 // 5, ([rng.getrandbits(32) for _ in range(256)], [3, 100, 200]))
+    ok &= check_case('function inserted at 40%', base, link(grown), 0.3)
+
+    # A release's worth of changes: a few functions added, removed and edited
+    release = [(list(w), p) for w, p in functions]
+    for _ in range(10):
+        del release[rng.randrange(len(release))]
+        release.insert(rng.randrange(len(release)), ([rng.getrandbits(32) for _ in range(64)], [5]))
+    ok &= check_case('release with 30 changes', base, link(release), 0.6)
+
+    # An unrelated image still round-trips, just without the savings
+    other, _ = sample_image(3)
+    ok &= check_case('unrelated image', base, other, 1.2)
+
+    # A patch made for another base must not pass as the new image
+    patch = make_patch(base, link(edited))
+    try:
+        rebuilt, _ = delta_ota.apply_patch(other, patch)
+        wrong_base_rejected = rebuilt != link(edited)
+    except Exception:
+        wrong_base_rejected = True
+    print(f'{"patch on the wrong base":<28} {"rejected" if wrong_base_rejected else "FAIL: accepted"}')
+    ok &= wrong_base_rejected
+
+    try:
+        delta_ota.apply_patch(base, b'\0' * 100)
+        print('  FAIL: patch without the esp_delta_ota header accepted')
+        ok = False
+    except ValueError:
+        pass
+
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Run tools/hostlink.py against the firmware's protocol handler.
+
+The argument is the hostlink_device host binary: app_hostlink and app_settings serving the
+console on a pseudo-terminal. The client's own CONFIG_SET check runs against it, with the pins
+the host build's profile gives to other features, so a provisioning frame with a bad signal
+pin is refused by the firmware and not only by the client.
+"""
+
+import os
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+
+import hostlink  # noqa: E402
+
+# Claimed in AppProfile::kPins by the host build (stubs/sdkconfig.h): the button, and on top of
+# BAD_SIGNAL_PINS' 12 and 20 more of the ESP32-C3's flash, USB and console pins
+CLAIMED_PINS = (9, 11, 17, 18, 19, 21)
+SIGNAL_GPIO = 4
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        failures += 1
+        print(f'FAIL {what}')
+
+
+def test_config_set(path):
+    with hostlink.HostLink(path, timeout=2.0) as link:
+        check(link.profile == 'host', f'profile {link.profile!r}')
+        before, pending = link.config_get()
+        check(before['signal_gpio'] == SIGNAL_GPIO and not pending, f'boot settings {before}')
+
+        for failure in hostlink.check_config_set(link, hostlink.BAD_SIGNAL_PINS + CLAIMED_PINS):
+            check(False, failure)
+
+        # The refusal is the firmware's: the raw frame gets ESP_ERR_INVALID_ARG back
+        raw = dict(before, signal_gpio=CLAIMED_PINS[0])
+        try:
+            link.request(hostlink.OP_CONFIG_SET, hostlink.SETTINGS.pack(*(raw[f] for f in hostlink.SETTINGS_FIELDS)))
+            check(False, 'raw CONFIG_SET with the button pin accepted')
+        except hostlink.HostLinkError as e:
+            check(e.status == hostlink.ESP_ERR_INVALID_ARG, f'raw CONFIG_SET: {e}')
+
+        # Moving the signal to a free pin is fine, and waits for a reboot
+        link.config_set(signal_gpio=5)
+        after, pending = link.config_get()
+        check(after['signal_gpio'] == 5 and pending, f'move to GPIO 5: {after}, pending {pending}')
+        link.config_set(signal_gpio=SIGNAL_GPIO)
+
+    # A value the frame cannot carry never leaves the host
+    with hostlink.HostLink(path, timeout=2.0) as link:
+        try:
+            link.config_set(signal_gpio=200)
+            check(False, 'signal_gpio=200 sent')
+        except ValueError:
+            pass
+        settings, pending = link.config_get()
+        check(settings == before and not pending, f'settings after the checks: {settings}')
+
+
+def main():
+    device = subprocess.Popen([sys.argv[1]], stdout=subprocess.PIPE, text=True)
+    try:
+        path = device.stdout.readline().strip()
+        check(path.startswith('/dev/'), f'device terminal {path!r}')
+        if path.startswith('/dev/'):
+            test_config_set(path)
+    finally:
+        device.kill()
+        device.wait()
+    print('FAIL' if failures else 'PASS')
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Check tools/pattern_compile.py: spec parsing, its errors, and the image round trip.
+
+With an output path argument, also writes the image of SAMPLE_SPEC there; the app_pattern
+host test loads it, so the compiler and the firmware loader are checked against each other.
+"""
+
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+
+import pattern_compile  # noqa: E402
+from pattern_compile import SpecError  # noqa: E402
+
+# Keep in sync with check_compiled_image() in test_app_pattern.cpp
+SAMPLE_SPEC = """
+# jaw chatter, then a long scream
+pattern 1
+repeat 3
+    high 120ms
+    low 80ms
+end
+high 1.5s
+
+pattern 7           # ids need not be dense
+high 250us
+low 1s
+high 2s
+"""
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        failures += 1
+        print(f'FAIL {what}')
+
+
+def expect_error(spec, fragment):
+    try:
+        pattern_compile.parse_spec(spec)
+    except SpecError as e:
+        check(fragment in str(e), f'error for {spec!r}: {e} (expected "{fragment}")')
+        return
+    check(False, f'no error for {spec!r}')
+
+
+def test_parse():
+    patterns = pattern_compile.parse_spec(SAMPLE_SPEC)
+    check(list(patterns) == [1, 7], 'pattern order')
+    check(patterns[1] == [(120000, 1), (80000, 0)] * 3 + [(1500000, 1)], 'repeat expansion')
+    check(patterns[7] == [(250, 1), (1000000, 0), (2000000, 1)], 'units')
+
+    nested = pattern_compile.parse_spec('pattern 2\nrepeat 2\nhigh 1ms\nrepeat 2\nlow 2ms\nend\nend\n')
+    check(nested[2] == [(1000, 1), (2000, 0), (2000, 0)] * 2, 'nested repeat')
+
+
+def test_parse_errors():
+    expect_error('high 1ms', 'outside a pattern')
+    expect_error('pattern 0\nhigh 1ms', 'expected "pattern <1-255>"')
+    expect_error('pattern 256\nhigh 1ms', 'expected "pattern <1-255>"')
+    expect_error('pattern 1\nhigh 1ms\npattern 1\nhigh 1ms', 'defined twice')
+    expect_error('pattern 1\nhigh 10', 'bad duration')
+    expect_error('pattern 1\nhigh 0ms', 'out of range')
+    expect_error('pattern 1\nhigh 2148s', 'out of range')
+    expect_error('pattern 1\nrepeat 0\nhigh 1ms\nend', 'expected "repeat <count>"')
+    expect_error('pattern 1\nrepeat 2\nhigh 1ms', 'missing "end"')
+    expect_error('pattern 1\nrepeat 2\nhigh 1ms\npattern 2\nhigh 1ms', 'missing "end"')
+    expect_error('pattern 1\nend', '"end" without "repeat"')
+    expect_error('pattern 1\nblink 1ms', 'unknown statement')
+    expect_error('pattern 1\n', 'has no steps')
+    expect_error('pattern 1\nrepeat 65536\nhigh 1us\nend', 'at most 65535 fit')
+
+
+def test_round_trip():
+    patterns = pattern_compile.parse_spec(SAMPLE_SPEC)
+    image = pattern_compile.build_image(patterns)
+    check(pattern_compile.parse_image(image) == patterns, 'round trip')
+
+    magic, version, count, length, _ = pattern_compile.HEADER.unpack_from(image)
+    check((magic, version, count, length) == (pattern_compile.MAGIC, 1, 2, len(image)), 'header')
+    # Step arrays are word aligned and follow the index
+    for i in range(count):
+        _, _, offset, _, _ = pattern_compile.ENTRY.unpack_from(image, 16 + i * 16)
+        check(offset % 4 == 0 and offset >= 16 + count * 16, f'entry {i} offset {offset}')
+
+    for corrupt, fragment in [
+        (image[:15], 'too short'),
+        (b'\0' + image[1:], 'bad magic'),
+        (image[:4] + struct.pack('<H', 2) + image[6:], 'unsupported version'),
+        (image[:-1], 'bad length'),
+        (image[:-1] + bytes([image[-1] ^ 1]), 'CRC mismatch'),
+    ]:
+        try:
+            pattern_compile.parse_image(corrupt)
+            check(False, f'{fragment} accepted')
+        except SpecError as e:
+            check(fragment in str(e), f'{e} (expected "{fragment}")')
+
+
+def main():
+    test_parse()
+    test_parse_errors()
+    test_round_trip()
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], 'wb') as f:
+            f.write(pattern_compile.build_image(pattern_compile.parse_spec(SAMPLE_SPEC)))
+    print('FAIL' if failures else 'PASS')
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
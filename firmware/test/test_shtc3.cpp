@@ -0,0 +1,471 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// SHTC3 driver against a sensor model on the mock I2C bus, with its polling task run in
+// simulated time: how long one poll can block the task, and how many reports and status
+// callbacks a healthy sensor, an unplugged one, a stuck bus, bad CRCs and a wrong part make.
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <math.h>
+
+#include <climits>
+#include <vector>
+
+#include "drivers/shtc3.h"
+#include "sdkconfig.h"
+#include "test_support.h"
+
+#define TICK_US         (portTICK_PERIOD_MS * 1000)
+#define INTERVAL_MS     5000
+#define BACKOFF_MAX_MS  300000
+#define TEMP_ENDPOINT   3
+#define HUMID_ENDPOINT  4
+#define S(s)            ((int64_t)(s) * 1000 * 1000)
+
+// A measurement wait and one timed-out read; a recovery and the wire time fit in the last 1 ms
+#define WORST_POLL_US   ((pdMS_TO_TICKS(13) + 1 + pdMS_TO_TICKS(20)) * TICK_US + 1000)
+
+#define CMD_WAKE        0x3517
+#define CMD_SLEEP       0xB098
+#define CMD_SOFT_RESET  0x805D
+#define CMD_READ_ID     0xEFC8
+#define CMD_MEASURE     0x7866
+
+// Raw words for 25.0 C and 50.0 %RH
+#define TEMP_RAW        0x6666
+#define HUMID_RAW       0x8000
+
+typedef struct {
+    bool present = true;
+    bool bus_stuck = false;         // every transaction times out while SDA is held
+    int sda_held_pulses = 0;        // SCL pulses until the sensor lets go of SDA
+    int stuck_reads = 0;            // reads that time out
+    int corrupt_every = 0;          // every n-th measurement comes back with a bad CRC
+    uint16_t product = 0x0887;      // bit 7 is don't care
+    bool awake = false;
+    uint16_t pending = 0;
+    int64_t ready_at_us = 0;
+    uint32_t measurements = 0;
+    size_t edges_seen = 0;
+} sensor_t;
+
+typedef struct {
+    int64_t at_us;
+    uint16_t endpoint;
+    float value;
+} report_t;
+
+typedef struct {
+    int64_t at_us;
+    shtc3_status_t status;
+    esp_err_t err;
+} status_event_t;
+
+static sensor_t s_sensor;
+static std::vector<report_t> s_reports;
+static std::vector<status_event_t> s_status;
+static int64_t s_worst_poll_us;
+static shtc3_sensor_config_t s_config;
+
+static uint8_t crc8(const uint8_t *data, int len)
+{
+    uint8_t crc = 0xFF;
+    for (int j = 0; j < len; j++) {
+        crc ^= data[j];
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void put_word(uint8_t *out, uint16_t word)
+{
+    out[0] = (uint8_t)(word >> 8);
+    out[1] = (uint8_t)word;
+    out[2] = crc8(out, 2);
+}
+
+// The sensor's open-drain SDA: low until SCL has been clocked enough times
+static uint32_t sensor_sda(void)
+{
+    const std::vector<host_edge_t> &edges = host_gpio_edges();
+    for (; s_sensor.edges_seen < edges.size(); s_sensor.edges_seen++) {
+        const host_edge_t &edge = edges[s_sensor.edges_seen];
+        if (edge.gpio_num == CONFIG_SHTC3_I2C_SCL_PIN && edge.level == 0 && s_sensor.sda_held_pulses > 0 &&
+            s_sensor.sda_held_pulses != INT_MAX) {
+            s_sensor.sda_held_pulses--;
+        }
+    }
+    if (s_sensor.sda_held_pulses > 0) {
+        return 0;
+    }
+    s_sensor.bus_stuck = false;
+    return 1;
+}
+
+static esp_err_t sensor_transfer(uint8_t address, bool read, uint8_t *data, size_t len)
+{
+    if (s_sensor.bus_stuck) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (address != 0x70 || !s_sensor.present) {
+        return ESP_FAIL;
+    }
+    if (!read) {
+        uint16_t command = len == 2 ? (uint16_t)(data[0] << 8 | data[1]) : 0;
+        if (command == CMD_WAKE) {
+            s_sensor.awake = true;
+            return ESP_OK;
+        }
+        // Asleep, only the wake-up command is acknowledged
+        if (!s_sensor.awake) {
+            return ESP_FAIL;
+        }
+        switch (command) {
+        case CMD_SLEEP:
+            s_sensor.awake = false;
+            break;
+        case CMD_SOFT_RESET:
+            s_sensor.pending = 0;
+            break;
+        case CMD_MEASURE:
+            s_sensor.ready_at_us = esp_timer_get_time() + 12100;
+            // fall through
+        case CMD_READ_ID:
+            s_sensor.pending = command;
+            break;
+        default:
+            return ESP_FAIL;
+        }
+        return ESP_OK;
+    }
+
+    if (!s_sensor.awake || !s_sensor.pending) {
+        return ESP_FAIL;
+    }
+    if (s_sensor.stuck_reads > 0) {
+        s_sensor.stuck_reads--;
+        return ESP_ERR_TIMEOUT;
+    }
+    if (s_sensor.pending == CMD_READ_ID && len == 3) {
+        put_word(data, s_sensor.product);
+    } else if (s_sensor.pending == CMD_MEASURE && len == 6) {
+        // Not done yet: the address is NACKed
+        if (esp_timer_get_time() < s_sensor.ready_at_us) {
+            return ESP_FAIL;
+        }
+        put_word(data, TEMP_RAW);
+        put_word(data + 3, HUMID_RAW);
+        s_sensor.measurements++;
+        if (s_sensor.corrupt_every && s_sensor.measurements % s_sensor.corrupt_every == 0) {
+            data[5] ^= 0x01;
+        }
+    } else {
+        return ESP_FAIL;
+    }
+    s_sensor.pending = 0;
+    return ESP_OK;
+}
+
+static void value_cb(uint16_t endpoint_id, float value, void *user_data)
+{
+    s_reports.push_back({esp_timer_get_time(), endpoint_id, value});
+}
+
+static void status_cb(shtc3_status_t status, esp_err_t err, void *user_data)
+{
+    s_status.push_back({esp_timer_get_time(), status, err});
+}
+
+static void start(void)
+{
+    host_i2c_set_device(sensor_transfer);
+    host_gpio_set_bus(CONFIG_SHTC3_I2C_SDA_PIN, sensor_sda);
+    s_config.temperature.cb = value_cb;
+    s_config.temperature.endpoint_id = TEMP_ENDPOINT;
+    s_config.humidity.cb = value_cb;
+    s_config.humidity.endpoint_id = HUMID_ENDPOINT;
+    s_config.status_cb = status_cb;
+    s_config.interval_ms = INTERVAL_MS;
+    CHECK_EQ(shtc3_sensor_init(&s_config), ESP_OK);
+}
+
+// The driver's polling task
+static void run_until(int64_t until_us)
+{
+    while (esp_timer_get_time() < until_us) {
+        int64_t start_us = esp_timer_get_time();
+        uint32_t delay_ms = shtc3_sensor_poll();
+        int64_t took_us = esp_timer_get_time() - start_us;
+        s_worst_poll_us = took_us > s_worst_poll_us ? took_us : s_worst_poll_us;
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    }
+}
+
+static size_t count_reports(uint16_t endpoint, bool nan, int64_t from_us = 0, int64_t to_us = INT64_MAX)
+{
+    size_t count = 0;
+    for (const report_t &report : s_reports) {
+        if (report.endpoint == endpoint && isnan(report.value) == nan && report.at_us >= from_us &&
+            report.at_us < to_us) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static std::vector<status_event_t> events(shtc3_status_t status)
+{
+    std::vector<status_event_t> out;
+    for (const status_event_t &event : s_status) {
+        if (event.status == status) {
+            out.push_back(event);
+        }
+    }
+    return out;
+}
+
+static size_t scl_pulses(void)
+{
+    size_t pulses = 0;
+    for (const host_edge_t &edge : host_gpio_edges()) {
+        pulses += edge.gpio_num == CONFIG_SHTC3_I2C_SCL_PIN && edge.level == 0;
+    }
+    return pulses;
+}
+
+// An hour of a healthy sensor: one report per endpoint per interval, and a poll costs one
+// measurement wait (plus the ID check on the first)
+static void boot_healthy(void)
+{
+    start();
+    run_until(S(3600));
+
+    size_t temperatures = count_reports(TEMP_ENDPOINT, false);
+    CHECK(temperatures <= 3600 * 1000 / INTERVAL_MS + 1);
+    CHECK(temperatures >= 3600 * 1000 / (INTERVAL_MS + WORST_POLL_US / 1000));
+    CHECK_EQ(count_reports(HUMID_ENDPOINT, false), temperatures);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, true) + count_reports(HUMID_ENDPOINT, true), 0u);
+    CHECK(s_status.empty());
+    for (const report_t &report : s_reports) {
+        float expected = report.endpoint == TEMP_ENDPOINT ? 25.0f : 50.0f;
+        CHECK(fabsf(report.value - expected) < 0.01f);
+    }
+    int64_t previous_us = -S(INTERVAL_MS / 1000);
+    for (const report_t &report : s_reports) {
+        if (report.endpoint == TEMP_ENDPOINT) {
+            CHECK(report.at_us - previous_us >= INTERVAL_MS * 1000);
+            previous_us = report.at_us;
+        }
+    }
+    CHECK(s_worst_poll_us < (pdMS_TO_TICKS(13) + 1) * TICK_US + 2000);
+    // The sensor goes back to sleep after every measurement
+    CHECK(!s_sensor.awake);
+    CHECK_EQ(host_i2c_stats().installs, 1u);
+    CHECK_EQ(host_i2c_stats().timeouts, 0u);
+}
+
+// Unplugged from 600 s to 1800 s: three failed polls, then one DEGRADED and one NAN per
+// endpoint, probes backing off to the cap, and one RECOVERED within a capped backoff of the
+// sensor coming back
+static void boot_unplugged(void)
+{
+    start();
+    run_until(S(600));
+    s_sensor.present = false;
+    run_until(S(1800));
+    s_sensor.present = true;
+    run_until(S(2400));
+
+    std::vector<status_event_t> degraded = events(SHTC3_STATUS_DEGRADED);
+    std::vector<status_event_t> recovered = events(SHTC3_STATUS_RECOVERED);
+    std::vector<status_event_t> failed = events(SHTC3_STATUS_READ_FAILED);
+    CHECK_EQ(degraded.size(), 1u);
+    CHECK_EQ(recovered.size(), 1u);
+    if (degraded.size() != 1 || recovered.size() != 1) {
+        return;
+    }
+    CHECK(degraded[0].at_us < S(600 + 3 * INTERVAL_MS / 1000));
+    CHECK(recovered[0].at_us >= S(1800));
+    CHECK(recovered[0].at_us < S(1800) + (int64_t)BACKOFF_MAX_MS * 1000 + WORST_POLL_US);
+
+    // A missing sensor NACKs: no bus recovery
+    for (const status_event_t &event : failed) {
+        CHECK_EQ(event.err, ESP_FAIL);
+    }
+    CHECK_EQ(host_i2c_stats().deletes, 0u);
+
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, true), 1u);
+    CHECK_EQ(count_reports(HUMID_ENDPOINT, true), 1u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, false, S(600) + WORST_POLL_US, recovered[0].at_us), 0u);
+    CHECK_EQ(count_reports(HUMID_ENDPOINT, false, S(600) + WORST_POLL_US, recovered[0].at_us), 0u);
+    CHECK(count_reports(TEMP_ENDPOINT, false, recovered[0].at_us) >= (size_t)((S(2400) - recovered[0].at_us) /
+                                                                               S(INTERVAL_MS / 1000 + 1)));
+
+    // Probes after DEGRADED double from the interval up to the cap
+    int64_t previous_us = degraded[0].at_us;
+    int64_t expected_ms = INTERVAL_MS;
+    size_t probes = 0;
+    for (const status_event_t &event : failed) {
+        if (event.at_us <= degraded[0].at_us) {
+            continue;
+        }
+        int64_t gap_us = event.at_us - previous_us;
+        CHECK(gap_us >= expected_ms * 1000 && gap_us < expected_ms * 1000 + WORST_POLL_US);
+        previous_us = event.at_us;
+        expected_ms = expected_ms * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : expected_ms * 2;
+        probes++;
+    }
+    CHECK_EQ(failed.size() - probes, 3u);
+    // 5, 10, 20, 40, 80, 160 s and then every 300 s until 1800 s
+    CHECK(probes >= 7 && probes <= 9);
+    CHECK(s_worst_poll_us < WORST_POLL_US);
+}
+
+// A sensor reset mid-byte holds SDA: the first transaction times out, the bus is clocked
+// free and the next poll reads normally
+static void boot_stuck_bus(void)
+{
+    s_sensor.bus_stuck = true;
+    s_sensor.sda_held_pulses = 4;
+    start();
+    run_until(S(60));
+
+    std::vector<status_event_t> failed = events(SHTC3_STATUS_READ_FAILED);
+    CHECK_EQ(failed.size(), 1u);
+    CHECK(!failed.empty() && failed[0].err == ESP_ERR_TIMEOUT);
+    CHECK(events(SHTC3_STATUS_DEGRADED).empty());
+    // Four pulses to release SDA, one more for the STOP
+    CHECK_EQ(scl_pulses(), 5u);
+    CHECK_EQ(host_i2c_stats().deletes, 1u);
+    CHECK_EQ(host_i2c_stats().installs, 2u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, false), 60u / (INTERVAL_MS / 1000) - 1);
+    CHECK(s_worst_poll_us < WORST_POLL_US);
+}
+
+// SDA never comes free: every poll times out once and recovers once, with at most nine
+// pulses each; degraded after three polls
+static void boot_bus_held(void)
+{
+    s_sensor.bus_stuck = true;
+    s_sensor.sda_held_pulses = INT_MAX;
+    start();
+    run_until(S(1800));
+
+    host_i2c_stats_t stats = host_i2c_stats();
+    std::vector<status_event_t> failed = events(SHTC3_STATUS_READ_FAILED);
+    CHECK_EQ(events(SHTC3_STATUS_DEGRADED).size(), 1u);
+    CHECK_EQ(stats.timeouts, (uint32_t)failed.size());
+    CHECK_EQ(stats.deletes, (uint32_t)failed.size());
+    CHECK_EQ(stats.installs, stats.deletes + 1);
+    CHECK_EQ(scl_pulses(), failed.size() * 10);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, true), 1u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, false), 0u);
+    CHECK(s_worst_poll_us < WORST_POLL_US);
+}
+
+// The worst case: the measurement read times out after the full wait, every poll
+static void boot_stuck_reads(void)
+{
+    start();
+    run_until(S(30));
+    s_sensor.stuck_reads = INT_MAX;
+    s_worst_poll_us = 0;
+    run_until(S(600));
+
+    CHECK_EQ(events(SHTC3_STATUS_DEGRADED).size(), 1u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, true), 1u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, false, S(30) + WORST_POLL_US), 0u);
+    CHECK_EQ(host_i2c_stats().longest_us, (int64_t)pdMS_TO_TICKS(20) * TICK_US);
+    CHECK(s_worst_poll_us < WORST_POLL_US);
+    CHECK(s_worst_poll_us > WORST_POLL_US - 2000);
+    printf("  worst poll %lld us, bound %lld us\n", (long long)s_worst_poll_us, (long long)WORST_POLL_US);
+}
+
+// One bad CRC in three measurements never adds up to a degraded sensor
+static void boot_crc_errors(void)
+{
+    s_sensor.corrupt_every = 3;
+    start();
+    run_until(S(600));
+
+    std::vector<status_event_t> failed = events(SHTC3_STATUS_READ_FAILED);
+    CHECK(failed.size() >= s_sensor.measurements / 3 - 1);
+    for (const status_event_t &event : failed) {
+        CHECK_EQ(event.err, ESP_ERR_INVALID_CRC);
+    }
+    CHECK(events(SHTC3_STATUS_DEGRADED).empty());
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, true), 0u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, false), s_sensor.measurements - failed.size());
+    CHECK_EQ(host_i2c_stats().deletes, 0u);
+}
+
+// Something else answers at 0x70
+static void boot_wrong_product(void)
+{
+    s_sensor.product = 0x0A01;
+    start();
+    run_until(S(600));
+
+    std::vector<status_event_t> failed = events(SHTC3_STATUS_READ_FAILED);
+    CHECK(failed.size() > 3);
+    for (const status_event_t &event : failed) {
+        CHECK_EQ(event.err, ESP_ERR_NOT_FOUND);
+    }
+    CHECK_EQ(events(SHTC3_STATUS_DEGRADED).size(), 1u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, true), 1u);
+    CHECK_EQ(count_reports(TEMP_ENDPOINT, false), 0u);
+    CHECK_EQ(s_sensor.measurements, 0u);
+}
+
+static void boot_init(void)
+{
+    CHECK_EQ(shtc3_sensor_poll(), (uint32_t)BACKOFF_MAX_MS);
+    CHECK_EQ(host_i2c_stats().transactions, 0u);
+    CHECK_EQ(shtc3_sensor_init(NULL), ESP_ERR_INVALID_ARG);
+    shtc3_sensor_config_t no_callbacks;
+    CHECK_EQ(shtc3_sensor_init(&no_callbacks), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(host_i2c_stats().installs, 0u);
+    start();
+    CHECK_EQ(shtc3_sensor_init(&s_config), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(host_i2c_stats().installs, 1u);
+}
+
+typedef struct {
+    const char *name;
+    void (*boot)(void);
+} scenario_t;
+
+static const scenario_t s_scenarios[] = {
+    {"healthy hour", boot_healthy},
+    {"unplugged 20 min", boot_unplugged},
+    {"stuck bus", boot_stuck_bus},
+    {"bus held", boot_bus_held},
+    {"stuck reads", boot_stuck_reads},
+    {"CRC errors", boot_crc_errors},
+    {"wrong product", boot_wrong_product},
+    {"init", boot_init},
+};
+
+static void test_scenarios(void)
+{
+    for (const scenario_t &scenario : s_scenarios) {
+        int result = host_boot(scenario.boot);
+        printf("  %-22s %s\n", scenario.name, result == 0 ? "ok" : "FAILED");
+        CHECK_EQ(result, 0);
+    }
+}
+
+int main(void)
+{
+    RUN_TEST(test_scenarios);
+    return TEST_EXIT();
+}
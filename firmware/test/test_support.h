@@ -0,0 +1,72 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Minimal check macros for the host tests. A failed check is reported and counted, and the
+// test executable exits non-zero at the end so ctest marks it failed.
+#pragma once
+
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "host_fakes.h"
+
+static int s_test_failures;
+
+#define CHECK(cond)                                                                            \
+    do {                                                                                       \
+        if (!(cond)) {                                                                         \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);                    \
+            s_test_failures++;                                                                 \
+        }                                                                                      \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                             \
+    do {                                                                                       \
+        long long actual_ = (long long)(actual);                                               \
+        long long expected_ = (long long)(expected);                                           \
+        if (actual_ != expected_) {                                                            \
+            printf("%s:%d: CHECK_EQ failed: %s is %lld, expected %lld\n", __FILE__, __LINE__,  \
+                   #actual, actual_, expected_);                                               \
+            s_test_failures++;                                                                 \
+        }                                                                                      \
+    } while (0)
+
+// Runs one test case from a clean set of fakes
+#define RUN_TEST(fn)                                                                           \
+    do {                                                                                       \
+        host_reset();                                                                          \
+        int before_ = s_test_failures;                                                         \
+        fn();                                                                                  \
+        printf("%s %s\n", s_test_failures == before_ ? "PASS" : "FAIL", #fn);                  \
+    } while (0)
+
+#define TEST_EXIT() (s_test_failures ? 1 : 0)
+
+// Runs fn as one boot of the device in a forked process, so module state starts from zero
+// while emulated flash carries over. Returns 0 when the boot's checks passed, 1 when one
+// failed, HOST_EXIT_POWER_CUT or HOST_EXIT_RESTART when it ended that way.
+static int host_boot(void (*fn)(void), bool quiet = false)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        s_test_failures = 0;
+        if (quiet) {
+            (void)!freopen("/dev/null", "w", stdout);
+        }
+        fn();
+        fflush(stdout);
+        _exit(s_test_failures ? 1 : 0);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
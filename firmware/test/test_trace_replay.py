@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Hold tools/trace_replay.py to the firmware on the traces in traces/.
+
+The arguments are the trace_device host binary (the firmware's trigger path fed from a trace)
+and the pattern image test_pattern_compile.py writes. For each trace, trace_device has to reach
+the outcomes recorded in it, and the Python model, run with the options of the same build, has
+to make the same decisions and draw the same signal edges. A change to app_dedupe, app_sched,
+app_pir, app_thermal or app_limiter that the model does not follow fails here.
+
+With --regenerate, traces/sample.log is rebuilt from SCENARIO and re-recorded by trace_device;
+do that only when the firmware's behaviour changed on purpose, and update the model with it.
+"""
+
+import glob
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+REPLAY = os.path.join(HERE, '..', 'tools', 'trace_replay.py')
+SAMPLE = os.path.join(HERE, 'traces', 'sample.log')
+
+sys.path.insert(0, os.path.join(HERE, '..', 'tools'))
+
+from trace_replay import (BUSY, BUTTON, CONTROL, FIRE, ONOFF, PIR_EDGE, PULSE_DURATION, RECORD,  # noqa: E402
+                          START, TEMPERATURE, TRIGGER_AT_UTC, TRIGGER_DELAY, TRIGGER_PATTERN)
+
+BOOT_US = 2_000_000
+UTC_OFFSET_US = 1_760_000_000_000_000
+CONSOLE, HOST = 2, 5
+
+
+def s(seconds):
+    return BOOT_US + round(seconds * 1e6)
+
+
+def temperature(at, celsius):
+    bits = struct.unpack('<I', struct.pack('<f', celsius))[0]
+    centi = -32768 if celsius != celsius else round(celsius * 100)
+    return (s(at), TEMPERATURE, 0, centi & 0xFFFF, bits)
+
+
+# Inputs only, (time_us, type, arg, a, b); trace_device adds the outcomes. Pattern 1 and 7 are
+# in the sample image, 2 and 9 are not.
+SCENARIO = [
+    (s(0), START, 0, 500, 10 | 100 << 16),
+    # Dedupe: a repeat inside the window, and ON, OFF, ON counted as three changes
+    (s(0.5), ONOFF, 1, 1, 0),
+    (s(0.52), ONOFF, 1, 1, 0),
+    (s(0.6), ONOFF, 1, 0, 0),
+    (s(0.65), ONOFF, 1, 1, 0),
+    (s(0.7), ONOFF, 1, 1, 0),
+    (s(1.0), ONOFF, 1, 1, 0),
+    # Two endpoints do not suppress each other
+    (s(2.0), ONOFF, 2, 1, 0),
+    (s(2.01), ONOFF, 1, 1, 0),
+    # The scheduler wheel, relative and absolute, one past the longest delay
+    (s(4.0), CONTROL, TRIGGER_DELAY, 0, 1500),
+    (s(4.1), CONTROL, TRIGGER_AT_UTC, 0, 0),    # filled in below
+    (s(4.2), CONTROL, TRIGGER_DELAY, 0, 3600001),
+    (s(7.0), CONTROL, PULSE_DURATION, 0, 800),
+    (s(7.5), CONTROL, PULSE_DURATION, 0, 20),   # below the minimum, refused
+    # Button clicks: pattern 1 replaces the single click, no pattern 2 or 3
+    (s(8.0), BUTTON, 0, 0, 40000),
+    (s(12.0), BUTTON, 1, 0, 41000),
+    (s(20.0), BUTTON, 2, 0, 42000),
+    (s(23.0), BUTTON, 4, 0, 5100000),
+    # The rate limiter: the fourth back-to-back fire finds the bucket empty
+    (s(24.0), CONTROL, PULSE_DURATION, 0, 100),
+    (s(25.0), FIRE, CONSOLE, 1, 0),
+    (s(25.2), FIRE, CONSOLE, 1, 0),
+    (s(25.4), FIRE, CONSOLE, 1, 0),
+    (s(25.6), FIRE, CONSOLE, 1, 0),
+    # The duty budget: 2 s patterns every 2.5 s until 15 s of a minute are spent
+] + [(s(30.0 + 2.5 * i), FIRE, HOST, 1, 7) for i in range(9)] + [
+    (s(55.0), CONTROL, TRIGGER_PATTERN, 0, 9),
+    # PIR: occupied by sensor 0, held by sensor 1, a new period only after the hold
+    (s(100.0), PIR_EDGE, 0, 1, 0),
+    (s(101.0), PIR_EDGE, 1, 1, 0),
+    (s(102.0), PIR_EDGE, 0, 0, 0),
+    (s(103.0), PIR_EDGE, 1, 0, 0),
+    (s(110.0), PIR_EDGE, 2, 1, 0),
+    (s(111.0), PIR_EDGE, 2, 0, 0),
+    (s(121.0), PIR_EDGE, 3, 1, 0),
+    (s(121.5), PIR_EDGE, 3, 0, 0),
+    # The busy line
+    (s(130.0), BUSY, 0, 1, 0),
+    (s(130.5), ONOFF, 1, 1, 0),
+    (s(131.0), ONOFF, 1, 0, 0),
+    (s(135.0), BUSY, 0, 0, 0),
+    # Thermal derating: a narrower pulse, the cutoff and its hysteresis, the floor, no reading
+    temperature(140.0, 45.0),
+    (s(141.0), CONTROL, PULSE_DURATION, 0, 1000),
+    (s(142.0), ONOFF, 1, 1, 0),
+    (s(143.0), ONOFF, 1, 0, 0),
+    temperature(150.0, 61.2),
+    (s(151.0), FIRE, CONSOLE, 1, 0),
+    temperature(155.0, 58.04),
+    (s(156.0), FIRE, CONSOLE, 1, 0),
+    temperature(160.0, 56.96),
+    (s(161.0), FIRE, CONSOLE, 2, 0),
+    temperature(165.0, float('nan')),
+    (s(166.0), CONTROL, TRIGGER_PATTERN, 0, 1),
+    # Left pending at the end
+    (s(170.0), CONTROL, TRIGGER_DELAY, 0, 100000),
+    temperature(175.0, 30.0),
+]
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        failures += 1
+        print(f'FAIL {what}')
+
+
+def scenario_log():
+    utc_fire_ms = (s(6.2345) + UTC_OFFSET_US) // 1000
+    lines = [f'trace v1: {len(SCENARIO)} records, 0 overwritten, utc offset {UTC_OFFSET_US} us']
+    for time_us, kind, arg, a, b in SCENARIO:
+        if kind == CONTROL and arg == TRIGGER_AT_UTC:
+            a, b = utc_fire_ms >> 32, utc_fire_ms & 0xFFFFFFFF
+        lines.append(f'trace {RECORD.pack(time_us, kind, arg, a, b).hex()}')
+    return '\n'.join(lines) + '\n'
+
+
+def regenerate(device, patterns):
+    with tempfile.NamedTemporaryFile('w', suffix='.log') as inputs:
+        inputs.write(scenario_log())
+        inputs.flush()
+        dump = subprocess.run([device, '--record', '--patterns', patterns, inputs.name], check=True,
+                              capture_output=True, text=True).stdout
+    with open(SAMPLE, 'w') as f:
+        f.write(dump)
+    print(f'wrote {SAMPLE}')
+
+
+def first_difference(a, b):
+    for n, (x, y) in enumerate(zip(a.splitlines(), b.splitlines()), 1):
+        if x != y:
+            return f'line {n}: firmware "{x}", model "{y}"'
+    return f'{len(a.splitlines())} lines from the firmware, {len(b.splitlines())} from the model'
+
+
+def check_trace(device, patterns, options, log, tmp):
+    name = os.path.basename(log)
+    out = {}
+    for side in ('firmware', 'model'):
+        out[side] = (os.path.join(tmp, f'{side}.decisions'), os.path.join(tmp, f'{side}.edges'))
+    decisions, edges = out['firmware']
+    run = subprocess.run([device, '--patterns', patterns, '--decisions', decisions, '--edges', edges, log],
+                         capture_output=True, text=True)
+    check(run.returncode == 0, f'{name}: the firmware no longer reaches the recorded outcomes '
+                               f'(re-record with --regenerate if that was intended)\n{run.stdout}')
+    decisions, edges = out['model']
+    run = subprocess.run([sys.executable, REPLAY, 'replay', '--patterns', patterns, '--latency-us', '0',
+                          '--decisions', decisions, '--edges', edges] + options + [log],
+                         capture_output=True, text=True)
+    check(run.returncode == 0,
+          f'{name}: trace_replay.py disagrees with the recorded outcomes\n{run.stdout}{run.stderr}')
+
+    for kind, index in (('decisions', 0), ('edges', 1)):
+        with open(out['firmware'][index]) as f:
+            firmware = f.read()
+        with open(out['model'][index]) as f:
+            model = f.read()
+        check(firmware == model, f'{name}: {kind} differ, {first_difference(firmware, model)}')
+        check(firmware != '', f'{name}: no {kind}')
+    print(f'  {name:<22} {"FAILED" if failures else "ok"}')
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(f'usage: {sys.argv[0]} TRACE_DEVICE PATTERN_IMAGE [--regenerate]')
+    device, patterns = sys.argv[1], sys.argv[2]
+    if '--regenerate' in sys.argv[3:]:
+        regenerate(device, patterns)
+    options = subprocess.run([device, '--options'], check=True, capture_output=True, text=True).stdout.split()
+    with tempfile.TemporaryDirectory() as tmp:
+        for log in sorted(glob.glob(os.path.join(HERE, 'traces', '*.log'))):
+            check_trace(device, patterns, options, log, tmp)
+    print('FAIL' if failures else 'PASS')
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,610 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// The trigger path of a prop, fed from a `trace dump` log: the firmware's On/Off dedupe,
+// scheduler wheel, PIR occupancy, thermal derating, rate limiter, pattern library and GPIO
+// output on the simulated clock. The glue between them follows the input handlers and
+// start_trigger() in app_main.cpp; the Matter, console and button plumbing in front of them is
+// left out, since the trace holds what came out of it.
+//
+//   trace_device [--patterns IMAGE] [--decisions FILE] [--edges FILE] LOG
+//       Replays the inputs of the log. Writes the decisions and the signal edges in the formats
+//       of tools/trace_replay.py and exits 1 when a decision differs from the one in the log.
+//   trace_device --record [--patterns IMAGE] LOG
+//       Replays the inputs of the log and prints a new dump with this build's outcomes.
+//   trace_device --options
+//       Prints the tools/trace_replay.py options that describe this build.
+//
+// Like the replay tool, the signal starts as soon as it is requested and a busy record stands
+// for the debounced busy line. Button records are the gestures app_gesture classified, so its
+// own handling of the raw button edges is left to test_app_gesture.
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <esp_timer.h>
+
+#include "app_dedupe.h"
+#include "app_evtlog.h"
+#include "app_gesture.h"
+#include "app_limiter.h"
+#include "app_output.h"
+#include "app_pattern.h"
+#include "app_pir.h"
+#include "app_sched.h"
+#include "app_settings.h"
+#include "app_thermal.h"
+#include "app_trace.h"
+#include "host_fakes.h"
+#include "sdkconfig.h"
+
+#define SIGNAL_GPIO         CONFIG_SKULL_SIGNAL_GPIO
+#define MAX_BURST_PULSES    APP_GESTURE_MAX_CLICKS
+#define SOURCE_COUNT        (APP_EVTLOG_SRC_HOST + 1)
+#define RECORD_CAPACITY     8192
+
+static const char *const SOURCES[SOURCE_COUNT] = {"matter", "scheduled", "console", "motion", "button", "host"};
+static const char *const REASONS[] = {"busy", "duplicate", "rate", "duty", "playing", "thermal"};
+
+typedef struct {
+    std::vector<app_trace_record_t> records;
+    uint32_t overwritten;
+    bool utc_known;
+    int64_t utc_offset_us;
+} trace_t;
+
+typedef struct {
+    int64_t time_us;
+    app_trace_record_t outcome;     // the TRIGGER or IGNORED record the firmware wrote
+    bool matched;                   // a device outcome was left to pair it with
+    app_trace_record_t device;
+} decision_t;
+
+static bool s_busy;
+static std::vector<decision_t> s_decisions;
+static std::deque<app_trace_record_t> s_device[SOURCE_COUNT];
+static app_output_step_t s_burst_steps[2 * MAX_BURST_PULSES - 1];
+static uint32_t s_missing_patterns;
+
+// The last dump in the log; earlier ones are superseded
+static bool parse_log(FILE *f, trace_t *trace)
+{
+    bool found = false;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        const char *header = strstr(line, "trace v");
+        if (header) {
+            int version;
+            unsigned count, overwritten;
+            char offset[32];
+            if (sscanf(header, "trace v%d: %u records, %u overwritten, utc offset %31s", &version, &count,
+                       &overwritten, offset) != 4) {
+                continue;
+            }
+            if (version != APP_TRACE_VERSION) {
+                fprintf(stderr, "unsupported trace version %d\n", version);
+                return false;
+            }
+            found = true;
+            trace->records.clear();
+            trace->overwritten = overwritten;
+            trace->utc_known = strcmp(offset, "unknown") != 0;
+            trace->utc_offset_us = trace->utc_known ? strtoll(offset, NULL, 10) : 0;
+            continue;
+        }
+        const char *hex = strstr(line, "trace ");
+        if (!hex || !found) {
+            continue;
+        }
+        hex += strlen("trace ");
+        uint8_t bytes[sizeof(app_trace_record_t)];
+        size_t n = 0;
+        for (; n < sizeof(bytes); n++) {
+            unsigned byte;
+            if (!isxdigit((unsigned char)hex[2 * n]) || !isxdigit((unsigned char)hex[2 * n + 1]) ||
+                sscanf(hex + 2 * n, "%2x", &byte) != 1) {
+                break;
+            }
+            bytes[n] = (uint8_t)byte;
+        }
+        if (n == sizeof(bytes) && !isxdigit((unsigned char)hex[2 * n])) {
+            app_trace_record_t record;
+            memcpy(&record, bytes, sizeof(record));
+            trace->records.push_back(record);
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "no \"trace v1:\" header found\n");
+    }
+    return found;
+}
+
+// As trace_replay.py words a TRIGGER or IGNORED record
+static std::string describe_outcome(const app_trace_record_t &outcome)
+{
+    char text[48];
+    if (outcome.type == APP_TRACE_IGNORED) {
+        if (outcome.a < sizeof(REASONS) / sizeof(REASONS[0])) {
+            return REASONS[outcome.a];
+        }
+        snprintf(text, sizeof(text), "reason %u", outcome.a);
+    } else if (outcome.b >> 24) {
+        snprintf(text, sizeof(text), "pulse %u ms x%" PRIu32, outcome.a, outcome.b >> 24);
+    } else {
+        snprintf(text, sizeof(text), "pattern, %u ms high", outcome.a);
+    }
+    return text;
+}
+
+static bool same_outcome(const app_trace_record_t &x, const app_trace_record_t &y)
+{
+    return x.type == y.type && x.arg == y.arg && x.a == y.a && (x.type == APP_TRACE_IGNORED || x.b >> 24 == y.b >> 24);
+}
+
+static void decide(app_trace_type_t type, app_evtlog_source_t source, uint16_t a, uint32_t b)
+{
+    app_trace_append(type, source, a, b);
+    decision_t decision = {};
+    decision.time_us = esp_timer_get_time();
+    decision.outcome = {.time_us = decision.time_us, .type = (uint8_t)type, .arg = (uint8_t)source, .a = a, .b = b};
+    std::deque<app_trace_record_t> &pending = s_device[source];
+    if (!pending.empty()) {
+        decision.matched = true;
+        decision.device = pending.front();
+        pending.pop_front();
+    }
+    s_decisions.push_back(decision);
+}
+
+static void note_ignored(app_evtlog_source_t source, app_evtlog_ignore_reason_t reason)
+{
+    decide(APP_TRACE_IGNORED, source, reason, 0);
+}
+
+// start_trigger() of app_main.cpp with CONFIG_SKULL_THERMAL and the busy line
+static void start_trigger(app_evtlog_source_t source, uint8_t pulses, uint8_t pattern_id)
+{
+    int64_t request_us = esp_timer_get_time();
+    uint32_t pulse_ms = app_settings_get_pulse_ms();
+    app_pattern_info_t info = {};
+    if (pattern_id != 0 && app_pattern_find(pattern_id, &info) != ESP_OK) {
+        s_missing_patterns++;
+        return;
+    }
+    if (app_output_is_active(APP_OUTPUT_CHANNEL_SIGNAL)) {
+        note_ignored(source, APP_EVTLOG_IGNORED_BUSY);
+        return;
+    }
+    if (s_busy) {
+        note_ignored(source, APP_EVTLOG_IGNORED_PLAYING);
+        return;
+    }
+    uint8_t thermal_pct = app_thermal_scale_pct();
+    if (thermal_pct == 0) {
+        note_ignored(source, APP_EVTLOG_IGNORED_THERMAL);
+        return;
+    }
+    if (thermal_pct < 100) {
+        uint32_t max_pulse_ms = app_thermal_max_pulse_ms(thermal_pct, APP_SETTINGS_PULSE_MS_MIN);
+        pulse_ms = pulse_ms > max_pulse_ms ? max_pulse_ms : pulse_ms;
+    }
+    uint32_t high_us = pattern_id != 0 ? info.high_us : pulses * pulse_ms * 1000;
+    app_limiter_verdict_t verdict =
+        app_limiter_acquire(APP_OUTPUT_CHANNEL_SIGNAL, high_us, request_us, thermal_pct);
+    if (verdict != APP_LIMITER_ALLOWED) {
+        note_ignored(source, verdict == APP_LIMITER_REJECTED_RATE ? APP_EVTLOG_IGNORED_RATE : APP_EVTLOG_IGNORED_DUTY);
+        return;
+    }
+    esp_err_t err;
+    if (pattern_id != 0) {
+        err = app_pattern_play(APP_OUTPUT_CHANNEL_SIGNAL, pattern_id);
+    } else if (pulses <= 1) {
+        err = app_output_pulse(APP_OUTPUT_CHANNEL_SIGNAL, pulse_ms * 1000);
+    } else {
+        pulses = pulses > MAX_BURST_PULSES ? MAX_BURST_PULSES : pulses;
+        uint16_t step_count = 0;
+        for (uint8_t i = 0; i < pulses; i++) {
+            if (i > 0) {
+                s_burst_steps[step_count++] = {.duration_us = CONFIG_SKULL_BUTTON_BURST_GAP_MS * 1000, .level = 0};
+            }
+            s_burst_steps[step_count++] = {.duration_us = pulse_ms * 1000, .level = 1};
+        }
+        app_output_pattern_t pattern = {.steps = s_burst_steps, .step_count = step_count};
+        err = app_output_play(APP_OUTPUT_CHANNEL_SIGNAL, &pattern);
+    }
+    if (err != ESP_OK) {
+        app_limiter_refund(APP_OUTPUT_CHANNEL_SIGNAL, high_us, request_us);
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        note_ignored(source, APP_EVTLOG_IGNORED_BUSY);
+        return;
+    }
+    if (err != ESP_OK) {
+        fprintf(stderr, "failed to start the signal: %s\n", esp_err_to_name(err));
+        return;
+    }
+    uint32_t latency_us = (uint32_t)(esp_timer_get_time() - request_us);
+    uint32_t traced = (latency_us > 0xFFFFFF ? 0xFFFFFF : latency_us) |
+                      (uint32_t)(pattern_id != 0 ? 0 : pulses) << 24;
+    uint32_t high_ms = pattern_id != 0 ? info.high_us / 1000 : pulse_ms;
+    decide(APP_TRACE_TRIGGER, source, high_ms > UINT16_MAX ? UINT16_MAX : (uint16_t)high_ms, traced);
+}
+
+static void scheduled_trigger_cb(void *arg)
+{
+    start_trigger(APP_EVTLOG_SRC_SCHEDULED, 1, 0);
+}
+
+static void pir_occupancy_cb(bool occupied, uint8_t first_sensor, void *user_data)
+{
+#if CONFIG_SKULL_PIR_TRIGGER
+    if (occupied) {
+        start_trigger(APP_EVTLOG_SRC_MOTION, 1, 0);
+    }
+#endif
+}
+
+static esp_err_t init_pir_input(uint32_t hold_s)
+{
+    static const int gpios[] = {CONFIG_SKULL_PIR1_GPIO, CONFIG_SKULL_PIR2_GPIO, CONFIG_SKULL_PIR3_GPIO,
+                                CONFIG_SKULL_PIR4_GPIO};
+    app_pir_config_t pir_config;
+    // The recorded edges are the ones the device's debounce let through
+    for (size_t i = 0; i < APP_PIR_MAX_SENSORS; i++) {
+        pir_config.sensors[i] = {.gpio_num = gpios[i], .debounce_ms = 0};
+    }
+    pir_config.sensor_count = APP_PIR_MAX_SENSORS;
+    pir_config.hold_ms = hold_s * 1000;
+    pir_config.occupancy_cb = pir_occupancy_cb;
+    return app_pir_init(&pir_config);
+}
+
+static esp_err_t init_thermal(void)
+{
+    app_thermal_config_t thermal_config;
+    thermal_config.derate_start_c = CONFIG_SKULL_THERMAL_DERATE_START_C;
+    thermal_config.derate_full_c = CONFIG_SKULL_THERMAL_DERATE_FULL_C;
+    thermal_config.min_scale_pct = CONFIG_SKULL_THERMAL_MIN_SCALE_PCT;
+    thermal_config.cutoff_c = CONFIG_SKULL_THERMAL_CUTOFF_C;
+    thermal_config.hysteresis_c = CONFIG_SKULL_THERMAL_HYSTERESIS_C;
+    thermal_config.unknown_scale_pct = CONFIG_SKULL_THERMAL_UNKNOWN_SCALE_PCT;
+    thermal_config.max_pulse_ms = CONFIG_SKULL_THERMAL_MAX_PULSE_MS;
+    return app_thermal_init(&thermal_config);
+}
+
+// The recorded scale is where the samples before the trace left the curve; find a reading that
+// gives it, from the hot end so a recorded cutoff is latched
+static void seed_thermal(uint8_t scale_pct)
+{
+    if (app_thermal_scale_pct() == scale_pct) {
+        return;
+    }
+    for (int dc = CONFIG_SKULL_THERMAL_CUTOFF_C * 10; dc >= CONFIG_SKULL_THERMAL_DERATE_START_C * 10; dc--) {
+        if (app_thermal_update(dc / 10.0f) == scale_pct) {
+            return;
+        }
+    }
+    if (app_thermal_update(NAN) != scale_pct) {
+        fprintf(stderr, "no reading gives the recorded thermal scale of %u%%\n", scale_pct);
+    }
+}
+
+static void handle_control(const app_trace_record_t &r)
+{
+    switch (r.arg) {
+    case APP_TRACE_TRIGGER_DELAY:
+        app_sched_after(r.b, scheduled_trigger_cb, NULL);
+        break;
+    case APP_TRACE_TRIGGER_AT_UTC:
+        app_sched_at_utc((uint64_t)r.a << 32 | r.b, scheduled_trigger_cb, NULL);
+        break;
+    case APP_TRACE_PULSE_DURATION:
+        app_settings_set_pulse_ms(r.b);
+        break;
+    case APP_TRACE_TRIGGER_PATTERN:
+        if (r.b != 0) {
+            start_trigger(APP_EVTLOG_SRC_MATTER, 1, (uint8_t)r.b);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void handle(const app_trace_record_t &r)
+{
+    switch (r.type) {
+    case APP_TRACE_START:
+        s_busy = r.arg != 0;
+        app_settings_set_pulse_ms(r.a);
+        seed_thermal((uint8_t)(r.b >> 16));
+        break;
+    case APP_TRACE_ONOFF: {
+        bool on = r.a != 0;
+        bool duplicate = app_dedupe_check(r.arg, on, esp_timer_get_time());
+        app_dedupe_commit(0);
+        if (duplicate) {
+            if (on) {
+                note_ignored(APP_EVTLOG_SRC_MATTER, APP_EVTLOG_IGNORED_DUPLICATE);
+            }
+        } else if (on) {
+            start_trigger(APP_EVTLOG_SRC_MATTER, 1, 0);
+        } else {
+            app_output_stop(APP_OUTPUT_CHANNEL_SIGNAL);
+        }
+        break;
+    }
+    case APP_TRACE_CONTROL:
+        handle_control(r);
+        break;
+    case APP_TRACE_PIR_EDGE:
+        app_pir_handle_edge(r.arg, r.a != 0, esp_timer_get_time());
+        break;
+    case APP_TRACE_BUTTON:
+#if CONFIG_SKULL_BUTTON_TRIGGER
+        if (r.arg <= APP_GESTURE_TRIPLE) {
+            uint8_t clicks = r.arg - APP_GESTURE_SINGLE + 1;
+            if (app_pattern_find(clicks, NULL) == ESP_OK) {
+                start_trigger(APP_EVTLOG_SRC_BUTTON, 1, clicks);
+            } else {
+                start_trigger(APP_EVTLOG_SRC_BUTTON, clicks, 0);
+            }
+        }
+#endif
+        break;
+    case APP_TRACE_BUSY:
+        s_busy = r.a != 0;
+        break;
+    case APP_TRACE_TEMPERATURE: {
+        float celsius;
+        memcpy(&celsius, &r.b, sizeof(celsius));
+        app_thermal_update(celsius);
+        break;
+    }
+    case APP_TRACE_FIRE:
+        start_trigger((app_evtlog_source_t)r.arg, (uint8_t)r.a, (uint8_t)r.b);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool load_patterns(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    // Played in place, so it stays for the whole run
+    static std::vector<uint8_t> image;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    fclose(f);
+    esp_err_t err = app_pattern_load(image.data(), image.size());
+    if (err != ESP_OK) {
+        fprintf(stderr, "%s: %s\n", path, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+static bool boot(const char *patterns)
+{
+    app_output_config_t output_config = {.gpio_num = SIGNAL_GPIO};
+    app_limiter_config_t limiter_config;
+    if (app_settings_init() != ESP_OK || app_output_init(APP_OUTPUT_CHANNEL_SIGNAL, &output_config) != ESP_OK ||
+        app_limiter_init(APP_OUTPUT_CHANNEL_SIGNAL, &limiter_config) != ESP_OK || app_sched_init() != ESP_OK ||
+        init_thermal() != ESP_OK) {
+        fprintf(stderr, "boot failed\n");
+        return false;
+    }
+    return !patterns || load_patterns(patterns);
+}
+
+static void run(const trace_t &trace)
+{
+    const app_trace_record_t &first = trace.records.front();
+    host_advance_us(first.time_us - esp_timer_get_time());
+    if (trace.utc_known) {
+        host_set_utc_offset_us(trace.utc_offset_us);
+    }
+    uint32_t hold_s =
+        first.type == APP_TRACE_START ? first.b & 0xFFFF : CONFIG_PIR_OCCUPIED_TO_UNOCCUPIED_DELAY_SECONDS;
+    if (init_pir_input(hold_s) != ESP_OK) {
+        fprintf(stderr, "PIR hold of %" PRIu32 " s refused\n", hold_s);
+    }
+    for (const app_trace_record_t &r : trace.records) {
+        if (r.type == APP_TRACE_TRIGGER || r.type == APP_TRACE_IGNORED) {
+            continue;
+        }
+        // Timers due by then run first, as in trace_replay.py
+        host_advance_us(r.time_us - esp_timer_get_time());
+        app_trace_append((app_trace_type_t)r.type, r.arg, r.a, r.b);
+        handle(r);
+    }
+    // The replay stops at the last record: what was scheduled past it never fires, what is
+    // playing plays out
+    size_t pending = app_sched_pending();
+    if (pending) {
+        fprintf(stderr, "scheduled triggers still pending at the end: %zu\n", pending);
+    }
+    app_sched_cancel_all();
+    while (app_output_is_active(APP_OUTPUT_CHANNEL_SIGNAL)) {
+        host_advance_us(1000);
+    }
+}
+
+static bool write_file(const char *path, const std::string &text)
+{
+    FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fputs(text.c_str(), f);
+    return f == stdout || fclose(f) == 0;
+}
+
+// "<us from the first record> <level>" per change of the signal line
+static std::string edge_timeline(int64_t t0)
+{
+    std::string text;
+    uint32_t level = 0;
+    for (const host_edge_t &edge : host_gpio_edges()) {
+        if (edge.gpio_num != SIGNAL_GPIO || edge.level == level) {
+            continue;
+        }
+        level = edge.level;
+        text += std::to_string(edge.time_us - t0) + " " + std::to_string(level) + "\n";
+    }
+    return text;
+}
+
+// "<us from the first record> <source> <decision>" per trigger
+static std::string decision_list(int64_t t0)
+{
+    std::string text;
+    for (const decision_t &d : s_decisions) {
+        text += std::to_string(d.time_us - t0) + " " + SOURCES[d.outcome.arg] + " " + describe_outcome(d.outcome);
+        text += "\n";
+    }
+    return text;
+}
+
+static int report(const trace_t &trace)
+{
+    int64_t t0 = trace.records.front().time_us;
+    size_t differ = 0;
+    for (const decision_t &d : s_decisions) {
+        if (!d.matched || !same_outcome(d.outcome, d.device)) {
+            differ++;
+            printf("  %12.6f %-9s firmware: %-24s device: %s\n", (d.time_us - t0) / 1e6, SOURCES[d.outcome.arg],
+                   describe_outcome(d.outcome).c_str(), d.matched ? describe_outcome(d.device).c_str() : "-");
+        }
+    }
+    size_t unmatched = 0;
+    for (size_t source = 0; source < SOURCE_COUNT; source++) {
+        for (const app_trace_record_t &r : s_device[source]) {
+            unmatched++;
+            printf("  %12.6f %-9s firmware: %-24s device: %s\n", (r.time_us - t0) / 1e6, SOURCES[source], "-",
+                   describe_outcome(r).c_str());
+        }
+    }
+    printf("%zu decisions, %zu as on the device, %zu differ, %zu device outcomes left unmatched\n",
+           s_decisions.size(), s_decisions.size() - differ, differ, unmatched);
+    if (s_missing_patterns) {
+        printf("patterns not in the library: %" PRIu32 "\n", s_missing_patterns);
+    }
+    return differ || unmatched ? 1 : 0;
+}
+
+static void print_options(void)
+{
+    printf("--pulse-ms %d --pir-hold-s %d --dedupe-window-ms %d --sched-tick-ms %d --sched-max-pending %d "
+           "--sched-max-delay-ms %d --burst-gap-ms %d --%sbutton-trigger --%spir-trigger --thermal --start %d "
+           "--full %d --floor %d --cutoff %d --hysteresis %d --unknown %d --max-pulse-ms %d --burst %d "
+           "--refill-ms %d --window-ms %d --max-duty %d\n",
+           CONFIG_SKULL_PULSE_DURATION_MS, CONFIG_PIR_OCCUPIED_TO_UNOCCUPIED_DELAY_SECONDS,
+           CONFIG_SKULL_DEDUPE_WINDOW_MS, CONFIG_SKULL_SCHED_TICK_MS, CONFIG_SKULL_SCHED_MAX_PENDING,
+           CONFIG_SKULL_SCHED_MAX_DELAY_MS, CONFIG_SKULL_BUTTON_BURST_GAP_MS, CONFIG_SKULL_BUTTON_TRIGGER ? "" : "no-",
+           CONFIG_SKULL_PIR_TRIGGER ? "" : "no-", CONFIG_SKULL_THERMAL_DERATE_START_C,
+           CONFIG_SKULL_THERMAL_DERATE_FULL_C, CONFIG_SKULL_THERMAL_MIN_SCALE_PCT, CONFIG_SKULL_THERMAL_CUTOFF_C,
+           CONFIG_SKULL_THERMAL_HYSTERESIS_C, CONFIG_SKULL_THERMAL_UNKNOWN_SCALE_PCT, CONFIG_SKULL_THERMAL_MAX_PULSE_MS,
+           CONFIG_SKULL_LIMIT_BURST, CONFIG_SKULL_LIMIT_REFILL_MS, CONFIG_SKULL_LIMIT_DUTY_WINDOW_MS,
+           CONFIG_SKULL_LIMIT_MAX_DUTY_PCT);
+}
+
+static int usage(void)
+{
+    fprintf(stderr, "usage: trace_device [--record] [--patterns IMAGE] [--decisions FILE] [--edges FILE] LOG\n"
+                    "       trace_device --options\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    bool record = false;
+    const char *patterns = NULL, *decisions = NULL, *edges = NULL, *log = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--options") == 0) {
+            print_options();
+            return 0;
+        } else if (strcmp(argv[i], "--record") == 0) {
+            record = true;
+        } else if (strcmp(argv[i], "--patterns") == 0 && i + 1 < argc) {
+            patterns = argv[++i];
+        } else if (strcmp(argv[i], "--decisions") == 0 && i + 1 < argc) {
+            decisions = argv[++i];
+        } else if (strcmp(argv[i], "--edges") == 0 && i + 1 < argc) {
+            edges = argv[++i];
+        } else if (argv[i][0] != '-' && !log) {
+            log = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!log) {
+        return usage();
+    }
+
+    FILE *f = fopen(log, "r");
+    if (!f) {
+        perror(log);
+        return 2;
+    }
+    trace_t trace = {};
+    bool parsed = parse_log(f, &trace);
+    fclose(f);
+    if (!parsed || trace.records.empty()) {
+        fprintf(stderr, "%s: no trace records\n", log);
+        return 2;
+    }
+    for (const app_trace_record_t &r : trace.records) {
+        if ((r.type == APP_TRACE_TRIGGER || r.type == APP_TRACE_IGNORED) && r.arg < SOURCE_COUNT) {
+            s_device[r.arg].push_back(r);
+        }
+    }
+
+    // The firmware's logs go to stderr; stdout is the report, or the dump when recording
+    fflush(stdout);
+    int report_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    if (!boot(patterns)) {
+        return 2;
+    }
+    if (record && app_trace_start(RECORD_CAPACITY) != ESP_OK) {
+        return 2;
+    }
+    run(trace);
+    fflush(stdout);
+    dup2(report_fd, STDOUT_FILENO);
+    close(report_fd);
+
+    if (record) {
+        app_trace_dump();
+        return 0;
+    }
+    int64_t t0 = trace.records.front().time_us;
+    if ((edges && !write_file(edges, edge_timeline(t0))) || (decisions && !write_file(decisions, decision_list(t0)))) {
+        return 2;
+    }
+    return report(trace);
+}
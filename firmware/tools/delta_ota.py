@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Build a Matter OTA image that carries a delta patch instead of a full firmware.
+
+The device must be running exactly the base image: esp_delta_ota checks the base
+digest embedded in the patch before applying it, and the rebuilt image is verified
+by esp_ota_end() before it is marked bootable. Only devices built with
+sdkconfig.delta_ota accept patches, and those accept nothing else.
+
+Before wrapping the patch, the tool applies it to the base image on the host with
+detools, the library whose C port runs on the device, and compares the result with
+the new image. The time of that apply alone is reported as the host throughput.
+
+Example:
+    python tools/delta_ota.py --base old/sensors.bin --new build/sensors.bin \\
+        --vendor-id 0xFFF1 --product-id 0x8001 --version 2 --version-str 1.1 \\
+        --out build/sensors-delta.ota
+"""
+
+import argparse
+import glob
+import io
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+FIRMWARE_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# esp_delta_ota puts a fixed header in front of the detools patch: magic, then the
+# SHA-256 of the base image, then reserved bytes up to 64
+DELTA_MAGIC = 0xFCCDDE10
+DELTA_HEADER_SIZE = 64
+
+
+def find_tool(explicit, patterns, name):
+    if explicit:
+        return explicit
+    roots = [FIRMWARE_DIR]
+    if os.environ.get('ESP_MATTER_PATH'):
+        roots.append(os.environ['ESP_MATTER_PATH'])
+    for root in roots:
+        for pattern in patterns:
+            matches = sorted(glob.glob(os.path.join(root, pattern), recursive=True))
+            if matches:
+                return matches[0]
+    sys.exit(f'Could not find {name}; pass its path explicitly')
+
+
+def run(args):
+    subprocess.run([sys.executable] + args, check=True)
+
+
+def apply_patch(base, patch):
+    """Apply an esp_delta_ota patch to the base image bytes.
+
+    Returns (new image bytes, seconds spent in the apply itself).
+    """
+    import detools
+
+    if len(patch) < DELTA_HEADER_SIZE or struct.unpack_from('<I', patch)[0] != DELTA_MAGIC:
+        raise ValueError('not an esp_delta_ota patch (bad magic)')
+    out = io.BytesIO()
+    start = time.perf_counter()
+    detools.apply_patch(io.BytesIO(base), io.BytesIO(patch[DELTA_HEADER_SIZE:]), out)
+    return out.getvalue(), time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--base', required=True, help='firmware image currently running on the devices')
+    parser.add_argument('--new', required=True, help='firmware image to update to')
+    parser.add_argument('--out', required=True, help='Matter OTA image to write')
+    parser.add_argument('--chip', default='esp32c3')
+    parser.add_argument('--vendor-id', required=True)
+    parser.add_argument('--product-id', required=True)
+    parser.add_argument('--version', required=True, help='new software version number (PROJECT_VER_NUMBER)')
+    parser.add_argument('--version-str', required=True, help='new software version string (PROJECT_VER)')
+    parser.add_argument('--patch-gen', help='path to esp_delta_ota_patch_gen.py')
+    parser.add_argument('--ota-image-tool', help='path to connectedhomeip src/app/ota_image_tool.py')
+    parser.add_argument('--no-verify', action='store_true', help='skip applying the patch on the host')
+    args = parser.parse_args()
+
+    patch_gen = find_tool(args.patch_gen, ['managed_components/espressif__esp_delta_ota/**/esp_delta_ota_patch_gen.py'],
+                          'esp_delta_ota_patch_gen.py')
+    ota_image_tool = find_tool(args.ota_image_tool, ['managed_components/**/src/app/ota_image_tool.py',
+                                                     'connectedhomeip/connectedhomeip/src/app/ota_image_tool.py'],
+                               'ota_image_tool.py')
+
+    with tempfile.TemporaryDirectory() as tmp:
+        patch = os.path.join(tmp, 'patch.bin')
+        run([patch_gen, 'create_patch', '--chip', args.chip, '--base_binary', args.base,
+             '--new_binary', args.new, '--patch_file_name', patch])
+
+        apply_s = None
+        if not args.no_verify:
+            with open(args.base, 'rb') as f:
+                base = f.read()
+            with open(args.new, 'rb') as f:
+                new = f.read()
+            with open(patch, 'rb') as f:
+                rebuilt, apply_s = apply_patch(base, f.read())
+            if rebuilt != new:
+                sys.exit('The patch does not rebuild the new image; not writing an OTA image')
+
+        run([ota_image_tool, 'create', '-v', args.vendor_id, '-p', args.product_id, '-vn', args.version,
+             '-vs', args.version_str, '-da', 'sha256', patch, args.out])
+
+        new_size = os.path.getsize(args.new)
+        patch_size = os.path.getsize(patch)
+
+    print(f'base image : {os.path.getsize(args.base):>9} bytes')
+    print(f'new image  : {new_size:>9} bytes')
+    print(f'patch      : {patch_size:>9} bytes ({100.0 * patch_size / new_size:.1f}% of a full image)')
+    print(f'OTA image  : {os.path.getsize(args.out):>9} bytes -> {args.out}')
+    if apply_s:
+        print(f'host apply : {new_size / apply_s / 1024:.0f} KiB/s of output image')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,581 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Host side of the binary console protocol (main/app_hostlink.h), for setting up and
+testing many props at once.
+
+HostLink opens a console port, sends the `hostlink` command and then talks frames until
+it is closed, which hands the console back to the REPL. It can be imported as a library;
+every command below takes any number of ports and drives them in parallel, one thread
+per port. Only the standard library is needed (termios), so it runs on Linux and macOS.
+
+Commands:
+    info       protocol version and device profile
+    provision  stage settings and/or upload a pattern library
+    fire       fire pulses or a library pattern
+    stats      counters, and with --histogram the trigger latency histogram
+    check      protocol checks to run on a prop before provisioning a batch: staging
+               settings round trips, and a signal pin the prop cannot use is refused
+    logs       stream the ESP_LOG output of the devices until interrupted
+    bench      counter readout and pattern upload over the protocol against the same
+               work done through the text console commands
+
+Example:
+    python tools/hostlink.py info /dev/ttyUSB0 /dev/ttyUSB1
+    python tools/hostlink.py provision --set pulse_ms=800 --set pir_hold_s=30 --patterns patterns.bin /dev/ttyUSB*
+    python tools/hostlink.py stats --histogram /dev/ttyUSB0
+    python tools/hostlink.py check --bad-pin 9 /dev/ttyUSB0
+    python tools/hostlink.py bench --count 200 --patterns patterns.bin /dev/ttyUSB0
+"""
+
+import argparse
+import concurrent.futures
+import os
+import select
+import struct
+import sys
+import termios
+import threading
+import time
+import tty
+
+SOF = 0xA7
+VERSION = 1
+RESPONSE = 0x80
+
+OP_HELLO = 0x01
+OP_CONFIG_GET = 0x02
+OP_CONFIG_SET = 0x03
+OP_PATTERN_BEGIN = 0x04
+OP_PATTERN_DATA = 0x05
+OP_PATTERN_COMMIT = 0x06
+OP_FIRE = 0x07
+OP_STATS = 0x08
+OP_HISTOGRAM = 0x09
+OP_LOG = 0x0A
+OP_EXIT = 0x0F
+OP_LOG_LINE = 0x40
+
+SETTINGS = struct.Struct('<HbHI')
+SETTINGS_FIELDS = ('pulse_ms', 'signal_gpio', 'pir_hold_s', 'shtc3_interval_ms')
+
+STATS = struct.Struct('<10I3IHH4Ii2I')
+STATS_FIELDS = ('triggers', 'ignored', 'rate_limited', 'last_latency_us', 'p99_latency_us', 'pir_edges',
+                'sensor_errors', 'uptime_s', 'reports_saved', 'thermal_throttle',
+                'limiter_allowed', 'limiter_rejected_rate', 'limiter_rejected_duty', 'duty_permille', 'tokens',
+                'sched_scheduled', 'sched_fired', 'sched_late', 'sched_dropped', 'sched_max_lag_us',
+                'evtlog_appended', 'evtlog_dropped')
+
+ESP_ERR_INVALID_ARG = 0x102
+
+ERRORS = {
+    0x101: 'ESP_ERR_NO_MEM',
+    0x102: 'ESP_ERR_INVALID_ARG',
+    0x103: 'ESP_ERR_INVALID_STATE',
+    0x104: 'ESP_ERR_INVALID_SIZE',
+    0x105: 'ESP_ERR_NOT_FOUND',
+    0x106: 'ESP_ERR_NOT_SUPPORTED',
+    0x107: 'ESP_ERR_TIMEOUT',
+    0x109: 'ESP_ERR_INVALID_CRC',
+    0x10A: 'ESP_ERR_INVALID_VERSION',
+}
+
+# The console commands the pattern upload bench sends; pattern_compile.py console uses the same chunk
+TEXT_CHUNK = 96
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, as app_hostlink_crc16()."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def encode(seq, op, payload=b''):
+    body = struct.pack('<HBB', len(payload) + 2, seq & 0xFF, op) + payload
+    return bytes([SOF]) + body + struct.pack('>H', crc16(body))
+
+
+class Parser:
+    """Byte-at-a-time decoder with the same resynchronisation rules as app_hostlink_parse()."""
+
+    def __init__(self, max_payload=1024):
+        self.max_payload = max_payload
+        self.state = 'sof'
+        self.buf = bytearray()
+        self.errors = 0
+
+    def feed(self, data):
+        frames = []
+        for byte in data:
+            if self.state == 'sof':
+                if byte == SOF:
+                    self.state = 'len'
+                    self.buf = bytearray()
+                else:
+                    self.errors += 1
+                continue
+            self.buf.append(byte)
+            if self.state == 'len':
+                if len(self.buf) < 2:
+                    continue
+                length = self.buf[0] | self.buf[1] << 8
+                if not 2 <= length <= self.max_payload + 2:
+                    self.state = 'len' if byte == SOF else 'sof'
+                    self.buf = bytearray()
+                    self.errors += 3
+                    continue
+                self.state = 'body'
+            elif len(self.buf) == (self.buf[0] | self.buf[1] << 8) + 4:
+                self.state = 'sof'
+                covered = len(self.buf) - 2
+                if struct.unpack('>H', self.buf[covered:])[0] != crc16(self.buf[:covered]):
+                    self.errors += len(self.buf) + 1
+                    continue
+                frames.append((self.buf[2], self.buf[3], bytes(self.buf[4:covered])))
+        return frames
+
+
+class Port:
+    """Raw serial port (or pseudo-terminal) that counts the bytes it moves."""
+
+    def __init__(self, path, baud=115200):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        speed = getattr(termios, f'B{baud}', None)
+        if speed is not None:
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.tx_bytes = 0
+        self.rx_bytes = 0
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            written = os.write(self.fd, view)
+            view = view[written:]
+        self.tx_bytes += len(data)
+
+    def read(self, timeout):
+        if not select.select([self.fd], [], [], max(timeout, 0))[0]:
+            return b''
+        data = os.read(self.fd, 4096)
+        self.rx_bytes += len(data)
+        return data
+
+    def drain(self, quiet=0.05):
+        while self.read(quiet):
+            pass
+
+    def close(self):
+        os.close(self.fd)
+
+
+class HostLinkError(Exception):
+    def __init__(self, message, status=None):
+        super().__init__(message)
+        self.status = status    # the device's esp_err_t, if it answered with an error
+
+
+class HostLink:
+    """One device in a protocol session. Use as a context manager so the REPL gets the console back."""
+
+    def __init__(self, path, baud=115200, timeout=1.0, on_log=None):
+        self.path = path
+        self.port = Port(path, baud)
+        self.timeout = timeout
+        self.on_log = on_log
+        self.parser = Parser()
+        self.seq = 0
+        self.max_payload = 0
+        self.profile = ''
+        self._open()
+
+    def _open(self):
+        # A fresh line first, in case something was typed; the echo and prompt are not frames
+        self.port.write(b'\r')
+        self.port.drain()
+        self.port.write(b'hostlink\r')
+        for _ in range(3):
+            try:
+                version, self.max_payload, self.profile = self.hello()
+                break
+            except HostLinkError:
+                continue
+        else:
+            self.port.close()
+            raise HostLinkError(f'{self.path}: no answer to hostlink')
+        if version != VERSION:
+            self.port.close()
+            raise HostLinkError(f'{self.path}: protocol version {version}, expected {VERSION}')
+        self.parser.max_payload = self.max_payload
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self):
+        try:
+            self.request(OP_EXIT)
+        except (HostLinkError, OSError):
+            pass  # the idle timeout ends the session anyway
+        self.port.close()
+
+    def request(self, op, payload=b''):
+        """Send one request and return the data of its answer; log lines are passed to on_log."""
+        self.seq = (self.seq + 1) & 0xFF
+        self.port.write(encode(self.seq, op, payload))
+        deadline = time.monotonic() + self.timeout
+        while time.monotonic() < deadline:
+            for seq, rop, data in self.parser.feed(self.port.read(deadline - time.monotonic())):
+                if rop == OP_LOG_LINE:
+                    if self.on_log:
+                        self.on_log(self.path, data.decode(errors='replace'))
+                elif rop == op | RESPONSE and seq == self.seq:
+                    status = struct.unpack_from('<h', data)[0] & 0xFFFF
+                    if status:
+                        raise HostLinkError(f'{self.path}: op 0x{op:02x} failed: {ERRORS.get(status, hex(status))}',
+                                            status)
+                    return data[2:]
+        raise HostLinkError(f'{self.path}: op 0x{op:02x} timed out')
+
+    def poll_logs(self, timeout):
+        """Wait up to timeout for unsolicited log lines."""
+        for _, op, data in self.parser.feed(self.port.read(timeout)):
+            if op == OP_LOG_LINE and self.on_log:
+                self.on_log(self.path, data.decode(errors='replace'))
+
+    def hello(self):
+        data = self.request(OP_HELLO)
+        version, max_payload = struct.unpack_from('<BH', data)
+        return version, max_payload, data[3:].decode(errors='replace')
+
+    def config_get(self):
+        """Settings the next boot will use, and whether any of them still wait for a reboot."""
+        data = self.request(OP_CONFIG_GET)
+        return dict(zip(SETTINGS_FIELDS, SETTINGS.unpack_from(data))), bool(data[SETTINGS.size])
+
+    def config_set(self, **changes):
+        unknown = set(changes) - set(SETTINGS_FIELDS)
+        if unknown:
+            raise ValueError(f'unknown settings: {", ".join(sorted(unknown))}')
+        settings, _ = self.config_get()
+        settings.update(changes)
+        try:
+            payload = SETTINGS.pack(*(settings[f] for f in SETTINGS_FIELDS))
+        except struct.error as e:
+            raise ValueError(f'setting out of range: {e}') from None
+        self.request(OP_CONFIG_SET, payload)
+        return settings
+
+    def upload_patterns(self, image):
+        """Replace the pattern library; returns the number of patterns loaded."""
+        self.request(OP_PATTERN_BEGIN, struct.pack('<I', len(image)))
+        chunk = self.max_payload - 4
+        for offset in range(0, len(image), chunk):
+            self.request(OP_PATTERN_DATA, struct.pack('<I', offset) + image[offset:offset + chunk])
+        return struct.unpack('<H', self.request(OP_PATTERN_COMMIT))[0]
+
+    def fire(self, pulses=1, pattern=0):
+        self.request(OP_FIRE, bytes([pulses, pattern]))
+
+    def stats(self):
+        return dict(zip(STATS_FIELDS, STATS.unpack_from(self.request(OP_STATS))))
+
+    def histogram(self):
+        """(upper bound in us, count) of every non-empty latency bucket."""
+        data = self.request(OP_HISTOGRAM)
+        return [struct.unpack_from('<II', data, i) for i in range(0, len(data), 8)]
+
+    def stream_logs(self, enable=True):
+        self.request(OP_LOG, bytes([1 if enable else 0]))
+
+
+def run_parallel(ports, job, jobs):
+    """Run job(path) on every port, jobs at a time; returns {path: result or exception}."""
+    results = {}
+    with concurrent.futures.ThreadPoolExecutor(max_workers=jobs) as pool:
+        futures = {pool.submit(job, path): path for path in ports}
+        for future in concurrent.futures.as_completed(futures):
+            try:
+                results[futures[future]] = future.result()
+            except (HostLinkError, OSError, ValueError) as e:
+                results[futures[future]] = e
+    return results
+
+
+def report(results):
+    failed = 0
+    for path in sorted(results):
+        result = results[path]
+        if isinstance(result, Exception):
+            failed += 1
+            print(f'{path}: FAILED {result}')
+        else:
+            print(f'{path}: {result}')
+    if failed:
+        sys.exit(f'{failed} of {len(results)} devices failed')
+
+
+def parse_setting(text):
+    name, sep, value = text.partition('=')
+    if not sep or name not in SETTINGS_FIELDS:
+        raise argparse.ArgumentTypeError(f'expected <name>=<value>, name one of {", ".join(SETTINGS_FIELDS)}')
+    return name, int(value, 0)
+
+
+def cmd_info(args):
+    def job(path):
+        with HostLink(path, args.baud, args.timeout) as link:
+            settings, pending = link.config_get()
+            return f'profile {link.profile}, {settings}{" (reboot pending)" if pending else ""}'
+    report(run_parallel(args.ports, job, args.jobs))
+
+
+def cmd_provision(args):
+    image = None
+    if args.patterns:
+        with open(args.patterns, 'rb') as f:
+            image = f.read()
+
+    def job(path):
+        with HostLink(path, args.baud, args.timeout) as link:
+            done = []
+            if args.set:
+                link.config_set(**dict(args.set))
+                done.append('settings staged')
+            if image is not None:
+                done.append(f'{link.upload_patterns(image)} patterns loaded')
+            _, pending = link.config_get()
+            if pending:
+                done.append('reboot to apply')
+            return ', '.join(done) or 'nothing to do'
+    report(run_parallel(args.ports, job, args.jobs))
+
+
+# Pins no ESP32-C3 prop can drive the signal from: no GPIO at all, the SPI flash (12), the
+# UART0 console (20); check --bad-pin adds the ones its profile gives to other features
+# (button, status LED, PIR inputs...)
+BAD_SIGNAL_PINS = (-1, 12, 20, 22, 48, 127)
+
+
+def check_config_set(link, bad_pins=BAD_SIGNAL_PINS):
+    """CONFIG_SET checks; returns a list of failures, empty if the prop passed.
+
+    A frame naming a bad signal pin must be refused with ESP_ERR_INVALID_ARG and leave the
+    staged settings alone: staging it would fail the output on every following boot. A valid
+    change must round trip. The prop ends with the settings it started with.
+    """
+    failures = []
+    before, _ = link.config_get()
+    for pin in bad_pins:
+        try:
+            link.config_set(signal_gpio=pin)
+            failures.append(f'signal_gpio={pin} accepted')
+        except HostLinkError as e:
+            if e.status != ESP_ERR_INVALID_ARG:
+                failures.append(f'signal_gpio={pin}: {e}')
+        after, _ = link.config_get()
+        if after != before:
+            failures.append(f'signal_gpio={pin} changed the staged settings to {after}')
+    try:
+        changed = dict(before, pulse_ms=before['pulse_ms'] + 1 if before['pulse_ms'] < 1000 else 500)
+        link.config_set(**changed)
+        after, _ = link.config_get()
+        if after != changed:
+            failures.append(f'staged {changed}, read back {after}')
+    except HostLinkError as e:
+        failures.append(f'valid settings refused: {e}')
+    finally:
+        link.config_set(**before)
+    return failures
+
+
+def cmd_check(args):
+    def job(path):
+        with HostLink(path, args.baud, args.timeout) as link:
+            failures = check_config_set(link, BAD_SIGNAL_PINS + tuple(args.bad_pin))
+            if failures:
+                raise HostLinkError('; '.join(failures))
+            return 'passed'
+    report(run_parallel(args.ports, job, args.jobs))
+
+
+def cmd_fire(args):
+    def job(path):
+        with HostLink(path, args.baud, args.timeout) as link:
+            link.fire(args.pulses, args.pattern)
+            return 'fired'
+    report(run_parallel(args.ports, job, args.jobs))
+
+
+def cmd_stats(args):
+    def job(path):
+        with HostLink(path, args.baud, args.timeout) as link:
+            lines = [' '.join(f'{k}={v}' for k, v in link.stats().items())]
+            if args.histogram:
+                lines += [f'  <= {upper:>9} us {count:8d}' for upper, count in link.histogram()]
+            return '\n'.join(lines)
+    report(run_parallel(args.ports, job, args.jobs))
+
+
+def cmd_logs(args):
+    lock = threading.Lock()
+    stop = threading.Event()
+
+    def on_log(path, line):
+        with lock:
+            print(f'{path}: {line}' if len(args.ports) > 1 else line, flush=True)
+
+    def job(path):
+        with HostLink(path, args.baud, args.timeout, on_log=on_log) as link:
+            link.stream_logs(True)
+            last = time.monotonic()
+            while not stop.is_set():
+                link.poll_logs(0.2)
+                # Any request keeps the session from going idle
+                if time.monotonic() - last > 2:
+                    link.hello()
+                    last = time.monotonic()
+            link.stream_logs(False)
+            return 'stopped'
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=len(args.ports)) as pool:
+        futures = [pool.submit(job, path) for path in args.ports]
+        try:
+            while not all(f.done() for f in futures):
+                time.sleep(0.2)
+        except KeyboardInterrupt:
+            stop.set()
+    for future in futures:
+        if future.exception():
+            print(f'FAILED {future.exception()}', file=sys.stderr)
+
+
+class TextConsole:
+    """The REPL as a person would use it: one command line, then wait for the prompt."""
+
+    def __init__(self, path, baud, prompt, timeout):
+        self.port = Port(path, baud)
+        self.prompt = prompt.encode()
+        self.timeout = timeout
+        self.run('')
+
+    def run(self, line):
+        self.port.write(line.encode() + b'\r')
+        out = bytearray()
+        deadline = time.monotonic() + self.timeout
+        while not out.endswith(self.prompt):
+            if time.monotonic() > deadline:
+                raise HostLinkError(f'no prompt after {line!r}')
+            out += self.port.read(deadline - time.monotonic())
+        return out.decode(errors='replace')
+
+
+def cmd_bench(args):
+    path = args.ports[0]
+    image = None
+    if args.patterns:
+        with open(args.patterns, 'rb') as f:
+            image = f.read()
+    rows = []
+
+    console = TextConsole(path, args.baud, args.prompt, args.timeout)
+    start, wire = time.perf_counter(), console.port.tx_bytes + console.port.rx_bytes
+    for _ in range(args.count):
+        console.run('trigger stats')
+    elapsed = time.perf_counter() - start
+    rows.append(('text', 'counter readout', args.count / elapsed,
+                 (console.port.tx_bytes + console.port.rx_bytes - wire) / args.count, 'reads/s'))
+    if image is not None:
+        start, wire = time.perf_counter(), console.port.tx_bytes + console.port.rx_bytes
+        console.run(f'pattern begin {len(image)}')
+        for offset in range(0, len(image), TEXT_CHUNK):
+            console.run(f'pattern data {offset} {image[offset:offset + TEXT_CHUNK].hex()}')
+        console.run('pattern commit')
+        elapsed = time.perf_counter() - start
+        rows.append(('text', 'pattern upload', len(image) / 1024 / elapsed,
+                     console.port.tx_bytes + console.port.rx_bytes - wire, 'KiB/s'))
+    console.port.close()
+
+    with HostLink(path, args.baud, args.timeout) as link:
+        start, wire = time.perf_counter(), link.port.tx_bytes + link.port.rx_bytes
+        for _ in range(args.count):
+            link.stats()
+        elapsed = time.perf_counter() - start
+        rows.append(('binary', 'counter readout', args.count / elapsed,
+                     (link.port.tx_bytes + link.port.rx_bytes - wire) / args.count, 'reads/s'))
+        if image is not None:
+            start, wire = time.perf_counter(), link.port.tx_bytes + link.port.rx_bytes
+            link.upload_patterns(image)
+            elapsed = time.perf_counter() - start
+            rows.append(('binary', 'pattern upload', len(image) / 1024 / elapsed,
+                         link.port.tx_bytes + link.port.rx_bytes - wire, 'KiB/s'))
+
+    # On a real UART the wire, not the host, sets the pace: 10 bit times per byte (8N1)
+    print(f'{"console":<8} {"task":<16} {"measured":>16} {"bytes":>8} {f"wire limit @{args.baud}":>22}')
+    for console_kind, task, rate, wire, unit in rows:
+        seconds = wire * 10 / args.baud
+        limit = 1 / seconds if unit == 'reads/s' else len(image) / 1024 / seconds
+        print(f'{console_kind:<8} {task:<16} {rate:8.1f} {unit:<7} {wire:>8.0f} {limit:14.1f} {unit}')
+    print('bytes are per read for the counter readout; a binary read also carries the limiter, scheduler and '
+          'event log counters')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--timeout', type=float, default=1.0, help='seconds to wait for an answer')
+    parser.add_argument('--jobs', type=int, default=32, help='devices driven at the same time')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    info = sub.add_parser('info')
+    info.set_defaults(func=cmd_info)
+
+    provision = sub.add_parser('provision')
+    provision.add_argument('--set', type=parse_setting, action='append', default=[],
+                           help=f'<name>=<value>, name one of {", ".join(SETTINGS_FIELDS)}')
+    provision.add_argument('--patterns', help='pattern library image from pattern_compile.py')
+    provision.set_defaults(func=cmd_provision)
+
+    fire = sub.add_parser('fire')
+    fire.add_argument('--pulses', type=int, default=1)
+    fire.add_argument('--pattern', type=int, default=0, help='library pattern id, 0 for plain pulses')
+    fire.set_defaults(func=cmd_fire)
+
+    stats = sub.add_parser('stats')
+    stats.add_argument('--histogram', action='store_true')
+    stats.set_defaults(func=cmd_stats)
+
+    check = sub.add_parser('check')
+    check.add_argument('--bad-pin', type=int, action='append', default=[],
+                       help='a GPIO the profile gives to another feature; must be refused as the signal pin')
+    check.set_defaults(func=cmd_check)
+
+    logs = sub.add_parser('logs')
+    logs.set_defaults(func=cmd_logs)
+
+    bench = sub.add_parser('bench')
+    bench.add_argument('--count', type=int, default=100, help='counter reads per console')
+    bench.add_argument('--patterns', help='pattern library image to upload both ways (replaces the library)')
+    bench.add_argument('--prompt', default='> ', help='end of the REPL prompt')
+    bench.set_defaults(func=cmd_bench)
+
+    for command in (info, provision, check, fire, stats, logs, bench):
+        command.add_argument('ports', nargs=1 if command is bench else '+', help='serial ports, e.g. /dev/ttyUSB0')
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Compile a text pattern spec into the pattern library image (main/app_pattern.h).
+
+Spec syntax, one statement per line, '#' starts a comment:
+
+    pattern <id>            start pattern <id> (1-255)
+    high <duration>         drive the signal line high
+    low <duration>          drive it low
+    repeat <n> ... end      repeat the enclosed steps n times (may nest)
+
+Durations take an 'us', 'ms' or 's' suffix, e.g. '250ms' or '1.5s'. The line returns
+to idle after the last step, so a trailing 'low' only delays the done callback.
+
+Commands:
+    compile    write the binary image; flash it with
+               parttool.py write_partition --partition-name patterns --input <image>
+    console    print the 'pattern begin/data/commit' lines that upload an image through
+               the serial console, for pasting or piping into a terminal
+    dump       print the contents of an image
+
+Example:
+    python tools/pattern_compile.py compile scares.txt -o patterns.bin
+    python tools/pattern_compile.py console patterns.bin > upload.txt
+    python tools/pattern_compile.py dump patterns.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4C504B53
+VERSION = 1
+HEADER = struct.Struct('<IHHII')
+ENTRY = struct.Struct('<HHIII')
+MAX_ID = 255
+MAX_STEPS = 0xFFFF
+MAX_DURATION_US = (1 << 31) - 1
+PARTITION_SIZE = 0xA000
+CONSOLE_CHUNK = 64
+
+UNITS = {'us': 1, 'ms': 1000, 's': 1000000}
+
+
+class SpecError(Exception):
+    pass
+
+
+def parse_duration(text, lineno):
+    match = re.fullmatch(r'(\d+(?:\.\d+)?)(us|ms|s)', text)
+    if not match:
+        raise SpecError(f'line {lineno}: bad duration {text!r}')
+    duration = round(float(match.group(1)) * UNITS[match.group(2)])
+    if not 0 < duration <= MAX_DURATION_US:
+        raise SpecError(f'line {lineno}: duration {text} out of range')
+    return duration
+
+
+def parse_spec(text):
+    """Returns {id: [(duration_us, level), ...]} in spec order."""
+    patterns = {}
+    stack = None        # [(steps, repeat count)], innermost last
+    current = None
+    for lineno, line in enumerate(text.splitlines(), 1):
+        words = line.split('#', 1)[0].split()
+        if not words:
+            continue
+        keyword, args = words[0], words[1:]
+        if keyword == 'pattern':
+            if stack and len(stack) > 1:
+                raise SpecError(f'line {lineno}: missing "end"')
+            if len(args) != 1 or not args[0].isdigit() or not 1 <= int(args[0]) <= MAX_ID:
+                raise SpecError(f'line {lineno}: expected "pattern <1-{MAX_ID}>"')
+            current = int(args[0])
+            if current in patterns:
+                raise SpecError(f'line {lineno}: pattern {current} defined twice')
+            patterns[current] = []
+            stack = [(patterns[current], 1)]
+        elif current is None:
+            raise SpecError(f'line {lineno}: "{keyword}" outside a pattern')
+        elif keyword in ('high', 'low'):
+            if len(args) != 1:
+                raise SpecError(f'line {lineno}: expected "{keyword} <duration>"')
+            stack[-1][0].append((parse_duration(args[0], lineno), 1 if keyword == 'high' else 0))
+        elif keyword == 'repeat':
+            if len(args) != 1 or not args[0].isdigit() or int(args[0]) < 1:
+                raise SpecError(f'line {lineno}: expected "repeat <count>"')
+            stack.append(([], int(args[0])))
+        elif keyword == 'end':
+            if len(stack) < 2:
+                raise SpecError(f'line {lineno}: "end" without "repeat"')
+            steps, count = stack.pop()
+            stack[-1][0].extend(steps * count)
+        else:
+            raise SpecError(f'line {lineno}: unknown statement "{keyword}"')
+    if stack and len(stack) > 1:
+        raise SpecError('missing "end" at end of file')
+    for pattern_id, steps in patterns.items():
+        if not steps:
+            raise SpecError(f'pattern {pattern_id} has no steps')
+        if len(steps) > MAX_STEPS:
+            raise SpecError(f'pattern {pattern_id} has {len(steps)} steps, at most {MAX_STEPS} fit')
+    return patterns
+
+
+def build_image(patterns):
+    offset = HEADER.size + len(patterns) * ENTRY.size
+    index = b''
+    steps_blob = b''
+    for pattern_id, steps in patterns.items():
+        high_us = sum(d for d, level in steps if level)
+        total_us = sum(d for d, _ in steps)
+        if total_us > 0xFFFFFFFF:
+            raise SpecError(f'pattern {pattern_id} is longer than {0xFFFFFFFF // 1000000} s')
+        index += ENTRY.pack(pattern_id, len(steps), offset + len(steps_blob), high_us, total_us)
+        steps_blob += b''.join(struct.pack('<I', d | (level << 31)) for d, level in steps)
+    body = index + steps_blob
+    length = HEADER.size + len(body)
+    return HEADER.pack(MAGIC, VERSION, len(patterns), length, zlib.crc32(body)) + body
+
+
+def parse_image(image):
+    """Inverse of build_image(), with the same checks as app_pattern_load()."""
+    if len(image) < HEADER.size:
+        raise SpecError('image too short')
+    magic, version, count, length, crc = HEADER.unpack_from(image)
+    if magic != MAGIC:
+        raise SpecError('bad magic')
+    if version != VERSION:
+        raise SpecError(f'unsupported version {version}')
+    if length > len(image) or length < HEADER.size + count * ENTRY.size:
+        raise SpecError('bad length')
+    if zlib.crc32(image[HEADER.size:length]) != crc:
+        raise SpecError('CRC mismatch')
+    patterns = {}
+    next_offset = HEADER.size + count * ENTRY.size
+    for i in range(count):
+        pattern_id, step_count, offset, high_us, total_us = ENTRY.unpack_from(image, HEADER.size + i * ENTRY.size)
+        if offset != next_offset:
+            raise SpecError(f'entry {i}: steps not packed after the index')
+        words = struct.unpack_from(f'<{step_count}I', image, offset)
+        patterns[pattern_id] = [(w & MAX_DURATION_US, w >> 31) for w in words]
+        next_offset += step_count * 4
+    if next_offset != length:
+        raise SpecError('bad length')
+    return patterns
+
+
+def cmd_compile(args):
+    with open(args.spec) as f:
+        patterns = parse_spec(f.read())
+    image = build_image(patterns)
+    if len(image) > PARTITION_SIZE:
+        raise SpecError(f'image is {len(image)} bytes, the partition holds {PARTITION_SIZE}')
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    print(f'{len(patterns)} patterns, {len(image)} bytes -> {args.output}')
+
+
+def cmd_console(args):
+    with open(args.image, 'rb') as f:
+        image = f.read()
+    parse_image(image)
+    print(f'pattern begin {len(image)}')
+    for offset in range(0, len(image), CONSOLE_CHUNK):
+        print(f'pattern data {offset} {image[offset:offset + CONSOLE_CHUNK].hex()}')
+    print('pattern commit')
+
+
+def cmd_dump(args):
+    with open(args.image, 'rb') as f:
+        patterns = parse_image(f.read())
+    for pattern_id, steps in patterns.items():
+        high_us = sum(d for d, level in steps if level)
+        total_us = sum(d for d, _ in steps)
+        print(f'pattern {pattern_id}: {len(steps)} steps, high {high_us / 1000:g} ms of {total_us / 1000:g} ms')
+        if args.verbose:
+            for duration, level in steps:
+                print(f'    {"high" if level else "low "} {duration}us')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    compile_ = sub.add_parser('compile')
+    compile_.add_argument('spec')
+    compile_.add_argument('-o', '--output', default='patterns.bin')
+    compile_.set_defaults(func=cmd_compile)
+
+    console = sub.add_parser('console')
+    console.add_argument('image')
+    console.set_defaults(func=cmd_console)
+
+    dump = sub.add_parser('dump')
+    dump.add_argument('image')
+    dump.add_argument('-v', '--verbose', action='store_true')
+    dump.set_defaults(func=cmd_dump)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except SpecError as e:
+        sys.exit(f'error: {e}')
+
+
+if __name__ == '__main__':
+    main()
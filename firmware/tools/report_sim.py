@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Simulate the OnOff subscription reports a prop sends per trigger, with and without
+CONFIG_SKULL_REPORT_COALESCE.
+
+Each subscription is modelled the way the Matter reporting engine treats it: a change
+marks the attribute dirty, and the report goes out at the later of the change and
+last report + min interval, carrying every change made so far. A subscription that
+has been quiet for its max interval gets an empty keep-alive report. Without
+coalescing a trigger marks OnOff dirty twice, ON when the command lands and OFF when
+the pulse ends. With coalescing it marks it dirty once.
+
+Subscriptions are given as min:max in seconds, one per fabric/controller.
+
+Example:
+    python tools/report_sim.py
+    python tools/report_sim.py --sub 0:60 --sub 1:300 --pulse-ms 500 --mean-gap 20 --props 30
+"""
+
+import argparse
+import random
+
+
+def simulate(changes, min_s, max_s, horizon):
+    """Returns (reports, keepalives) for one subscription over [0, horizon)."""
+    reports = 0
+    keepalives = 0
+    last = 0.0      # the priming report of the subscription
+    i = 0
+    while i < len(changes):
+        dirty = changes[i]
+        while last + max_s <= dirty:
+            last += max_s
+            keepalives += 1
+        last = max(dirty, last + min_s)
+        reports += 1
+        # Everything changed by the time the report is built goes out in it
+        while i < len(changes) and changes[i] <= last:
+            i += 1
+    if horizon > last:
+        keepalives += int((horizon - last) // max_s)
+    return reports, keepalives
+
+
+def trigger_times(count, mean_gap_s, pulse_s, seed):
+    rng = random.Random(seed)
+    times = []
+    t = 0.0
+    for _ in range(count):
+        # Retriggers inside a running pulse are ignored by the firmware, so keep them apart
+        t += max(rng.expovariate(1.0 / mean_gap_s), pulse_s + 0.001)
+        times.append(t)
+    return times
+
+
+def parse_sub(text):
+    min_s, max_s = (float(v) for v in text.split(':'))
+    if min_s < 0 or max_s <= 0 or max_s < min_s:
+        raise argparse.ArgumentTypeError(f'bad subscription {text!r}, expected min:max with max >= min')
+    return min_s, max_s
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--sub', type=parse_sub, action='append',
+                        help='subscription min:max interval in seconds (default: 0:60 1:300 0:3600)')
+    parser.add_argument('--pulse-ms', type=int, default=500)
+    parser.add_argument('--triggers', type=int, default=1000)
+    parser.add_argument('--mean-gap', type=float, default=30.0, help='mean seconds between triggers')
+    parser.add_argument('--props', type=int, default=1, help='devices sharing the access point')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+    subs = args.sub or [(0, 60), (1, 300), (0, 3600)]
+
+    pulse_s = args.pulse_ms / 1000
+    times = trigger_times(args.triggers, args.mean_gap, pulse_s, args.seed)
+    horizon = times[-1] + pulse_s + 1
+    plain = sorted(times + [t + pulse_s for t in times])
+
+    print(f'{args.triggers} triggers, {args.pulse_ms} ms pulses, mean gap {args.mean_gap:g} s, '
+          f'{horizon / 3600:.2f} h simulated')
+    print(f'{"subscription":>14} {"reports/trigger":>16} {"coalesced":>10} {"keep-alives":>12}')
+    totals = [0, 0]
+    for min_s, max_s in subs:
+        reports, keepalives = simulate(plain, min_s, max_s, horizon)
+        coalesced, keepalives_c = simulate(times, min_s, max_s, horizon)
+        totals[0] += reports + keepalives
+        totals[1] += coalesced + keepalives_c
+        print(f'{f"{min_s:g}:{max_s:g} s":>14} {reports / args.triggers:16.2f} {coalesced / args.triggers:10.2f} '
+              f'{keepalives:6d}/{keepalives_c:<5d}')
+    saved = totals[0] - totals[1]
+    print(f'all reports: {totals[0]} -> {totals[1]}, {saved} saved ({saved / args.triggers:.2f} per trigger)')
+    if args.props > 1:
+        hours = horizon / 3600
+        print(f'{args.props} props: {totals[0] * args.props / hours:.0f} -> {totals[1] * args.props / hours:.0f} '
+              f'reports per hour on the access point')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Simulate a scene firing several props and measure how far apart they go off.
+
+Every node gets the command after its own network delay, reads a wall clock that is off
+by its own offset and drifts by its own ppm, and runs the trigger scheduler the way
+app_sched.cpp does: the wheel starts at the moment of the first insert, an entry fires
+on the first tick at or after its time but never on a tick that has already run, and the
+esp_timer task adds a little dispatch latency. Three ways of firing are compared:
+
+  now     fire as the command lands (what a plain On/Off does)
+  delay   'trigger <ms>': the same delay on every node, so the network jitter remains
+  at      'trigger at <unix_ms>': a shared fire time, so only clock error and the tick remain
+
+The spread is the time between the first and the last node of a scene. test/test_app_sched.cpp
+runs a scene on app_sched.cpp itself and holds each node's fire time to the model in Node.fire().
+
+Example:
+    python tools/sched_sim.py
+    python tools/sched_sim.py --nodes 8 --offset-ms 5 --drift-ppm 40 --sync-age-s 600 --tick-ms 10
+"""
+
+import argparse
+import math
+import random
+
+
+class Node:
+    def __init__(self, rng, args):
+        # SNTP/Time Sync leaves a roughly normal offset; drift accumulates since the last sync
+        self.offset_us = rng.gauss(0, args.offset_ms * 1000)
+        self.drift_ppm = rng.uniform(-args.drift_ppm, args.drift_ppm)
+        self.sync_age_s = rng.uniform(0, args.sync_age_s)
+        self.tick_us = args.tick_ms * 1000
+
+    def clock_error_us(self):
+        return self.offset_us + self.drift_ppm * self.sync_age_s
+
+    def fire(self, arrival_us, fire_at_us, rng, dispatch_us):
+        """Real time at which a callback asked for fire_at_us (true time) goes off.
+
+        The node only knows its own view of time, so the target is shifted by its clock
+        error. The wheel starts at arrival with a random phase of the esp_timer tick.
+        """
+        local_target = fire_at_us - self.clock_error_us()
+        origin = arrival_us
+        next_tick = 1
+        ticks = next_tick
+        if local_target > origin:
+            ticks = max(next_tick, math.ceil((local_target - origin) / self.tick_us))
+        return origin + ticks * self.tick_us + rng.expovariate(1.0 / dispatch_us)
+
+
+def spread(times):
+    return max(times) - min(times)
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p / 100 * len(values)))]
+
+
+def run(args):
+    rng = random.Random(args.seed)
+    nodes = [Node(rng, args) for _ in range(args.nodes)]
+    results = {'now': [], 'delay': [], 'at': []}
+    for _ in range(args.scenes):
+        sent = 0.0
+        # A controller sends the scene to each node in turn; Wi-Fi adds a long-tailed delay
+        arrivals = [sent + i * args.fanout_ms * 1000 + rng.lognormvariate(math.log(args.net_ms * 1000), 0.8)
+                    for i in range(len(nodes))]
+        results['now'].append(spread([a + rng.expovariate(1.0 / args.dispatch_us) for a in arrivals]))
+        delay_us = args.lead_ms * 1000
+        results['delay'].append(spread([n.fire(a, a + delay_us, rng, args.dispatch_us)
+                                        for n, a in zip(nodes, arrivals)]))
+        fire_at = sent + args.lead_ms * 1000
+        fired = [n.fire(a, fire_at, rng, args.dispatch_us) for n, a in zip(nodes, arrivals)]
+        results['at'].append(spread(fired))
+        if any(a > fire_at for a in arrivals):
+            results.setdefault('late', []).append(1)
+    return nodes, results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--nodes', type=int, default=5)
+    parser.add_argument('--scenes', type=int, default=2000)
+    parser.add_argument('--tick-ms', type=int, default=1, help='CONFIG_SKULL_SCHED_TICK_MS')
+    parser.add_argument('--offset-ms', type=float, default=2.0, help='std deviation of the clock offset after sync')
+    parser.add_argument('--drift-ppm', type=float, default=20.0, help='worst crystal drift between syncs')
+    parser.add_argument('--sync-age-s', type=float, default=3600.0, help='longest time since the last sync')
+    parser.add_argument('--net-ms', type=float, default=30.0, help='median command delivery delay')
+    parser.add_argument('--fanout-ms', type=float, default=15.0, help='gap between commands to successive nodes')
+    parser.add_argument('--lead-ms', type=int, default=500, help='delay, or how far ahead the fire time is set')
+    parser.add_argument('--dispatch-us', type=float, default=50.0, help='mean esp_timer task dispatch latency')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+    if args.nodes < 2 or args.tick_ms < 1:
+        parser.error('need at least two nodes and a tick of 1 ms or more')
+
+    nodes, results = run(args)
+    errors = [n.clock_error_us() / 1000 for n in nodes]
+    print(f'{args.nodes} nodes, {args.scenes} scenes, {args.tick_ms} ms tick, lead {args.lead_ms} ms')
+    print('clock error per node (ms): ' + ' '.join(f'{e:+.2f}' for e in errors))
+    print(f'{"mode":>6} {"median":>10} {"p95":>10} {"p99":>10} {"worst":>10}  spread in ms')
+    for mode in ('now', 'delay', 'at'):
+        values = [v / 1000 for v in results[mode]]
+        print(f'{mode:>6} {percentile(values, 50):10.2f} {percentile(values, 95):10.2f} '
+              f'{percentile(values, 99):10.2f} {max(values):10.2f}')
+    late = len(results.get('late', []))
+    if late:
+        print(f'{late} scenes had a node receive the command after the fire time; raise --lead-ms')
+    bound = (max(errors) - min(errors)) + args.tick_ms
+    print(f'expected bound for "at": clock error range + one tick = {bound:.2f} ms, plus dispatch latency')
+
+
+if __name__ == '__main__':
+    main()
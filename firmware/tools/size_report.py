@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Build every device profile (CONFIG_SKULL_PROFILE_*) and compare its footprint with a
+kitchen-sink build that has every feature on.
+
+Each profile is built into build/size-<profile> with its own sdkconfig, layered on top of
+sdkconfig.defaults. For every build the report shows:
+
+    image       size of the application binary
+    flash       code and read-only data mapped from flash (.flash.* sections)
+    static RAM  .dram0/.iram0 sections: data, bss and IRAM code
+    heap        free internal heap at the "matter started" and "ble released" marks
+                (main/app_heap.h), taken from a captured boot log of that profile; the
+                column stays empty without --heap-log
+
+Run from the firmware directory with the ESP-IDF environment exported.
+
+Example:
+    python tools/size_report.py
+    python tools/size_report.py --skip-build --heap-log prop=prop_boot.log --heap-log minimal=min_boot.log
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+PROFILES = {
+    'minimal': ['CONFIG_SKULL_PROFILE_MINIMAL=y'],
+    'prop': ['CONFIG_SKULL_PROFILE_PROP=y'],
+    'sensor': ['CONFIG_SKULL_PROFILE_SENSOR=y'],
+    # Everything on, with pins moved so no two features share one
+    'kitchen-sink': [
+        'CONFIG_SKULL_PROFILE_CUSTOM=y',
+        'CONFIG_SKULL_UI_ENDPOINT=y',
+        'CONFIG_SKULL_STATUS_LED=y',
+        'CONFIG_SKULL_BENCH=y',
+        'CONFIG_SKULL_LINK_UART=y',
+        'CONFIG_SKULL_LINK_ACK_TIMEOUT_MS=50',
+        'CONFIG_SKULL_BUSY_INPUT=y',
+        'CONFIG_SKULL_PIR_INPUT=y',
+        'CONFIG_SKULL_PIR_COUNT=2',
+        'CONFIG_SKULL_SHTC3=y',
+        'CONFIG_SHTC3_I2C_SDA_PIN=6',
+        'CONFIG_SHTC3_I2C_SCL_PIN=7',
+        'CONFIG_SKULL_THERMAL=y',
+    ],
+}
+BASELINE = 'kitchen-sink'
+
+HEAP_MARKS = ('matter started', 'ble released')
+HEAP_LINE = re.compile(r'app_heap: (?P<mark>[^:]+): free (?P<free>\d+), min (?P<min>\d+), largest (?P<largest>\d+)')
+
+
+def project_name():
+    with open('CMakeLists.txt') as f:
+        match = re.search(r'project\((\S+?)\)', f.read())
+    if not match:
+        sys.exit('error: no project() in CMakeLists.txt, run from the firmware directory')
+    return match.group(1)
+
+
+def build(profile, lines, build_dir):
+    os.makedirs(build_dir, exist_ok=True)
+    fragment = os.path.join(build_dir, 'sdkconfig.profile')
+    with open(fragment, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    # A fresh sdkconfig each time, so a profile never inherits options from an older build
+    sdkconfig = os.path.join(build_dir, 'sdkconfig')
+    if os.path.exists(sdkconfig):
+        os.remove(sdkconfig)
+    print(f'building {profile} ...', file=sys.stderr)
+    subprocess.run(['idf.py', '-B', build_dir, f'-DSDKCONFIG={sdkconfig}',
+                    f'-DSDKCONFIG_DEFAULTS=sdkconfig.defaults;{fragment}', 'build'],
+                   check=True, stdout=subprocess.DEVNULL)
+
+
+def section_sizes(size_tool, elf):
+    """Returns (flash, static RAM) in bytes from the ELF section table."""
+    out = subprocess.run([size_tool, '-A', elf], check=True, capture_output=True, text=True).stdout
+    flash = ram = 0
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) < 2 or not fields[1].isdigit():
+            continue
+        name, size = fields[0], int(fields[1])
+        if name.startswith('.flash.'):
+            flash += size
+        elif name.startswith(('.dram0.', '.iram0.')):
+            ram += size
+    return flash, ram
+
+
+def heap_marks(path):
+    marks = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            match = HEAP_LINE.search(line)
+            if match and match.group('mark') in HEAP_MARKS:
+                marks.setdefault(match.group('mark'), int(match.group('free')))
+    return marks
+
+
+def parse_heap_log(text):
+    profile, sep, path = text.partition('=')
+    if not sep or profile not in PROFILES:
+        raise argparse.ArgumentTypeError(f'expected <profile>=<log>, profile one of {", ".join(PROFILES)}')
+    return profile, path
+
+
+def delta(value, base):
+    if value is None or base is None:
+        return ''
+    return f'{value - base:+d}'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--profile', action='append', choices=list(PROFILES),
+                        help='profile to report (default: all)')
+    parser.add_argument('--skip-build', action='store_true', help='report on the existing build/size-* builds')
+    parser.add_argument('--size-tool', default='riscv32-esp-elf-size',
+                        help='binutils size for the target (xtensa-esp32s3-elf-size for the ESP32-S3)')
+    parser.add_argument('--heap-log', type=parse_heap_log, action='append', default=[],
+                        help='<profile>=<boot log> captured with idf.py monitor')
+    args = parser.parse_args()
+
+    profiles = args.profile or list(PROFILES)
+    if BASELINE not in profiles:
+        profiles.append(BASELINE)
+    logs = dict(args.heap_log)
+    name = project_name()
+
+    rows = {}
+    for profile in profiles:
+        build_dir = os.path.join('build', f'size-{profile}')
+        if not args.skip_build:
+            build(profile, PROFILES[profile], build_dir)
+        image = os.path.getsize(os.path.join(build_dir, f'{name}.bin'))
+        flash, ram = section_sizes(args.size_tool, os.path.join(build_dir, f'{name}.elf'))
+        marks = heap_marks(logs[profile]) if profile in logs else {}
+        rows[profile] = [image, flash, ram] + [marks.get(mark) for mark in HEAP_MARKS]
+
+    headers = ['image', 'flash', 'static RAM'] + [f'heap @{mark}' for mark in HEAP_MARKS]
+    print(f'{"profile":<14}' + ''.join(f'{h:>22}' for h in headers))
+    base = rows[BASELINE]
+    for profile in profiles:
+        cells = []
+        for value, base_value in zip(rows[profile], base):
+            text = '' if value is None else str(value)
+            if profile != BASELINE and value is not None:
+                text += f' ({delta(value, base_value)})' if base_value is not None else ''
+            cells.append(f'{text:>22}')
+        print(f'{profile:<14}' + ''.join(cells))
+    print(f'bytes; changes are against {BASELINE}, heap is free internal heap (more is better)')
+
+
+if __name__ == '__main__':
+    main()
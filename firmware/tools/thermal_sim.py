@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Replay an enclosure temperature ramp against a trigger stream, with and without
+CONFIG_SKULL_THERMAL.
+
+The model follows the firmware: the sensor is sampled every --interval-ms and each
+sample sets the derating scale (app_thermal.cpp); every trigger then goes through the
+cutoff check, the pulse-width clamp and the rate limiter with its refill and duty budget
+scaled (app_limiter.cpp). Heat is counted as the HIGH time of accepted pulses.
+
+The ramp is a list of temp@minute points, linearly interpolated and held after the last
+one. Triggers come from --triggers-file (one time in seconds per line) or are generated
+with exponential gaps of mean --mean-gap seconds.
+
+Example:
+    python tools/thermal_sim.py
+    python tools/thermal_sim.py --ramp 30@0 58@20 63@40 35@60 --mean-gap 4 --pulse-ms 800
+"""
+
+import argparse
+import random
+
+DUTY_BUCKETS = 16
+
+
+class Curve:
+    def __init__(self, args):
+        self.start, self.full, self.cutoff = args.start, args.full, args.cutoff
+        self.floor, self.hysteresis, self.unknown = args.floor, args.hysteresis, args.unknown
+        self.cut_off = False
+
+    def scale(self, celsius):
+        if celsius is None:
+            self.cut_off = False
+            return self.unknown
+        dc = round(celsius * 10)
+        if dc >= self.cutoff * 10 or (self.cut_off and dc > (self.cutoff - self.hysteresis) * 10):
+            self.cut_off = True
+            return 0
+        self.cut_off = False
+        if dc <= self.start * 10:
+            return 100
+        if dc >= self.full * 10:
+            return self.floor
+        return 100 - (100 - self.floor) * (dc - self.start * 10) // ((self.full - self.start) * 10)
+
+
+class Limiter:
+    def __init__(self, burst, refill_ms, window_ms, max_duty_pct):
+        self.token_us = refill_ms * 1000
+        self.capacity_us = self.token_us * burst
+        self.credit_us = self.capacity_us
+        self.last_us = 0
+        self.scale = 100
+        self.bucket_us = window_ms * 1000 // DUTY_BUCKETS
+        self.budget_us = window_ms * 1000 * max_duty_pct // 100
+        self.current = 0
+        self.high = [0] * DUTY_BUCKETS
+
+    def _advance(self, now_us):
+        if now_us > self.last_us:
+            self.credit_us = min(self.capacity_us, self.credit_us + (now_us - self.last_us) * self.scale // 100)
+            self.last_us = now_us
+        index = now_us // self.bucket_us
+        if index - self.current >= DUTY_BUCKETS:
+            self.high = [0] * DUTY_BUCKETS
+            self.current = index
+        while self.current < index:
+            self.current += 1
+            self.high[self.current % DUTY_BUCKETS] = 0
+
+    def acquire(self, high_us, now_us, scale):
+        self._advance(now_us)
+        self.scale = scale
+        if self.credit_us < self.token_us:
+            return 'rate'
+        if sum(self.high) + high_us > self.budget_us * scale // 100:
+            return 'duty'
+        self.credit_us -= self.token_us
+        self.high[self.current % DUTY_BUCKETS] += high_us
+        return None
+
+
+def parse_point(text):
+    temp, minute = text.split('@')
+    return float(minute) * 60, float(temp)
+
+
+def temperature_at(ramp, t):
+    if t <= ramp[0][0]:
+        return ramp[0][1]
+    for (t0, c0), (t1, c1) in zip(ramp, ramp[1:]):
+        if t <= t1:
+            return c0 + (c1 - c0) * (t - t0) / (t1 - t0)
+    return ramp[-1][1]
+
+
+def run(args, ramp, triggers, derate):
+    curve = Curve(args)
+    limiter = Limiter(args.burst, args.refill_ms, args.window_ms, args.max_duty)
+    scale = args.unknown if derate else 100
+    next_sample = 0.0
+    phases = {}
+    for t in triggers:
+        while next_sample <= t:
+            if derate:
+                scale = curve.scale(temperature_at(ramp, next_sample))
+            next_sample += args.interval_ms / 1000
+        phase = phases.setdefault(int(t // args.phase_s), {'offered': 0, 'accepted': 0, 'rate': 0, 'duty': 0,
+                                                            'thermal': 0, 'high_s': 0.0, 'min_scale': 100})
+        phase['offered'] += 1
+        phase['min_scale'] = min(phase['min_scale'], scale)
+        if scale == 0:
+            phase['thermal'] += 1
+            continue
+        pulse_ms = args.pulse_ms
+        if scale < 100:
+            pulse_ms = min(pulse_ms, max(50, args.max_pulse_ms * scale // 100))
+        verdict = limiter.acquire(pulse_ms * 1000, int(t * 1e6), scale)
+        if verdict:
+            phase[verdict] += 1
+        else:
+            phase['accepted'] += 1
+            phase['high_s'] += pulse_ms / 1000
+    return phases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--ramp', nargs='+', type=parse_point, default=None,
+                        help='temperature points temp@minute (default: 30@0 50@20 62@35 62@45 30@75)')
+    parser.add_argument('--triggers-file', help='trigger times in seconds, one per line')
+    parser.add_argument('--mean-gap', type=float, default=5.0, help='mean seconds between generated triggers')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--phase-s', type=float, default=300, help='report granularity in seconds')
+    parser.add_argument('--interval-ms', type=int, default=5000, help='SHTC3 polling interval')
+    parser.add_argument('--pulse-ms', type=int, default=500)
+    curve = parser.add_argument_group('derating curve (CONFIG_SKULL_THERMAL_*)')
+    curve.add_argument('--start', type=int, default=40)
+    curve.add_argument('--full', type=int, default=55)
+    curve.add_argument('--floor', type=int, default=25)
+    curve.add_argument('--cutoff', type=int, default=60)
+    curve.add_argument('--hysteresis', type=int, default=3)
+    curve.add_argument('--unknown', type=int, default=100)
+    curve.add_argument('--max-pulse-ms', type=int, default=1000)
+    limit = parser.add_argument_group('rate limiter (CONFIG_SKULL_LIMIT_*)')
+    limit.add_argument('--burst', type=int, default=3)
+    limit.add_argument('--refill-ms', type=int, default=2000)
+    limit.add_argument('--window-ms', type=int, default=60000)
+    limit.add_argument('--max-duty', type=int, default=25)
+    args = parser.parse_args()
+    if not args.start < args.full < args.cutoff:
+        parser.error('the curve needs start < full < cutoff')
+
+    ramp = sorted(args.ramp or [parse_point(p) for p in ('30@0', '50@20', '62@35', '62@45', '30@75')])
+    horizon = ramp[-1][0]
+    if args.triggers_file:
+        with open(args.triggers_file) as f:
+            triggers = sorted(float(line) for line in f if line.strip())
+    else:
+        rng = random.Random(args.seed)
+        triggers, t = [], 0.0
+        while True:
+            t += rng.expovariate(1.0 / args.mean_gap)
+            if t >= horizon:
+                break
+            triggers.append(t)
+
+    plain = run(args, ramp, triggers, derate=False)
+    derated = run(args, ramp, triggers, derate=True)
+    print(f'{len(triggers)} triggers over {horizon / 60:g} min, {args.pulse_ms} ms pulses')
+    print(f'{"minute":>7} {"temp C":>7} {"budget":>7} {"offered":>8} {"accepted":>13} {"rate":>9} {"duty":>9} '
+          f'{"cutoff":>7} {"HIGH s":>13}')
+    for index in sorted(derated):
+        p, d = plain[index], derated[index]
+        start = index * args.phase_s
+        print(f'{start / 60:7g} {temperature_at(ramp, start):7.1f} {d["min_scale"]:6d}% {d["offered"]:8d} '
+              f'{p["accepted"]:6d}/{d["accepted"]:<6d} {p["rate"]:4d}/{d["rate"]:<4d} {p["duty"]:4d}/{d["duty"]:<4d} '
+              f'{d["thermal"]:7d} {p["high_s"]:6.1f}/{d["high_s"]:<6.1f}')
+    total_plain = sum(p['high_s'] for p in plain.values())
+    total_derated = sum(d['high_s'] for d in derated.values())
+    print(f'HIGH time: {total_plain:.1f} s -> {total_derated:.1f} s with derating '
+          f'({100 * (1 - total_derated / total_plain) if total_plain else 0:.0f}% less heat); '
+          'columns are without/with derating')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,578 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Decode an input trace printed by the `trace dump` console command (main/app_trace.h) and
+replay it on the host.
+
+The replay feeds the recorded inputs, at their recorded esp_timer times, through a model of
+the trigger logic in app_main.cpp: the dedupe window (app_dedupe.cpp), the scheduler wheel
+(app_sched.cpp), PIR occupancy and hold (app_pir.cpp), button gestures, the running-pulse and
+busy-line checks, thermal derating and the rate limiter (the Curve and Limiter models of
+thermal_sim.py). Time is simulated, so the same trace and options always give the same GPIO
+edge timeline; its SHA-256 turns a field trace into a regression benchmark. Every decision is
+compared with the TRIGGER and IGNORED records the device wrote, per source in order, and the
+latency of each source is reported as the device measured it (request to pulse start) and from
+the input to the rising edge.
+
+A rising edge lands one start latency after its request: the one the device recorded for the
+same trigger, the median of the device's when it did not fire, or --latency-us for all. Library
+patterns play step by step from --patterns; without an image each one is a single high of the
+width the device recorded for it.
+
+The model has to agree with the firmware: firmware/test/test_trace_replay.py runs the same
+modules, built for the host, on the traces in firmware/test/traces and compares the decisions
+(--decisions) and the edge timelines.
+
+Options default to the Kconfig defaults; --sdkconfig reads CONFIG_SKULL_* from a build's
+sdkconfig instead, and options given on the command line override both. The pulse width,
+PIR hold, busy level and thermal scale come from the trace's first record.
+
+Commands:
+    decode     print the records
+    replay     replay the trace; prints the edge timeline digest, the decisions that differ
+               from the device's and the latency per source. Exits 1 on a difference.
+
+Example:
+    idf.py monitor | tee monitor.log          # then `trace dump` on the console
+    python tools/trace_replay.py decode monitor.log
+    python tools/trace_replay.py replay --sdkconfig sdkconfig --edges edges.txt monitor.log
+    python tools/trace_replay.py replay --patterns patterns.bin --latency-us 40 monitor.log
+"""
+
+import argparse
+import collections
+import hashlib
+import heapq
+import math
+import re
+import struct
+import sys
+
+from pattern_compile import parse_image
+from thermal_sim import Curve, Limiter
+
+TRACE_VERSION = 1
+RECORD = struct.Struct('<qBBHI')
+HEADER_RE = re.compile(r'trace v(\d+): (\d+) records, (\d+) overwritten, utc offset (-?\d+ us|unknown)')
+RECORD_RE = re.compile(r'trace ([0-9a-f]{32})\b')
+
+START, ONOFF, CONTROL, PIR_EDGE, BUTTON, BUSY, TEMPERATURE, FIRE, TRIGGER, IGNORED = range(1, 11)
+TYPES = {START: 'start', ONOFF: 'onoff', CONTROL: 'control', PIR_EDGE: 'pir', BUTTON: 'button', BUSY: 'busy',
+         TEMPERATURE: 'temperature', FIRE: 'fire', TRIGGER: 'trigger', IGNORED: 'ignored'}
+TRIGGER_DELAY, TRIGGER_AT_UTC, PULSE_DURATION, TRIGGER_PATTERN = range(4)
+CONTROLS = ['TriggerDelay', 'TriggerAtUtc', 'PulseDuration', 'TriggerPattern']
+
+MATTER, SCHEDULED, CONSOLE, MOTION, BUTTON_SRC, HOST = range(6)
+SOURCES = ['matter', 'scheduled', 'console', 'motion', 'button', 'host']
+REASONS = ['busy', 'duplicate', 'rate', 'duty', 'playing', 'thermal']
+GESTURES = ['single', 'double', 'triple', 'long hold', 'long press']
+
+PULSE_MS_MIN, PULSE_MS_MAX = 50, 5000       # app_settings.h
+DEDUPE_TABLE_SIZE = 8                       # app_dedupe.h
+MAX_BURST_PULSES = 3                        # APP_GESTURE_MAX_CLICKS
+NO_READING = -32768
+
+Record = collections.namedtuple('Record', 'time_us type arg a b')
+Trace = collections.namedtuple('Trace', 'records overwritten utc_offset_us')
+
+# option dest -> (sdkconfig symbol, default)
+KCONFIG = {
+    'pulse_ms': ('CONFIG_SKULL_PULSE_DURATION_MS', 500),
+    'pir_hold_s': ('CONFIG_PIR_OCCUPIED_TO_UNOCCUPIED_DELAY_SECONDS', 10),
+    'dedupe_window_ms': ('CONFIG_SKULL_DEDUPE_WINDOW_MS', 300),
+    'sched_tick_ms': ('CONFIG_SKULL_SCHED_TICK_MS', 1),
+    'sched_max_pending': ('CONFIG_SKULL_SCHED_MAX_PENDING', 16),
+    'sched_max_delay_ms': ('CONFIG_SKULL_SCHED_MAX_DELAY_MS', 3600000),
+    'burst_gap_ms': ('CONFIG_SKULL_BUTTON_BURST_GAP_MS', 250),
+    'button_trigger': ('CONFIG_SKULL_BUTTON_TRIGGER', True),
+    'pir_trigger': ('CONFIG_SKULL_PIR_TRIGGER', False),
+    'thermal': ('CONFIG_SKULL_THERMAL', True),
+    'start': ('CONFIG_SKULL_THERMAL_DERATE_START_C', 40),
+    'full': ('CONFIG_SKULL_THERMAL_DERATE_FULL_C', 55),
+    'floor': ('CONFIG_SKULL_THERMAL_MIN_SCALE_PCT', 25),
+    'cutoff': ('CONFIG_SKULL_THERMAL_CUTOFF_C', 60),
+    'hysteresis': ('CONFIG_SKULL_THERMAL_HYSTERESIS_C', 3),
+    'unknown': ('CONFIG_SKULL_THERMAL_UNKNOWN_SCALE_PCT', 100),
+    'max_pulse_ms': ('CONFIG_SKULL_THERMAL_MAX_PULSE_MS', 1000),
+    'burst': ('CONFIG_SKULL_LIMIT_BURST', 3),
+    'refill_ms': ('CONFIG_SKULL_LIMIT_REFILL_MS', 2000),
+    'window_ms': ('CONFIG_SKULL_LIMIT_DUTY_WINDOW_MS', 60000),
+    'max_duty': ('CONFIG_SKULL_LIMIT_MAX_DUTY_PCT', 25),
+}
+
+
+def parse_log(lines):
+    """Records of the last dump in a console log; earlier dumps are superseded."""
+    records, overwritten, offset = None, 0, None
+    for line in lines:
+        match = HEADER_RE.search(line)
+        if match:
+            if int(match.group(1)) != TRACE_VERSION:
+                raise ValueError(f'unsupported trace version {match.group(1)}')
+            records, overwritten = [], int(match.group(3))
+            offset = None if match.group(4) == 'unknown' else int(match.group(4).split()[0])
+            continue
+        match = RECORD_RE.search(line)
+        if match and records is not None:
+            records.append(Record(*RECORD.unpack(bytes.fromhex(match.group(1)))))
+    if records is None:
+        raise ValueError('no "trace v1:" header found')
+    return Trace(records, overwritten, offset)
+
+
+def celsius_of(record):
+    """The reading app_thermal_update() saw, rounded to deci-degrees the way it does."""
+    if record.a == NO_READING + 0x10000:
+        return None
+    value = struct.unpack('<f', struct.pack('<I', record.b))[0]
+    if math.isnan(value):
+        return None
+    scaled = struct.unpack('<f', struct.pack('<f', value * 10))[0]     # float arithmetic, as on the device
+    dc = math.copysign(math.floor(abs(scaled) + 0.5), scaled)          # lroundf()
+    return dc / 10
+
+
+def describe(record):
+    kind, arg, a, b = record.type, record.arg, record.a, record.b
+    if kind == START:
+        return f'pulse {a} ms, PIR hold {b & 0xFFFF} s, thermal scale {(b >> 16) & 0xFF}%, busy {arg}'
+    if kind == ONOFF:
+        return f'endpoint {arg} {"ON" if a else "OFF"}'
+    if kind == CONTROL:
+        name = CONTROLS[arg] if arg < len(CONTROLS) else f'control {arg}'
+        return f'{name} = {a << 32 | b if arg == TRIGGER_AT_UTC else b}'
+    if kind == PIR_EDGE:
+        return f'PIR {arg} {"high" if a else "low"}'
+    if kind == BUTTON:
+        name = GESTURES[arg] if arg < len(GESTURES) else f'gesture {arg}'
+        return f'{name}, press {b} us before'
+    if kind == BUSY:
+        return 'busy' if a else 'idle'
+    if kind == TEMPERATURE:
+        celsius = celsius_of(record)
+        return 'no reading' if celsius is None else f'{struct.unpack("<f", struct.pack("<I", b))[0]:.2f} C'
+    if kind == FIRE:
+        return f'{source_name(arg)}: pattern {b}' if b else f'{source_name(arg)}: {a} pulse(s)'
+    if kind == TRIGGER:
+        return f'{source_name(arg)}: {device_decision(record)}, started after {b & 0xFFFFFF} us'
+    if kind == IGNORED:
+        return f'{source_name(arg)}: {device_decision(record)}'
+    return f'arg {arg}, a {a}, b {b}'
+
+
+def source_name(source):
+    return SOURCES[source] if source < len(SOURCES) else f'source {source}'
+
+
+def device_decision(record):
+    if record.type == IGNORED:
+        return REASONS[record.a] if record.a < len(REASONS) else f'reason {record.a}'
+    pulses = record.b >> 24
+    return f'pulse {record.a} ms x{pulses}' if pulses else f'pattern, {record.a} ms high'
+
+
+def percentiles(values):
+    ordered = sorted(values)
+    # Nearest rank
+    return tuple(ordered[max(0, math.ceil(p * len(ordered)) - 1)] for p in (0.5, 0.9, 0.99, 1.0))
+
+
+class Replay:
+    def __init__(self, trace, args, patterns):
+        self.args = args
+        self.patterns = patterns
+        self.utc_offset_us = trace.utc_offset_us
+        self.pulse_ms = args.pulse_ms
+        self.hold_us = args.pir_hold_s * 1000000
+        self.busy = False
+        self.curve = Curve(args)
+        self.scale = 100
+        self.limiter = Limiter(args.burst, args.refill_ms, args.window_ms, args.max_duty)
+        self.dedupe = [None] * DEDUPE_TABLE_SIZE
+        self.dedupe_next = 0
+        self.timers = []
+        self.timer_seq = 0
+        self.sched_pending = 0
+        self.sched_origin_us = 0
+        self.hold_at = None
+        self.pir_occupied = False
+        self.pir_mask = 0
+        self.active_until = -1
+        self.edges = []
+        self.notes = collections.Counter()
+        # The device's outcomes per source, paired in order with the replay's decisions
+        self.device = collections.defaultdict(collections.deque)
+        for record in trace.records:
+            if record.type in (TRIGGER, IGNORED):
+                self.device[record.arg].append(record)
+        latencies = sorted(r.b & 0xFFFFFF for r in trace.records if r.type == TRIGGER)
+        self.default_latency_us = latencies[len(latencies) // 2] if latencies else 0
+        self.pairs = []         # (time, source, replay decision, device decision or None)
+        self.input_to_edge = collections.defaultdict(list)
+
+    # Timers run before any input recorded at the same time
+    def add_timer(self, time_us, kind, data=None):
+        self.timer_seq += 1
+        heapq.heappush(self.timers, (time_us, self.timer_seq, kind, data))
+
+    def run_timers(self, until_us):
+        while self.timers and self.timers[0][0] <= until_us:
+            time_us, _, kind, data = heapq.heappop(self.timers)
+            if kind == 'sched':
+                self.sched_pending -= 1
+                self.start_trigger(time_us, SCHEDULED, 1, 0, input_us=data)
+            elif kind == 'hold' and self.hold_at == time_us:
+                self.hold_at = None
+                if self.pir_occupied and self.pir_mask == 0:
+                    self.pir_occupied = False
+
+    def run(self, records):
+        for record in records:
+            self.run_timers(record.time_us)
+            self.handle(record)
+        self.notes['scheduled triggers still pending at the end'] += self.sched_pending
+
+    def handle(self, r):
+        t = r.time_us
+        if r.type == START:
+            self.busy = bool(r.arg)
+            self.pulse_ms = r.a
+            self.hold_us = (r.b & 0xFFFF) * 1000000
+            self.scale = (r.b >> 16) & 0xFF if self.args.thermal else 100
+            self.curve.cut_off = self.scale == 0
+        elif r.type == ONOFF:
+            if self.is_duplicate(r.arg, bool(r.a), t):
+                if r.a:
+                    self.decide(t, MATTER, 'duplicate')
+            elif r.a:
+                self.start_trigger(t, MATTER, 1, 0)
+            else:
+                self.stop(t)
+        elif r.type == CONTROL:
+            self.control(t, r)
+        elif r.type == PIR_EDGE:
+            self.pir_edge(t, r.arg, bool(r.a))
+        elif r.type == BUTTON:
+            if r.arg <= 2 and self.args.button_trigger:
+                clicks = r.arg + 1
+                if self.has_pattern(clicks, BUTTON_SRC):
+                    self.start_trigger(t, BUTTON_SRC, 1, clicks, input_us=t - r.b)
+                else:
+                    self.start_trigger(t, BUTTON_SRC, clicks, 0, input_us=t - r.b)
+            elif r.arg == 4:
+                self.notes['factory resets (the replay carries on)'] += 1
+        elif r.type == BUSY:
+            self.busy = bool(r.a)
+        elif r.type == TEMPERATURE:
+            if self.args.thermal:
+                self.scale = self.curve.scale(celsius_of(r))
+        elif r.type == FIRE:
+            self.start_trigger(t, r.arg, r.a, r.b)
+
+    def is_duplicate(self, endpoint, value, now_us):
+        window_us = self.args.dedupe_window_ms * 1000
+        for entry in self.dedupe:
+            if entry and entry[1] == endpoint and entry[2] == value and now_us - entry[0] < window_us:
+                return True
+        # Accepting a value ends the window of the opposite one on the same endpoint
+        self.dedupe = [None if entry and entry[1] == endpoint and entry[2] != value else entry
+                       for entry in self.dedupe]
+        self.dedupe[self.dedupe_next] = (now_us, endpoint, value)
+        self.dedupe_next = (self.dedupe_next + 1) % DEDUPE_TABLE_SIZE
+        return False
+
+    def control(self, t, r):
+        if r.arg == TRIGGER_DELAY:
+            self.schedule(t, t + r.b * 1000)
+        elif r.arg == TRIGGER_AT_UTC:
+            if self.utc_offset_us is None:
+                self.notes['TriggerAtUtc writes skipped: the dump had no UTC offset'] += 1
+                return
+            self.schedule(t, (r.a << 32 | r.b) * 1000 - self.utc_offset_us)
+        elif r.arg == PULSE_DURATION:
+            if PULSE_MS_MIN <= r.b <= PULSE_MS_MAX:
+                self.pulse_ms = r.b
+        elif r.arg == TRIGGER_PATTERN and r.b != 0:
+            self.start_trigger(t, MATTER, 1, r.b)
+
+    def schedule(self, now_us, fire_at_us):
+        args = self.args
+        if fire_at_us - now_us > args.sched_max_delay_ms * 1000:
+            self.notes['scheduled triggers rejected: too far ahead'] += 1
+            return
+        if self.sched_pending >= args.sched_max_pending:
+            self.notes['scheduled triggers dropped: scheduler full'] += 1
+            return
+        # The wheel restarts at tick 0 when it was idle and fires on the first tick at or after
+        # the requested time that has not run yet
+        tick_us = args.sched_tick_ms * 1000
+        if self.sched_pending == 0:
+            self.sched_origin_us = now_us
+        next_tick = (now_us - self.sched_origin_us) // tick_us + 1
+        target = max(next_tick, -(-(fire_at_us - self.sched_origin_us) // tick_us))
+        self.sched_pending += 1
+        self.add_timer(self.sched_origin_us + target * tick_us, 'sched', fire_at_us)
+
+    def pir_edge(self, t, sensor, level):
+        # The recorded edges are the ones app_pir accepted, already debounced
+        bit = 1 << sensor
+        started = False
+        if level:
+            started = not self.pir_occupied
+            self.pir_occupied = True
+            self.pir_mask |= bit
+            self.hold_at = None
+        else:
+            self.pir_mask &= ~bit
+            self.hold_at = t + self.hold_us if self.pir_occupied and self.pir_mask == 0 else None
+            if self.hold_at is not None:
+                self.add_timer(self.hold_at, 'hold')
+        if started and self.args.pir_trigger:
+            self.start_trigger(t, MOTION, 1, 0)
+
+    def has_pattern(self, pattern_id, source):
+        if self.patterns is not None:
+            return pattern_id in self.patterns
+        pending = self.device[source]
+        return bool(pending) and pending[0].type == TRIGGER and pending[0].b >> 24 == 0
+
+    def pattern_steps(self, pattern_id, source):
+        if self.patterns is not None:
+            return self.patterns.get(pattern_id)
+        pending = self.device[source]
+        if pending and pending[0].type == TRIGGER and pending[0].b >> 24 == 0:
+            return [(pending[0].a * 1000, 1)]
+        return [(self.pulse_ms * 1000, 1)]
+
+    def start_trigger(self, t, source, pulses, pattern_id, input_us=None):
+        steps = None
+        if pattern_id != 0:
+            steps = self.pattern_steps(pattern_id, source)
+            if steps is None:
+                self.notes[f'pattern {pattern_id} not in the library'] += 1
+                return
+        if t < self.active_until:
+            return self.decide(t, source, 'busy')
+        if self.busy:
+            return self.decide(t, source, 'playing')
+        scale = self.scale if self.args.thermal else 100
+        if scale == 0:
+            return self.decide(t, source, 'thermal')
+        pulse_ms = self.pulse_ms
+        if scale < 100:
+            pulse_ms = min(pulse_ms, max(PULSE_MS_MIN, self.args.max_pulse_ms * scale // 100))
+        if steps is not None:
+            high_us = sum(d for d, level in steps if level)
+        else:
+            high_us = pulses * pulse_ms * 1000
+        verdict = self.limiter.acquire(high_us, t, scale)
+        if verdict:
+            return self.decide(t, source, verdict)
+        if steps is not None:
+            decision = f'pattern, {min(high_us // 1000, 0xFFFF)} ms high'
+        else:
+            pulses = min(max(pulses, 1), MAX_BURST_PULSES)
+            steps = []
+            for i in range(pulses):
+                if i:
+                    steps.append((self.args.burst_gap_ms * 1000, 0))
+                steps.append((pulse_ms * 1000, 1))
+            decision = f'pulse {pulse_ms} ms x{pulses}'
+        device = self.decide(t, source, decision)
+        if self.args.latency_us is not None:
+            latency_us = self.args.latency_us
+        elif device is not None and device.type == TRIGGER:
+            latency_us = device.b & 0xFFFFFF
+        else:
+            latency_us = self.default_latency_us
+        start_us = t + latency_us
+        self.play(start_us, steps)
+        self.input_to_edge[source].append(start_us - (t if input_us is None else input_us))
+
+    def play(self, start_us, steps):
+        now, level = start_us, 0
+        for duration_us, step_level in steps:
+            if step_level != level:
+                self.edges.append((now, step_level))
+                level = step_level
+            now += duration_us
+        if level:
+            self.edges.append((now, 0))
+        self.active_until = now
+
+    def stop(self, t):
+        if t >= self.active_until:
+            return
+        while self.edges and self.edges[-1][0] > t:
+            self.edges.pop()
+        if self.edges and self.edges[-1][1]:
+            self.edges.append((t, 0))
+        self.active_until = t
+
+    def decide(self, t, source, decision):
+        pending = self.device[source]
+        device = pending.popleft() if pending else None
+        self.pairs.append((t, source, decision, device_decision(device) if device else None))
+        return device
+
+
+def load_trace(path):
+    with open(path, errors='replace') as f:
+        trace = parse_log(f)
+    if not trace.records:
+        raise ValueError('the dump holds no records')
+    return trace
+
+
+def cmd_decode(args):
+    trace = load_trace(args.log)
+    t0 = trace.records[0].time_us
+    offset = 'unknown' if trace.utc_offset_us is None else f'{trace.utc_offset_us} us'
+    print(f'{len(trace.records)} records, {trace.overwritten} overwritten, UTC offset {offset}')
+    for record in trace.records:
+        name = TYPES.get(record.type, f'type {record.type}')
+        print(f'{(record.time_us - t0) / 1e6:12.6f} {name:<12} {describe(record)}')
+    return 0
+
+
+def write_output(path, text):
+    if path == '-':
+        sys.stdout.write(text)
+    elif path:
+        with open(path, 'w') as f:
+            f.write(text)
+
+
+def cmd_replay(args):
+    trace = load_trace(args.log)
+    patterns = None
+    if args.patterns:
+        with open(args.patterns, 'rb') as f:
+            patterns = parse_image(f.read())
+    if trace.overwritten or trace.records[0].type != START:
+        print(f'warning: the ring overwrote {trace.overwritten} records; the replay starts from the '
+              'options instead of the recorded state', file=sys.stderr)
+
+    replay = Replay(trace, args, patterns)
+    replay.run(trace.records)
+
+    t0 = trace.records[0].time_us
+    timeline = ''.join(f'{t - t0} {level}\n' for t, level in replay.edges)
+    write_output(args.edges, timeline)
+    write_output(args.decisions, ''.join(f'{t - t0} {source_name(source)} {decision}\n'
+                                         for t, source, decision, _ in replay.pairs))
+    span_s = (trace.records[-1].time_us - t0) / 1e6
+    print(f'{len(trace.records)} records over {span_s:.3f} s, {len(replay.edges)} GPIO edges, '
+          f'sha256 {hashlib.sha256(timeline.encode()).hexdigest()}')
+
+    mismatches = [p for p in replay.pairs if p[2] != p[3]]
+    unmatched = sum(len(pending) for pending in replay.device.values())
+    print(f'{len(replay.pairs)} decisions, {len(replay.pairs) - len(mismatches)} as on the device, '
+          f'{len(mismatches)} differ, {unmatched} device outcomes left unmatched')
+    for t, source, decision, device in mismatches[:args.show]:
+        print(f'  {(t - t0) / 1e6:12.6f} {source_name(source):<9} replay: {decision:<24} device: {device or "-"}')
+    for source, pending in replay.device.items():
+        for record in list(pending)[:args.show]:
+            print(f'  {(record.time_us - t0) / 1e6:12.6f} {source_name(source):<9} replay: {"-":<24} '
+                  f'device: {device_decision(record)}')
+    for note, count in sorted(replay.notes.items()):
+        if count:
+            print(f'{note}: {count}')
+
+    device_latency = collections.defaultdict(list)
+    for record in trace.records:
+        if record.type == TRIGGER:
+            device_latency[record.arg].append(record.b & 0xFFFFFF)
+    print(f'{"source":<10} {"fired":>6} {"start us p50/p90/p99/max":>28} {"input to edge us p50/p90/p99/max":>38}')
+    for source in sorted(set(device_latency) | set(replay.input_to_edge)):
+        device = device_latency.get(source)
+        edge = replay.input_to_edge.get(source)
+        start_text = '/'.join(str(v) for v in percentiles(device)) if device else '-'
+        edge_text = '/'.join(str(v) for v in percentiles(edge)) if edge else '-'
+        print(f'{source_name(source):<10} {len(edge or []):6d} {start_text:>28} {edge_text:>38}')
+    return 1 if mismatches or unmatched else 0
+
+
+def read_sdkconfig(path):
+    values = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            match = re.fullmatch(r'# (CONFIG_\w+) is not set', line)
+            if match:
+                values[match.group(1)] = False
+            elif line.startswith('CONFIG_') and '=' in line:
+                name, value = line.split('=', 1)
+                if value == 'y':
+                    values[name] = True
+                elif re.fullmatch(r'-?\d+', value):
+                    values[name] = int(value)
+    # A bool missing from an sdkconfig is off; an int missing is one whose menu was hidden
+    return {dest: values.get(symbol, False if isinstance(default, bool) else default)
+            for dest, (symbol, default) in KCONFIG.items()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    decode = sub.add_parser('decode', help='print the records')
+    decode.add_argument('log', help='console log holding the output of `trace dump`')
+    decode.set_defaults(func=cmd_decode)
+
+    replay = sub.add_parser('replay', help='replay the trace against the trigger model')
+    replay.add_argument('log', help='console log holding the output of `trace dump`')
+    replay.add_argument('--sdkconfig', help='take the defaults below from this sdkconfig')
+    replay.add_argument('--patterns', help='pattern library image (tools/pattern_compile.py) the device runs')
+    replay.add_argument('--latency-us', type=int, help='start every pulse this long after its request')
+    replay.add_argument('--edges', help="write the edge timeline (us from the first record, level) here, '-' for stdout")
+    replay.add_argument('--decisions', help="write the replay's decisions (us from the first record, source, "
+                        "decision) here, '-' for stdout")
+    replay.add_argument('--show', type=int, default=10, help='differences to list')
+    device = replay.add_argument_group('device settings, used when the trace lost its first record')
+    device.add_argument('--pulse-ms', type=int)
+    device.add_argument('--pir-hold-s', type=int)
+    model = replay.add_argument_group('trigger logic (CONFIG_SKULL_*)')
+    model.add_argument('--dedupe-window-ms', type=int)
+    model.add_argument('--sched-tick-ms', type=int)
+    model.add_argument('--sched-max-pending', type=int)
+    model.add_argument('--sched-max-delay-ms', type=int)
+    model.add_argument('--burst-gap-ms', type=int)
+    model.add_argument('--button-trigger', action=argparse.BooleanOptionalAction)
+    model.add_argument('--pir-trigger', action=argparse.BooleanOptionalAction)
+    curve = replay.add_argument_group('derating curve (CONFIG_SKULL_THERMAL_*)')
+    curve.add_argument('--thermal', action=argparse.BooleanOptionalAction)
+    curve.add_argument('--start', type=int)
+    curve.add_argument('--full', type=int)
+    curve.add_argument('--floor', type=int)
+    curve.add_argument('--cutoff', type=int)
+    curve.add_argument('--hysteresis', type=int)
+    curve.add_argument('--unknown', type=int)
+    curve.add_argument('--max-pulse-ms', type=int)
+    limit = replay.add_argument_group('rate limiter (CONFIG_SKULL_LIMIT_*)')
+    limit.add_argument('--burst', type=int)
+    limit.add_argument('--refill-ms', type=int)
+    limit.add_argument('--window-ms', type=int)
+    limit.add_argument('--max-duty', type=int)
+    replay.set_defaults(func=cmd_replay)
+
+    args = parser.parse_args()
+    if args.command == 'replay':
+        defaults = read_sdkconfig(args.sdkconfig) if args.sdkconfig else \
+            {dest: default for dest, (_, default) in KCONFIG.items()}
+        for dest, value in defaults.items():
+            if getattr(args, dest) is None:
+                setattr(args, dest, value)
+    try:
+        sys.exit(args.func(args))
+    except (OSError, ValueError) as e:
+        sys.exit(f'error: {e}')
+
+
+if __name__ == '__main__':
+    main()
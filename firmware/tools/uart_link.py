@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+
+"""Host side of the framed UART link to the animatronic controller (main/app_link.h).
+
+Commands:
+    loopback   send frames through a pseudo-terminal to an emulated controller that
+               acks them, and check every frame arrives intact and in order
+    bench      frame throughput and ack round-trip over the pseudo-terminal, next to
+               the time the GPIO pulse approach needs to select the same track
+    listen     decode frames from a real serial port (needs pyserial) and ack them
+
+Example:
+    python tools/uart_link.py loopback --count 1000
+    python tools/uart_link.py bench --baud 115200 --pulse-ms 500 --track 7
+    python tools/uart_link.py listen --port /dev/ttyUSB0 --baud 115200
+"""
+
+import argparse
+import os
+import statistics
+import struct
+import sys
+import threading
+import time
+import tty
+
+SOF = 0xA5
+MAX_PAYLOAD = 16
+CMD_PLAY = 0x01
+CMD_STOP = 0x02
+ACK = 0x80
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as app_link_crc16()."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def encode(seq, cmd, payload=b''):
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError('payload too long')
+    body = bytes([len(payload) + 2, seq & 0xFF, cmd]) + payload
+    return bytes([SOF]) + body + struct.pack('>H', crc16(body))
+
+
+def encode_play(seq, track, volume=200, effect=0):
+    return encode(seq, CMD_PLAY, struct.pack('<HBB', track, volume, effect))
+
+
+class Parser:
+    """Byte-at-a-time decoder with the same resynchronisation rules as app_link_parse()."""
+
+    def __init__(self):
+        self.state = 'sof'
+        self.buf = bytearray()
+        self.errors = 0
+
+    def feed(self, data):
+        frames = []
+        for byte in data:
+            if self.state == 'sof':
+                if byte == SOF:
+                    self.state = 'len'
+                else:
+                    self.errors += 1
+            elif self.state == 'len':
+                if 2 <= byte <= MAX_PAYLOAD + 2:
+                    self.buf = bytearray([byte])
+                    self.state = 'body'
+                else:
+                    self.state = 'len' if byte == SOF else 'sof'
+                    self.errors += 1
+            else:
+                self.buf.append(byte)
+                if len(self.buf) < self.buf[0] + 3:
+                    continue
+                self.state = 'sof'
+                covered = self.buf[0] + 1
+                if struct.unpack('>H', self.buf[covered:covered + 2])[0] != crc16(self.buf[:covered]):
+                    self.errors += len(self.buf) + 1
+                    continue
+                frames.append((self.buf[1], self.buf[2], bytes(self.buf[3:covered])))
+        return frames
+
+
+def open_pty_pair():
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    return master, slave
+
+
+def controller(fd, stop, received, ack):
+    """Emulated animatronic controller: optionally acks every valid frame with status 0."""
+    parser = Parser()
+    try:
+        while not stop.is_set():
+            for seq, cmd, payload in parser.feed(os.read(fd, 256)):
+                received.append((seq, cmd, payload))
+                if ack:
+                    os.write(fd, encode(seq, cmd | ACK, b'\x00'))
+    except OSError:
+        pass  # pty closed
+
+
+def run_link(count, ack):
+    """Send count PLAY frames host -> controller; return (received, rtts_us, elapsed_s, errors)."""
+    host, device = open_pty_pair()
+    stop = threading.Event()
+    received = []
+    thread = threading.Thread(target=controller, args=(device, stop, received, ack), daemon=True)
+    thread.start()
+
+    parser = Parser()
+    rtts = []
+    start = time.perf_counter()
+    for i in range(count):
+        frame = encode_play(i, track=i % 1000, volume=i % 256, effect=i % 4)
+        sent = time.perf_counter()
+        os.write(host, frame)
+        if not ack:
+            continue
+        acked = False
+        while not acked:
+            for seq, cmd, _ in parser.feed(os.read(host, 256)):
+                if cmd == CMD_PLAY | ACK and seq == i & 0xFF:
+                    rtts.append((time.perf_counter() - sent) * 1e6)
+                    acked = True
+    elapsed = time.perf_counter() - start
+    if not ack:
+        deadline = time.time() + 5
+        while len(received) < count and time.time() < deadline:
+            time.sleep(0.01)
+    stop.set()
+    os.close(host)
+    os.close(device)
+    return received, rtts, elapsed, parser.errors
+
+
+def cmd_loopback(args):
+    received, _, _, errors = run_link(args.count, ack=True)
+    for i, (seq, cmd, payload) in enumerate(received):
+        expected = encode_play(i, track=i % 1000, volume=i % 256, effect=i % 4)
+        if (seq, cmd, payload) != (expected[2], expected[3], expected[4:-2]):
+            sys.exit(f'frame {i} corrupted: {seq} {cmd} {payload.hex()}')
+    if len(received) != args.count or errors:
+        sys.exit(f'{len(received)}/{args.count} frames received, {errors} bytes discarded')
+
+    # Resynchronisation: garbage and a corrupted frame in front of a good one
+    parser = Parser()
+    bad = bytearray(encode_play(1, 2))
+    bad[5] ^= 0xFF
+    frames = parser.feed(b'\x00\xA5\xFF' + bytes(bad) + encode_play(2, 3))
+    if [f[0] for f in frames] != [2]:
+        sys.exit('parser did not resynchronise')
+    print(f'loopback ok: {args.count} frames acked in order')
+
+
+def cmd_bench(args):
+    frame_len = len(encode_play(0, args.track))
+    wire_us = frame_len * 10 * 1e6 / args.baud   # 8N1
+
+    received, rtts, elapsed, _ = run_link(args.count, ack=False)
+    _, rtts, _, _ = run_link(min(args.count, 2000), ack=True)
+
+    # A plain GPIO line selects a track by counting pulses: track n costs n pulses
+    # plus gaps of the same width, and the last one still has to be recognised as last.
+    pulse_select_ms = (2 * args.track) * args.pulse_ms
+
+    print(f'frame: {frame_len} bytes, {wire_us:.0f} us on the wire at {args.baud} baud')
+    print(f'pty throughput: {len(received) / elapsed:.0f} frames/s ({len(received)} frames)')
+    print(f'ack round-trip over pty: median {statistics.median(rtts):.0f} us, '
+          f'p99 {sorted(rtts)[int(len(rtts) * 0.99) - 1]:.0f} us')
+    print(f'select track {args.track}: {wire_us / 1000:.2f} ms as a frame vs '
+          f'{pulse_select_ms} ms as {args.pulse_ms} ms pulses')
+
+
+def cmd_listen(args):
+    try:
+        import serial
+    except ImportError:
+        sys.exit('listen needs pyserial: pip install pyserial')
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    parser = Parser()
+    while True:
+        for seq, cmd, payload in parser.feed(port.read(256)):
+            if cmd == CMD_PLAY and len(payload) == 4:
+                track, volume, effect = struct.unpack('<HBB', payload)
+                print(f'#{seq} PLAY track={track} volume={volume} effect={effect}')
+            else:
+                print(f'#{seq} cmd=0x{cmd:02x} payload={payload.hex()}')
+            if not args.no_ack:
+                port.write(encode(seq, cmd | ACK, b'\x00'))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    loopback = sub.add_parser('loopback')
+    loopback.add_argument('--count', type=int, default=1000)
+    loopback.set_defaults(func=cmd_loopback)
+
+    bench = sub.add_parser('bench')
+    bench.add_argument('--count', type=int, default=10000)
+    bench.add_argument('--baud', type=int, default=115200)
+    bench.add_argument('--pulse-ms', type=int, default=500)
+    bench.add_argument('--track', type=int, default=7)
+    bench.set_defaults(func=cmd_bench)
+
+    listen = sub.add_parser('listen')
+    listen.add_argument('--port', required=True)
+    listen.add_argument('--baud', type=int, default=115200)
+    listen.add_argument('--no-ack', action='store_true')
+    listen.set_defaults(func=cmd_listen)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()